@@ -29,11 +29,19 @@ def get_appsi_extension(in_setup=False, appsi_root=None):
         for file_ in (
             'interval.cpp',
             'expression.cpp',
+            'repn.cpp',
             'common.cpp',
             'nl_writer.cpp',
+            'nl_stream.cpp',
+            'buffered_sink.cpp',
+            'sol_reader.cpp',
             'lp_writer.cpp',
+            'memory_report.cpp',
             'model_base.cpp',
             'fbbt_model.cpp',
+            'mccormick.cpp',
+            'codegen.cpp',
+            'snapshot.cpp',
             'cmodel_bindings.cpp',
         )
     ]
@@ -46,10 +54,18 @@ def get_appsi_extension(in_setup=False, appsi_root=None):
         # Assume that builds on Windows will use MSVC
         # MSVC doesn't have a flag for c++11, use c++14
         extra_args = ['/std:c++14']
+        extra_link_args = []
     else:
         # Assume all other platforms are GCC-like
-        extra_args = ['-std=c++11']
-    return Pybind11Extension(package_name, sources, extra_compile_args=extra_args)
+        # the NL writer formats segments with std::thread
+        extra_args = ['-std=c++11', '-pthread']
+        extra_link_args = ['-pthread']
+    return Pybind11Extension(
+        package_name,
+        sources,
+        extra_compile_args=extra_args,
+        extra_link_args=extra_link_args,
+    )
 
 
 def build_appsi(args=[]):
@@ -0,0 +1,144 @@
+/**___________________________________________________________________________
+ *
+ * Pyomo: Python Optimization Modeling Objects
+ * Copyright (c) 2008-2024
+ * National Technology and Engineering Solutions of Sandia, LLC
+ * Under the terms of Contract DE-NA0003525 with National Technology and
+ * Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+ * rights in this software.
+ * This software is distributed under the 3-clause BSD License.
+ * ___________________________________________________________________________
+**/
+
+#include "buffered_sink.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+int format_int(long long val, char *buf) {
+  char digits[20];
+  int n_digits = 0;
+  // work with the negative value so that LLONG_MIN does not overflow
+  long long v = (val < 0) ? val : -val;
+  do {
+    digits[n_digits++] = '0' - (char)(v % 10);
+    v /= 10;
+  } while (v != 0);
+  int n = 0;
+  if (val < 0)
+    buf[n++] = '-';
+  while (n_digits > 0)
+    buf[n++] = digits[--n_digits];
+  return n;
+}
+
+// Writes m / 10^n_decimals with n_decimals digits after the decimal point
+static int format_fixed(long long m, int n_decimals, char *buf) {
+  char digits[20];
+  int n = format_int(m, digits);
+  int n_sign = (m < 0) ? 1 : 0;
+  int n_int = n - n_sign - n_decimals;
+  int res = 0;
+  if (n_sign)
+    buf[res++] = '-';
+  if (n_int <= 0) {
+    buf[res++] = '0';
+    buf[res++] = '.';
+    for (; n_int < 0; ++n_int)
+      buf[res++] = '0';
+    std::memcpy(buf + res, digits + n_sign, n - n_sign);
+    return res + n - n_sign;
+  }
+  std::memcpy(buf + res, digits + n_sign, n_int);
+  res += n_int;
+  buf[res++] = '.';
+  std::memcpy(buf + res, digits + n_sign + n_int, n_decimals);
+  return res + n_decimals;
+}
+
+int format_double(double val, char *buf) {
+  if (std::isnan(val)) {
+    std::memcpy(buf, "nan", 3);
+    return 3;
+  }
+  if (std::isinf(val)) {
+    if (val < 0) {
+      std::memcpy(buf, "-inf", 4);
+      return 4;
+    }
+    std::memcpy(buf, "inf", 3);
+    return 3;
+  }
+  // integral values (very common for bounds and coefficients)
+  if (val == std::floor(val) && std::abs(val) < 1e15) {
+    if (val == 0 && std::signbit(val)) {
+      std::memcpy(buf, "-0", 2);
+      return 2;
+    }
+    return format_int((long long)val, buf);
+  }
+  // Short decimals (e.g., 0.25 or -1.375) are written without snprintf. If
+  // the integer m = val * 10^k for the smallest k reads back as val after
+  // dividing by 10^k, m with the decimal point k digits from the right is
+  // what %.15g gives (m has at most 15 digits and val is within half an ulp
+  // of it). %g only uses this notation for 1e-4 <= |val| < 1e15.
+  static const double pow10[] = {1e1,  1e2,  1e3,  1e4,  1e5,  1e6,
+                                  1e7,  1e8,  1e9,  1e10, 1e11, 1e12,
+                                  1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+  if (std::abs(val) >= 1e-4) {
+    double scaled;
+    for (int k = 0; k < 18; ++k) {
+      scaled = std::round(val * pow10[k]);
+      if (std::abs(scaled) >= 1e15)
+        break;
+      if (scaled / pow10[k] == val)
+        return format_fixed((long long)scaled, k + 1, buf);
+    }
+  }
+  // Every double is recovered from 17 significant digits, and most from
+  // 15; %g drops trailing zeros, so values like 0.1 stay short. snprintf
+  // and strtod use the "C" locale unless the program changes LC_NUMERIC.
+  int n;
+  for (int precision = 15; precision < 17; ++precision) {
+    n = std::snprintf(buf, 32, "%.*g", precision, val);
+    if (std::strtod(buf, nullptr) == val)
+      return n;
+  }
+  return std::snprintf(buf, 32, "%.17g", val);
+}
+
+BufferedSink::BufferedSink(std::ostream &_out, size_t _capacity)
+    : out(&_out), capacity(_capacity) {
+  buffer.reserve(capacity);
+}
+
+BufferedSink::~BufferedSink() { flush(); }
+
+void BufferedSink::put_int(long long val) {
+  char buf[21];
+  write(buf, format_int(val, buf));
+}
+
+void BufferedSink::put_double(double val) {
+  char buf[32];
+  write(buf, format_double(val, buf));
+}
+
+void BufferedSink::flush() {
+  if (out != nullptr && !buffer.empty()) {
+    out->write(buffer.data(), buffer.size());
+    buffer.clear();
+  }
+}
+
+std::string BufferedSink::release() {
+  std::string res;
+  res.swap(buffer);
+  return res;
+}
+
+BufferedSink &BufferedSink::operator<<(const char *s) {
+  write(s, std::strlen(s));
+  return *this;
+}
@@ -0,0 +1,92 @@
+/**___________________________________________________________________________
+ *
+ * Pyomo: Python Optimization Modeling Objects
+ * Copyright (c) 2008-2024
+ * National Technology and Engineering Solutions of Sandia, LLC
+ * Under the terms of Contract DE-NA0003525 with National Technology and
+ * Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+ * rights in this software.
+ * This software is distributed under the 3-clause BSD License.
+ * ___________________________________________________________________________
+**/
+
+#ifndef BUFFERED_SINK_HEADER
+#define BUFFERED_SINK_HEADER
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+// Write a decimal representation of val that reads back as exactly val
+// into buf, which must hold at least 32 characters. Integral values are
+// written as integers; other values use the fewest of 15, 16, or 17
+// significant digits that round-trip, without trailing zeros. Returns the
+// number of characters written.
+int format_double(double val, char *buf);
+
+// Write the decimal representation of val into buf, which must hold at
+// least 21 characters. Returns the number of characters written.
+int format_int(long long val, char *buf);
+
+// Output buffer for the file writers. Numbers are formatted with
+// format_double and format_int instead of iostreams. Without a target
+// stream, everything is kept in memory; with one, the buffer is written to
+// the stream whenever it holds more than capacity bytes and on flush().
+class BufferedSink {
+public:
+  BufferedSink() = default;
+  BufferedSink(std::ostream &_out, size_t _capacity = 1 << 20);
+  ~BufferedSink();
+  void put(char c) { buffer.push_back(c); }
+  void write(const char *s, size_t n) {
+    buffer.append(s, n);
+    if (out != nullptr && buffer.size() >= capacity)
+      flush();
+  }
+  void put_int(long long val);
+  void put_double(double val);
+  void flush();
+  // the bytes that have not been written to the target stream yet
+  const std::string &str() { return buffer; }
+  std::string release();
+  BufferedSink &operator<<(const std::string &s) {
+    write(s.data(), s.size());
+    return *this;
+  }
+  BufferedSink &operator<<(const char *s);
+  BufferedSink &operator<<(char c) {
+    put(c);
+    return *this;
+  }
+  BufferedSink &operator<<(int val) {
+    put_int(val);
+    return *this;
+  }
+  BufferedSink &operator<<(unsigned int val) {
+    put_int(val);
+    return *this;
+  }
+  BufferedSink &operator<<(long val) {
+    put_int(val);
+    return *this;
+  }
+  BufferedSink &operator<<(unsigned long val) {
+    put_int(val);
+    return *this;
+  }
+  BufferedSink &operator<<(long long val) {
+    put_int(val);
+    return *this;
+  }
+  BufferedSink &operator<<(double val) {
+    put_double(val);
+    return *this;
+  }
+
+private:
+  std::string buffer;
+  std::ostream *out = nullptr;
+  size_t capacity = 0;
+};
+
+#endif
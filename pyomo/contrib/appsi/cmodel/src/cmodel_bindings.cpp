@@ -10,16 +10,49 @@
  * ___________________________________________________________________________
  **/
 
+#include "codegen.hpp"
 #include "expression.hpp"
 #include "fbbt_model.hpp"
 #include "interval.hpp"
 #include "lp_writer.hpp"
+#include "mccormick.hpp"
 #include "model_base.hpp"
 #include "nl_writer.hpp"
+#include "repn.hpp"
+#include "snapshot.hpp"
+#include "sol_reader.hpp"
+#include <pybind11/numpy.h>
 //#include "profiler.h"
 
 extern double inf;
 
+// a NumPy array that shares memory with the first n elements of a member of
+// the object wrapped by self (which becomes the base of the array)
+template <typename T>
+static py::array_t<T> array_view(py::object self, std::vector<T> &vec,
+                                 size_t n) {
+  return py::array_t<T>(n, vec.data(), self);
+}
+
+template <typename T>
+static py::array_t<T> array_view(py::object self, std::vector<T> &vec) {
+  return array_view(self, vec, vec.size());
+}
+
+// the getter of a read-only property that returns the vector member of C as
+// an array_view
+template <typename C, typename T> struct ArrayMember {
+  std::vector<T> C::*member;
+  py::array_t<T> operator()(py::object self) const {
+    return array_view(self, self.cast<C &>().*member);
+  }
+};
+
+template <typename C, typename T>
+static ArrayMember<C, T> array_member(std::vector<T> C::*member) {
+  return ArrayMember<C, T>{member};
+}
+
 PYBIND11_MODULE(appsi_cmodel, m) {
   inf = py::module_::import("math").attr("inf").cast<double>();
   m.attr("inf") = inf;
@@ -55,6 +88,7 @@ PYBIND11_MODULE(appsi_cmodel, m) {
   m.def("process_lp_constraints", &process_lp_constraints);
   m.def("process_lp_objective", &process_lp_objective);
   m.def("process_nl_constraints", &process_nl_constraints);
+  m.def("process_nl_objective", &process_nl_objective);
   m.def("process_fbbt_constraints", &process_fbbt_constraints);
   m.def("process_pyomo_vars", &process_pyomo_vars);
   m.def("create_vars", &create_vars);
@@ -63,8 +97,27 @@ PYBIND11_MODULE(appsi_cmodel, m) {
   m.def("appsi_exprs_from_pyomo_exprs", &appsi_exprs_from_pyomo_exprs);
   m.def("appsi_expr_from_pyomo_expr", &appsi_expr_from_pyomo_expr);
   m.def("prep_for_repn", &prep_for_repn);
+  m.def("generate_standard_repn", &generate_standard_repn, py::arg("expr"),
+        py::arg("var_map"), py::arg("param_map"), py::arg("expr_types"),
+        py::arg("quadratic") = true);
+  m.def("generate_c_code", &generate_c_code);
   py::class_<PyomoExprTypes>(m, "PyomoExprTypes", py::module_local())
       .def(py::init<>());
+  py::class_<StandardRepn>(m, "StandardRepn")
+      .def_readonly("constant", &StandardRepn::constant)
+      .def_readonly("linear_coefs", &StandardRepn::linear_coefs)
+      .def_readonly("linear_vars", &StandardRepn::linear_vars)
+      .def_readonly("quadratic_coefs", &StandardRepn::quadratic_coefs)
+      .def_readonly("quadratic_vars_1", &StandardRepn::quadratic_vars_1)
+      .def_readonly("quadratic_vars_2", &StandardRepn::quadratic_vars_2)
+      .def("get_nonlinear_expr",
+           [](StandardRepn &repn, py::dict var_map, py::dict param_map,
+              PyomoExprTypes &expr_types) -> py::object {
+             if (!repn.has_nonlinear())
+               return py::none();
+             return py::cast(
+                 repn.get_nonlinear_expr(var_map, param_map, expr_types));
+           });
   py::class_<Node, std::shared_ptr<Node>>(m, "Node")
       .def("is_variable_type", &Node::is_variable_type)
       .def("is_param_type", &Node::is_param_type)
@@ -117,11 +170,54 @@ PYBIND11_MODULE(appsi_cmodel, m) {
       .def_readwrite("name", &Constraint::name)
       .def(py::init<>());
   py::class_<Model>(m, "Model")
-      .def_readwrite("constraints", &Model::constraints)
+      .def_property_readonly(
+          "constraints", [](Model &m) { return m.constraints.to_vector(); })
       .def_readwrite("objective", &Model::objective)
       .def("add_constraint", &Model::add_constraint)
       .def("remove_constraint", &Model::remove_constraint)
+      .def("add_constraints", &Model::add_constraints)
+      .def("remove_constraints", &Model::remove_constraints)
+      .def("add_dependencies", &Model::add_dependencies)
+      .def("get_dependents", &Model::get_dependents)
+      .def("mark_dirty", &Model::mark_dirty)
+      .def("find_changed_values", &Model::find_changed_values)
+      .def("get_dirty_leaves", &Model::get_dirty_leaves)
+      .def("get_dirty_constraints", &Model::get_dirty_constraints)
+      .def("clear_dirty", &Model::clear_dirty)
+      .def("memory_report", &Model::memory_report)
       .def(py::init<>());
+  // the subgradients share memory with the McCormickRelaxation, so they are
+  // updated in place by the next evaluation
+  py::class_<McCormickRelaxation>(m, "McCormickRelaxation")
+      .def(py::init<std::shared_ptr<ExpressionBase>,
+                    std::vector<std::shared_ptr<Var>>>())
+      .def("evaluate", &McCormickRelaxation::evaluate)
+      .def("evaluate_from_bounds",
+           [](McCormickRelaxation &r,
+              py::array_t<double, py::array::c_style | py::array::forcecast>
+                  lbs,
+              py::array_t<double, py::array::c_style | py::array::forcecast>
+                  ubs) {
+             if ((size_t)lbs.size() != r.n_operators() ||
+                 (size_t)ubs.size() != r.n_operators())
+               throw py::value_error(
+                   "evaluate_from_bounds: expected the bounds of " +
+                   std::to_string(r.n_operators()) + " operators");
+             std::vector<double> _lbs(lbs.data(), lbs.data() + lbs.size());
+             std::vector<double> _ubs(ubs.data(), ubs.data() + ubs.size());
+             r.evaluate_from_bounds(_lbs.data(), _ubs.data());
+           })
+      .def_property_readonly("n_operators", &McCormickRelaxation::n_operators)
+      .def_readonly("lb", &McCormickRelaxation::lb)
+      .def_readonly("ub", &McCormickRelaxation::ub)
+      .def_readonly("cv", &McCormickRelaxation::cv)
+      .def_readonly("cc", &McCormickRelaxation::cc)
+      .def_property_readonly(
+          "cv_subgradient",
+          array_member(&McCormickRelaxation::cv_subgradient))
+      .def_property_readonly(
+          "cc_subgradient",
+          array_member(&McCormickRelaxation::cc_subgradient));
   py::class_<FBBTObjective, Objective, std::shared_ptr<FBBTObjective>>(
       m, "FBBTObjective")
       .def_readwrite("expr", &FBBTObjective::expr)
@@ -143,7 +239,8 @@ PYBIND11_MODULE(appsi_cmodel, m) {
       .def(py::init<std::shared_ptr<ExpressionBase>,
                     std::vector<std::shared_ptr<ExpressionBase>>,
                     std::vector<std::shared_ptr<Var>>,
-                    std::shared_ptr<ExpressionBase>>());
+                    std::shared_ptr<ExpressionBase>>())
+      .def_readwrite("dual", &NLConstraint::dual);
   py::class_<NLObjective, NLBase, Objective, std::shared_ptr<NLObjective>>(
       m, "NLObjective")
       .def(py::init<std::shared_ptr<ExpressionBase>,
@@ -152,9 +249,70 @@ PYBIND11_MODULE(appsi_cmodel, m) {
                     std::shared_ptr<ExpressionBase>>());
   py::class_<NLWriter, Model>(m, "NLWriter")
       .def(py::init<>())
-      .def("write", &NLWriter::write)
+      .def("write", &NLWriter::write, py::arg("filename"),
+           py::arg("binary") = false, py::arg("n_threads") = 1,
+           py::arg("streaming") = false)
+      .def(
+          "write_to_bytes",
+          [](NLWriter &w, bool binary, int n_threads, bool streaming) {
+            return py::bytes(w.write_to_string(binary, n_threads, streaming));
+          },
+          py::arg("binary") = false, py::arg("n_threads") = 1,
+          py::arg("streaming") = false)
       .def("get_solve_cons", &NLWriter::get_solve_cons)
-      .def("get_solve_vars", &NLWriter::get_solve_vars);
+      .def("get_solve_vars", &NLWriter::get_solve_vars)
+      .def("convert_nonlinear_expr",
+           static_cast<std::shared_ptr<ExpressionBase> (NLWriter::*)(
+               py::handle, py::handle, py::handle, PyomoExprTypes &)>(
+               &NLWriter::convert_nonlinear_expr))
+      .def("load_solution", &NLWriter::load_solution)
+      .def("set_duals",
+           [](NLWriter &w,
+              py::array_t<double, py::array::c_style | py::array::forcecast>
+                  duals) { w.set_duals(duals.data(), duals.size()); })
+      .def("get_jacobian", &NLWriter::get_jacobian);
+  // the arrays share memory with the NLJacobian/SolFile/SolSuffix (passed
+  // as base); the objective row of the NLJacobian is not exposed
+  py::class_<NLJacobian, std::shared_ptr<NLJacobian>>(m, "NLJacobian")
+      .def_property_readonly("shape",
+                             [](NLJacobian &j) {
+                               return py::make_tuple(j.n_rows, j.n_cols);
+                             })
+      .def_property_readonly("indptr",
+                             [](py::object self) {
+                               NLJacobian &j = self.cast<NLJacobian &>();
+                               return array_view(self, j.indptr,
+                                                 j.n_rows + 1);
+                             })
+      .def_property_readonly("indices",
+                             [](py::object self) {
+                               NLJacobian &j = self.cast<NLJacobian &>();
+                               return array_view(self, j.indices,
+                                                 j.indptr[j.n_rows]);
+                             })
+      .def_property_readonly("values", array_member(&NLJacobian::values));
+  py::class_<SolSuffix>(m, "SolSuffix")
+      .def_readonly("kind", &SolSuffix::kind)
+      .def_readonly("is_real", &SolSuffix::is_real)
+      .def_readonly("name", &SolSuffix::name)
+      .def_property_readonly("indices", array_member(&SolSuffix::indices))
+      .def_property_readonly("values", array_member(&SolSuffix::values));
+  py::class_<SolFile, std::shared_ptr<SolFile>>(m, "SolFile")
+      .def_readonly("message", &SolFile::message)
+      .def_readonly("options", &SolFile::options)
+      .def_readonly("n_cons", &SolFile::n_cons)
+      .def_readonly("n_vars", &SolFile::n_vars)
+      .def_readonly("objno", &SolFile::objno)
+      .def_readonly("solve_result_num", &SolFile::solve_result_num)
+      .def_property_readonly("duals", array_member(&SolFile::duals))
+      .def_property_readonly("primals", array_member(&SolFile::primals))
+      .def("has_suffix", &SolFile::has_suffix)
+      .def("get_suffix", &SolFile::get_suffix,
+           py::return_value_policy::reference_internal);
+  m.def("read_sol", &read_sol);
+  m.def("read_sol_from_bytes", [](py::bytes content) {
+    return read_sol_from_string(content.cast<std::string>());
+  });
   py::class_<LPBase, std::shared_ptr<LPBase>>(m, "LPBase");
   py::class_<LPConstraint, LPBase, Constraint, std::shared_ptr<LPConstraint>>(
       m, "LPConstraint")
@@ -162,10 +320,45 @@ PYBIND11_MODULE(appsi_cmodel, m) {
   py::class_<LPObjective, LPBase, Objective, std::shared_ptr<LPObjective>>(
       m, "LPObjective")
       .def(py::init<>());
+  py::class_<LPArrays, std::shared_ptr<LPArrays>>(m, "LPArrays")
+      .def_readonly("n_rows", &LPArrays::n_rows)
+      .def_readonly("n_cols", &LPArrays::n_cols)
+      .def_readonly("obj_constant", &LPArrays::obj_constant)
+      .def_readonly("sense", &LPArrays::sense)
+      .def_property_readonly("row_indptr", array_member(&LPArrays::row_indptr))
+      .def_property_readonly("row_indices",
+                             array_member(&LPArrays::row_indices))
+      .def_property_readonly("row_values", array_member(&LPArrays::row_values))
+      .def_property_readonly("col_indptr", array_member(&LPArrays::col_indptr))
+      .def_property_readonly("col_indices",
+                             array_member(&LPArrays::col_indices))
+      .def_property_readonly("col_values", array_member(&LPArrays::col_values))
+      .def_property_readonly("row_lower", array_member(&LPArrays::row_lower))
+      .def_property_readonly("row_upper", array_member(&LPArrays::row_upper))
+      .def_property_readonly("col_lower", array_member(&LPArrays::col_lower))
+      .def_property_readonly("col_upper", array_member(&LPArrays::col_upper))
+      .def_property_readonly("integrality",
+                             array_member(&LPArrays::integrality))
+      .def_property_readonly("obj_coefs", array_member(&LPArrays::obj_coefs))
+      .def_property_readonly("q_rows", array_member(&LPArrays::q_rows))
+      .def_property_readonly("q_cols", array_member(&LPArrays::q_cols))
+      .def_property_readonly("q_values", array_member(&LPArrays::q_values));
   py::class_<LPWriter, Model>(m, "LPWriter")
       .def(py::init<>())
-      .def("write", &LPWriter::write)
-      .def("get_solve_cons", &LPWriter::get_solve_cons);
+      .def("write", &LPWriter::write, py::arg("filename"),
+           py::arg("n_threads") = 1, py::arg("compact_labels") = false)
+      .def("get_var_from_label", &LPWriter::get_var_from_label)
+      .def("get_con_from_label", &LPWriter::get_con_from_label)
+      .def("write_mps", &LPWriter::write_mps)
+      .def("to_arrays", &LPWriter::to_arrays)
+      .def("get_solve_cons", &LPWriter::get_solve_cons)
+      .def("get_solve_vars", &LPWriter::get_solve_vars)
+      .def("get_changed_cons", &LPWriter::get_changed_cons);
+  m.attr("snapshot_version") = snapshot_version;
+  m.def("save_snapshot", &save_snapshot, py::arg("model"),
+        py::arg("filename"), py::arg("vars"), py::arg("params"));
+  m.def("load_snapshot", &load_snapshot, py::arg("model"),
+        py::arg("filename"));
   py::enum_<ExprType>(m, "ExprType", py::module_local())
       .value("py_float", ExprType::py_float)
       .value("var", ExprType::var)
@@ -0,0 +1,606 @@
+/**___________________________________________________________________________
+ *
+ * Pyomo: Python Optimization Modeling Objects
+ * Copyright (c) 2008-2024
+ * National Technology and Engineering Solutions of Sandia, LLC
+ * Under the terms of Contract DE-NA0003525 with National Technology and
+ * Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+ * rights in this software.
+ * This software is distributed under the 3-clause BSD License.
+ * ___________________________________________________________________________
+**/
+
+#include "codegen.hpp"
+
+// Interval helpers included in every generated kernel. These are simpler
+// (and sometimes looser) than the ones in interval.cpp, but always valid.
+static const char *c_prelude = R"(#include <math.h>
+
+#ifdef _WIN32
+#define CG_EXPORT __declspec(dllexport)
+#else
+#define CG_EXPORT
+#endif
+
+#define CG_INF HUGE_VAL
+
+static inline double cg_mulb(double a, double b)
+{
+  /* 0 * inf is 0 for bounds */
+  if (a == 0 || b == 0)
+    return 0;
+  return a * b;
+}
+
+static inline void cg_mul(double xl, double xu, double yl, double yu, double *l,
+                   double *u)
+{
+  double c[4];
+  int i;
+  c[0] = cg_mulb(xl, yl);
+  c[1] = cg_mulb(xl, yu);
+  c[2] = cg_mulb(xu, yl);
+  c[3] = cg_mulb(xu, yu);
+  *l = c[0];
+  *u = c[0];
+  for (i = 1; i < 4; ++i) {
+    if (c[i] < *l)
+      *l = c[i];
+    if (c[i] > *u)
+      *u = c[i];
+  }
+}
+
+static inline void cg_lin_term(double coef, double xl, double xu, double *l,
+                        double *u)
+{
+  double tl, tu;
+  cg_mul(coef, coef, xl, xu, &tl, &tu);
+  *l += tl;
+  *u += tu;
+}
+
+static inline void cg_div(double xl, double xu, double yl, double yu, double *l,
+                   double *u)
+{
+  if (yl <= 0 && yu >= 0) {
+    *l = -CG_INF;
+    *u = CG_INF;
+    return;
+  }
+  cg_mul(xl, xu, 1.0 / yu, 1.0 / yl, l, u);
+}
+
+static inline void cg_exp(double xl, double xu, double *l, double *u)
+{
+  *l = exp(xl);
+  *u = exp(xu);
+}
+
+static inline void cg_log(double xl, double xu, double *l, double *u)
+{
+  *l = xl > 0 ? log(xl) : -CG_INF;
+  *u = xu > 0 ? log(xu) : -CG_INF;
+}
+
+static inline void cg_pow(double xl, double xu, double yl, double yu, double *l,
+                   double *u)
+{
+  double n = yl;
+  if (yl == yu && n == floor(n) && fabs(n) < 1e9) {
+    double a, b;
+    if (n == 0) {
+      *l = 1;
+      *u = 1;
+      return;
+    }
+    if (n < 0) {
+      double rl, ru;
+      if (xl <= 0 && xu >= 0) {
+        *l = -CG_INF;
+        *u = CG_INF;
+        return;
+      }
+      cg_div(1, 1, xl, xu, &rl, &ru);
+      cg_pow(rl, ru, -n, -n, l, u);
+      return;
+    }
+    a = pow(xl, n);
+    b = pow(xu, n);
+    if (fmod(n, 2) != 0) {
+      *l = a;
+      *u = b;
+    } else if (xl >= 0) {
+      *l = a;
+      *u = b;
+    } else if (xu <= 0) {
+      *l = b;
+      *u = a;
+    } else {
+      *l = 0;
+      *u = a > b ? a : b;
+    }
+    return;
+  }
+  if (xl >= 0) {
+    /* x**y = exp(y * log(x)) */
+    double ll, lu, ml, mu;
+    cg_log(xl, xu, &ll, &lu);
+    cg_mul(ll, lu, yl, yu, &ml, &mu);
+    cg_exp(ml, mu, l, u);
+    return;
+  }
+  *l = -CG_INF;
+  *u = CG_INF;
+}
+
+static inline void cg_neg(double xl, double xu, double *l, double *u)
+{
+  *l = -xu;
+  *u = -xl;
+}
+
+static inline void cg_log10(double xl, double xu, double *l, double *u)
+{
+  *l = xl > 0 ? log10(xl) : -CG_INF;
+  *u = xu > 0 ? log10(xu) : -CG_INF;
+}
+
+static inline void cg_sqrt(double xl, double xu, double *l, double *u)
+{
+  *l = xl > 0 ? sqrt(xl) : 0;
+  *u = xu > 0 ? sqrt(xu) : 0;
+}
+
+static inline void cg_abs(double xl, double xu, double *l, double *u)
+{
+  if (xl >= 0) {
+    *l = xl;
+    *u = xu;
+  } else if (xu <= 0) {
+    *l = -xu;
+    *u = -xl;
+  } else {
+    *l = 0;
+    *u = -xl > xu ? -xl : xu;
+  }
+}
+
+static inline void cg_sin(double xl, double xu, double *l, double *u)
+{
+  *l = -1;
+  *u = 1;
+}
+
+static inline void cg_cos(double xl, double xu, double *l, double *u)
+{
+  *l = -1;
+  *u = 1;
+}
+
+static inline void cg_tan(double xl, double xu, double *l, double *u)
+{
+  *l = -CG_INF;
+  *u = CG_INF;
+}
+
+static inline void cg_asin(double xl, double xu, double *l, double *u)
+{
+  *l = asin(xl > -1 ? xl : -1);
+  *u = asin(xu < 1 ? xu : 1);
+}
+
+static inline void cg_acos(double xl, double xu, double *l, double *u)
+{
+  *l = acos(xu < 1 ? xu : 1);
+  *u = acos(xl > -1 ? xl : -1);
+}
+
+static inline void cg_atan(double xl, double xu, double *l, double *u)
+{
+  *l = atan(xl);
+  *u = atan(xu);
+}
+)";
+
+std::string CCodeWriter::literal(double val) {
+  if (val == inf)
+    return "CG_INF";
+  if (val == -inf)
+    return "(-CG_INF)";
+  if (val != val)
+    return "NAN";
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%.17g", val);
+  std::string res = buf;
+  if (val < 0)
+    res = "(" + res + ")";
+  return res;
+}
+
+std::string CCodeWriter::value(std::shared_ptr<Node> node) {
+  if (node->is_variable_type()) {
+    std::shared_ptr<Var> v = std::dynamic_pointer_cast<Var>(node);
+    if (v->index < 0)
+      throw py::value_error("Variable " + v->name +
+                            " is not in the list of variables");
+    return "x[" + std::to_string(v->index) + "]";
+  } else if (node->is_param_type()) {
+    auto it = param_index.find(node);
+    if (it != param_index.end())
+      return "p[" + std::to_string(it->second) + "]";
+    return literal(std::dynamic_pointer_cast<Param>(node)->value);
+  } else if (node->is_constant_type()) {
+    return literal(std::dynamic_pointer_cast<Constant>(node)->value);
+  } else if (node->is_operator_type()) {
+    return prefix + "v" +
+           std::to_string(std::dynamic_pointer_cast<Operator>(node)->index);
+  } else {
+    return inline_value(std::dynamic_pointer_cast<ExpressionBase>(node));
+  }
+}
+
+std::string CCodeWriter::lb(std::shared_ptr<Node> node) {
+  if (node->is_variable_type()) {
+    value(node);
+    return "xl[" +
+           std::to_string(std::dynamic_pointer_cast<Var>(node)->index) + "]";
+  } else if (node->is_operator_type()) {
+    return prefix + "l" +
+           std::to_string(std::dynamic_pointer_cast<Operator>(node)->index);
+  }
+  return value(node);
+}
+
+std::string CCodeWriter::ub(std::shared_ptr<Node> node) {
+  if (node->is_variable_type()) {
+    value(node);
+    return "xu[" +
+           std::to_string(std::dynamic_pointer_cast<Var>(node)->index) + "]";
+  } else if (node->is_operator_type()) {
+    return prefix + "u" +
+           std::to_string(std::dynamic_pointer_cast<Operator>(node)->index);
+  }
+  return value(node);
+}
+
+std::string CCodeWriter::adjoint(std::shared_ptr<Node> node) {
+  if (node->is_variable_type()) {
+    value(node);
+    return "g[" +
+           std::to_string(std::dynamic_pointer_cast<Var>(node)->index) + "]";
+  } else if (node->is_operator_type()) {
+    return prefix + "a" +
+           std::to_string(std::dynamic_pointer_cast<Operator>(node)->index);
+  }
+  return "";
+}
+
+void CCodeWriter::add_adjoint(std::shared_ptr<Node> node,
+                              std::string contribution) {
+  std::string name = adjoint(node);
+  if (name.empty())
+    return;
+  adjoints.push_back("  " + name + " += " + contribution + ";\n");
+}
+
+void CCodeWriter::write_operators(std::shared_ptr<Expression> expr) {
+  std::shared_ptr<Operator> oper;
+  for (unsigned int i = 0; i < expr->n_operators; ++i) {
+    oper = expr->operators[i];
+    oper->index = i;
+    oper->write_c_code(*this);
+  }
+}
+
+std::string CCodeWriter::inline_value(std::shared_ptr<ExpressionBase> expr) {
+  // used for the coefficients of linear operators; these only depend on
+  // params, so their values are written to both the value and the interval
+  // sweeps
+  if (!expr->is_expression_type())
+    return value(expr);
+  if (expr->identify_variables()->size() > 0)
+    throw py::value_error(
+        "Cannot generate C code for a coefficient that depends on variables");
+  std::shared_ptr<Expression> e = std::dynamic_pointer_cast<Expression>(expr);
+  std::string old_prefix = prefix;
+  bool old_values_only = values_only;
+  prefix = "c" + std::to_string(n_nested) + "_";
+  ++n_nested;
+  values_only = true;
+  write_operators(e);
+  std::string res = prefix + "v" + std::to_string(e->n_operators - 1);
+  prefix = old_prefix;
+  values_only = old_values_only;
+  return res;
+}
+
+static void _write_value(CCodeWriter &w, std::shared_ptr<Node> node,
+                         std::string rhs) {
+  std::string stmt = "  double " + w.value(node) + " = " + rhs + ";\n";
+  w.values << stmt;
+  if (w.values_only)
+    w.bounds << stmt;
+}
+
+static void _write_bounds(CCodeWriter &w, std::shared_ptr<Node> node,
+                          std::string func, std::string args) {
+  w.bounds << "  double " << w.lb(node) << ", " << w.ub(node) << ";\n";
+  w.bounds << "  " << func << "(" << args << ", &" << w.lb(node) << ", &"
+           << w.ub(node) << ");\n";
+}
+
+static std::string _interval_args(CCodeWriter &w, std::shared_ptr<Node> node) {
+  return w.lb(node) + ", " + w.ub(node);
+}
+
+void Operator::write_c_code(CCodeWriter &w) {
+  throw py::value_error("Cannot generate C code for " + name());
+}
+
+void LinearOperator::write_c_code(CCodeWriter &w) {
+  std::shared_ptr<Node> self = shared_from_this();
+  std::string c = w.inline_value(constant);
+  std::vector<std::string> coefs(nterms);
+  std::string rhs = c;
+  for (unsigned int i = 0; i < nterms; ++i) {
+    coefs[i] = w.inline_value(coefficients[i]);
+    rhs += " + " + coefs[i] + " * " + w.value(variables[i]);
+  }
+  _write_value(w, self, rhs);
+  if (w.values_only)
+    return;
+  w.bounds << "  double " << w.lb(self) << " = " << c << ", " << w.ub(self)
+           << " = " << c << ";\n";
+  for (unsigned int i = 0; i < nterms; ++i) {
+    w.bounds << "  cg_lin_term(" << coefs[i] << ", "
+             << _interval_args(w, variables[i]) << ", &" << w.lb(self)
+             << ", &" << w.ub(self) << ");\n";
+    w.add_adjoint(variables[i], w.adjoint(self) + " * " + coefs[i]);
+  }
+}
+
+void SumOperator::write_c_code(CCodeWriter &w) {
+  std::shared_ptr<Node> self = shared_from_this();
+  std::string rhs = w.value(operands[0]);
+  for (unsigned int i = 1; i < nargs; ++i)
+    rhs += " + " + w.value(operands[i]);
+  _write_value(w, self, rhs);
+  if (w.values_only)
+    return;
+  std::string l = w.lb(operands[0]);
+  std::string u = w.ub(operands[0]);
+  for (unsigned int i = 1; i < nargs; ++i) {
+    l += " + " + w.lb(operands[i]);
+    u += " + " + w.ub(operands[i]);
+  }
+  w.bounds << "  double " << w.lb(self) << " = " << l << ";\n";
+  w.bounds << "  double " << w.ub(self) << " = " << u << ";\n";
+  for (unsigned int i = 0; i < nargs; ++i)
+    w.add_adjoint(operands[i], w.adjoint(self));
+}
+
+void MultiplyOperator::write_c_code(CCodeWriter &w) {
+  std::shared_ptr<Node> self = shared_from_this();
+  _write_value(w, self, w.value(operand1) + " * " + w.value(operand2));
+  if (w.values_only)
+    return;
+  _write_bounds(w, self, "cg_mul",
+                _interval_args(w, operand1) + ", " +
+                    _interval_args(w, operand2));
+  w.add_adjoint(operand1, w.adjoint(self) + " * " + w.value(operand2));
+  w.add_adjoint(operand2, w.adjoint(self) + " * " + w.value(operand1));
+}
+
+void DivideOperator::write_c_code(CCodeWriter &w) {
+  std::shared_ptr<Node> self = shared_from_this();
+  _write_value(w, self, w.value(operand1) + " / " + w.value(operand2));
+  if (w.values_only)
+    return;
+  _write_bounds(w, self, "cg_div",
+                _interval_args(w, operand1) + ", " +
+                    _interval_args(w, operand2));
+  w.add_adjoint(operand1, w.adjoint(self) + " / " + w.value(operand2));
+  w.add_adjoint(operand2, "-" + w.adjoint(self) + " * " + w.value(self) +
+                              " / " + w.value(operand2));
+}
+
+void PowerOperator::write_c_code(CCodeWriter &w) {
+  std::shared_ptr<Node> self = shared_from_this();
+  std::string x = w.value(operand1);
+  std::string y = w.value(operand2);
+  _write_value(w, self, "pow(" + x + ", " + y + ")");
+  if (w.values_only)
+    return;
+  _write_bounds(w, self, "cg_pow",
+                _interval_args(w, operand1) + ", " +
+                    _interval_args(w, operand2));
+  w.add_adjoint(operand1, w.adjoint(self) + " * " + y + " * pow(" + x + ", " +
+                              y + " - 1)");
+  w.add_adjoint(operand2,
+                w.adjoint(self) + " * " + w.value(self) + " * log(" + x + ")");
+}
+
+void NegationOperator::write_c_code(CCodeWriter &w) {
+  std::shared_ptr<Node> self = shared_from_this();
+  _write_value(w, self, "-" + w.value(operand));
+  if (w.values_only)
+    return;
+  _write_bounds(w, self, "cg_neg", _interval_args(w, operand));
+  w.add_adjoint(operand, "-" + w.adjoint(self));
+}
+
+void ExpOperator::write_c_code(CCodeWriter &w) {
+  std::shared_ptr<Node> self = shared_from_this();
+  _write_value(w, self, "exp(" + w.value(operand) + ")");
+  if (w.values_only)
+    return;
+  _write_bounds(w, self, "cg_exp", _interval_args(w, operand));
+  w.add_adjoint(operand, w.adjoint(self) + " * " + w.value(self));
+}
+
+void LogOperator::write_c_code(CCodeWriter &w) {
+  std::shared_ptr<Node> self = shared_from_this();
+  _write_value(w, self, "log(" + w.value(operand) + ")");
+  if (w.values_only)
+    return;
+  _write_bounds(w, self, "cg_log", _interval_args(w, operand));
+  w.add_adjoint(operand, w.adjoint(self) + " / " + w.value(operand));
+}
+
+void Log10Operator::write_c_code(CCodeWriter &w) {
+  std::shared_ptr<Node> self = shared_from_this();
+  _write_value(w, self, "log10(" + w.value(operand) + ")");
+  if (w.values_only)
+    return;
+  _write_bounds(w, self, "cg_log10", _interval_args(w, operand));
+  w.add_adjoint(operand, w.adjoint(self) + " / (" + w.value(operand) +
+                             " * log(10.0))");
+}
+
+void SqrtOperator::write_c_code(CCodeWriter &w) {
+  std::shared_ptr<Node> self = shared_from_this();
+  _write_value(w, self, "sqrt(" + w.value(operand) + ")");
+  if (w.values_only)
+    return;
+  _write_bounds(w, self, "cg_sqrt", _interval_args(w, operand));
+  w.add_adjoint(operand, w.adjoint(self) + " * 0.5 / " + w.value(self));
+}
+
+void AbsOperator::write_c_code(CCodeWriter &w) {
+  std::shared_ptr<Node> self = shared_from_this();
+  _write_value(w, self, "fabs(" + w.value(operand) + ")");
+  if (w.values_only)
+    return;
+  _write_bounds(w, self, "cg_abs", _interval_args(w, operand));
+  w.add_adjoint(operand, "(" + w.value(operand) + " >= 0 ? " +
+                             w.adjoint(self) + " : -" + w.adjoint(self) +
+                             ")");
+}
+
+void SinOperator::write_c_code(CCodeWriter &w) {
+  std::shared_ptr<Node> self = shared_from_this();
+  _write_value(w, self, "sin(" + w.value(operand) + ")");
+  if (w.values_only)
+    return;
+  _write_bounds(w, self, "cg_sin", _interval_args(w, operand));
+  w.add_adjoint(operand,
+                w.adjoint(self) + " * cos(" + w.value(operand) + ")");
+}
+
+void CosOperator::write_c_code(CCodeWriter &w) {
+  std::shared_ptr<Node> self = shared_from_this();
+  _write_value(w, self, "cos(" + w.value(operand) + ")");
+  if (w.values_only)
+    return;
+  _write_bounds(w, self, "cg_cos", _interval_args(w, operand));
+  w.add_adjoint(operand,
+                "-" + w.adjoint(self) + " * sin(" + w.value(operand) + ")");
+}
+
+void TanOperator::write_c_code(CCodeWriter &w) {
+  std::shared_ptr<Node> self = shared_from_this();
+  std::string x = w.value(operand);
+  _write_value(w, self, "tan(" + x + ")");
+  if (w.values_only)
+    return;
+  _write_bounds(w, self, "cg_tan", _interval_args(w, operand));
+  w.add_adjoint(operand, w.adjoint(self) + " / (cos(" + x + ") * cos(" + x +
+                             "))");
+}
+
+void AsinOperator::write_c_code(CCodeWriter &w) {
+  std::shared_ptr<Node> self = shared_from_this();
+  std::string x = w.value(operand);
+  _write_value(w, self, "asin(" + x + ")");
+  if (w.values_only)
+    return;
+  _write_bounds(w, self, "cg_asin", _interval_args(w, operand));
+  w.add_adjoint(operand,
+                w.adjoint(self) + " / sqrt(1 - " + x + " * " + x + ")");
+}
+
+void AcosOperator::write_c_code(CCodeWriter &w) {
+  std::shared_ptr<Node> self = shared_from_this();
+  std::string x = w.value(operand);
+  _write_value(w, self, "acos(" + x + ")");
+  if (w.values_only)
+    return;
+  _write_bounds(w, self, "cg_acos", _interval_args(w, operand));
+  w.add_adjoint(operand,
+                "-" + w.adjoint(self) + " / sqrt(1 - " + x + " * " + x + ")");
+}
+
+void AtanOperator::write_c_code(CCodeWriter &w) {
+  std::shared_ptr<Node> self = shared_from_this();
+  std::string x = w.value(operand);
+  _write_value(w, self, "atan(" + x + ")");
+  if (w.values_only)
+    return;
+  _write_bounds(w, self, "cg_atan", _interval_args(w, operand));
+  w.add_adjoint(operand, w.adjoint(self) + " / (1 + " + x + " * " + x + ")");
+}
+
+std::string generate_c_code(std::shared_ptr<ExpressionBase> expr,
+                            std::vector<std::shared_ptr<Var>> &variables,
+                            std::vector<std::shared_ptr<Param>> &params) {
+  CCodeWriter w;
+
+  std::shared_ptr<std::vector<std::shared_ptr<Var>>> expr_vars =
+      expr->identify_variables();
+  for (std::shared_ptr<Var> &v : *expr_vars)
+    v->index = -1;
+  for (unsigned int i = 0; i < variables.size(); ++i)
+    variables[i]->index = i;
+  for (unsigned int i = 0; i < params.size(); ++i)
+    w.param_index[params[i]] = i;
+
+  std::string res_value;
+  std::string res_lb;
+  std::string res_ub;
+  std::shared_ptr<Expression> e;
+  if (expr->is_expression_type()) {
+    e = std::dynamic_pointer_cast<Expression>(expr);
+    w.write_operators(e);
+    std::shared_ptr<Operator> last = e->operators[e->n_operators - 1];
+    res_value = w.value(last);
+    res_lb = w.lb(last);
+    res_ub = w.ub(last);
+  } else {
+    res_value = w.value(expr);
+    res_lb = w.lb(expr);
+    res_ub = w.ub(expr);
+    w.add_adjoint(expr, "1.0");
+  }
+
+  std::ostringstream src;
+  src << "/* generated by pyomo.contrib.appsi */\n" << c_prelude << "\n";
+
+  src << "CG_EXPORT double pyomo_kernel_value(const double *x, const double "
+         "*p)\n{\n";
+  src << w.values.str();
+  src << "  return " << res_value << ";\n}\n\n";
+
+  src << "CG_EXPORT double pyomo_kernel_gradient(const double *x, const "
+         "double *p, double *g)\n{\n";
+  src << "  int i;\n";
+  src << "  for (i = 0; i < " << variables.size() << "; ++i)\n";
+  src << "    g[i] = 0;\n";
+  src << w.values.str();
+  if (e) {
+    for (unsigned int i = 0; i < e->n_operators; ++i)
+      src << "  double a" << i << " = " << (i == e->n_operators - 1 ? 1 : 0)
+          << ";\n";
+  }
+  for (auto it = w.adjoints.rbegin(); it != w.adjoints.rend(); ++it)
+    src << *it;
+  src << "  return " << res_value << ";\n}\n\n";
+
+  src << "CG_EXPORT void pyomo_kernel_bounds(const double *xl, const double "
+         "*xu, const double *p, double *lb, double *ub)\n{\n";
+  src << w.bounds.str();
+  src << "  *lb = " << res_lb << ";\n";
+  src << "  *ub = " << res_ub << ";\n}\n";
+
+  return src.str();
+}
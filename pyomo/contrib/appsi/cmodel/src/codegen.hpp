@@ -0,0 +1,60 @@
+/**___________________________________________________________________________
+ *
+ * Pyomo: Python Optimization Modeling Objects
+ * Copyright (c) 2008-2024
+ * National Technology and Engineering Solutions of Sandia, LLC
+ * Under the terms of Contract DE-NA0003525 with National Technology and
+ * Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+ * rights in this software.
+ * This software is distributed under the 3-clause BSD License.
+ * ___________________________________________________________________________
+**/
+
+#ifndef CODEGEN_HEADER
+#define CODEGEN_HEADER
+
+#include "expression.hpp"
+
+// Accumulates the C statements of a generated kernel. Each operator of an
+// Expression writes one statement to the value sweep, one to the interval
+// sweep, and its adjoint contributions to the reverse sweep.
+class CCodeWriter {
+public:
+  CCodeWriter() = default;
+  ~CCodeWriter() = default;
+  std::ostringstream values;
+  std::ostringstream bounds;
+  // reverse sweep statements, in the order of the operators
+  std::vector<std::string> adjoints;
+  // used to give operators of nested (parameter-only) expressions distinct
+  // names
+  std::string prefix;
+  bool values_only = false;
+  std::map<std::shared_ptr<Node>, int> param_index;
+  std::string literal(double val);
+  std::string value(std::shared_ptr<Node> node);
+  std::string lb(std::shared_ptr<Node> node);
+  std::string ub(std::shared_ptr<Node> node);
+  std::string adjoint(std::shared_ptr<Node> node);
+  void add_adjoint(std::shared_ptr<Node> node, std::string contribution);
+  void write_operators(std::shared_ptr<Expression> expr);
+  std::string inline_value(std::shared_ptr<ExpressionBase> expr);
+
+private:
+  int n_nested = 0;
+};
+
+// Generate C source with the functions
+//   double pyomo_kernel_value(const double *x, const double *p)
+//   double pyomo_kernel_gradient(const double *x, const double *p, double *g)
+//   void pyomo_kernel_bounds(const double *xl, const double *xu,
+//                            const double *p, double *lb, double *ub)
+// where x, xl and xu follow the order of variables and p the order of
+// params. Params that are not listed are embedded as constants. The source
+// only depends on the structure of the expression, the constants, and the
+// order of variables and params, so it can be used as a cache key.
+std::string generate_c_code(std::shared_ptr<ExpressionBase> expr,
+                            std::vector<std::shared_ptr<Var>> &variables,
+                            std::vector<std::shared_ptr<Param>> &params);
+
+#endif
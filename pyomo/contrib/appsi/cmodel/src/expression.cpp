@@ -11,6 +11,7 @@
 **/
 
 #include "expression.hpp"
+#include "nl_stream.hpp"
 
 bool Leaf::is_leaf() { return true; }
 
@@ -250,6 +251,90 @@ std::shared_ptr<std::vector<std::shared_ptr<Var>>> Param::identify_variables() {
   return res;
 }
 
+static void
+_identify_params(std::shared_ptr<Node> operand,
+                 std::set<std::shared_ptr<Node>> &param_set,
+                 std::shared_ptr<std::vector<std::shared_ptr<Param>>> param_vec) {
+  if (operand->is_param_type()) {
+    if (param_set.count(operand) == 0) {
+      param_vec->push_back(std::dynamic_pointer_cast<Param>(operand));
+      param_set.insert(operand);
+    }
+  } else if (operand->is_expression_type()) {
+    // nested expressions only contain params and constants
+    std::shared_ptr<Expression> e =
+        std::dynamic_pointer_cast<Expression>(operand);
+    for (unsigned int i = 0; i < e->n_operators; ++i) {
+      e->operators[i]->identify_params(param_set, param_vec);
+    }
+  }
+}
+
+void UnaryOperator::identify_params(
+    std::set<std::shared_ptr<Node>> &param_set,
+    std::shared_ptr<std::vector<std::shared_ptr<Param>>> param_vec) {
+  _identify_params(operand, param_set, param_vec);
+}
+
+void BinaryOperator::identify_params(
+    std::set<std::shared_ptr<Node>> &param_set,
+    std::shared_ptr<std::vector<std::shared_ptr<Param>>> param_vec) {
+  _identify_params(operand1, param_set, param_vec);
+  _identify_params(operand2, param_set, param_vec);
+}
+
+void ExternalOperator::identify_params(
+    std::set<std::shared_ptr<Node>> &param_set,
+    std::shared_ptr<std::vector<std::shared_ptr<Param>>> param_vec) {
+  for (unsigned int i = 0; i < nargs; ++i) {
+    _identify_params(operands[i], param_set, param_vec);
+  }
+}
+
+void LinearOperator::identify_params(
+    std::set<std::shared_ptr<Node>> &param_set,
+    std::shared_ptr<std::vector<std::shared_ptr<Param>>> param_vec) {
+  _identify_params(constant, param_set, param_vec);
+  for (unsigned int i = 0; i < nterms; ++i) {
+    _identify_params(coefficients[i], param_set, param_vec);
+  }
+}
+
+void SumOperator::identify_params(
+    std::set<std::shared_ptr<Node>> &param_set,
+    std::shared_ptr<std::vector<std::shared_ptr<Param>>> param_vec) {
+  for (unsigned int i = 0; i < nargs; ++i) {
+    _identify_params(operands[i], param_set, param_vec);
+  }
+}
+
+std::shared_ptr<std::vector<std::shared_ptr<Param>>>
+Expression::identify_params() {
+  std::set<std::shared_ptr<Node>> param_set;
+  std::shared_ptr<std::vector<std::shared_ptr<Param>>> res =
+      std::make_shared<std::vector<std::shared_ptr<Param>>>();
+  for (unsigned int i = 0; i < n_operators; ++i) {
+    operators[i]->identify_params(param_set, res);
+  }
+  return res;
+}
+
+std::shared_ptr<std::vector<std::shared_ptr<Param>>> Var::identify_params() {
+  return std::make_shared<std::vector<std::shared_ptr<Param>>>();
+}
+
+std::shared_ptr<std::vector<std::shared_ptr<Param>>>
+Constant::identify_params() {
+  return std::make_shared<std::vector<std::shared_ptr<Param>>>();
+}
+
+std::shared_ptr<std::vector<std::shared_ptr<Param>>> Param::identify_params() {
+  std::shared_ptr<std::vector<std::shared_ptr<Param>>> res =
+      std::make_shared<std::vector<std::shared_ptr<Param>>>();
+  res->push_back(std::static_pointer_cast<Param>(shared_from_this()));
+  return res;
+}
+
 std::shared_ptr<std::vector<std::shared_ptr<ExternalOperator>>>
 Expression::identify_external_operators() {
   std::set<std::shared_ptr<Node>> external_set;
@@ -562,13 +647,29 @@ void ExternalOperator::fill_prefix_notation_stack(
   }
 }
 
-void Var::write_nl_string(std::ofstream &f) { f << "v" << index << "\n"; }
+static void _write_nl_op(NLStream &f, int opcode) {
+  f.put_key('o');
+  f.put_int(opcode);
+  f.newline();
+}
+
+static void _write_nl_num(NLStream &f, double val) {
+  f.put_key('n');
+  f.put_double(val);
+  f.newline();
+}
+
+void Var::write_nl_string(NLStream &f) {
+  f.put_key('v');
+  f.put_int(index);
+  f.newline();
+}
 
-void Param::write_nl_string(std::ofstream &f) { f << "n" << value << "\n"; }
+void Param::write_nl_string(NLStream &f) { _write_nl_num(f, value); }
 
-void Constant::write_nl_string(std::ofstream &f) { f << "n" << value << "\n"; }
+void Constant::write_nl_string(NLStream &f) { _write_nl_num(f, value); }
 
-void Expression::write_nl_string(std::ofstream &f) {
+void Expression::write_nl_string(NLStream &f) {
   std::shared_ptr<std::vector<std::shared_ptr<Node>>> prefix_notation =
       get_prefix_notation();
   for (std::shared_ptr<Node> &node : *(prefix_notation)) {
@@ -576,67 +677,73 @@ void Expression::write_nl_string(std::ofstream &f) {
   }
 }
 
-void MultiplyOperator::write_nl_string(std::ofstream &f) { f << "o2\n"; }
+void MultiplyOperator::write_nl_string(NLStream &f) { _write_nl_op(f, 2); }
 
-void ExternalOperator::write_nl_string(std::ofstream &f) {
-  f << "f" << external_function_index << " " << nargs << "\n";
+void ExternalOperator::write_nl_string(NLStream &f) {
+  f.put_key('f');
+  f.put_int(external_function_index);
+  f.space();
+  f.put_int(nargs);
+  f.newline();
 }
 
-void SumOperator::write_nl_string(std::ofstream &f) {
+void SumOperator::write_nl_string(NLStream &f) {
   if (nargs == 2) {
-    f << "o0\n";
+    _write_nl_op(f, 0);
   } else {
-    f << "o54\n";
-    f << nargs << "\n";
+    _write_nl_op(f, 54);
+    f.put_int(nargs);
+    f.newline();
   }
 }
 
-void LinearOperator::write_nl_string(std::ofstream &f) {
+void LinearOperator::write_nl_string(NLStream &f) {
   bool has_const =
       (!constant->is_constant_type()) || (constant->evaluate() != 0);
   unsigned int n_sum_args = nterms + (has_const ? 1 : 0);
   if (n_sum_args == 2) {
-    f << "o0\n";
+    _write_nl_op(f, 0);
   } else {
-    f << "o54\n";
-    f << n_sum_args << "\n";
+    _write_nl_op(f, 54);
+    f.put_int(n_sum_args);
+    f.newline();
   }
   if (has_const)
-    f << "n" << constant->evaluate() << "\n";
+    _write_nl_num(f, constant->evaluate());
   for (unsigned int ndx = 0; ndx < nterms; ++ndx) {
-    f << "o2\n";
-    f << "n" << coefficients[ndx]->evaluate() << "\n";
+    _write_nl_op(f, 2);
+    _write_nl_num(f, coefficients[ndx]->evaluate());
     variables[ndx]->write_nl_string(f);
   }
 }
 
-void DivideOperator::write_nl_string(std::ofstream &f) { f << "o3\n"; }
+void DivideOperator::write_nl_string(NLStream &f) { _write_nl_op(f, 3); }
 
-void PowerOperator::write_nl_string(std::ofstream &f) { f << "o5\n"; }
+void PowerOperator::write_nl_string(NLStream &f) { _write_nl_op(f, 5); }
 
-void NegationOperator::write_nl_string(std::ofstream &f) { f << "o16\n"; }
+void NegationOperator::write_nl_string(NLStream &f) { _write_nl_op(f, 16); }
 
-void ExpOperator::write_nl_string(std::ofstream &f) { f << "o44\n"; }
+void ExpOperator::write_nl_string(NLStream &f) { _write_nl_op(f, 44); }
 
-void LogOperator::write_nl_string(std::ofstream &f) { f << "o43\n"; }
+void LogOperator::write_nl_string(NLStream &f) { _write_nl_op(f, 43); }
 
-void AbsOperator::write_nl_string(std::ofstream &f) { f << "o15\n"; }
+void AbsOperator::write_nl_string(NLStream &f) { _write_nl_op(f, 15); }
 
-void SqrtOperator::write_nl_string(std::ofstream &f) { f << "o39\n"; }
+void SqrtOperator::write_nl_string(NLStream &f) { _write_nl_op(f, 39); }
 
-void Log10Operator::write_nl_string(std::ofstream &f) { f << "o42\n"; }
+void Log10Operator::write_nl_string(NLStream &f) { _write_nl_op(f, 42); }
 
-void SinOperator::write_nl_string(std::ofstream &f) { f << "o41\n"; }
+void SinOperator::write_nl_string(NLStream &f) { _write_nl_op(f, 41); }
 
-void CosOperator::write_nl_string(std::ofstream &f) { f << "o46\n"; }
+void CosOperator::write_nl_string(NLStream &f) { _write_nl_op(f, 46); }
 
-void TanOperator::write_nl_string(std::ofstream &f) { f << "o38\n"; }
+void TanOperator::write_nl_string(NLStream &f) { _write_nl_op(f, 38); }
 
-void AsinOperator::write_nl_string(std::ofstream &f) { f << "o51\n"; }
+void AsinOperator::write_nl_string(NLStream &f) { _write_nl_op(f, 51); }
 
-void AcosOperator::write_nl_string(std::ofstream &f) { f << "o53\n"; }
+void AcosOperator::write_nl_string(NLStream &f) { _write_nl_op(f, 53); }
 
-void AtanOperator::write_nl_string(std::ofstream &f) { f << "o49\n"; }
+void AtanOperator::write_nl_string(NLStream &f) { _write_nl_op(f, 49); }
 
 bool BinaryOperator::is_binary_operator() { return true; }
 
@@ -1506,6 +1613,409 @@ void AtanOperator::propagate_bounds_backward(
                                improvement_tol, improved_vars);
 }
 
+double Leaf::get_cv_from_array(double *cvs) { return value; }
+
+double Leaf::get_cc_from_array(double *ccs) { return value; }
+
+double Var::get_cv_from_array(double *cvs) {
+  // the reference point is the value of the variable projected onto its
+  // bounds
+  double lb = get_lb();
+  double ub = get_ub();
+  if (value < lb)
+    return lb;
+  if (value > ub)
+    return ub;
+  return value;
+}
+
+double Var::get_cc_from_array(double *ccs) { return get_cv_from_array(ccs); }
+
+double Expression::get_cv_from_array(double *cvs) {
+  return cvs[n_operators - 1];
+}
+
+double Expression::get_cc_from_array(double *ccs) {
+  return ccs[n_operators - 1];
+}
+
+double Operator::get_cv_from_array(double *cvs) { return cvs[index]; }
+
+double Operator::get_cc_from_array(double *ccs) { return ccs[index]; }
+
+void Leaf::add_subgradient_from_array(double coef, McSource src,
+                                      double *cv_subs, double *cc_subs,
+                                      unsigned int n_vars, double *res) {
+  ;
+}
+
+void Var::add_subgradient_from_array(double coef, McSource src,
+                                     double *cv_subs, double *cc_subs,
+                                     unsigned int n_vars, double *res) {
+  // variables that are not part of the relaxation have index -1 and are
+  // treated as constants
+  if (src != mc_none && index >= 0)
+    res[index] += coef;
+}
+
+void Expression::add_subgradient_from_array(double coef, McSource src,
+                                            double *cv_subs, double *cc_subs,
+                                            unsigned int n_vars,
+                                            double *res) {
+  operators[n_operators - 1]->add_subgradient_from_array(
+      coef, src, cv_subs, cc_subs, n_vars, res);
+}
+
+void Operator::add_subgradient_from_array(double coef, McSource src,
+                                          double *cv_subs, double *cc_subs,
+                                          unsigned int n_vars, double *res) {
+  double *row;
+  if (src == mc_cv)
+    row = cv_subs + index * n_vars;
+  else if (src == mc_cc)
+    row = cc_subs + index * n_vars;
+  else
+    return;
+  for (unsigned int ndx = 0; ndx < n_vars; ++ndx) {
+    res[ndx] += coef * row[ndx];
+  }
+}
+
+void Expression::propagate_mccormick(double *lbs, double *ubs, double *cvs,
+                                     double *ccs, double *cv_subs,
+                                     double *cc_subs, unsigned int n_vars) {
+  for (unsigned int ndx = 0; ndx < n_operators; ++ndx) {
+    operators[ndx]->index = ndx;
+    operators[ndx]->propagate_mccormick(lbs, ubs, cvs, ccs, cv_subs, cc_subs,
+                                        n_vars);
+  }
+}
+
+void Operator::set_mccormick_from_bounds(double *lbs, double *ubs, double *cvs,
+                                         double *ccs, double *cv_subs,
+                                         double *cc_subs,
+                                         unsigned int n_vars) {
+  cvs[index] = lbs[index];
+  ccs[index] = ubs[index];
+  std::fill(cv_subs + index * n_vars, cv_subs + (index + 1) * n_vars, 0.0);
+  std::fill(cc_subs + index * n_vars, cc_subs + (index + 1) * n_vars, 0.0);
+}
+
+void Operator::clip_mccormick(double *lbs, double *ubs, double *cvs,
+                              double *ccs, double *cv_subs, double *cc_subs,
+                              unsigned int n_vars) {
+  // the interval bounds are also valid (constant) relaxations
+  if (!(cvs[index] >= lbs[index])) {
+    cvs[index] = lbs[index];
+    std::fill(cv_subs + index * n_vars, cv_subs + (index + 1) * n_vars, 0.0);
+  }
+  if (!(ccs[index] <= ubs[index])) {
+    ccs[index] = ubs[index];
+    std::fill(cc_subs + index * n_vars, cc_subs + (index + 1) * n_vars, 0.0);
+  }
+}
+
+void Operator::propagate_mccormick(double *lbs, double *ubs, double *cvs,
+                                   double *ccs, double *cv_subs,
+                                   double *cc_subs, unsigned int n_vars) {
+  set_mccormick_from_bounds(lbs, ubs, cvs, ccs, cv_subs, cc_subs, n_vars);
+}
+
+void UnaryOperator::set_mccormick_from_sides(McSide &cv, McSide &cc,
+                                             double *lbs, double *ubs,
+                                             double *cvs, double *ccs,
+                                             double *cv_subs, double *cc_subs,
+                                             unsigned int n_vars) {
+  double *cv_row = cv_subs + index * n_vars;
+  double *cc_row = cc_subs + index * n_vars;
+  std::fill(cv_row, cv_row + n_vars, 0.0);
+  std::fill(cc_row, cc_row + n_vars, 0.0);
+  cvs[index] = cv.value;
+  ccs[index] = cc.value;
+  operand->add_subgradient_from_array(cv.coef, cv.src, cv_subs, cc_subs,
+                                      n_vars, cv_row);
+  operand->add_subgradient_from_array(cc.coef, cc.src, cv_subs, cc_subs,
+                                      n_vars, cc_row);
+  clip_mccormick(lbs, ubs, cvs, ccs, cv_subs, cc_subs, n_vars);
+}
+
+void LinearOperator::propagate_mccormick(double *lbs, double *ubs, double *cvs,
+                                         double *ccs, double *cv_subs,
+                                         double *cc_subs,
+                                         unsigned int n_vars) {
+  double *cv_row = cv_subs + index * n_vars;
+  double *cc_row = cc_subs + index * n_vars;
+  std::fill(cv_row, cv_row + n_vars, 0.0);
+  double val = constant->evaluate();
+  double coef;
+  for (unsigned int ndx = 0; ndx < nterms; ++ndx) {
+    coef = coefficients[ndx]->evaluate();
+    val += coef * variables[ndx]->get_cv_from_array(cvs);
+    variables[ndx]->add_subgradient_from_array(coef, mc_cv, cv_subs, cc_subs,
+                                               n_vars, cv_row);
+  }
+  cvs[index] = val;
+  ccs[index] = val;
+  std::copy(cv_row, cv_row + n_vars, cc_row);
+  clip_mccormick(lbs, ubs, cvs, ccs, cv_subs, cc_subs, n_vars);
+}
+
+void SumOperator::propagate_mccormick(double *lbs, double *ubs, double *cvs,
+                                      double *ccs, double *cv_subs,
+                                      double *cc_subs, unsigned int n_vars) {
+  double *cv_row = cv_subs + index * n_vars;
+  double *cc_row = cc_subs + index * n_vars;
+  std::fill(cv_row, cv_row + n_vars, 0.0);
+  std::fill(cc_row, cc_row + n_vars, 0.0);
+  double cv = 0.0;
+  double cc = 0.0;
+  for (unsigned int ndx = 0; ndx < nargs; ++ndx) {
+    cv += operands[ndx]->get_cv_from_array(cvs);
+    cc += operands[ndx]->get_cc_from_array(ccs);
+    operands[ndx]->add_subgradient_from_array(1.0, mc_cv, cv_subs, cc_subs,
+                                              n_vars, cv_row);
+    operands[ndx]->add_subgradient_from_array(1.0, mc_cc, cv_subs, cc_subs,
+                                              n_vars, cc_row);
+  }
+  cvs[index] = cv;
+  ccs[index] = cc;
+  clip_mccormick(lbs, ubs, cvs, ccs, cv_subs, cc_subs, n_vars);
+}
+
+void NegationOperator::propagate_mccormick(double *lbs, double *ubs,
+                                           double *cvs, double *ccs,
+                                           double *cv_subs, double *cc_subs,
+                                           unsigned int n_vars) {
+  McSide cv;
+  McSide cc;
+  cv.value = -operand->get_cc_from_array(ccs);
+  cv.coef = -1.0;
+  cv.src = mc_cc;
+  cc.value = -operand->get_cv_from_array(cvs);
+  cc.coef = -1.0;
+  cc.src = mc_cv;
+  set_mccormick_from_sides(cv, cc, lbs, ubs, cvs, ccs, cv_subs, cc_subs,
+                           n_vars);
+}
+
+void _set_mccormick_from_product(McProductSide &cv, McProductSide &cc,
+                                 std::shared_ptr<Node> x,
+                                 std::shared_ptr<Node> y, unsigned int index,
+                                 double *cvs, double *ccs, double *cv_subs,
+                                 double *cc_subs, unsigned int n_vars) {
+  double *cv_row = cv_subs + index * n_vars;
+  double *cc_row = cc_subs + index * n_vars;
+  std::fill(cv_row, cv_row + n_vars, 0.0);
+  std::fill(cc_row, cc_row + n_vars, 0.0);
+  cvs[index] = cv.value;
+  ccs[index] = cc.value;
+  x->add_subgradient_from_array(cv.coef_x, cv.src_x, cv_subs, cc_subs, n_vars,
+                                cv_row);
+  y->add_subgradient_from_array(cv.coef_y, cv.src_y, cv_subs, cc_subs, n_vars,
+                                cv_row);
+  x->add_subgradient_from_array(cc.coef_x, cc.src_x, cv_subs, cc_subs, n_vars,
+                                cc_row);
+  y->add_subgradient_from_array(cc.coef_y, cc.src_y, cv_subs, cc_subs, n_vars,
+                                cc_row);
+}
+
+void MultiplyOperator::propagate_mccormick(double *lbs, double *ubs,
+                                           double *cvs, double *ccs,
+                                           double *cv_subs, double *cc_subs,
+                                           unsigned int n_vars) {
+  double xl = operand1->get_lb_from_array(lbs);
+  double xu = operand1->get_ub_from_array(ubs);
+  double xcv = operand1->get_cv_from_array(cvs);
+  double xcc = operand1->get_cc_from_array(ccs);
+
+  if (operand1 == operand2) {
+    McSide cv;
+    McSide cc;
+    if (!mc_power(xl, xu, xcv, xcc, 2, &cv, &cc)) {
+      set_mccormick_from_bounds(lbs, ubs, cvs, ccs, cv_subs, cc_subs, n_vars);
+      return;
+    }
+    McProductSide pcv;
+    McProductSide pcc;
+    pcv.value = cv.value;
+    pcv.coef_x = cv.coef;
+    pcv.src_x = cv.src;
+    pcc.value = cc.value;
+    pcc.coef_x = cc.coef;
+    pcc.src_x = cc.src;
+    _set_mccormick_from_product(pcv, pcc, operand1, operand2, index, cvs, ccs,
+                                cv_subs, cc_subs, n_vars);
+  } else {
+    McProductSide cv;
+    McProductSide cc;
+    if (!mc_product(xl, xu, xcv, xcc, operand2->get_lb_from_array(lbs),
+                    operand2->get_ub_from_array(ubs),
+                    operand2->get_cv_from_array(cvs),
+                    operand2->get_cc_from_array(ccs), &cv, &cc)) {
+      set_mccormick_from_bounds(lbs, ubs, cvs, ccs, cv_subs, cc_subs, n_vars);
+      return;
+    }
+    _set_mccormick_from_product(cv, cc, operand1, operand2, index, cvs, ccs,
+                                cv_subs, cc_subs, n_vars);
+  }
+  clip_mccormick(lbs, ubs, cvs, ccs, cv_subs, cc_subs, n_vars);
+}
+
+void DivideOperator::propagate_mccormick(double *lbs, double *ubs, double *cvs,
+                                         double *ccs, double *cv_subs,
+                                         double *cc_subs,
+                                         unsigned int n_vars) {
+  // x / y is relaxed as x * (1 / y)
+  double yl = operand2->get_lb_from_array(lbs);
+  double yu = operand2->get_ub_from_array(ubs);
+  McSide rcv;
+  McSide rcc;
+  if (!mc_inv(yl, yu, operand2->get_cv_from_array(cvs),
+              operand2->get_cc_from_array(ccs), &rcv, &rcc)) {
+    set_mccormick_from_bounds(lbs, ubs, cvs, ccs, cv_subs, cc_subs, n_vars);
+    return;
+  }
+  double rl = 1.0 / yu;
+  double ru = 1.0 / yl;
+  if (rcv.value < rl) {
+    rcv.value = rl;
+    rcv.coef = 0;
+    rcv.src = mc_none;
+  }
+  if (rcc.value > ru) {
+    rcc.value = ru;
+    rcc.coef = 0;
+    rcc.src = mc_none;
+  }
+
+  McProductSide cv;
+  McProductSide cc;
+  if (!mc_product(operand1->get_lb_from_array(lbs),
+                  operand1->get_ub_from_array(ubs),
+                  operand1->get_cv_from_array(cvs),
+                  operand1->get_cc_from_array(ccs), rl, ru, rcv.value,
+                  rcc.value, &cv, &cc)) {
+    set_mccormick_from_bounds(lbs, ubs, cvs, ccs, cv_subs, cc_subs, n_vars);
+    return;
+  }
+
+  // map the subgradients of 1/y back onto y
+  McProductSide *sides[2] = {&cv, &cc};
+  for (McProductSide *side : sides) {
+    if (side->src_y == mc_cv) {
+      side->coef_y *= rcv.coef;
+      side->src_y = rcv.src;
+    } else if (side->src_y == mc_cc) {
+      side->coef_y *= rcc.coef;
+      side->src_y = rcc.src;
+    }
+  }
+
+  _set_mccormick_from_product(cv, cc, operand1, operand2, index, cvs, ccs,
+                              cv_subs, cc_subs, n_vars);
+  clip_mccormick(lbs, ubs, cvs, ccs, cv_subs, cc_subs, n_vars);
+}
+
+void PowerOperator::propagate_mccormick(double *lbs, double *ubs, double *cvs,
+                                        double *ccs, double *cv_subs,
+                                        double *cc_subs, unsigned int n_vars) {
+  double yl = operand2->get_lb_from_array(lbs);
+  double yu = operand2->get_ub_from_array(ubs);
+  McSide cv;
+  McSide cc;
+  // only constant exponents are relaxed; otherwise fall back to the bounds
+  if (yl != yu ||
+      !mc_power(operand1->get_lb_from_array(lbs),
+                operand1->get_ub_from_array(ubs),
+                operand1->get_cv_from_array(cvs),
+                operand1->get_cc_from_array(ccs), yl, &cv, &cc)) {
+    set_mccormick_from_bounds(lbs, ubs, cvs, ccs, cv_subs, cc_subs, n_vars);
+    return;
+  }
+  McProductSide pcv;
+  McProductSide pcc;
+  pcv.value = cv.value;
+  pcv.coef_x = cv.coef;
+  pcv.src_x = cv.src;
+  pcc.value = cc.value;
+  pcc.coef_x = cc.coef;
+  pcc.src_x = cc.src;
+  _set_mccormick_from_product(pcv, pcc, operand1, operand2, index, cvs, ccs,
+                              cv_subs, cc_subs, n_vars);
+  clip_mccormick(lbs, ubs, cvs, ccs, cv_subs, cc_subs, n_vars);
+}
+
+void ExpOperator::propagate_mccormick(double *lbs, double *ubs, double *cvs,
+                                      double *ccs, double *cv_subs,
+                                      double *cc_subs, unsigned int n_vars) {
+  McSide cv;
+  McSide cc;
+  if (mc_exp(operand->get_lb_from_array(lbs), operand->get_ub_from_array(ubs),
+             operand->get_cv_from_array(cvs), operand->get_cc_from_array(ccs),
+             &cv, &cc))
+    set_mccormick_from_sides(cv, cc, lbs, ubs, cvs, ccs, cv_subs, cc_subs,
+                             n_vars);
+  else
+    set_mccormick_from_bounds(lbs, ubs, cvs, ccs, cv_subs, cc_subs, n_vars);
+}
+
+void LogOperator::propagate_mccormick(double *lbs, double *ubs, double *cvs,
+                                      double *ccs, double *cv_subs,
+                                      double *cc_subs, unsigned int n_vars) {
+  McSide cv;
+  McSide cc;
+  if (mc_log(operand->get_lb_from_array(lbs), operand->get_ub_from_array(ubs),
+             operand->get_cv_from_array(cvs), operand->get_cc_from_array(ccs),
+             &cv, &cc))
+    set_mccormick_from_sides(cv, cc, lbs, ubs, cvs, ccs, cv_subs, cc_subs,
+                             n_vars);
+  else
+    set_mccormick_from_bounds(lbs, ubs, cvs, ccs, cv_subs, cc_subs, n_vars);
+}
+
+void Log10Operator::propagate_mccormick(double *lbs, double *ubs, double *cvs,
+                                        double *ccs, double *cv_subs,
+                                        double *cc_subs, unsigned int n_vars) {
+  McSide cv;
+  McSide cc;
+  if (mc_log10(operand->get_lb_from_array(lbs),
+               operand->get_ub_from_array(ubs),
+               operand->get_cv_from_array(cvs),
+               operand->get_cc_from_array(ccs), &cv, &cc))
+    set_mccormick_from_sides(cv, cc, lbs, ubs, cvs, ccs, cv_subs, cc_subs,
+                             n_vars);
+  else
+    set_mccormick_from_bounds(lbs, ubs, cvs, ccs, cv_subs, cc_subs, n_vars);
+}
+
+void SqrtOperator::propagate_mccormick(double *lbs, double *ubs, double *cvs,
+                                       double *ccs, double *cv_subs,
+                                       double *cc_subs, unsigned int n_vars) {
+  McSide cv;
+  McSide cc;
+  if (mc_sqrt(operand->get_lb_from_array(lbs), operand->get_ub_from_array(ubs),
+              operand->get_cv_from_array(cvs), operand->get_cc_from_array(ccs),
+              &cv, &cc))
+    set_mccormick_from_sides(cv, cc, lbs, ubs, cvs, ccs, cv_subs, cc_subs,
+                             n_vars);
+  else
+    set_mccormick_from_bounds(lbs, ubs, cvs, ccs, cv_subs, cc_subs, n_vars);
+}
+
+void AbsOperator::propagate_mccormick(double *lbs, double *ubs, double *cvs,
+                                      double *ccs, double *cv_subs,
+                                      double *cc_subs, unsigned int n_vars) {
+  McSide cv;
+  McSide cc;
+  if (mc_abs(operand->get_lb_from_array(lbs), operand->get_ub_from_array(ubs),
+             operand->get_cv_from_array(cvs), operand->get_cc_from_array(ccs),
+             &cv, &cc))
+    set_mccormick_from_sides(cv, cc, lbs, ubs, cvs, ccs, cv_subs, cc_subs,
+                             n_vars);
+  else
+    set_mccormick_from_bounds(lbs, ubs, cvs, ccs, cv_subs, cc_subs, n_vars);
+}
+
 std::vector<std::shared_ptr<Var>> create_vars(int n_vars) {
   std::vector<std::shared_ptr<Var>> res;
   for (int i = 0; i < n_vars; ++i) {
@@ -1785,15 +2295,111 @@ py::tuple prep_for_repn(py::handle expr, PyomoExprTypes &expr_types) {
   return res;
 }
 
-int build_expression_tree(py::handle pyomo_expr,
-                          std::shared_ptr<Node> appsi_expr, py::handle var_map,
-                          py::handle param_map, PyomoExprTypes &expr_types) {
+std::shared_ptr<Node> NamedExpressionCache::find(py::handle named_expr,
+                                                int &num_nodes) {
+  std::map<PyObject *, Entry>::iterator it = entries.find(named_expr.ptr());
+  if (it == entries.end())
+    return nullptr;
+  Entry &entry = it->second;
+  for (Snapshot &snapshot : entry.contents) {
+    if (!snapshot.first.attr("expr").is(snapshot.second)) {
+      replaced_nodes.push_back(entry.node);
+      entries.erase(it);
+      return nullptr;
+    }
+  }
+  if (!pending.empty())
+    pending.back().insert(pending.back().end(), entry.contents.begin(),
+                          entry.contents.end());
+  num_nodes = entry.num_nodes;
+  return entry.node;
+}
+
+void NamedExpressionCache::start(py::handle named_expr) {
+  pending.emplace_back();
+  pending.back().emplace_back(py::reinterpret_borrow<py::object>(named_expr),
+                              named_expr.attr("expr"));
+}
+
+void NamedExpressionCache::add(py::handle named_expr,
+                               std::shared_ptr<Node> node, int num_nodes) {
+  std::vector<Snapshot> contents;
+  contents.swap(pending.back());
+  pending.pop_back();
+  if (!pending.empty())
+    pending.back().insert(pending.back().end(), contents.begin(),
+                          contents.end());
+  // there is nothing to gain from sharing leaves
+  if (num_nodes == 0)
+    return;
+  Entry &entry = entries[named_expr.ptr()];
+  entry.node = node;
+  entry.num_nodes = num_nodes;
+  entry.contents.swap(contents);
+  nodes.push_back(node);
+}
+
+void NamedExpressionCache::cancel() { pending.pop_back(); }
+
+void NamedExpressionCache::retain(const std::set<Node *> &nodes_in_use) {
+  std::map<PyObject *, Entry>::iterator it = entries.begin();
+  while (it != entries.end()) {
+    if (nodes_in_use.count(it->second.node.get()) == 0)
+      it = entries.erase(it);
+    else
+      ++it;
+  }
+}
+
+static int build_expression_tree(py::handle pyomo_expr,
+                                 std::shared_ptr<Node> appsi_expr,
+                                 py::handle var_map, py::handle param_map,
+                                 PyomoExprTypes &expr_types,
+                                 NamedExpressionCache *named_exprs);
+
+// converts pyomo_expr and stores the result in operand; returns the number
+// of operators in the result
+static int build_operand(py::handle pyomo_expr, std::shared_ptr<Node> &operand,
+                         py::handle var_map, py::handle param_map,
+                         PyomoExprTypes &expr_types,
+                         NamedExpressionCache *named_exprs) {
+  int num_nodes;
+  if (named_exprs != nullptr &&
+      expr_types.expr_type_map[py::type::of(pyomo_expr)].cast<ExprType>() ==
+          named_expr) {
+    operand = named_exprs->find(pyomo_expr, num_nodes);
+    if (operand != nullptr)
+      return num_nodes;
+    named_exprs->start(pyomo_expr);
+    try {
+      operand = appsi_operator_from_pyomo_expr(pyomo_expr, var_map, param_map,
+                                               expr_types);
+      num_nodes = build_expression_tree(pyomo_expr, operand, var_map,
+                                        param_map, expr_types, named_exprs);
+    } catch (...) {
+      named_exprs->cancel();
+      throw;
+    }
+    named_exprs->add(pyomo_expr, operand, num_nodes);
+    return num_nodes;
+  }
+  operand =
+      appsi_operator_from_pyomo_expr(pyomo_expr, var_map, param_map, expr_types);
+  return build_expression_tree(pyomo_expr, operand, var_map, param_map,
+                               expr_types, named_exprs);
+}
+
+static int build_expression_tree(py::handle pyomo_expr,
+                                 std::shared_ptr<Node> appsi_expr,
+                                 py::handle var_map, py::handle param_map,
+                                 PyomoExprTypes &expr_types,
+                                 NamedExpressionCache *named_exprs) {
   int num_nodes = 0;
 
   if (expr_types.expr_type_map[py::type::of(pyomo_expr)].cast<ExprType>() ==
       named_expr)
     return build_expression_tree(pyomo_expr.attr("expr"), appsi_expr, var_map,
-                                 param_map, expr_types);
+                                 param_map, expr_types, named_exprs);
 
   if (appsi_expr->is_leaf()) {
     ;
@@ -1802,34 +2408,26 @@ int build_expression_tree(py::handle pyomo_expr,
     std::shared_ptr<BinaryOperator> oper =
         std::dynamic_pointer_cast<BinaryOperator>(appsi_expr);
     py::list pyomo_args = pyomo_expr.attr("args");
-    oper->operand1 = appsi_operator_from_pyomo_expr(pyomo_args[0], var_map,
-                                                    param_map, expr_types);
-    oper->operand2 = appsi_operator_from_pyomo_expr(pyomo_args[1], var_map,
-                                                    param_map, expr_types);
-    num_nodes += build_expression_tree(pyomo_args[0], oper->operand1, var_map,
-                                       param_map, expr_types);
-    num_nodes += build_expression_tree(pyomo_args[1], oper->operand2, var_map,
-                                       param_map, expr_types);
+    num_nodes += build_operand(pyomo_args[0], oper->operand1, var_map,
+                               param_map, expr_types, named_exprs);
+    num_nodes += build_operand(pyomo_args[1], oper->operand2, var_map,
+                               param_map, expr_types, named_exprs);
   } else if (appsi_expr->is_unary_operator()) {
     num_nodes += 1;
     std::shared_ptr<UnaryOperator> oper =
         std::dynamic_pointer_cast<UnaryOperator>(appsi_expr);
     py::list pyomo_args = pyomo_expr.attr("args");
-    oper->operand = appsi_operator_from_pyomo_expr(pyomo_args[0], var_map,
-                                                   param_map, expr_types);
-    num_nodes += build_expression_tree(pyomo_args[0], oper->operand, var_map,
-                                       param_map, expr_types);
+    num_nodes += build_operand(pyomo_args[0], oper->operand, var_map,
+                               param_map, expr_types, named_exprs);
   } else if (appsi_expr->is_sum_operator()) {
     num_nodes += 1;
     std::shared_ptr<SumOperator> oper =
         std::dynamic_pointer_cast<SumOperator>(appsi_expr);
     py::list pyomo_args = pyomo_expr.attr("args");
     for (unsigned int arg_ndx = 0; arg_ndx < oper->nargs; ++arg_ndx) {
-      oper->operands[arg_ndx] = appsi_operator_from_pyomo_expr(
-          pyomo_args[arg_ndx], var_map, param_map, expr_types);
       num_nodes +=
-          build_expression_tree(pyomo_args[arg_ndx], oper->operands[arg_ndx],
-                                var_map, param_map, expr_types);
+          build_operand(pyomo_args[arg_ndx], oper->operands[arg_ndx], var_map,
+                        param_map, expr_types, named_exprs);
     }
   } else if (appsi_expr->is_linear_operator()) {
     num_nodes += 1;
@@ -1851,11 +2449,9 @@ int build_expression_tree(py::handle pyomo_expr,
         std::dynamic_pointer_cast<ExternalOperator>(appsi_expr);
     py::list pyomo_args = pyomo_expr.attr("args");
     for (unsigned int arg_ndx = 0; arg_ndx < oper->nargs; ++arg_ndx) {
-      oper->operands[arg_ndx] = appsi_operator_from_pyomo_expr(
-          pyomo_args[arg_ndx], var_map, param_map, expr_types);
       num_nodes +=
-          build_expression_tree(pyomo_args[arg_ndx], oper->operands[arg_ndx],
-                                var_map, param_map, expr_types);
+          build_operand(pyomo_args[arg_ndx], oper->operands[arg_ndx], var_map,
+                        param_map, expr_types, named_exprs);
     }
   } else {
     throw py::value_error(
@@ -1866,22 +2462,49 @@ int build_expression_tree(py::handle pyomo_expr,
   return num_nodes;
 }
 
-std::shared_ptr<ExpressionBase>
-appsi_expr_from_pyomo_expr(py::handle expr, py::handle var_map,
-                           py::handle param_map, PyomoExprTypes &expr_types) {
-  std::shared_ptr<Node> node =
-      appsi_operator_from_pyomo_expr(expr, var_map, param_map, expr_types);
-  int num_nodes =
-      build_expression_tree(expr, node, var_map, param_map, expr_types);
-  if (num_nodes == 0) {
+int appsi_node_from_pyomo_expr(py::handle expr, std::shared_ptr<Node> &node,
+                               py::handle var_map, py::handle param_map,
+                               PyomoExprTypes &expr_types,
+                               NamedExpressionCache *named_exprs) {
+  return build_operand(expr, node, var_map, param_map, expr_types,
+                       named_exprs);
+}
+
+std::shared_ptr<ExpressionBase> expression_from_node(std::shared_ptr<Node> node,
+                                                     int n_operators) {
+  if (n_operators == 0) {
     return std::dynamic_pointer_cast<ExpressionBase>(node);
   } else {
-    std::shared_ptr<Expression> res = std::make_shared<Expression>(num_nodes);
-    node->fill_expression(res->operators, num_nodes);
+    std::shared_ptr<Expression> res = std::make_shared<Expression>(n_operators);
+    node->fill_expression(res->operators, n_operators);
     return res;
   }
 }
 
+static std::shared_ptr<ExpressionBase>
+_appsi_expr_from_pyomo_expr(py::handle expr, py::handle var_map,
+                            py::handle param_map, PyomoExprTypes &expr_types,
+                            NamedExpressionCache *named_exprs) {
+  std::shared_ptr<Node> node;
+  int num_nodes = build_operand(expr, node, var_map, param_map, expr_types,
+                                named_exprs);
+  return expression_from_node(node, num_nodes);
+}
+
+std::shared_ptr<ExpressionBase>
+appsi_expr_from_pyomo_expr(py::handle expr, py::handle var_map,
+                           py::handle param_map, PyomoExprTypes &expr_types) {
+  return _appsi_expr_from_pyomo_expr(expr, var_map, param_map, expr_types,
+                                     nullptr);
+}
+
+std::shared_ptr<ExpressionBase> appsi_expr_from_pyomo_expr_with_cache(
+    py::handle expr, py::handle var_map, py::handle param_map,
+    PyomoExprTypes &expr_types, NamedExpressionCache &named_exprs) {
+  return _appsi_expr_from_pyomo_expr(expr, var_map, param_map, expr_types,
+                                     &named_exprs);
+}
+
 std::vector<std::shared_ptr<ExpressionBase>>
 appsi_exprs_from_pyomo_exprs(py::list expr_list, py::dict var_map,
                              py::dict param_map) {
@@ -14,6 +14,7 @@
 #define EXPRESSION_HEADER
 
 #include "interval.hpp"
+#include "mccormick.hpp"
 #include <mutex>
 
 class Node;
@@ -37,6 +38,8 @@ class LogOperator;
 class AbsOperator;
 class ExternalOperator;
 class PyomoExprTypes;
+class CCodeWriter;
+class NLStream;
 
 extern double inf;
 
@@ -68,7 +71,7 @@ public:
   virtual std::string get_string_from_array(std::string *) = 0;
   virtual void fill_prefix_notation_stack(
       std::shared_ptr<std::vector<std::shared_ptr<Node>>> stack) = 0;
-  virtual void write_nl_string(std::ofstream &) = 0;
+  virtual void write_nl_string(NLStream &) = 0;
   virtual void fill_expression(std::shared_ptr<Operator> *oper_array,
                                int &oper_ndx) = 0;
   virtual double get_lb_from_array(double *lbs) = 0;
@@ -78,6 +81,12 @@ public:
                       double feasibility_tol, double integer_tol,
                       double improvement_tol,
                       std::set<std::shared_ptr<Var>> &improved_vars) = 0;
+  virtual double get_cv_from_array(double *cvs) = 0;
+  virtual double get_cc_from_array(double *ccs) = 0;
+  virtual void add_subgradient_from_array(double coef, McSource src,
+                                          double *cv_subs, double *cc_subs,
+                                          unsigned int n_vars,
+                                          double *res) = 0;
 };
 
 class ExpressionBase : public Node {
@@ -89,6 +98,8 @@ public:
   identify_variables() = 0;
   virtual std::shared_ptr<std::vector<std::shared_ptr<ExternalOperator>>>
   identify_external_operators() = 0;
+  virtual std::shared_ptr<std::vector<std::shared_ptr<Param>>>
+  identify_params() = 0;
   virtual std::shared_ptr<std::vector<std::shared_ptr<Node>>>
   get_prefix_notation() = 0;
   std::shared_ptr<ExpressionBase> shared_from_this() {
@@ -121,6 +132,11 @@ public:
                       double feasibility_tol, double integer_tol,
                       double improvement_tol,
                       std::set<std::shared_ptr<Var>> &improved_vars) override;
+  double get_cv_from_array(double *cvs) override;
+  double get_cc_from_array(double *ccs) override;
+  void add_subgradient_from_array(double coef, McSource src, double *cv_subs,
+                                  double *cc_subs, unsigned int n_vars,
+                                  double *res) override;
 };
 
 class Constant : public Leaf {
@@ -134,7 +150,9 @@ public:
   identify_variables() override;
   std::shared_ptr<std::vector<std::shared_ptr<ExternalOperator>>>
   identify_external_operators() override;
-  void write_nl_string(std::ofstream &) override;
+  std::shared_ptr<std::vector<std::shared_ptr<Param>>>
+  identify_params() override;
+  void write_nl_string(NLStream &) override;
 };
 
 enum Domain { continuous, binary, integers };
@@ -160,7 +178,9 @@ public:
   identify_variables() override;
   std::shared_ptr<std::vector<std::shared_ptr<ExternalOperator>>>
   identify_external_operators() override;
-  void write_nl_string(std::ofstream &) override;
+  std::shared_ptr<std::vector<std::shared_ptr<Param>>>
+  identify_params() override;
+  void write_nl_string(NLStream &) override;
   std::shared_ptr<Var> shared_from_this() {
     return std::static_pointer_cast<Var>(Node::shared_from_this());
   }
@@ -174,6 +194,11 @@ public:
                       double feasibility_tol, double integer_tol,
                       double improvement_tol,
                       std::set<std::shared_ptr<Var>> &improved_vars) override;
+  double get_cv_from_array(double *cvs) override;
+  double get_cc_from_array(double *ccs) override;
+  void add_subgradient_from_array(double coef, McSource src, double *cv_subs,
+                                  double *cc_subs, unsigned int n_vars,
+                                  double *res) override;
 };
 
 class Param : public Leaf {
@@ -190,7 +215,9 @@ public:
   identify_variables() override;
   std::shared_ptr<std::vector<std::shared_ptr<ExternalOperator>>>
   identify_external_operators() override;
-  void write_nl_string(std::ofstream &) override;
+  std::shared_ptr<std::vector<std::shared_ptr<Param>>>
+  identify_params() override;
+  void write_nl_string(NLStream &) override;
 };
 
 class Expression : public ExpressionBase {
@@ -209,10 +236,12 @@ public:
   identify_variables() override;
   std::shared_ptr<std::vector<std::shared_ptr<ExternalOperator>>>
   identify_external_operators() override;
+  std::shared_ptr<std::vector<std::shared_ptr<Param>>>
+  identify_params() override;
   std::string get_string_from_array(std::string *) override;
   std::shared_ptr<std::vector<std::shared_ptr<Node>>>
   get_prefix_notation() override;
-  void write_nl_string(std::ofstream &) override;
+  void write_nl_string(NLStream &) override;
   std::vector<std::shared_ptr<Operator>> get_operators();
   std::shared_ptr<Operator> *operators;
   unsigned int n_operators;
@@ -231,6 +260,14 @@ public:
                       double feasibility_tol, double integer_tol,
                       double improvement_tol,
                       std::set<std::shared_ptr<Var>> &improved_vars) override;
+  void propagate_mccormick(double *lbs, double *ubs, double *cvs, double *ccs,
+                           double *cv_subs, double *cc_subs,
+                           unsigned int n_vars);
+  double get_cv_from_array(double *cvs) override;
+  double get_cc_from_array(double *ccs) override;
+  void add_subgradient_from_array(double coef, McSource src, double *cv_subs,
+                                  double *cc_subs, unsigned int n_vars,
+                                  double *res) override;
 };
 
 class Operator : public Node {
@@ -242,6 +279,9 @@ public:
   virtual void
   identify_variables(std::set<std::shared_ptr<Node>> &,
                      std::shared_ptr<std::vector<std::shared_ptr<Var>>>) = 0;
+  virtual void
+  identify_params(std::set<std::shared_ptr<Node>> &,
+                  std::shared_ptr<std::vector<std::shared_ptr<Param>>>) = 0;
   std::shared_ptr<Operator> shared_from_this() {
     return std::static_pointer_cast<Operator>(Node::shared_from_this());
   }
@@ -265,6 +305,20 @@ public:
                       double feasibility_tol, double integer_tol,
                       double improvement_tol,
                       std::set<std::shared_ptr<Var>> &improved_vars) override;
+  virtual void propagate_mccormick(double *lbs, double *ubs, double *cvs,
+                                   double *ccs, double *cv_subs,
+                                   double *cc_subs, unsigned int n_vars);
+  double get_cv_from_array(double *cvs) override;
+  double get_cc_from_array(double *ccs) override;
+  void add_subgradient_from_array(double coef, McSource src, double *cv_subs,
+                                  double *cc_subs, unsigned int n_vars,
+                                  double *res) override;
+  void set_mccormick_from_bounds(double *lbs, double *ubs, double *cvs,
+                                 double *ccs, double *cv_subs, double *cc_subs,
+                                 unsigned int n_vars);
+  void clip_mccormick(double *lbs, double *ubs, double *cvs, double *ccs,
+                      double *cv_subs, double *cc_subs, unsigned int n_vars);
+  virtual void write_c_code(CCodeWriter &w);
 };
 
 class BinaryOperator : public Operator {
@@ -274,6 +328,9 @@ public:
   void identify_variables(
       std::set<std::shared_ptr<Node>> &,
       std::shared_ptr<std::vector<std::shared_ptr<Var>>>) override;
+  void identify_params(
+      std::set<std::shared_ptr<Node>> &,
+      std::shared_ptr<std::vector<std::shared_ptr<Param>>>) override;
   std::shared_ptr<Node> operand1;
   std::shared_ptr<Node> operand2;
   void fill_prefix_notation_stack(
@@ -290,6 +347,9 @@ public:
   void identify_variables(
       std::set<std::shared_ptr<Node>> &,
       std::shared_ptr<std::vector<std::shared_ptr<Var>>>) override;
+  void identify_params(
+      std::set<std::shared_ptr<Node>> &,
+      std::shared_ptr<std::vector<std::shared_ptr<Param>>>) override;
   std::shared_ptr<Node> operand;
   void fill_prefix_notation_stack(
       std::shared_ptr<std::vector<std::shared_ptr<Node>>> stack) override;
@@ -297,6 +357,10 @@ public:
   void propagate_degree_forward(int *degrees, double *values) override;
   void fill_expression(std::shared_ptr<Operator> *oper_array,
                        int &oper_ndx) override;
+  void set_mccormick_from_sides(McSide &cv, McSide &cc, double *lbs,
+                                double *ubs, double *cvs, double *ccs,
+                                double *cv_subs, double *cc_subs,
+                                unsigned int n_vars);
 };
 
 class LinearOperator : public Operator {
@@ -313,6 +377,9 @@ public:
   void identify_variables(
       std::set<std::shared_ptr<Node>> &,
       std::shared_ptr<std::vector<std::shared_ptr<Var>>>) override;
+  void identify_params(
+      std::set<std::shared_ptr<Node>> &,
+      std::shared_ptr<std::vector<std::shared_ptr<Param>>>) override;
   std::shared_ptr<Var> *variables;
   std::shared_ptr<ExpressionBase> *coefficients;
   std::shared_ptr<ExpressionBase> constant = std::make_shared<Constant>(0);
@@ -320,7 +387,8 @@ public:
   void propagate_degree_forward(int *degrees, double *values) override;
   void print(std::string *) override;
   std::string name() override { return "LinearOperator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_c_code(CCodeWriter &w) override;
+  void write_nl_string(NLStream &) override;
   void fill_prefix_notation_stack(
       std::shared_ptr<std::vector<std::shared_ptr<Node>>> stack) override;
   bool is_linear_operator() override;
@@ -334,6 +402,9 @@ public:
       double *lbs, double *ubs, double feasibility_tol, double integer_tol,
       double improvement_tol,
       std::set<std::shared_ptr<Var>> &improved_vars) override;
+  void propagate_mccormick(double *lbs, double *ubs, double *cvs, double *ccs,
+                           double *cv_subs, double *cc_subs,
+                           unsigned int n_vars) override;
 };
 
 class SumOperator : public Operator {
@@ -346,11 +417,15 @@ public:
   void identify_variables(
       std::set<std::shared_ptr<Node>> &,
       std::shared_ptr<std::vector<std::shared_ptr<Var>>>) override;
+  void identify_params(
+      std::set<std::shared_ptr<Node>> &,
+      std::shared_ptr<std::vector<std::shared_ptr<Param>>>) override;
   void evaluate(double *values) override;
   void propagate_degree_forward(int *degrees, double *values) override;
   void print(std::string *) override;
   std::string name() override { return "SumOperator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_c_code(CCodeWriter &w) override;
+  void write_nl_string(NLStream &) override;
   void fill_prefix_notation_stack(
       std::shared_ptr<std::vector<std::shared_ptr<Node>>> stack) override;
   bool is_sum_operator() override;
@@ -365,6 +440,9 @@ public:
       double *lbs, double *ubs, double feasibility_tol, double integer_tol,
       double improvement_tol,
       std::set<std::shared_ptr<Var>> &improved_vars) override;
+  void propagate_mccormick(double *lbs, double *ubs, double *cvs, double *ccs,
+                           double *cv_subs, double *cc_subs,
+                           unsigned int n_vars) override;
 };
 
 class MultiplyOperator : public BinaryOperator {
@@ -374,7 +452,8 @@ public:
   void propagate_degree_forward(int *degrees, double *values) override;
   void print(std::string *) override;
   std::string name() override { return "MultiplyOperator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_c_code(CCodeWriter &w) override;
+  void write_nl_string(NLStream &) override;
   bool is_multiply_operator() override;
   void propagate_bounds_forward(double *lbs, double *ubs,
                                 double feasibility_tol,
@@ -383,6 +462,9 @@ public:
       double *lbs, double *ubs, double feasibility_tol, double integer_tol,
       double improvement_tol,
       std::set<std::shared_ptr<Var>> &improved_vars) override;
+  void propagate_mccormick(double *lbs, double *ubs, double *cvs, double *ccs,
+                           double *cv_subs, double *cc_subs,
+                           unsigned int n_vars) override;
 };
 
 class ExternalOperator : public Operator {
@@ -396,12 +478,15 @@ public:
   void propagate_degree_forward(int *degrees, double *values) override;
   void print(std::string *) override;
   std::string name() override { return "ExternalOperator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_nl_string(NLStream &) override;
   void fill_prefix_notation_stack(
       std::shared_ptr<std::vector<std::shared_ptr<Node>>> stack) override;
   void identify_variables(
       std::set<std::shared_ptr<Node>> &,
       std::shared_ptr<std::vector<std::shared_ptr<Var>>>) override;
+  void identify_params(
+      std::set<std::shared_ptr<Node>> &,
+      std::shared_ptr<std::vector<std::shared_ptr<Param>>>) override;
   bool is_external_operator() override;
   std::string function_name;
   int external_function_index = -1;
@@ -418,7 +503,8 @@ public:
   void propagate_degree_forward(int *degrees, double *values) override;
   void print(std::string *) override;
   std::string name() override { return "DivideOperator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_c_code(CCodeWriter &w) override;
+  void write_nl_string(NLStream &) override;
   bool is_divide_operator() override;
   void propagate_bounds_forward(double *lbs, double *ubs,
                                 double feasibility_tol,
@@ -427,6 +513,9 @@ public:
       double *lbs, double *ubs, double feasibility_tol, double integer_tol,
       double improvement_tol,
       std::set<std::shared_ptr<Var>> &improved_vars) override;
+  void propagate_mccormick(double *lbs, double *ubs, double *cvs, double *ccs,
+                           double *cv_subs, double *cc_subs,
+                           unsigned int n_vars) override;
 };
 
 class PowerOperator : public BinaryOperator {
@@ -436,7 +525,8 @@ public:
   void propagate_degree_forward(int *degrees, double *values) override;
   void print(std::string *) override;
   std::string name() override { return "PowerOperator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_c_code(CCodeWriter &w) override;
+  void write_nl_string(NLStream &) override;
   bool is_power_operator() override;
   void propagate_bounds_forward(double *lbs, double *ubs,
                                 double feasibility_tol,
@@ -445,6 +535,9 @@ public:
       double *lbs, double *ubs, double feasibility_tol, double integer_tol,
       double improvement_tol,
       std::set<std::shared_ptr<Var>> &improved_vars) override;
+  void propagate_mccormick(double *lbs, double *ubs, double *cvs, double *ccs,
+                           double *cv_subs, double *cc_subs,
+                           unsigned int n_vars) override;
 };
 
 class NegationOperator : public UnaryOperator {
@@ -454,7 +547,8 @@ public:
   void propagate_degree_forward(int *degrees, double *values) override;
   void print(std::string *) override;
   std::string name() override { return "NegationOperator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_c_code(CCodeWriter &w) override;
+  void write_nl_string(NLStream &) override;
   bool is_negation_operator() override;
   void propagate_bounds_forward(double *lbs, double *ubs,
                                 double feasibility_tol,
@@ -463,6 +557,9 @@ public:
       double *lbs, double *ubs, double feasibility_tol, double integer_tol,
       double improvement_tol,
       std::set<std::shared_ptr<Var>> &improved_vars) override;
+  void propagate_mccormick(double *lbs, double *ubs, double *cvs, double *ccs,
+                           double *cv_subs, double *cc_subs,
+                           unsigned int n_vars) override;
 };
 
 class ExpOperator : public UnaryOperator {
@@ -471,7 +568,8 @@ public:
   void evaluate(double *values) override;
   void print(std::string *) override;
   std::string name() override { return "ExpOperator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_c_code(CCodeWriter &w) override;
+  void write_nl_string(NLStream &) override;
   bool is_exp_operator() override;
   void propagate_bounds_forward(double *lbs, double *ubs,
                                 double feasibility_tol,
@@ -480,6 +578,9 @@ public:
       double *lbs, double *ubs, double feasibility_tol, double integer_tol,
       double improvement_tol,
       std::set<std::shared_ptr<Var>> &improved_vars) override;
+  void propagate_mccormick(double *lbs, double *ubs, double *cvs, double *ccs,
+                           double *cv_subs, double *cc_subs,
+                           unsigned int n_vars) override;
 };
 
 class LogOperator : public UnaryOperator {
@@ -488,7 +589,8 @@ public:
   void evaluate(double *values) override;
   void print(std::string *) override;
   std::string name() override { return "LogOperator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_c_code(CCodeWriter &w) override;
+  void write_nl_string(NLStream &) override;
   bool is_log_operator() override;
   void propagate_bounds_forward(double *lbs, double *ubs,
                                 double feasibility_tol,
@@ -497,6 +599,9 @@ public:
       double *lbs, double *ubs, double feasibility_tol, double integer_tol,
       double improvement_tol,
       std::set<std::shared_ptr<Var>> &improved_vars) override;
+  void propagate_mccormick(double *lbs, double *ubs, double *cvs, double *ccs,
+                           double *cv_subs, double *cc_subs,
+                           unsigned int n_vars) override;
 };
 
 class AbsOperator : public UnaryOperator {
@@ -505,7 +610,8 @@ public:
   void evaluate(double *values) override;
   void print(std::string *) override;
   std::string name() override { return "AbsOperator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_c_code(CCodeWriter &w) override;
+  void write_nl_string(NLStream &) override;
   bool is_abs_operator() override;
   void propagate_bounds_forward(double *lbs, double *ubs,
                                 double feasibility_tol,
@@ -514,6 +620,9 @@ public:
       double *lbs, double *ubs, double feasibility_tol, double integer_tol,
       double improvement_tol,
       std::set<std::shared_ptr<Var>> &improved_vars) override;
+  void propagate_mccormick(double *lbs, double *ubs, double *cvs, double *ccs,
+                           double *cv_subs, double *cc_subs,
+                           unsigned int n_vars) override;
 };
 
 class SqrtOperator : public UnaryOperator {
@@ -522,7 +631,8 @@ public:
   void evaluate(double *values) override;
   void print(std::string *) override;
   std::string name() override { return "SqrtOperator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_c_code(CCodeWriter &w) override;
+  void write_nl_string(NLStream &) override;
   bool is_sqrt_operator() override;
   void propagate_bounds_forward(double *lbs, double *ubs,
                                 double feasibility_tol,
@@ -531,6 +641,9 @@ public:
       double *lbs, double *ubs, double feasibility_tol, double integer_tol,
       double improvement_tol,
       std::set<std::shared_ptr<Var>> &improved_vars) override;
+  void propagate_mccormick(double *lbs, double *ubs, double *cvs, double *ccs,
+                           double *cv_subs, double *cc_subs,
+                           unsigned int n_vars) override;
 };
 
 class Log10Operator : public UnaryOperator {
@@ -539,7 +652,8 @@ public:
   void evaluate(double *values) override;
   void print(std::string *) override;
   std::string name() override { return "Log10Operator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_c_code(CCodeWriter &w) override;
+  void write_nl_string(NLStream &) override;
   void propagate_bounds_forward(double *lbs, double *ubs,
                                 double feasibility_tol,
                                 double integer_tol) override;
@@ -547,6 +661,9 @@ public:
       double *lbs, double *ubs, double feasibility_tol, double integer_tol,
       double improvement_tol,
       std::set<std::shared_ptr<Var>> &improved_vars) override;
+  void propagate_mccormick(double *lbs, double *ubs, double *cvs, double *ccs,
+                           double *cv_subs, double *cc_subs,
+                           unsigned int n_vars) override;
 };
 
 class SinOperator : public UnaryOperator {
@@ -555,7 +672,8 @@ public:
   void evaluate(double *values) override;
   void print(std::string *) override;
   std::string name() override { return "SinOperator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_c_code(CCodeWriter &w) override;
+  void write_nl_string(NLStream &) override;
   void propagate_bounds_forward(double *lbs, double *ubs,
                                 double feasibility_tol,
                                 double integer_tol) override;
@@ -571,7 +689,8 @@ public:
   void evaluate(double *values) override;
   void print(std::string *) override;
   std::string name() override { return "CosOperator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_c_code(CCodeWriter &w) override;
+  void write_nl_string(NLStream &) override;
   void propagate_bounds_forward(double *lbs, double *ubs,
                                 double feasibility_tol,
                                 double integer_tol) override;
@@ -587,7 +706,8 @@ public:
   void evaluate(double *values) override;
   void print(std::string *) override;
   std::string name() override { return "TanOperator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_c_code(CCodeWriter &w) override;
+  void write_nl_string(NLStream &) override;
   void propagate_bounds_forward(double *lbs, double *ubs,
                                 double feasibility_tol,
                                 double integer_tol) override;
@@ -603,7 +723,8 @@ public:
   void evaluate(double *values) override;
   void print(std::string *) override;
   std::string name() override { return "AsinOperator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_c_code(CCodeWriter &w) override;
+  void write_nl_string(NLStream &) override;
   void propagate_bounds_forward(double *lbs, double *ubs,
                                 double feasibility_tol,
                                 double integer_tol) override;
@@ -619,7 +740,8 @@ public:
   void evaluate(double *values) override;
   void print(std::string *) override;
   std::string name() override { return "AcosOperator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_c_code(CCodeWriter &w) override;
+  void write_nl_string(NLStream &) override;
   void propagate_bounds_forward(double *lbs, double *ubs,
                                 double feasibility_tol,
                                 double integer_tol) override;
@@ -635,7 +757,8 @@ public:
   void evaluate(double *values) override;
   void print(std::string *) override;
   std::string name() override { return "AtanOperator"; };
-  void write_nl_string(std::ofstream &) override;
+  void write_c_code(CCodeWriter &w) override;
+  void write_nl_string(NLStream &) override;
   void propagate_bounds_forward(double *lbs, double *ubs,
                                 double feasibility_tol,
                                 double integer_tol) override;
@@ -780,12 +903,73 @@ public:
   py::dict expr_type_map;
 };
 
+// Remembers the node each Pyomo named expression was converted to, so that a
+// named expression referenced from several places is converted once and
+// becomes a shared node. The resulting expressions are DAGs; only the NL
+// writer, which emits shared nodes as defined variables, converts with a
+// cache.
+class NamedExpressionCache {
+public:
+  NamedExpressionCache() = default;
+  // returns nullptr if named_expr has not been converted or if its
+  // expression, or that of a named expression it contains, was replaced
+  // since it was converted
+  std::shared_ptr<Node> find(py::handle named_expr, int &num_nodes);
+  // start is called before converting named_expr and add (or cancel, if
+  // the conversion fails) after it; named expressions converted or found in
+  // between are the ones it contains. Named expressions that convert to a
+  // leaf are not cached, but the expressions containing them are checked
+  // for changes to them as well.
+  void start(py::handle named_expr);
+  void add(py::handle named_expr, std::shared_ptr<Node> node, int num_nodes);
+  void cancel();
+  // drops the entries whose node is not in nodes_in_use, e.g., after the
+  // constraints that used them were removed
+  void retain(const std::set<Node *> &nodes_in_use);
+  // the converted nodes in the order they were added; a named expression is
+  // always added after the named expressions it contains
+  std::vector<std::shared_ptr<Node>> nodes;
+  // nodes that were replaced because their named expression changed
+  std::vector<std::shared_ptr<Node>> replaced_nodes;
+
+private:
+  // a named expression and the expression it had when it was converted
+  typedef std::pair<py::object, py::object> Snapshot;
+  struct Entry {
+    std::shared_ptr<Node> node;
+    int num_nodes;
+    // the named expression itself and all the named expressions below it
+    std::vector<Snapshot> contents;
+  };
+  // keeping a reference to the named expression (in contents) also keeps
+  // its id from being reused
+  std::map<PyObject *, Entry> entries;
+  // the contents of the named expressions being converted, innermost last
+  std::vector<std::vector<Snapshot>> pending;
+};
+
 std::vector<std::shared_ptr<Var>> create_vars(int n_vars);
 std::vector<std::shared_ptr<Param>> create_params(int n_params);
 std::vector<std::shared_ptr<Constant>> create_constants(int n_constants);
+std::shared_ptr<Node>
+appsi_operator_from_pyomo_expr(py::handle expr, py::handle var_map,
+                               py::handle param_map,
+                               PyomoExprTypes &expr_types);
+// converts expr and stores the result in node; returns the number of
+// operators in the result (named_exprs may be nullptr)
+int appsi_node_from_pyomo_expr(py::handle expr, std::shared_ptr<Node> &node,
+                               py::handle var_map, py::handle param_map,
+                               PyomoExprTypes &expr_types,
+                               NamedExpressionCache *named_exprs);
+// the expression with root node, which has n_operators operators
+std::shared_ptr<ExpressionBase> expression_from_node(std::shared_ptr<Node> node,
+                                                     int n_operators);
 std::shared_ptr<ExpressionBase>
 appsi_expr_from_pyomo_expr(py::handle expr, py::handle var_map,
                            py::handle param_map, PyomoExprTypes &expr_types);
+std::shared_ptr<ExpressionBase> appsi_expr_from_pyomo_expr_with_cache(
+    py::handle expr, py::handle var_map, py::handle param_map,
+    PyomoExprTypes &expr_types, NamedExpressionCache &named_exprs);
 std::vector<std::shared_ptr<ExpressionBase>>
 appsi_exprs_from_pyomo_exprs(py::list expr_list, py::dict var_map,
                              py::dict param_map);
@@ -103,11 +103,9 @@ FBBTModel::get_var_to_con_map() {
       var_to_con_map = std::make_shared<
           std::map<std::shared_ptr<Var>,
                    std::vector<std::shared_ptr<FBBTConstraint>>>>();
-  current_con_ndx = 0;
+  compact_constraints();
   std::shared_ptr<FBBTConstraint> fbbt_c;
   for (const std::shared_ptr<Constraint> &c : constraints) {
-    c->index = current_con_ndx;
-    current_con_ndx += 1;
     fbbt_c = std::dynamic_pointer_cast<FBBTConstraint>(c);
     for (const std::shared_ptr<Var> &v : *(fbbt_c->variables)) {
       (*var_to_con_map)[v].push_back(fbbt_c);
@@ -126,7 +124,8 @@ unsigned int FBBTModel::perform_fbbt_on_cons(
   std::set<std::shared_ptr<Var>> improved_vars_set;
 
   std::vector<std::shared_ptr<FBBTConstraint>> cons_to_fbbt = seed_cons;
-  std::set<std::shared_ptr<FBBTConstraint>> cons_to_fbbt_set;
+  // indexed by Constraint::index (get_var_to_con_map compacts the slots)
+  std::vector<char> queued(constraints.n_slots(), 0);
   unsigned int _iter = 0;
   while (_iter < max_iter * constraints.size() && cons_to_fbbt.size() > 0) {
     _iter += cons_to_fbbt.size();
@@ -136,16 +135,18 @@ unsigned int FBBTModel::perform_fbbt_on_cons(
     }
 
     cons_to_fbbt.clear();
-    cons_to_fbbt_set.clear();
 
     for (const std::shared_ptr<Var> &v : improved_vars_set) {
       for (const std::shared_ptr<FBBTConstraint> &c : var_to_con_map->at(v)) {
-        if (cons_to_fbbt_set.count(c) == 0) {
-          cons_to_fbbt_set.insert(c);
+        if (!queued[c->index]) {
+          queued[c->index] = 1;
           cons_to_fbbt.push_back(c);
         }
       }
     }
+    for (const std::shared_ptr<FBBTConstraint> &c : cons_to_fbbt) {
+      queued[c->index] = 0;
+    }
     std::sort(cons_to_fbbt.begin(), cons_to_fbbt.end(), constraint_sorter);
     improved_vars_set.clear();
   }
@@ -191,6 +192,35 @@ unsigned int FBBTModel::perform_fbbt(double feasibility_tol, double integer_tol,
                               deactivate_satisfied_constraints, var_to_con_map);
 }
 
+void FBBTModel::add_to_memory_report(MemoryReport &report) {
+  Model::add_to_memory_report(report);
+  size_t &constraints_bytes = report["constraints"];
+  size_t &incidence = report["incidence"];
+  size_t &bounds = report["fbbt_bounds"];
+  std::shared_ptr<FBBTConstraint> fbbt_con;
+  unsigned int n_bounds;
+  for (const std::shared_ptr<Constraint> &con : constraints) {
+    fbbt_con = std::dynamic_pointer_cast<FBBTConstraint>(con);
+    report.add_shared(constraints_bytes, sizeof(FBBTConstraint));
+    report.add_node(fbbt_con->body);
+    report.add_shared_vector(incidence, fbbt_con->variables);
+    // lbs and ubs have an entry per operator of the body (see the
+    // constructor)
+    n_bounds = 1;
+    if (fbbt_con->body->is_expression_type())
+      n_bounds =
+          std::dynamic_pointer_cast<Expression>(fbbt_con->body)->n_operators;
+    report.add_allocation(bounds, n_bounds * sizeof(double));
+    report.add_allocation(bounds, n_bounds * sizeof(double));
+  }
+  std::shared_ptr<FBBTObjective> fbbt_obj =
+      std::dynamic_pointer_cast<FBBTObjective>(objective);
+  if (fbbt_obj != nullptr) {
+    report.add_shared(constraints_bytes, sizeof(FBBTObjective));
+    report.add_node(fbbt_obj->expr);
+  }
+}
+
 void process_fbbt_constraints(FBBTModel *model, PyomoExprTypes &expr_types,
                               py::list cons, py::dict var_map,
                               py::dict param_map, py::dict active_constraints,
@@ -229,6 +259,7 @@ void process_fbbt_constraints(FBBTModel *model, PyomoExprTypes &expr_types,
 
     ccon = std::make_shared<FBBTConstraint>(ccon_lb, ccon_body, ccon_ub);
     model->add_constraint(ccon);
+    model->add_dependencies(ccon, {ccon_body, ccon_lb, ccon_ub});
     con_map[c] = py::cast(ccon);
     rev_con_map[py::cast(ccon)] = c;
   }
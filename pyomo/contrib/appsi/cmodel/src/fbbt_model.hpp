@@ -63,6 +63,9 @@ public:
   std::shared_ptr<std::map<std::shared_ptr<Var>,
                            std::vector<std::shared_ptr<FBBTConstraint>>>>
   get_var_to_con_map();
+  // the map from the vars to the constraints is built by each call to
+  // perform_fbbt and is not included
+  void add_to_memory_report(MemoryReport &report) override;
 };
 
 void process_fbbt_constraints(FBBTModel *model, PyomoExprTypes &expr_types,
@@ -11,162 +11,249 @@
 **/
 
 #include "lp_writer.hpp"
+#include "buffered_sink.hpp"
+#include <functional>
 
-void write_expr(std::ofstream &f, std::shared_ptr<LPBase> obj,
-                bool is_objective) {
-  double coef;
-  for (unsigned int ndx = 0; ndx < obj->linear_coefficients->size(); ++ndx) {
-    coef = obj->linear_coefficients->at(ndx)->evaluate();
-    if (coef >= 0) {
-      f << "+";
-    } else {
-      f << "-";
+std::vector<std::shared_ptr<ExpressionBase>>
+LPBase::get_exprs(std::vector<std::shared_ptr<ExpressionBase>> exprs) {
+  exprs.push_back(constant_expr);
+  exprs.insert(exprs.end(), linear_coefficients->begin(),
+               linear_coefficients->end());
+  exprs.insert(exprs.end(), quadratic_coefficients->begin(),
+               quadratic_coefficients->end());
+  return exprs;
+}
+
+void LPBase::find_params(std::vector<std::shared_ptr<ExpressionBase>> exprs) {
+  exprs = get_exprs(exprs);
+  std::set<std::shared_ptr<Param>> param_set;
+  std::shared_ptr<std::vector<std::shared_ptr<Param>>> expr_params;
+  params.clear();
+  for (std::shared_ptr<ExpressionBase> &expr : exprs) {
+    // most coefficients are plain numbers
+    if (expr->is_constant_type())
+      continue;
+    expr_params = expr->identify_params();
+    for (std::shared_ptr<Param> &p : *expr_params) {
+      if (param_set.count(p) == 0) {
+        params.push_back(p);
+        param_set.insert(p);
+      }
     }
-    f << std::abs(coef) << " ";
-    f << obj->linear_vars->at(ndx)->name << " \n";
-  }
-  if (is_objective) {
-    f << "+1 obj_const \n";
   }
+  params_found = true;
+  cached_text_valid = false;
+}
 
-  if (obj->quadratic_coefficients->size() != 0) {
-    f << "+ [ \n";
-    for (unsigned int ndx = 0; ndx < obj->quadratic_coefficients->size();
-         ++ndx) {
-      coef = obj->quadratic_coefficients->at(ndx)->evaluate();
-      if (is_objective) {
-        coef *= 2;
+bool LPBase::evaluates_operators(
+    std::vector<std::shared_ptr<ExpressionBase>> exprs) {
+  if (!operators_checked) {
+    for (std::shared_ptr<ExpressionBase> &expr : get_exprs(exprs)) {
+      if (!expr->is_leaf()) {
+        has_operators = true;
+        break;
       }
-      if (coef >= 0) {
-        f << "+";
-      } else {
-        f << "-";
-      }
-      f << std::abs(coef) << " ";
-      f << obj->quadratic_vars_1->at(ndx)->name << " * ";
-      f << obj->quadratic_vars_2->at(ndx)->name << " \n";
     }
-    f << "] ";
-    if (is_objective) {
-      f << "/ 2 ";
+    operators_checked = true;
+  }
+  return has_operators;
+}
+
+bool LPBase::check_cached_text() {
+  bool valid = cached_text_valid;
+  cached_param_values.resize(params.size());
+  unsigned int ndx = 0;
+  for (std::shared_ptr<Param> &p : params) {
+    if (cached_param_values[ndx] != p->value) {
+      cached_param_values[ndx] = p->value;
+      valid = false;
     }
-    f << "\n";
+    ++ndx;
   }
+  cached_text_valid = true;
+  return valid;
 }
 
-void LPWriter::write(std::string filename) {
-  std::ofstream f;
-  f.open(filename);
-  f.precision(17);
+void LPBase::add_to_memory_report(MemoryReport &report) {
+  size_t &terms = report["terms"];
+  report.add_node(constant_expr);
+  report.add_shared_vector(terms, linear_coefficients);
+  report.add_shared_vector(terms, linear_vars);
+  report.add_shared_vector(terms, quadratic_coefficients);
+  report.add_shared_vector(terms, quadratic_vars_1);
+  report.add_shared_vector(terms, quadratic_vars_2);
+  for (std::shared_ptr<ExpressionBase> &coef : *linear_coefficients) {
+    report.add_node(coef);
+  }
+  for (std::shared_ptr<ExpressionBase> &coef : *quadratic_coefficients) {
+    report.add_node(coef);
+  }
+  for (std::shared_ptr<Var> &v : *linear_vars) {
+    report.add_node(v);
+  }
+  for (std::shared_ptr<Var> &v : *quadratic_vars_1) {
+    report.add_node(v);
+  }
+  for (std::shared_ptr<Var> &v : *quadratic_vars_2) {
+    report.add_node(v);
+  }
+  size_t &text = report["text_cache"];
+  report.add_string(text, cached_text);
+  report.add_vector(text, params);
+  report.add_vector(text, cached_param_values);
+}
 
-  std::shared_ptr<LPObjective> lp_objective =
-      std::dynamic_pointer_cast<LPObjective>(objective);
+static inline void write_term_coef(BufferedSink &f, double coef) {
+  f << (coef >= 0 ? '+' : '-') << std::abs(coef) << ' ';
+}
 
-  if (lp_objective->sense == 0) {
-    f << "minimize\n";
+// With compact labels, a variable is written as x followed by its column
+// (v.index, which write sets to the position of v in the active variables)
+static inline void write_var_label(BufferedSink &f, Var &v, bool compact) {
+  if (compact) {
+    f << 'x' << v.index;
   } else {
-    f << "maximize\n";
+    f << v.name;
   }
+}
 
-  f << lp_objective->name << ": \n";
-  write_expr(f, lp_objective, true);
-
-  f << "\ns.t.\n\n";
-
-  std::vector<std::shared_ptr<LPConstraint>> sorted_constraints;
-  for (std::shared_ptr<Constraint> con : constraints) {
-    sorted_constraints.push_back(std::dynamic_pointer_cast<LPConstraint>(con));
+void write_expr(BufferedSink &f, std::shared_ptr<LPBase> obj,
+                bool is_objective, bool compact) {
+  std::vector<std::shared_ptr<ExpressionBase>> &linear_coefs =
+      *(obj->linear_coefficients);
+  std::vector<std::shared_ptr<Var>> &linear_vars = *(obj->linear_vars);
+  for (unsigned int ndx = 0; ndx < linear_coefs.size(); ++ndx) {
+    write_term_coef(f, linear_coefs[ndx]->evaluate());
+    write_var_label(f, *linear_vars[ndx], compact);
+    f << " \n";
   }
-  int sorted_con_index = 0;
-  for (std::shared_ptr<LPConstraint> con : sorted_constraints) {
-    con->index = sorted_con_index;
-    sorted_con_index += 1;
+  if (is_objective) {
+    f << "+1 obj_const \n";
   }
-  current_con_ndx = constraints.size();
 
-  std::vector<std::shared_ptr<LPConstraint>> active_constraints;
-  for (std::shared_ptr<LPConstraint> con : sorted_constraints) {
-    if (con->active) {
-      active_constraints.push_back(con);
+  std::vector<std::shared_ptr<ExpressionBase>> &quadratic_coefs =
+      *(obj->quadratic_coefficients);
+  if (quadratic_coefs.size() != 0) {
+    f << "+ [ \n";
+    double coef;
+    for (unsigned int ndx = 0; ndx < quadratic_coefs.size(); ++ndx) {
+      coef = quadratic_coefs[ndx]->evaluate();
+      if (is_objective) {
+        coef *= 2;
+      }
+      write_term_coef(f, coef);
+      write_var_label(f, *obj->quadratic_vars_1->at(ndx), compact);
+      f << " * ";
+      write_var_label(f, *obj->quadratic_vars_2->at(ndx), compact);
+      f << " \n";
     }
+    f << "] ";
+    if (is_objective) {
+      f << "/ 2 ";
+    }
+    f << "\n";
   }
+}
 
+// Writes the rows of con; with compact labels, the rows are named after
+// the position of con in the active constraints (c<row>_lb, ...)
+static void write_constraint(BufferedSink &f, std::shared_ptr<LPConstraint> con,
+                             bool compact, unsigned int row) {
   double con_lb;
   double con_ub;
   double body_constant_val;
-  for (std::shared_ptr<LPConstraint> con : active_constraints) {
-    con_lb = con->lb->evaluate();
-    con_ub = con->ub->evaluate();
-    body_constant_val = con->constant_expr->evaluate();
-    if (con_lb == con_ub) {
-      con_lb -= body_constant_val;
-      con_ub = con_lb;
-      f << con->name << "_eq: \n";
-      write_expr(f, con, false);
-      f << "= " << con_lb << " \n\n";
-    } else if (con_lb > -inf && con_ub < inf) {
-      con_lb -= body_constant_val;
-      con_ub -= body_constant_val;
-      f << con->name << "_lb: \n";
-      write_expr(f, con, false);
-      f << ">= " << con_lb << " \n\n";
-      f << con->name << "_ub: \n";
-      write_expr(f, con, false);
-      f << "<= " << con_ub << " \n\n";
-    } else if (con_lb > -inf) {
-      con_lb -= body_constant_val;
-      f << con->name << "_lb: \n";
-      write_expr(f, con, false);
-      f << ">= " << con_lb << " \n\n";
-    } else if (con_ub < inf) {
-      con_ub -= body_constant_val;
-      f << con->name << "_ub: \n";
-      write_expr(f, con, false);
-      f << "<= " << con_ub << " \n\n";
+  con_lb = con->lb->evaluate();
+  con_ub = con->ub->evaluate();
+  body_constant_val = con->constant_expr->evaluate();
+  auto write_label = [&](const char *suffix) {
+    if (compact) {
+      f << 'c' << row;
+    } else {
+      f << con->name;
     }
+    f << suffix;
+  };
+  if (con_lb == con_ub) {
+    con_lb -= body_constant_val;
+    con_ub = con_lb;
+    write_label("_eq: \n");
+    write_expr(f, con, false, compact);
+    f << "= " << con_lb << " \n\n";
+  } else if (con_lb > -inf && con_ub < inf) {
+    con_lb -= body_constant_val;
+    con_ub -= body_constant_val;
+    write_label("_lb: \n");
+    write_expr(f, con, false, compact);
+    f << ">= " << con_lb << " \n\n";
+    write_label("_ub: \n");
+    write_expr(f, con, false, compact);
+    f << "<= " << con_ub << " \n\n";
+  } else if (con_lb > -inf) {
+    con_lb -= body_constant_val;
+    write_label("_lb: \n");
+    write_expr(f, con, false, compact);
+    f << ">= " << con_lb << " \n\n";
+  } else if (con_ub < inf) {
+    con_ub -= body_constant_val;
+    write_label("_ub: \n");
+    write_expr(f, con, false, compact);
+    f << "<= " << con_ub << " \n\n";
   }
+}
 
-  f << "obj_const_con_eq: \n";
-  f << "+1 obj_const \n";
-  f << "= " << lp_objective->constant_expr->evaluate() << " \n\n";
+std::vector<std::shared_ptr<LPConstraint>> LPWriter::get_active_constraints() {
+  compact_constraints();
+  std::vector<std::shared_ptr<LPConstraint>> active_constraints;
+  active_constraints.reserve(constraints.size());
+  for (const std::shared_ptr<Constraint> &con : constraints) {
+    if (con->active) {
+      active_constraints.push_back(
+          std::dynamic_pointer_cast<LPConstraint>(con));
+    }
+  }
+  return active_constraints;
+}
 
-  for (std::shared_ptr<LPConstraint> con : active_constraints) {
-    for (std::shared_ptr<Var> v : *(con->linear_vars)) {
+std::vector<std::shared_ptr<Var>> LPWriter::get_active_vars(
+    std::vector<std::shared_ptr<LPConstraint>> &active_constraints,
+    std::shared_ptr<LPObjective> lp_objective) {
+  for (std::shared_ptr<LPConstraint> &con : active_constraints) {
+    for (std::shared_ptr<Var> &v : *(con->linear_vars)) {
       v->index = -1;
     }
-    for (std::shared_ptr<Var> v : *(con->quadratic_vars_1)) {
+    for (std::shared_ptr<Var> &v : *(con->quadratic_vars_1)) {
       v->index = -1;
     }
-    for (std::shared_ptr<Var> v : *(con->quadratic_vars_2)) {
+    for (std::shared_ptr<Var> &v : *(con->quadratic_vars_2)) {
       v->index = -1;
     }
   }
 
-  for (std::shared_ptr<Var> v : *(lp_objective->linear_vars)) {
+  for (std::shared_ptr<Var> &v : *(lp_objective->linear_vars)) {
     v->index = -1;
   }
-  for (std::shared_ptr<Var> v : *(lp_objective->quadratic_vars_1)) {
+  for (std::shared_ptr<Var> &v : *(lp_objective->quadratic_vars_1)) {
     v->index = -1;
   }
-  for (std::shared_ptr<Var> v : *(lp_objective->quadratic_vars_2)) {
+  for (std::shared_ptr<Var> &v : *(lp_objective->quadratic_vars_2)) {
     v->index = -1;
   }
 
   std::vector<std::shared_ptr<Var>> active_vars;
-  for (std::shared_ptr<LPConstraint> con : active_constraints) {
-    for (std::shared_ptr<Var> v : *(con->linear_vars)) {
+  for (std::shared_ptr<LPConstraint> &con : active_constraints) {
+    for (std::shared_ptr<Var> &v : *(con->linear_vars)) {
       if (v->index == -1) {
         v->index = -2;
         active_vars.push_back(v);
       }
     }
-    for (std::shared_ptr<Var> v : *(con->quadratic_vars_1)) {
+    for (std::shared_ptr<Var> &v : *(con->quadratic_vars_1)) {
       if (v->index == -1) {
         v->index = -2;
         active_vars.push_back(v);
       }
     }
-    for (std::shared_ptr<Var> v : *(con->quadratic_vars_2)) {
+    for (std::shared_ptr<Var> &v : *(con->quadratic_vars_2)) {
       if (v->index == -1) {
         v->index = -2;
         active_vars.push_back(v);
@@ -174,24 +261,227 @@ void LPWriter::write(std::string filename) {
     }
   }
 
-  for (std::shared_ptr<Var> v : *(lp_objective->linear_vars)) {
+  for (std::shared_ptr<Var> &v : *(lp_objective->linear_vars)) {
     if (v->index == -1) {
       v->index = -2;
       active_vars.push_back(v);
     }
   }
-  for (std::shared_ptr<Var> v : *(lp_objective->quadratic_vars_1)) {
+  for (std::shared_ptr<Var> &v : *(lp_objective->quadratic_vars_1)) {
     if (v->index == -1) {
       v->index = -2;
       active_vars.push_back(v);
     }
   }
-  for (std::shared_ptr<Var> v : *(lp_objective->quadratic_vars_2)) {
+  for (std::shared_ptr<Var> &v : *(lp_objective->quadratic_vars_2)) {
     if (v->index == -1) {
       v->index = -2;
       active_vars.push_back(v);
     }
   }
+  return active_vars;
+}
+
+// Reads the number in a compact label (prefix, digits, suffix) into ndx
+static bool parse_compact_label(const std::string &label, char prefix,
+                                const std::string &suffix, unsigned long &ndx) {
+  if (label.size() < 2 + suffix.size() || label[0] != prefix ||
+      label.compare(label.size() - suffix.size(), suffix.size(), suffix) != 0)
+    return false;
+  ndx = 0;
+  for (unsigned int i = 1; i < label.size() - suffix.size(); ++i) {
+    if (label[i] < '0' || label[i] > '9' || ndx > 1000000000000UL)
+      return false;
+    ndx = ndx * 10 + (label[i] - '0');
+  }
+  return true;
+}
+
+// Calls fill(t, begin, end) for at most n_threads disjoint ranges
+// [begin, end) of [0, n) on worker threads (t is the index of the range) and
+// waits for them; an exception thrown by any of the ranges is rethrown here.
+// Returns the number of ranges. Small problems are done on the calling
+// thread as a single range.
+static unsigned int
+for_each_range(unsigned int n, unsigned int n_threads,
+               std::function<void(unsigned int, unsigned int, unsigned int)>
+                   fill) {
+  // not worth starting threads for a few rows
+  unsigned int min_chunk = 64;
+  unsigned int n_chunks = std::min<unsigned int>(n_threads, n / min_chunk);
+  if (n_chunks <= 1) {
+    fill(0, 0, n);
+    return 1;
+  }
+
+  std::vector<std::exception_ptr> errors(n_chunks);
+  std::vector<std::thread> threads;
+  unsigned int chunk = n / n_chunks;
+  unsigned int remainder = n % n_chunks;
+  unsigned int begin = 0;
+  unsigned int end;
+  for (unsigned int t = 0; t < n_chunks; ++t) {
+    end = begin + chunk + (t < remainder ? 1 : 0);
+    threads.push_back(std::thread([&, t, begin, end]() {
+      try {
+        fill(t, begin, end);
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    }));
+    begin = end;
+  }
+  for (std::thread &th : threads) {
+    th.join();
+  }
+  for (unsigned int t = 0; t < n_chunks; ++t) {
+    if (errors[t])
+      std::rethrow_exception(errors[t]);
+  }
+  return n_chunks;
+}
+
+void LPWriter::write(std::string filename, int n_threads, bool compact_labels) {
+  std::ofstream out;
+  out.open(filename);
+  BufferedSink f(out);
+
+  std::shared_ptr<LPObjective> lp_objective =
+      std::dynamic_pointer_cast<LPObjective>(objective);
+
+  std::vector<std::shared_ptr<LPConstraint>> active_constraints =
+      get_active_constraints();
+  std::vector<std::shared_ptr<Var>> active_vars =
+      get_active_vars(active_constraints, lp_objective);
+
+  // With compact labels, the cached text of a row is out of date if the row
+  // or any of its variables moved since the labels were last written.
+  std::vector<char> moved_cols;
+  if (compact_labels != cached_compact_labels) {
+    // including the inactive constraints, which keep their text
+    lp_objective->invalidate_cached_text();
+    for (const std::shared_ptr<Constraint> &con : constraints) {
+      std::dynamic_pointer_cast<LPConstraint>(con)->invalidate_cached_text();
+    }
+    cached_compact_labels = compact_labels;
+  }
+  if (compact_labels) {
+    moved_cols.resize(active_vars.size());
+    for (unsigned int col = 0; col < active_vars.size(); ++col) {
+      active_vars[col]->index = col;
+      moved_cols[col] =
+          col >= label_cols.size() || label_cols[col] != active_vars[col];
+    }
+    for (unsigned int row = 0; row < active_constraints.size(); ++row) {
+      if (row >= label_rows.size() ||
+          label_rows[row] != active_constraints[row])
+        active_constraints[row]->invalidate_cached_text();
+    }
+  }
+  auto labels_moved = [&](LPBase &obj) {
+    if (!compact_labels)
+      return false;
+    for (std::shared_ptr<Var> &v : *(obj.linear_vars)) {
+      if (moved_cols[v->index])
+        return true;
+    }
+    for (std::shared_ptr<Var> &v : *(obj.quadratic_vars_1)) {
+      if (moved_cols[v->index])
+        return true;
+    }
+    for (std::shared_ptr<Var> &v : *(obj.quadratic_vars_2)) {
+      if (moved_cols[v->index])
+        return true;
+    }
+    return false;
+  };
+
+  if (lp_objective->sense == 0) {
+    f << "minimize\n";
+  } else {
+    f << "maximize\n";
+  }
+
+  if (!lp_objective->params_found)
+    lp_objective->find_params({});
+  if (labels_moved(*lp_objective))
+    lp_objective->invalidate_cached_text();
+  if (!lp_objective->check_cached_text()) {
+    BufferedSink buf;
+    if (compact_labels) {
+      buf << "obj";
+    } else {
+      buf << lp_objective->name;
+    }
+    buf << ": \n";
+    write_expr(buf, lp_objective, true, compact_labels);
+    lp_objective->cached_text = buf.release();
+  }
+  f << lp_objective->cached_text;
+
+  f << "\ns.t.\n\n";
+
+  // the rows that depend on a param or fixed variable whose value changed
+  for (std::shared_ptr<LPConstraint> &con : active_constraints) {
+    if (!con->params_found) {
+      add_dependencies(con, con->get_exprs({con->lb, con->ub}));
+      con->params_found = true;
+    }
+  }
+  for (std::shared_ptr<Constraint> &con : take_changed_constraints()) {
+    std::dynamic_pointer_cast<LPConstraint>(con)->invalidate_cached_text();
+  }
+
+  // The rows that are new or out of date are formatted on worker threads;
+  // each thread only touches its own constraints, and the params and vars
+  // are only read. Rows that evaluate expressions with operators are
+  // formatted on this thread first, since their operators may be shared
+  // with rows in other ranges (see LPBase::evaluates_operators). The rows
+  // are then written in order.
+  if (n_threads <= 0)
+    n_threads = std::max(1u, std::thread::hardware_concurrency());
+  unsigned int n_rows = active_constraints.size();
+  std::vector<char> row_changed(n_rows, 0);
+  auto format_row = [&](BufferedSink &buf, unsigned int i) {
+    std::shared_ptr<LPConstraint> &con = active_constraints[i];
+    if (labels_moved(*con))
+      con->invalidate_cached_text();
+    if (!con->check_cached_text()) {
+      write_constraint(buf, con, compact_labels, i);
+      con->cached_text = buf.release();
+      row_changed[i] = 1;
+    }
+  };
+  std::vector<char> on_caller(n_rows, 0);
+  BufferedSink caller_buf;
+  for (unsigned int i = 0; i < n_rows; ++i) {
+    std::shared_ptr<LPConstraint> &con = active_constraints[i];
+    if (con->evaluates_operators({con->lb, con->ub})) {
+      on_caller[i] = 1;
+      format_row(caller_buf, i);
+    }
+  }
+  for_each_range(n_rows, n_threads,
+                 [&](unsigned int, unsigned int begin, unsigned int end) {
+                   BufferedSink buf;
+                   for (unsigned int i = begin; i < end; ++i) {
+                     if (!on_caller[i])
+                       format_row(buf, i);
+                   }
+                 });
+
+  changed_cons.clear();
+  for (unsigned int i = 0; i < n_rows; ++i) {
+    if (row_changed[i])
+      changed_cons.push_back(active_constraints[i]);
+  }
+  for (std::shared_ptr<LPConstraint> &con : active_constraints) {
+    f << con->cached_text;
+  }
+
+  f << "obj_const_con_eq: \n";
+  f << "+1 obj_const \n";
+  f << "= " << lp_objective->constant_expr->evaluate() << " \n\n";
 
   f << "Bounds\n";
   std::vector<std::shared_ptr<Var>> binaries;
@@ -199,7 +489,7 @@ void LPWriter::write(std::string filename) {
   double v_lb;
   double v_ub;
   Domain v_domain;
-  for (std::shared_ptr<Var> v : active_vars) {
+  for (std::shared_ptr<Var> &v : active_vars) {
     v_domain = v->get_domain();
     if (v_domain == binary) {
       binaries.push_back(v);
@@ -207,7 +497,9 @@ void LPWriter::write(std::string filename) {
       integer_vars.push_back(v);
     }
     if (v->fixed) {
-      f << "  " << v->value << " <= " << v->name << " <= " << v->value << " \n";
+      f << "  " << v->value << " <= ";
+      write_var_label(f, *v, compact_labels);
+      f << " <= " << v->value << " \n";
     } else {
       v_lb = v->get_lb();
       v_ub = v->get_ub();
@@ -217,7 +509,9 @@ void LPWriter::write(std::string filename) {
       } else {
         f << v_lb;
       }
-      f << " <= " << v->name << " <= ";
+      f << " <= ";
+      write_var_label(f, *v, compact_labels);
+      f << " <= ";
       if (v_ub >= inf) {
         f << "+inf";
       } else {
@@ -230,24 +524,391 @@ void LPWriter::write(std::string filename) {
 
   if (binaries.size() > 0) {
     f << "Binaries \n";
-    for (std::shared_ptr<Var> v : binaries) {
-      f << v->name << " \n";
+    for (std::shared_ptr<Var> &v : binaries) {
+      write_var_label(f, *v, compact_labels);
+      f << " \n";
     }
   }
 
   if (integer_vars.size() > 0) {
     f << "Generals \n";
-    for (std::shared_ptr<Var> v : integer_vars) {
-      f << v->name << " \n";
+    for (std::shared_ptr<Var> &v : integer_vars) {
+      write_var_label(f, *v, compact_labels);
+      f << " \n";
     }
   }
 
   f << "end\n";
 
-  f.close();
+  f.flush();
+  out.close();
+
+  if (compact_labels) {
+    label_rows = active_constraints;
+    label_cols = active_vars;
+  } else {
+    label_rows.clear();
+    label_cols.clear();
+  }
+  solve_cons = active_constraints;
+  solve_vars = active_vars;
+}
+
+std::shared_ptr<Var> LPWriter::get_var_from_label(std::string label) {
+  unsigned long ndx;
+  if (!parse_compact_label(label, 'x', "", ndx) || ndx >= label_cols.size())
+    throw py::value_error("unknown variable label: " + label);
+  return label_cols[ndx];
+}
+
+std::shared_ptr<LPConstraint>
+LPWriter::get_con_from_label(std::string label) {
+  unsigned long ndx;
+  if (!(parse_compact_label(label, 'c', "_lb", ndx) ||
+        parse_compact_label(label, 'c', "_ub", ndx) ||
+        parse_compact_label(label, 'c', "_eq", ndx) ||
+        parse_compact_label(label, 'c', "", ndx)) ||
+      ndx >= label_rows.size())
+    throw py::value_error("unknown constraint label: " + label);
+  return label_rows[ndx];
+}
+
+// The symmetric matrix of the quadratic terms of obj as (row, column,
+// value) entries with row >= column, keyed by the column indices of the
+// variables. For the objective (0.5 x^T Q x), Q has the coefficient of
+// x_i * x_j (i != j) off the diagonal and twice the coefficient of x_i^2 on
+// it; for constraints (x^T Q x), both are halved.
+static std::map<std::pair<int, int>, double>
+quadratic_matrix(LPBase &obj, bool is_objective) {
+  std::map<std::pair<int, int>, double> res;
+  int i;
+  int j;
+  double coef;
+  for (unsigned int ndx = 0; ndx < obj.quadratic_coefficients->size(); ++ndx) {
+    i = obj.quadratic_vars_1->at(ndx)->index;
+    j = obj.quadratic_vars_2->at(ndx)->index;
+    coef = obj.quadratic_coefficients->at(ndx)->evaluate();
+    if (i == j)
+      coef *= 2;
+    if (!is_objective)
+      coef /= 2;
+    res[std::make_pair(std::max(i, j), std::min(i, j))] += coef;
+  }
+  return res;
+}
+
+// Transposes the linear parts of rows into compressed column (CSC) arrays
+// in one counting-sort pass; the rows within each column end up in
+// increasing order. The index of each variable must be its column.
+static void rows_to_columns(std::vector<LPBase *> &rows, int n_cols,
+                            std::vector<int> &col_ptr,
+                            std::vector<int> &col_rows,
+                            std::vector<double> &col_values) {
+  col_ptr.assign(n_cols + 1, 0);
+  for (LPBase *row : rows) {
+    for (std::shared_ptr<Var> &v : *(row->linear_vars)) {
+      col_ptr[v->index + 1] += 1;
+    }
+  }
+  for (int col = 0; col < n_cols; ++col) {
+    col_ptr[col + 1] += col_ptr[col];
+  }
+  col_rows.resize(col_ptr[n_cols]);
+  col_values.resize(col_ptr[n_cols]);
+  std::vector<int> next(col_ptr.begin(), col_ptr.end() - 1);
+  int k;
+  for (unsigned int row_ndx = 0; row_ndx < rows.size(); ++row_ndx) {
+    LPBase &row = *(rows[row_ndx]);
+    for (unsigned int ndx = 0; ndx < row.linear_vars->size(); ++ndx) {
+      k = next[row.linear_vars->at(ndx)->index]++;
+      col_rows[k] = row_ndx;
+      col_values[k] = row.linear_coefficients->at(ndx)->evaluate();
+    }
+  }
+}
+
+// Converts a compressed sparse matrix with n_major rows (or columns) and
+// n_minor columns (or rows) to the other orientation with counting sort
+static void transpose(int n_major, int n_minor, std::vector<int> &ptr,
+                      std::vector<int> &ind, std::vector<double> &val,
+                      std::vector<int> &out_ptr, std::vector<int> &out_ind,
+                      std::vector<double> &out_val) {
+  out_ptr.assign(n_minor + 1, 0);
+  for (int i : ind) {
+    out_ptr[i + 1] += 1;
+  }
+  for (int i = 0; i < n_minor; ++i) {
+    out_ptr[i + 1] += out_ptr[i];
+  }
+  out_ind.resize(ind.size());
+  out_val.resize(val.size());
+  std::vector<int> next(out_ptr.begin(), out_ptr.end() - 1);
+  int k;
+  for (int major = 0; major < n_major; ++major) {
+    for (int pos = ptr[major]; pos < ptr[major + 1]; ++pos) {
+      k = next[ind[pos]]++;
+      out_ind[k] = major;
+      out_val[k] = val[pos];
+    }
+  }
+}
+
+static void write_mps_entry(BufferedSink &f, const std::string &name1,
+                            const std::string &name2, double val) {
+  f << " " << name1 << " " << name2 << " " << val << "\n";
+}
+
+void LPWriter::write_mps(std::string filename) {
+  std::ofstream out;
+  out.open(filename);
+  BufferedSink f(out);
+
+  std::shared_ptr<LPObjective> lp_objective =
+      std::dynamic_pointer_cast<LPObjective>(objective);
+  std::vector<std::shared_ptr<LPConstraint>> active_constraints =
+      get_active_constraints();
+  std::vector<std::shared_ptr<Var>> active_vars =
+      get_active_vars(active_constraints, lp_objective);
+  int n_cols = active_vars.size();
+  for (int col = 0; col < n_cols; ++col) {
+    active_vars[col]->index = col;
+  }
+
+  // Rows are the objective followed by the constraints that have a bound
+  // (the others are not written, as in the LP format).
+  std::vector<LPBase *> rows;
+  std::vector<std::string *> row_names;
+  std::vector<char> row_types;
+  std::vector<double> rhs;
+  std::vector<double> ranges;
+  rows.push_back(lp_objective.get());
+  row_names.push_back(&(lp_objective->name));
+  row_types.push_back('N');
+  rhs.push_back(-lp_objective->constant_expr->evaluate());
+  ranges.push_back(0);
+  double con_lb;
+  double con_ub;
+  double body_constant_val;
+  for (std::shared_ptr<LPConstraint> &con : active_constraints) {
+    con_lb = con->lb->evaluate();
+    con_ub = con->ub->evaluate();
+    if (con_lb <= -inf && con_ub >= inf)
+      continue;
+    body_constant_val = con->constant_expr->evaluate();
+    if (con_lb == con_ub) {
+      row_types.push_back('E');
+      rhs.push_back(con_lb - body_constant_val);
+      ranges.push_back(0);
+    } else if (con_lb > -inf && con_ub < inf) {
+      row_types.push_back('G');
+      rhs.push_back(con_lb - body_constant_val);
+      ranges.push_back(con_ub - con_lb);
+    } else if (con_lb > -inf) {
+      row_types.push_back('G');
+      rhs.push_back(con_lb - body_constant_val);
+      ranges.push_back(0);
+    } else {
+      row_types.push_back('L');
+      rhs.push_back(con_ub - body_constant_val);
+      ranges.push_back(0);
+    }
+    rows.push_back(con.get());
+    row_names.push_back(&(con->name));
+  }
+  int n_rows = rows.size();
+
+  std::vector<int> col_ptr;
+  std::vector<int> col_rows;
+  std::vector<double> col_values;
+  rows_to_columns(rows, n_cols, col_ptr, col_rows, col_values);
+  int k;
+
+  f << "NAME " << lp_objective->name << "\n";
+  if (lp_objective->sense != 0) {
+    f << "OBJSENSE\n MAX\n";
+  }
+
+  f << "ROWS\n";
+  for (int row_ndx = 0; row_ndx < n_rows; ++row_ndx) {
+    f << " " << row_types[row_ndx] << " " << *(row_names[row_ndx]) << "\n";
+  }
+
+  f << "COLUMNS\n";
+  bool in_integer_block = false;
+  bool is_integer;
+  Domain v_domain;
+  for (int col = 0; col < n_cols; ++col) {
+    Var &v = *(active_vars[col]);
+    v_domain = v.get_domain();
+    is_integer = (v_domain == binary || v_domain == integers);
+    if (is_integer != in_integer_block) {
+      f << " MARKER 'MARKER' " << (is_integer ? "'INTORG'" : "'INTEND'")
+        << "\n";
+      in_integer_block = is_integer;
+    }
+    if (col_ptr[col] == col_ptr[col + 1]) {
+      // the column must be declared even if it only has quadratic terms
+      write_mps_entry(f, v.name, *(row_names[0]), 0);
+    }
+    for (k = col_ptr[col]; k < col_ptr[col + 1]; ++k) {
+      write_mps_entry(f, v.name, *(row_names[col_rows[k]]), col_values[k]);
+    }
+  }
+  if (in_integer_block) {
+    f << " MARKER 'MARKER' 'INTEND'\n";
+  }
+
+  f << "RHS\n";
+  for (int row_ndx = 0; row_ndx < n_rows; ++row_ndx) {
+    if (rhs[row_ndx] != 0)
+      write_mps_entry(f, "RHS", *(row_names[row_ndx]), rhs[row_ndx]);
+  }
+
+  bool has_ranges = false;
+  for (int row_ndx = 0; row_ndx < n_rows; ++row_ndx) {
+    if (ranges[row_ndx] == 0)
+      continue;
+    if (!has_ranges) {
+      f << "RANGES\n";
+      has_ranges = true;
+    }
+    write_mps_entry(f, "RNG", *(row_names[row_ndx]), ranges[row_ndx]);
+  }
+
+  // the default bounds are [0, inf)
+  f << "BOUNDS\n";
+  double v_lb;
+  double v_ub;
+  for (std::shared_ptr<Var> &v : active_vars) {
+    v_domain = v->get_domain();
+    if (v->fixed) {
+      v_lb = v->value;
+      v_ub = v->value;
+    } else {
+      v_lb = v->get_lb();
+      v_ub = v->get_ub();
+    }
+    if (v_lb == v_ub) {
+      write_mps_entry(f, "FX BND", v->name, v_lb);
+    } else if (v_domain == binary && v_lb == 0 && v_ub == 1) {
+      f << " BV BND " << v->name << "\n";
+    } else if (v_domain == binary || v_domain == integers) {
+      // readers do not agree on the default bounds of integer columns
+      if (v_lb > -inf)
+        write_mps_entry(f, "LO BND", v->name, v_lb);
+      else
+        f << " MI BND " << v->name << "\n";
+      if (v_ub < inf)
+        write_mps_entry(f, "UP BND", v->name, v_ub);
+      else
+        f << " PL BND " << v->name << "\n";
+    } else if (v_lb <= -inf && v_ub >= inf) {
+      f << " FR BND " << v->name << "\n";
+    } else {
+      if (v_lb <= -inf)
+        f << " MI BND " << v->name << "\n";
+      else if (v_lb != 0 || v_ub < 0)
+        write_mps_entry(f, "LO BND", v->name, v_lb);
+      if (v_ub < inf)
+        write_mps_entry(f, "UP BND", v->name, v_ub);
+    }
+  }
+
+  std::map<std::pair<int, int>, double> q;
+  q = quadratic_matrix(*lp_objective, true);
+  if (q.size() > 0) {
+    f << "QUADOBJ\n";
+    for (std::pair<const std::pair<int, int>, double> &entry : q) {
+      write_mps_entry(f, active_vars[entry.first.second]->name,
+                      active_vars[entry.first.first]->name, entry.second);
+    }
+  }
+  // QCMATRIX sections have both triangles of the matrix
+  for (int row_ndx = 1; row_ndx < n_rows; ++row_ndx) {
+    if (rows[row_ndx]->quadratic_coefficients->size() == 0)
+      continue;
+    q = quadratic_matrix(*(rows[row_ndx]), false);
+    f << "QCMATRIX " << *(row_names[row_ndx]) << "\n";
+    for (std::pair<const std::pair<int, int>, double> &entry : q) {
+      write_mps_entry(f, active_vars[entry.first.second]->name,
+                      active_vars[entry.first.first]->name, entry.second);
+      if (entry.first.first != entry.first.second)
+        write_mps_entry(f, active_vars[entry.first.first]->name,
+                        active_vars[entry.first.second]->name, entry.second);
+    }
+  }
+
+  f << "ENDATA\n";
+
+  f.flush();
+  out.close();
+
+  solve_cons = active_constraints;
+  solve_vars = active_vars;
+}
+
+std::shared_ptr<LPArrays> LPWriter::to_arrays() {
+  std::shared_ptr<LPObjective> lp_objective =
+      std::dynamic_pointer_cast<LPObjective>(objective);
+  std::vector<std::shared_ptr<LPConstraint>> active_constraints =
+      get_active_constraints();
+  std::vector<std::shared_ptr<Var>> active_vars =
+      get_active_vars(active_constraints, lp_objective);
+
+  std::shared_ptr<LPArrays> res = std::make_shared<LPArrays>();
+  res->n_rows = active_constraints.size();
+  res->n_cols = active_vars.size();
+  Domain v_domain;
+  for (int col = 0; col < res->n_cols; ++col) {
+    Var &v = *(active_vars[col]);
+    v.index = col;
+    if (v.fixed) {
+      res->col_lower.push_back(v.value);
+      res->col_upper.push_back(v.value);
+    } else {
+      res->col_lower.push_back(v.get_lb());
+      res->col_upper.push_back(v.get_ub());
+    }
+    v_domain = v.get_domain();
+    res->integrality.push_back((v_domain == binary || v_domain == integers) ? 1
+                                                                           : 0);
+  }
+
+  std::vector<LPBase *> rows;
+  double body_constant_val;
+  for (std::shared_ptr<LPConstraint> &con : active_constraints) {
+    if (con->quadratic_coefficients->size() > 0)
+      throw py::value_error("LPWriter.to_arrays does not support quadratic "
+                            "constraints");
+    body_constant_val = con->constant_expr->evaluate();
+    res->row_lower.push_back(con->lb->evaluate() - body_constant_val);
+    res->row_upper.push_back(con->ub->evaluate() - body_constant_val);
+    rows.push_back(con.get());
+  }
+  rows_to_columns(rows, res->n_cols, res->col_indptr, res->col_indices,
+                  res->col_values);
+  transpose(res->n_cols, res->n_rows, res->col_indptr, res->col_indices,
+            res->col_values, res->row_indptr, res->row_indices,
+            res->row_values);
+
+  res->sense = lp_objective->sense;
+  res->obj_constant = lp_objective->constant_expr->evaluate();
+  res->obj_coefs.assign(res->n_cols, 0);
+  for (unsigned int ndx = 0; ndx < lp_objective->linear_vars->size(); ++ndx) {
+    res->obj_coefs[lp_objective->linear_vars->at(ndx)->index] +=
+        lp_objective->linear_coefficients->at(ndx)->evaluate();
+  }
+  std::map<std::pair<int, int>, double> q =
+      quadratic_matrix(*lp_objective, true);
+  for (std::pair<const std::pair<int, int>, double> &entry : q) {
+    res->q_rows.push_back(entry.first.first);
+    res->q_cols.push_back(entry.first.second);
+    res->q_values.push_back(entry.second);
+  }
 
   solve_cons = active_constraints;
   solve_vars = active_vars;
+  return res;
 }
 
 std::vector<std::shared_ptr<Var>> LPWriter::get_solve_vars() {
@@ -258,13 +919,51 @@ std::vector<std::shared_ptr<LPConstraint>> LPWriter::get_solve_cons() {
   return solve_cons;
 }
 
+std::vector<std::shared_ptr<LPConstraint>> LPWriter::get_changed_cons() {
+  return changed_cons;
+}
+
+void LPWriter::add_to_memory_report(MemoryReport &report) {
+  Model::add_to_memory_report(report);
+  size_t &constraints_bytes = report["constraints"];
+  for (const std::shared_ptr<Constraint> &con : constraints) {
+    report.add_shared(constraints_bytes, sizeof(LPConstraint));
+    std::dynamic_pointer_cast<LPConstraint>(con)->add_to_memory_report(report);
+  }
+  std::shared_ptr<LPObjective> lp_objective =
+      std::dynamic_pointer_cast<LPObjective>(objective);
+  if (lp_objective != nullptr) {
+    report.add_shared(constraints_bytes, sizeof(LPObjective));
+    lp_objective->add_to_memory_report(report);
+  }
+  report.add_vector(constraints_bytes, solve_cons);
+  report.add_vector(constraints_bytes, changed_cons);
+  report.add_vector(constraints_bytes, label_rows);
+  size_t &incidence = report["incidence"];
+  report.add_vector(incidence, solve_vars);
+  report.add_vector(incidence, label_cols);
+}
+
+// moves the linear and quadratic parts of repn into lp_base
+static void set_lp_terms(LPBase &lp_base, StandardRepn &repn) {
+  lp_base.constant_expr = repn.constant;
+  lp_base.linear_coefficients =
+      std::make_shared<std::vector<std::shared_ptr<ExpressionBase>>>(
+          std::move(repn.linear_coefs));
+  lp_base.linear_vars = std::make_shared<std::vector<std::shared_ptr<Var>>>(
+      std::move(repn.linear_vars));
+  lp_base.quadratic_coefficients =
+      std::make_shared<std::vector<std::shared_ptr<ExpressionBase>>>(
+          std::move(repn.quadratic_coefs));
+  lp_base.quadratic_vars_1 =
+      std::make_shared<std::vector<std::shared_ptr<Var>>>(
+          std::move(repn.quadratic_vars_1));
+  lp_base.quadratic_vars_2 =
+      std::make_shared<std::vector<std::shared_ptr<Var>>>(
+          std::move(repn.quadratic_vars_2));
+}
+
 void process_lp_constraints(py::list cons, py::object writer) {
-  py::object generate_standard_repn =
-      py::module_::import("pyomo.repn.standard_repn")
-          .attr("generate_standard_repn");
-  py::object id = py::module_::import("builtins").attr("id");
-  py::str cname;
-  py::object repn;
   py::object getSymbol = writer.attr("_symbol_map").attr("getSymbol");
   py::object labeler = writer.attr("_con_labeler");
   LPWriter *c_writer = writer.attr("_writer").cast<LPWriter *>();
@@ -274,78 +973,25 @@ void process_lp_constraints(py::list cons, py::object writer) {
       writer.attr("_pyomo_con_to_solver_con_map");
   py::dict solver_con_to_pyomo_con_map =
       writer.attr("_solver_con_to_pyomo_con_map");
-  std::shared_ptr<ExpressionBase> _const;
-  py::object repn_constant;
-  py::list repn_linear_coefs;
-  py::list repn_linear_vars;
-  py::list repn_quad_coefs;
-  py::list repn_quad_vars;
   std::shared_ptr<LPConstraint> lp_con;
-  py::tuple v_tuple;
   py::handle lb;
   py::handle ub;
   py::tuple lower_body_upper;
-  py::dict active_constraints = writer.attr("_active_constraints");
-  py::object nonlinear_expr;
   PyomoExprTypes expr_types = PyomoExprTypes();
   for (py::handle c : cons) {
     lower_body_upper = c.attr("to_bounded_expression")();
-    cname = getSymbol(c, labeler);
-    repn = generate_standard_repn(
-        lower_body_upper[1], "compute_values"_a = false, "quadratic"_a = true);
-    nonlinear_expr = repn.attr("nonlinear_expr");
-    if (!(nonlinear_expr.is(py::none()))) {
+    StandardRepn repn = generate_standard_repn(lower_body_upper[1], var_map,
+                                               param_map, expr_types, true);
+    if (repn.has_nonlinear()) {
       throw py::value_error(
           "cannot write an LP file with a nonlinear constraint");
     }
-    repn_constant = repn.attr("constant");
-    _const = appsi_expr_from_pyomo_expr(repn_constant, var_map, param_map,
-                                        expr_types);
-    std::shared_ptr<std::vector<std::shared_ptr<ExpressionBase>>> lin_coef =
-        std::make_shared<std::vector<std::shared_ptr<ExpressionBase>>>();
-    std::shared_ptr<std::vector<std::shared_ptr<Var>>> lin_vars =
-        std::make_shared<std::vector<std::shared_ptr<Var>>>();
-    ;
-    std::shared_ptr<std::vector<std::shared_ptr<ExpressionBase>>> quad_coef =
-        std::make_shared<std::vector<std::shared_ptr<ExpressionBase>>>();
-    ;
-    std::shared_ptr<std::vector<std::shared_ptr<Var>>> quad_vars_1 =
-        std::make_shared<std::vector<std::shared_ptr<Var>>>();
-    ;
-    std::shared_ptr<std::vector<std::shared_ptr<Var>>> quad_vars_2 =
-        std::make_shared<std::vector<std::shared_ptr<Var>>>();
-    ;
-    repn_linear_coefs = repn.attr("linear_coefs");
-    for (py::handle coef : repn_linear_coefs) {
-      lin_coef->push_back(
-          appsi_expr_from_pyomo_expr(coef, var_map, param_map, expr_types));
-    }
-    repn_linear_vars = repn.attr("linear_vars");
-    for (py::handle v : repn_linear_vars) {
-      lin_vars->push_back(var_map[id(v)].cast<std::shared_ptr<Var>>());
-    }
-    repn_quad_coefs = repn.attr("quadratic_coefs");
-    for (py::handle coef : repn_quad_coefs) {
-      quad_coef->push_back(
-          appsi_expr_from_pyomo_expr(coef, var_map, param_map, expr_types));
-    }
-    repn_quad_vars = repn.attr("quadratic_vars");
-    for (py::handle v_tuple_handle : repn_quad_vars) {
-      v_tuple = v_tuple_handle.cast<py::tuple>();
-      quad_vars_1->push_back(
-          var_map[id(v_tuple[0])].cast<std::shared_ptr<Var>>());
-      quad_vars_2->push_back(
-          var_map[id(v_tuple[1])].cast<std::shared_ptr<Var>>());
-    }
 
     lp_con = std::make_shared<LPConstraint>();
-    lp_con->name = cname;
-    lp_con->constant_expr = _const;
-    lp_con->linear_coefficients = lin_coef;
-    lp_con->linear_vars = lin_vars;
-    lp_con->quadratic_coefficients = quad_coef;
-    lp_con->quadratic_vars_1 = quad_vars_1;
-    lp_con->quadratic_vars_2 = quad_vars_2;
+    // with compact labels, the writer does not name the constraints
+    if (!labeler.is(py::none()))
+      lp_con->name = getSymbol(c, labeler).cast<std::string>();
+    set_lp_terms(*lp_con, repn);
 
     lb = lower_body_upper[0];
     ub = lower_body_upper[2];
@@ -358,6 +1004,9 @@ void process_lp_constraints(py::list cons, py::object writer) {
           appsi_expr_from_pyomo_expr(ub, var_map, param_map, expr_types);
     }
     c_writer->add_constraint(lp_con);
+    c_writer->add_dependencies(lp_con,
+                               lp_con->get_exprs({lp_con->lb, lp_con->ub}));
+    lp_con->params_found = true;
     pyomo_con_to_solver_con_map[c] = py::cast(lp_con);
     solver_con_to_pyomo_con_map[py::cast(lp_con)] = c;
   }
@@ -367,66 +1016,19 @@ std::shared_ptr<LPObjective> process_lp_objective(PyomoExprTypes &expr_types,
                                                   py::object pyomo_obj,
                                                   py::dict var_map,
                                                   py::dict param_map) {
-  std::shared_ptr<std::vector<std::shared_ptr<ExpressionBase>>> lin_coef =
-      std::make_shared<std::vector<std::shared_ptr<ExpressionBase>>>();
-  std::shared_ptr<std::vector<std::shared_ptr<Var>>> lin_vars =
-      std::make_shared<std::vector<std::shared_ptr<Var>>>();
-  ;
-  std::shared_ptr<std::vector<std::shared_ptr<ExpressionBase>>> quad_coef =
-      std::make_shared<std::vector<std::shared_ptr<ExpressionBase>>>();
-  ;
-  std::shared_ptr<std::vector<std::shared_ptr<Var>>> quad_vars_1 =
-      std::make_shared<std::vector<std::shared_ptr<Var>>>();
-  ;
-  std::shared_ptr<std::vector<std::shared_ptr<Var>>> quad_vars_2 =
-      std::make_shared<std::vector<std::shared_ptr<Var>>>();
-  ;
-  std::shared_ptr<ExpressionBase> _const;
-
+  std::shared_ptr<LPObjective> lp_obj = std::make_shared<LPObjective>();
+  StandardRepn repn;
   if (pyomo_obj.is(py::none())) {
-    _const = std::make_shared<Constant>(0);
+    repn.constant = std::make_shared<Constant>(0);
   } else {
-    py::object generate_standard_repn =
-        py::module_::import("pyomo.repn.standard_repn")
-            .attr("generate_standard_repn");
-    py::object repn = generate_standard_repn(pyomo_obj.attr("expr"),
-                                             "compute_values"_a = false,
-                                             "quadratic"_a = true);
-    _const = appsi_expr_from_pyomo_expr(repn.attr("constant"), var_map,
-                                        param_map, expr_types);
-    py::handle repn_linear_coefs = repn.attr("linear_coefs");
-    for (py::handle coef : repn_linear_coefs) {
-      lin_coef->push_back(
-          appsi_expr_from_pyomo_expr(coef, var_map, param_map, expr_types));
-    }
-    py::handle repn_linear_vars = repn.attr("linear_vars");
-    for (py::handle v : repn_linear_vars) {
-      lin_vars->push_back(
-          var_map[expr_types.id(v)].cast<std::shared_ptr<Var>>());
-    }
-    py::handle repn_quad_coefs = repn.attr("quadratic_coefs");
-    for (py::handle coef : repn_quad_coefs) {
-      quad_coef->push_back(
-          appsi_expr_from_pyomo_expr(coef, var_map, param_map, expr_types));
-    }
-    py::handle repn_quad_vars = repn.attr("quadratic_vars");
-    py::tuple v_tuple;
-    for (py::handle v_tuple_handle : repn_quad_vars) {
-      v_tuple = v_tuple_handle.cast<py::tuple>();
-      quad_vars_1->push_back(
-          var_map[expr_types.id(v_tuple[0])].cast<std::shared_ptr<Var>>());
-      quad_vars_2->push_back(
-          var_map[expr_types.id(v_tuple[1])].cast<std::shared_ptr<Var>>());
+    repn = generate_standard_repn(pyomo_obj.attr("expr"), var_map, param_map,
+                                  expr_types, true);
+    if (repn.has_nonlinear()) {
+      throw py::value_error(
+          "cannot write an LP file with a nonlinear objective");
     }
   }
-
-  std::shared_ptr<LPObjective> lp_obj = std::make_shared<LPObjective>();
-  lp_obj->constant_expr = _const;
-  lp_obj->linear_coefficients = lin_coef;
-  lp_obj->linear_vars = lin_vars;
-  lp_obj->quadratic_coefficients = quad_coef;
-  lp_obj->quadratic_vars_1 = quad_vars_1;
-  lp_obj->quadratic_vars_2 = quad_vars_2;
+  set_lp_terms(*lp_obj, repn);
 
   return lp_obj;
 }
@@ -11,10 +11,12 @@
 **/
 
 #include "model_base.hpp"
+#include "repn.hpp"
 
 class LPBase;
 class LPConstraint;
 class LPObjective;
+class LPArrays;
 class LPWriter;
 
 extern double inf;
@@ -31,6 +33,39 @@ public:
       quadratic_coefficients;
   std::shared_ptr<std::vector<std::shared_ptr<Var>>> quadratic_vars_1;
   std::shared_ptr<std::vector<std::shared_ptr<Var>>> quadratic_vars_2;
+  // The text of the row in the LP file is cached between writes and only
+  // regenerated when the value of a param it depends on changes. exprs
+  // are the expressions it depends on besides the coefficients and the
+  // constant (e.g., the bounds of a constraint).
+  void find_params(std::vector<std::shared_ptr<ExpressionBase>> exprs);
+  // the constant, the coefficients and exprs
+  std::vector<std::shared_ptr<ExpressionBase>>
+  get_exprs(std::vector<std::shared_ptr<ExpressionBase>> exprs);
+  // For the objective, whether find_params was called. For a constraint,
+  // whether it was added to the dependency index of the writer, which then
+  // invalidates the text when a param or fixed variable it depends on
+  // changes.
+  bool params_found = false;
+  // returns false (and marks the text as valid) if the text has to be
+  // regenerated
+  bool check_cached_text();
+  // e.g., when the labels in the text change
+  void invalidate_cached_text() { cached_text_valid = false; }
+  // Whether one of get_exprs(exprs) is an expression rather than a leaf.
+  // Expression::evaluate numbers the operators of the expression in place,
+  // and they may be shared with other rows, so such rows are not formatted
+  // on worker threads. The result is computed on the first call.
+  bool evaluates_operators(std::vector<std::shared_ptr<ExpressionBase>> exprs);
+  std::string cached_text;
+  // the terms, the cached text and the params (not the object itself)
+  void add_to_memory_report(MemoryReport &report);
+
+private:
+  std::vector<std::shared_ptr<Param>> params;
+  std::vector<double> cached_param_values;
+  bool cached_text_valid = false;
+  bool operators_checked = false;
+  bool has_operators = false;
 };
 
 class LPObjective : public LPBase, public Objective {
@@ -43,14 +78,80 @@ public:
   LPConstraint() = default;
 };
 
+// The problem written by LPWriter as arrays, for solvers that are loaded
+// in-process. Rows are the active constraints and columns are the active
+// variables (see LPWriter::get_solve_cons and LPWriter::get_solve_vars).
+// The objective is obj_constant + obj_coefs^T x + 0.5 x^T Q x, with the
+// lower triangle of Q in q_rows, q_cols and q_values.
+class LPArrays {
+public:
+  LPArrays() = default;
+  int n_rows = 0;
+  int n_cols = 0;
+  // the constraint matrix in CSR form
+  std::vector<int> row_indptr;
+  std::vector<int> row_indices;
+  std::vector<double> row_values;
+  // the constraint matrix in CSC form
+  std::vector<int> col_indptr;
+  std::vector<int> col_indices;
+  std::vector<double> col_values;
+  std::vector<double> row_lower;
+  std::vector<double> row_upper;
+  std::vector<double> col_lower;
+  std::vector<double> col_upper;
+  // 1 for integer and binary columns, 0 for continuous ones
+  std::vector<int> integrality;
+  std::vector<double> obj_coefs;
+  double obj_constant = 0;
+  // 0 for minimize, 1 for maximize
+  int sense = 0;
+  std::vector<int> q_rows;
+  std::vector<int> q_cols;
+  std::vector<double> q_values;
+};
+
 class LPWriter : public Model {
 public:
   LPWriter() = default;
   std::vector<std::shared_ptr<LPConstraint>> solve_cons;
   std::vector<std::shared_ptr<Var>> solve_vars;
-  void write(std::string filename);
+  // The rows that need to be (re)formatted are split into ranges that are
+  // formatted on n_threads threads (0 means one per core). With
+  // compact_labels, the names of the variables and constraints are not
+  // used; variable i of get_solve_vars is written as x<i> and the rows of
+  // constraint i of get_solve_cons as c<i>_lb, c<i>_ub or c<i>_eq.
+  void write(std::string filename, int n_threads = 1,
+             bool compact_labels = false);
+  // The variable or constraint with a compact label in the last file
+  // written with compact_labels
+  std::shared_ptr<Var> get_var_from_label(std::string label);
+  std::shared_ptr<LPConstraint> get_con_from_label(std::string label);
+  // Writes the same problem in the free MPS format. Range constraints are
+  // written once (with a RANGES entry), the objective constant is the RHS
+  // of the objective row, and quadratic terms go in the QUADOBJ and
+  // QCMATRIX sections.
+  void write_mps(std::string filename);
+  // Evaluates the problem into arrays instead of writing a file. Quadratic
+  // constraints are not supported.
+  std::shared_ptr<LPArrays> to_arrays();
   std::vector<std::shared_ptr<LPConstraint>> get_solve_cons();
   std::vector<std::shared_ptr<Var>> get_solve_vars();
+  // the constraints whose rows were new or regenerated in the last call to
+  // write (e.g., for updating a solver that already has the other rows)
+  std::vector<std::shared_ptr<LPConstraint>> changed_cons;
+  std::vector<std::shared_ptr<LPConstraint>> get_changed_cons();
+  void add_to_memory_report(MemoryReport &report) override;
+
+private:
+  // the mode and the order of the rows and columns of the cached text
+  bool cached_compact_labels = false;
+  std::vector<std::shared_ptr<LPConstraint>> label_rows;
+  std::vector<std::shared_ptr<Var>> label_cols;
+  std::vector<std::shared_ptr<LPConstraint>> get_active_constraints();
+  std::vector<std::shared_ptr<Var>>
+  get_active_vars(std::vector<std::shared_ptr<LPConstraint>> &active_constraints,
+                  std::shared_ptr<LPObjective> lp_objective);
 };
 
 void process_lp_constraints(py::list, py::object);
@@ -0,0 +1,386 @@
+/**___________________________________________________________________________
+ *
+ * Pyomo: Python Optimization Modeling Objects
+ * Copyright (c) 2008-2024
+ * National Technology and Engineering Solutions of Sandia, LLC
+ * Under the terms of Contract DE-NA0003525 with National Technology and
+ * Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+ * rights in this software.
+ * This software is distributed under the 3-clause BSD License.
+ * ___________________________________________________________________________
+**/
+
+#include "expression.hpp"
+
+bool _mc_is_finite(double x) { return x > -inf && x < inf; }
+
+void _mc_mid(double xcv, double xcc, double z, double *res, McSource *src) {
+  // the median of xcv, xcc, and z; xcv <= xcc
+  if (z <= xcv) {
+    *res = xcv;
+    *src = mc_cv;
+  } else if (z >= xcc) {
+    *res = xcc;
+    *src = mc_cc;
+  } else {
+    *res = z;
+    *src = mc_none;
+  }
+}
+
+void mc_convex_univariate(double (*f)(double, double),
+                          double (*df)(double, double), double p, double xl,
+                          double xu, double xcv, double xcc, double zmin,
+                          McSide *cv, McSide *cc) {
+  double x;
+  _mc_mid(xcv, xcc, zmin, &x, &(cv->src));
+  cv->value = f(x, p);
+  if (cv->src == mc_none)
+    cv->coef = 0;
+  else
+    cv->coef = df(x, p);
+
+  if (!_mc_is_finite(xl) || !_mc_is_finite(xu)) {
+    cc->value = inf;
+    cc->coef = 0;
+    cc->src = mc_none;
+  } else if (xl == xu) {
+    cc->value = f(xl, p);
+    cc->coef = 0;
+    cc->src = mc_none;
+  } else {
+    // the secant is affine, so its maximum over [xcv, xcc] is at an end
+    double fl = f(xl, p);
+    double slope = (f(xu, p) - fl) / (xu - xl);
+    if (slope >= 0) {
+      x = xcc;
+      cc->src = mc_cc;
+    } else {
+      x = xcv;
+      cc->src = mc_cv;
+    }
+    cc->value = fl + slope * (x - xl);
+    cc->coef = slope;
+  }
+}
+
+void mc_concave_univariate(double (*f)(double, double),
+                           double (*df)(double, double), double p, double xl,
+                           double xu, double xcv, double xcc, double zmax,
+                           McSide *cv, McSide *cc) {
+  double x;
+  _mc_mid(xcv, xcc, zmax, &x, &(cc->src));
+  cc->value = f(x, p);
+  if (cc->src == mc_none)
+    cc->coef = 0;
+  else
+    cc->coef = df(x, p);
+
+  if (!_mc_is_finite(xl) || !_mc_is_finite(xu)) {
+    cv->value = -inf;
+    cv->coef = 0;
+    cv->src = mc_none;
+  } else if (xl == xu) {
+    cv->value = f(xl, p);
+    cv->coef = 0;
+    cv->src = mc_none;
+  } else {
+    // the secant is affine, so its minimum over [xcv, xcc] is at an end
+    double fl = f(xl, p);
+    double slope = (f(xu, p) - fl) / (xu - xl);
+    if (slope >= 0) {
+      x = xcv;
+      cv->src = mc_cv;
+    } else {
+      x = xcc;
+      cv->src = mc_cc;
+    }
+    cv->value = fl + slope * (x - xl);
+    cv->coef = slope;
+  }
+}
+
+void _mc_scaled_min(double a, double xcv, double xcc, double *res,
+                    McSource *src) {
+  // min(a*xcv, a*xcc)
+  if (a >= 0) {
+    *res = a * xcv;
+    *src = mc_cv;
+  } else {
+    *res = a * xcc;
+    *src = mc_cc;
+  }
+}
+
+void _mc_scaled_max(double a, double xcv, double xcc, double *res,
+                    McSource *src) {
+  // max(a*xcv, a*xcc)
+  if (a >= 0) {
+    *res = a * xcc;
+    *src = mc_cc;
+  } else {
+    *res = a * xcv;
+    *src = mc_cv;
+  }
+}
+
+bool mc_product(double xl, double xu, double xcv, double xcc, double yl,
+                double yu, double ycv, double ycc, McProductSide *cv,
+                McProductSide *cc) {
+  if (!_mc_is_finite(xl) || !_mc_is_finite(xu) || !_mc_is_finite(yl) ||
+      !_mc_is_finite(yu))
+    return false;
+
+  double t1, t2;
+  McSource s1, s2;
+
+  // convex underestimator: max of the two McCormick underestimators
+  _mc_scaled_min(yl, xcv, xcc, &t1, &s1);
+  _mc_scaled_min(xl, ycv, ycc, &t2, &s2);
+  double cv1 = t1 + t2 - xl * yl;
+  McSource cv1_sx = s1;
+  McSource cv1_sy = s2;
+  _mc_scaled_min(yu, xcv, xcc, &t1, &s1);
+  _mc_scaled_min(xu, ycv, ycc, &t2, &s2);
+  double cv2 = t1 + t2 - xu * yu;
+  if (cv1 >= cv2) {
+    cv->value = cv1;
+    cv->coef_x = yl;
+    cv->src_x = cv1_sx;
+    cv->coef_y = xl;
+    cv->src_y = cv1_sy;
+  } else {
+    cv->value = cv2;
+    cv->coef_x = yu;
+    cv->src_x = s1;
+    cv->coef_y = xu;
+    cv->src_y = s2;
+  }
+
+  // concave overestimator: min of the two McCormick overestimators
+  _mc_scaled_max(yl, xcv, xcc, &t1, &s1);
+  _mc_scaled_max(xu, ycv, ycc, &t2, &s2);
+  double cc1 = t1 + t2 - xu * yl;
+  McSource cc1_sx = s1;
+  McSource cc1_sy = s2;
+  _mc_scaled_max(yu, xcv, xcc, &t1, &s1);
+  _mc_scaled_max(xl, ycv, ycc, &t2, &s2);
+  double cc2 = t1 + t2 - xl * yu;
+  if (cc1 <= cc2) {
+    cc->value = cc1;
+    cc->coef_x = yl;
+    cc->src_x = cc1_sx;
+    cc->coef_y = xu;
+    cc->src_y = cc1_sy;
+  } else {
+    cc->value = cc2;
+    cc->coef_x = yu;
+    cc->src_x = s1;
+    cc->coef_y = xl;
+    cc->src_y = s2;
+  }
+  return true;
+}
+
+double _mc_exp(double x, double p) { return std::exp(x); }
+
+double _mc_log(double x, double p) { return std::log(x); }
+
+double _mc_dlog(double x, double p) { return 1.0 / x; }
+
+double _mc_log10(double x, double p) { return std::log10(x); }
+
+double _mc_dlog10(double x, double p) { return 1.0 / (x * std::log(10.0)); }
+
+double _mc_sqrt(double x, double p) { return std::sqrt(x); }
+
+double _mc_dsqrt(double x, double p) { return 0.5 / std::sqrt(x); }
+
+double _mc_abs(double x, double p) { return std::fabs(x); }
+
+double _mc_dabs(double x, double p) {
+  if (x >= 0)
+    return 1.0;
+  return -1.0;
+}
+
+double _mc_pow(double x, double p) { return std::pow(x, p); }
+
+double _mc_dpow(double x, double p) { return p * std::pow(x, p - 1); }
+
+bool mc_exp(double xl, double xu, double xcv, double xcc, McSide *cv,
+            McSide *cc) {
+  mc_convex_univariate(_mc_exp, _mc_exp, 0, xl, xu, xcv, xcc, xl, cv, cc);
+  return true;
+}
+
+bool mc_log(double xl, double xu, double xcv, double xcc, McSide *cv,
+            McSide *cc) {
+  if (xl <= 0)
+    return false;
+  mc_concave_univariate(_mc_log, _mc_dlog, 0, xl, xu, xcv, xcc, xu, cv, cc);
+  return true;
+}
+
+bool mc_log10(double xl, double xu, double xcv, double xcc, McSide *cv,
+              McSide *cc) {
+  if (xl <= 0)
+    return false;
+  mc_concave_univariate(_mc_log10, _mc_dlog10, 0, xl, xu, xcv, xcc, xu, cv,
+                        cc);
+  return true;
+}
+
+bool mc_sqrt(double xl, double xu, double xcv, double xcc, McSide *cv,
+             McSide *cc) {
+  if (xl < 0)
+    return false;
+  mc_concave_univariate(_mc_sqrt, _mc_dsqrt, 0, xl, xu, xcv, xcc, xu, cv, cc);
+  return true;
+}
+
+bool mc_abs(double xl, double xu, double xcv, double xcc, McSide *cv,
+            McSide *cc) {
+  double zmin = 0;
+  if (xl > 0)
+    zmin = xl;
+  else if (xu < 0)
+    zmin = xu;
+  mc_convex_univariate(_mc_abs, _mc_dabs, 0, xl, xu, xcv, xcc, zmin, cv, cc);
+  return true;
+}
+
+bool mc_inv(double xl, double xu, double xcv, double xcc, McSide *cv,
+            McSide *cc) {
+  return mc_power(xl, xu, xcv, xcc, -1, cv, cc);
+}
+
+bool mc_power(double xl, double xu, double xcv, double xcc, double p,
+              McSide *cv, McSide *cc) {
+  if (p == 0) {
+    cv->value = 1;
+    cv->coef = 0;
+    cv->src = mc_none;
+    cc->value = 1;
+    cc->coef = 0;
+    cc->src = mc_none;
+    return true;
+  }
+  if (p == 1) {
+    cv->value = xcv;
+    cv->coef = 1;
+    cv->src = mc_cv;
+    cc->value = xcc;
+    cc->coef = 1;
+    cc->src = mc_cc;
+    return true;
+  }
+
+  double intpart;
+  if (std::modf(p, &intpart) == 0.0) {
+    bool even = (std::fmod(p, 2.0) == 0.0);
+    if (p > 0) {
+      if (even) {
+        double zmin = 0;
+        if (xl > 0)
+          zmin = xl;
+        else if (xu < 0)
+          zmin = xu;
+        mc_convex_univariate(_mc_pow, _mc_dpow, p, xl, xu, xcv, xcc, zmin, cv,
+                             cc);
+      } else if (xl >= 0) {
+        mc_convex_univariate(_mc_pow, _mc_dpow, p, xl, xu, xcv, xcc, xl, cv,
+                             cc);
+      } else if (xu <= 0) {
+        mc_concave_univariate(_mc_pow, _mc_dpow, p, xl, xu, xcv, xcc, xu, cv,
+                              cc);
+      } else {
+        // x**p is neither convex nor concave on the domain
+        return false;
+      }
+    } else {
+      if (xl > 0) {
+        mc_convex_univariate(_mc_pow, _mc_dpow, p, xl, xu, xcv, xcc, xu, cv,
+                             cc);
+      } else if (xu < 0) {
+        if (even)
+          mc_convex_univariate(_mc_pow, _mc_dpow, p, xl, xu, xcv, xcc, xl, cv,
+                               cc);
+        else
+          mc_concave_univariate(_mc_pow, _mc_dpow, p, xl, xu, xcv, xcc, xl,
+                                cv, cc);
+      } else {
+        return false;
+      }
+    }
+  } else {
+    if (xl < 0 || (p < 0 && xl <= 0))
+      return false;
+    if (p > 1)
+      mc_convex_univariate(_mc_pow, _mc_dpow, p, xl, xu, xcv, xcc, xl, cv, cc);
+    else if (p > 0)
+      mc_concave_univariate(_mc_pow, _mc_dpow, p, xl, xu, xcv, xcc, xu, cv,
+                            cc);
+    else
+      mc_convex_univariate(_mc_pow, _mc_dpow, p, xl, xu, xcv, xcc, xu, cv, cc);
+  }
+  return true;
+}
+
+McCormickRelaxation::McCormickRelaxation(
+    std::shared_ptr<ExpressionBase> _expr,
+    std::vector<std::shared_ptr<Var>> _variables) {
+  expr = _expr;
+  variables = _variables;
+  expr_vars = expr->identify_variables();
+  unsigned int n_operators = 1;
+  if (expr->is_expression_type())
+    n_operators = std::dynamic_pointer_cast<Expression>(expr)->n_operators;
+  lbs.resize(n_operators);
+  ubs.resize(n_operators);
+  cvs.resize(n_operators);
+  ccs.resize(n_operators);
+  cv_subs.resize(n_operators * variables.size());
+  cc_subs.resize(n_operators * variables.size());
+  cv_subgradient.resize(variables.size());
+  cc_subgradient.resize(variables.size());
+}
+
+void McCormickRelaxation::evaluate(double feasibility_tol, double integer_tol) {
+  if (expr->is_expression_type()) {
+    std::shared_ptr<Expression> e = std::dynamic_pointer_cast<Expression>(expr);
+    e->propagate_bounds_forward(lbs.data(), ubs.data(), feasibility_tol,
+                                integer_tol);
+  }
+  evaluate_from_bounds(lbs.data(), ubs.data());
+}
+
+void McCormickRelaxation::evaluate_from_bounds(double *_lbs, double *_ubs) {
+  // _lbs and _ubs must already hold the forward interval bounds for each
+  // operator (e.g., from FBBTConstraint::perform_fbbt)
+  unsigned int n_vars = variables.size();
+  // variables in the expression but not in the list are treated as constants
+  for (std::shared_ptr<Var> &v : *expr_vars) {
+    v->index = -1;
+  }
+  for (unsigned int i = 0; i < n_vars; ++i) {
+    variables[i]->index = i;
+  }
+
+  if (expr->is_expression_type()) {
+    std::shared_ptr<Expression> e = std::dynamic_pointer_cast<Expression>(expr);
+    e->propagate_mccormick(_lbs, _ubs, cvs.data(), ccs.data(), cv_subs.data(),
+                           cc_subs.data(), n_vars);
+  }
+
+  lb = expr->get_lb_from_array(_lbs);
+  ub = expr->get_ub_from_array(_ubs);
+  cv = expr->get_cv_from_array(cvs.data());
+  cc = expr->get_cc_from_array(ccs.data());
+  std::fill(cv_subgradient.begin(), cv_subgradient.end(), 0.0);
+  std::fill(cc_subgradient.begin(), cc_subgradient.end(), 0.0);
+  expr->add_subgradient_from_array(1.0, mc_cv, cv_subs.data(), cc_subs.data(),
+                                   n_vars, cv_subgradient.data());
+  expr->add_subgradient_from_array(1.0, mc_cc, cv_subs.data(), cc_subs.data(),
+                                   n_vars, cc_subgradient.data());
+}
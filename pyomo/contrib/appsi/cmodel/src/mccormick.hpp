@@ -0,0 +1,103 @@
+/**___________________________________________________________________________
+ *
+ * Pyomo: Python Optimization Modeling Objects
+ * Copyright (c) 2008-2024
+ * National Technology and Engineering Solutions of Sandia, LLC
+ * Under the terms of Contract DE-NA0003525 with National Technology and
+ * Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+ * rights in this software.
+ * This software is distributed under the 3-clause BSD License.
+ * ___________________________________________________________________________
+**/
+
+#ifndef MCCORMICK_HEADER
+#define MCCORMICK_HEADER
+
+#include "interval.hpp"
+
+class ExpressionBase;
+class Var;
+
+extern double inf;
+
+// Which relaxation of an operand a subgradient refers to
+enum McSource { mc_none = 0, mc_cv = 1, mc_cc = 2 };
+
+// One side (convex or concave) of the McCormick relaxation of a univariate
+// function. The subgradient is coef times the src subgradient of the operand.
+struct McSide {
+  double value = 0;
+  double coef = 0;
+  McSource src = mc_none;
+};
+
+// One side of the McCormick relaxation of a product. The subgradient is
+// coef_x times the src_x subgradient of x plus coef_y times the src_y
+// subgradient of y.
+struct McProductSide {
+  double value = 0;
+  double coef_x = 0;
+  McSource src_x = mc_none;
+  double coef_y = 0;
+  McSource src_y = mc_none;
+};
+
+void mc_convex_univariate(double (*f)(double, double),
+                          double (*df)(double, double), double p, double xl,
+                          double xu, double xcv, double xcc, double zmin,
+                          McSide *cv, McSide *cc);
+void mc_concave_univariate(double (*f)(double, double),
+                           double (*df)(double, double), double p, double xl,
+                           double xu, double xcv, double xcc, double zmax,
+                           McSide *cv, McSide *cc);
+bool mc_product(double xl, double xu, double xcv, double xcc, double yl,
+                double yu, double ycv, double ycc, McProductSide *cv,
+                McProductSide *cc);
+bool mc_exp(double xl, double xu, double xcv, double xcc, McSide *cv,
+            McSide *cc);
+bool mc_log(double xl, double xu, double xcv, double xcc, McSide *cv,
+            McSide *cc);
+bool mc_log10(double xl, double xu, double xcv, double xcc, McSide *cv,
+              McSide *cc);
+bool mc_sqrt(double xl, double xu, double xcv, double xcc, McSide *cv,
+             McSide *cc);
+bool mc_abs(double xl, double xu, double xcv, double xcc, McSide *cv,
+            McSide *cc);
+bool mc_inv(double xl, double xu, double xcv, double xcc, McSide *cv,
+            McSide *cc);
+bool mc_power(double xl, double xu, double xcv, double xcc, double p,
+              McSide *cv, McSide *cc);
+
+// Computes McCormick relaxations of an appsi expression together with
+// subgradients with respect to a fixed list of variables. The reference
+// point is the current value of each variable (projected onto its bounds).
+// Interval bounds come from the same forward propagation used by FBBT.
+class McCormickRelaxation {
+public:
+  McCormickRelaxation(std::shared_ptr<ExpressionBase> _expr,
+                      std::vector<std::shared_ptr<Var>> _variables);
+  ~McCormickRelaxation() = default;
+  std::shared_ptr<ExpressionBase> expr;
+  std::vector<std::shared_ptr<Var>> variables;
+  double lb = -inf;
+  double ub = inf;
+  double cv = -inf;
+  double cc = inf;
+  std::vector<double> cv_subgradient;
+  std::vector<double> cc_subgradient;
+  void evaluate(double feasibility_tol, double integer_tol);
+  void evaluate_from_bounds(double *_lbs, double *_ubs);
+  // the length of the arrays passed to evaluate_from_bounds
+  unsigned int n_operators() const { return lbs.size(); }
+
+private:
+  std::shared_ptr<std::vector<std::shared_ptr<Var>>> expr_vars;
+  std::vector<double> lbs;
+  std::vector<double> ubs;
+  std::vector<double> cvs;
+  std::vector<double> ccs;
+  std::vector<double> cv_subs;
+  std::vector<double> cc_subs;
+};
+
+#endif
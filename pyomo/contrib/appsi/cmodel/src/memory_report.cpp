@@ -0,0 +1,197 @@
+/**___________________________________________________________________________
+ *
+ * Pyomo: Python Optimization Modeling Objects
+ * Copyright (c) 2008-2024
+ * National Technology and Engineering Solutions of Sandia, LLC
+ * Under the terms of Contract DE-NA0003525 with National Technology and
+ * Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+ * rights in this software.
+ * This software is distributed under the 3-clause BSD License.
+ * ___________________________________________________________________________
+**/
+
+#include "memory_report.hpp"
+#include <typeindex>
+
+// the size of the control block of an object created with std::make_shared
+// (the vtable pointer and the two reference counts)
+static const size_t control_block_size = 16;
+
+// the size of the chunk glibc malloc uses for an allocation of n bytes: an
+// 8 byte header, rounded up to a multiple of 16, and at least 32 bytes
+static size_t chunk_size(size_t n) {
+  size_t res = (n + 8 + 15) & ~size_t(15);
+  return res < 32 ? 32 : res;
+}
+
+enum NodeGroup {
+  leaf_group,
+  expression_group,
+  linear_group,
+  nary_group,
+  unary_group,
+  binary_group
+};
+
+struct NodeType {
+  std::string category;
+  size_t size;
+  NodeGroup group;
+};
+
+#define NODE_TYPE(T, group)                                                    \
+  { std::type_index(typeid(T)), {"nodes." #T, sizeof(T), group} }
+
+static const std::vector<std::pair<std::type_index, NodeType>> &
+node_types() {
+  static const std::vector<std::pair<std::type_index, NodeType>> res = {
+      NODE_TYPE(Var, leaf_group),
+      NODE_TYPE(Param, leaf_group),
+      NODE_TYPE(Constant, leaf_group),
+      NODE_TYPE(Expression, expression_group),
+      NODE_TYPE(LinearOperator, linear_group),
+      NODE_TYPE(SumOperator, nary_group),
+      NODE_TYPE(ExternalOperator, nary_group),
+      NODE_TYPE(NegationOperator, unary_group),
+      NODE_TYPE(ExpOperator, unary_group),
+      NODE_TYPE(LogOperator, unary_group),
+      NODE_TYPE(AbsOperator, unary_group),
+      NODE_TYPE(SqrtOperator, unary_group),
+      NODE_TYPE(Log10Operator, unary_group),
+      NODE_TYPE(SinOperator, unary_group),
+      NODE_TYPE(CosOperator, unary_group),
+      NODE_TYPE(TanOperator, unary_group),
+      NODE_TYPE(AsinOperator, unary_group),
+      NODE_TYPE(AcosOperator, unary_group),
+      NODE_TYPE(AtanOperator, unary_group),
+      NODE_TYPE(MultiplyOperator, binary_group),
+      NODE_TYPE(DivideOperator, binary_group),
+      NODE_TYPE(PowerOperator, binary_group)};
+  return res;
+}
+
+#undef NODE_TYPE
+
+static std::unordered_map<std::type_index, unsigned int>
+node_type_positions() {
+  std::unordered_map<std::type_index, unsigned int> res;
+  for (unsigned int i = 0; i < node_types().size(); ++i) {
+    res.emplace(node_types()[i].first, i);
+  }
+  return res;
+}
+
+// the position of the type of node in node_types()
+static unsigned int node_type_index(Node *node) {
+  static const std::unordered_map<std::type_index, unsigned int> positions =
+      node_type_positions();
+  std::unordered_map<std::type_index, unsigned int>::const_iterator it =
+      positions.find(std::type_index(typeid(*node)));
+  if (it == positions.end())
+    throw py::value_error("memory_report: unknown node type");
+  return it->second;
+}
+
+MemoryReport::MemoryReport()
+    : control_blocks(bytes["control_blocks"]),
+      allocator_overhead(bytes["allocator_overhead"]),
+      strings(bytes["strings"]), node_bytes(node_types().size(), 0) {}
+
+void MemoryReport::add_allocation(size_t &category, size_t n) {
+  category += n;
+  allocator_overhead += chunk_size(n) - n;
+}
+
+void MemoryReport::add_shared(size_t &category, size_t n) {
+  category += n;
+  control_blocks += control_block_size;
+  allocator_overhead +=
+      chunk_size(n + control_block_size) - n - control_block_size;
+}
+
+void MemoryReport::add_string(size_t &category, const std::string &s) {
+  const char *data = s.data();
+  const char *obj = reinterpret_cast<const char *>(&s);
+  if (data >= obj && data < obj + sizeof(s))
+    return;
+  add_allocation(category, s.capacity() + 1);
+}
+
+void MemoryReport::add_nodes(Node *root) {
+  auto push = [this](const std::shared_ptr<Node> &node) {
+    if (node != nullptr && first_visit(node))
+      stack.push_back(node.get());
+  };
+  stack.push_back(root);
+  while (!stack.empty()) {
+    Node *node = stack.back();
+    stack.pop_back();
+    unsigned int ndx = node_type_index(node);
+    const NodeType &type = node_types()[ndx].second;
+    size_t &category = node_bytes[ndx];
+    add_shared(category, type.size);
+
+    if (type.group == leaf_group) {
+      if (node->is_variable_type()) {
+        Var *v = static_cast<Var *>(node);
+        add_string(strings, v->name);
+        push(v->lb);
+        push(v->ub);
+      } else if (node->is_param_type()) {
+        add_string(strings, static_cast<Param *>(node)->name);
+      }
+    } else if (type.group == expression_group) {
+      Expression *e = static_cast<Expression *>(node);
+      // arrays allocated with new[] store their length as well
+      add_allocation(category, e->n_operators * sizeof(e->operators[0]) + 8);
+      for (unsigned int i = 0; i < e->n_operators; ++i) {
+        push(e->operators[i]);
+      }
+    } else if (type.group == linear_group) {
+      LinearOperator *oper = static_cast<LinearOperator *>(node);
+      add_allocation(category, oper->nterms * sizeof(oper->variables[0]) + 8);
+      add_allocation(category,
+                     oper->nterms * sizeof(oper->coefficients[0]) + 8);
+      for (unsigned int i = 0; i < oper->nterms; ++i) {
+        push(oper->variables[i]);
+        push(oper->coefficients[i]);
+      }
+      push(oper->constant);
+    } else if (type.group == nary_group) {
+      std::shared_ptr<Node> *operands;
+      unsigned int nargs;
+      if (node->is_sum_operator()) {
+        operands = static_cast<SumOperator *>(node)->operands;
+        nargs = static_cast<SumOperator *>(node)->nargs;
+      } else {
+        ExternalOperator *oper = static_cast<ExternalOperator *>(node);
+        operands = oper->operands;
+        nargs = oper->nargs;
+        add_string(strings, oper->function_name);
+      }
+      add_allocation(category, nargs * sizeof(operands[0]) + 8);
+      for (unsigned int i = 0; i < nargs; ++i) {
+        push(operands[i]);
+      }
+    } else if (type.group == unary_group) {
+      push(static_cast<UnaryOperator *>(node)->operand);
+    } else {
+      BinaryOperator *oper = static_cast<BinaryOperator *>(node);
+      push(oper->operand1);
+      push(oper->operand2);
+    }
+  }
+}
+
+std::map<std::string, size_t> MemoryReport::get_bytes() {
+  std::map<std::string, size_t> res;
+  for (const std::pair<const std::string, size_t> &item : bytes) {
+    if (item.second > 0)
+      res[item.first] = item.second;
+  }
+  for (unsigned int i = 0; i < node_bytes.size(); ++i) {
+    if (node_bytes[i] > 0)
+      res[node_types()[i].second.category] = node_bytes[i];
+  }
+  return res;
+}
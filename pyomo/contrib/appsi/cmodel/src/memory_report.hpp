@@ -0,0 +1,80 @@
+/**___________________________________________________________________________
+ *
+ * Pyomo: Python Optimization Modeling Objects
+ * Copyright (c) 2008-2024
+ * National Technology and Engineering Solutions of Sandia, LLC
+ * Under the terms of Contract DE-NA0003525 with National Technology and
+ * Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+ * rights in this software.
+ * This software is distributed under the 3-clause BSD License.
+ * ___________________________________________________________________________
+**/
+
+#ifndef MEMORY_REPORT_HEADER
+#define MEMORY_REPORT_HEADER
+
+#include "expression.hpp"
+#include <unordered_set>
+
+// An estimate of the memory used by a model, in bytes by category (see
+// Model::memory_report). Each object is counted with its size; the control
+// blocks of the shared_ptrs and the overhead of the allocator (the header
+// and the rounding of each allocation, as in glibc malloc) have categories
+// of their own. Nodes and vectors that are shared by several constraints
+// are counted once. The Python objects that refer to the model (e.g., the
+// maps from Pyomo components) are not included; they are reported by
+// pyomo.contrib.appsi.utils.python_memory_report.
+//
+// Nodes are counted by type ("nodes.Var", "nodes.SumOperator", ...),
+// including the arrays of their operands and operators.
+class MemoryReport {
+public:
+  MemoryReport();
+  // the nodes reachable from node that were not counted yet (including the
+  // bounds of the variables)
+  template <class T> void add_node(const std::shared_ptr<T> &node) {
+    if (node != nullptr && first_visit(node))
+      add_nodes(node.get());
+  }
+  // an allocation of n bytes
+  void add_allocation(size_t &category, size_t n);
+  // an object of n bytes created with std::make_shared
+  void add_shared(size_t &category, size_t n);
+  template <class T>
+  void add_vector(size_t &category, const std::vector<T> &v) {
+    if (v.capacity() > 0)
+      add_allocation(category, v.capacity() * sizeof(T));
+  }
+  // a vector owned by a shared_ptr, unless it was counted already
+  template <class T>
+  void add_shared_vector(size_t &category,
+                         const std::shared_ptr<std::vector<T>> &v) {
+    if (v == nullptr || !first_visit(v))
+      return;
+    add_shared(category, sizeof(std::vector<T>));
+    add_vector(category, *v);
+  }
+  // the buffer of s if it does not fit in the string object itself
+  void add_string(size_t &category, const std::string &s);
+  // True the first time ptr is passed. Objects that are only owned by ptr
+  // cannot be reached twice, so they are not stored; in most expressions,
+  // only the leaves are shared.
+  template <class T> bool first_visit(const std::shared_ptr<T> &ptr) {
+    return ptr.use_count() == 1 || visited.insert(ptr.get()).second;
+  }
+  size_t &operator[](const std::string &category) { return bytes[category]; }
+  std::map<std::string, size_t> get_bytes();
+
+private:
+  void add_nodes(Node *root);
+  std::map<std::string, size_t> bytes;
+  size_t &control_blocks;
+  size_t &allocator_overhead;
+  size_t &strings;
+  // by the position of the node type in the table in memory_report.cpp
+  std::vector<size_t> node_bytes;
+  std::unordered_set<const void *> visited;
+  std::vector<Node *> stack;
+};
+
+#endif
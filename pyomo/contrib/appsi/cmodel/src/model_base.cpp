@@ -17,19 +17,269 @@ bool constraint_sorter(std::shared_ptr<Constraint> c1,
   return c1->index < c2->index;
 }
 
-Model::Model() {
-  constraints =
-      std::set<std::shared_ptr<Constraint>, decltype(constraint_sorter) *>(
-          constraint_sorter);
+void ConstraintSet::add(std::shared_ptr<Constraint> con) {
+  if (contains(con))
+    return;
+  con->index = slots.size();
+  slots.push_back(con);
+  n_constraints += 1;
+}
+
+void ConstraintSet::remove(std::shared_ptr<Constraint> con) {
+  if (con->index < 0 || (unsigned int)con->index >= slots.size() ||
+      slots[con->index] != con)
+    return;
+  slots[con->index] = nullptr;
+  con->index = -1;
+  n_constraints -= 1;
+}
+
+void ConstraintSet::compact() {
+  unsigned int n = 0;
+  for (unsigned int i = 0; i < slots.size(); ++i) {
+    if (slots[i] == nullptr)
+      continue;
+    slots[i]->index = n;
+    if (i != n)
+      slots[n] = std::move(slots[i]);
+    n += 1;
+  }
+  slots.resize(n);
+}
+
+bool ConstraintSet::compact_if_sparse() {
+  if (slots.size() <= 2 * n_constraints)
+    return false;
+  compact();
+  return true;
+}
+
+std::vector<std::shared_ptr<Constraint>> ConstraintSet::to_vector() const {
+  std::vector<std::shared_ptr<Constraint>> res;
+  res.reserve(n_constraints);
+  for (const std::shared_ptr<Constraint> &con : *this) {
+    res.push_back(con);
+  }
+  return res;
 }
 
 void Model::add_constraint(std::shared_ptr<Constraint> con) {
-  con->index = current_con_ndx;
-  current_con_ndx += 1;
-  constraints.insert(constraints.end(), con);
+  constraints.add(con);
 }
 
 void Model::remove_constraint(std::shared_ptr<Constraint> con) {
-  constraints.erase(con);
-  con->index = -1;
+  constraints.remove(con);
+  if (constraints.compact_if_sparse())
+    prune_dependents();
+  constraints_removed();
+}
+
+void Model::compact_constraints() {
+  // every removed constraint leaves an empty slot, and the index is pruned
+  // whenever the slots are compacted
+  if (constraints.n_slots() == constraints.size())
+    return;
+  constraints.compact();
+  prune_dependents();
+}
+
+void Model::add_constraints(std::vector<std::shared_ptr<Constraint>> &cons) {
+  constraints.reserve(constraints.n_slots() + cons.size());
+  for (std::shared_ptr<Constraint> &con : cons) {
+    constraints.add(con);
+  }
+}
+
+void Model::remove_constraints(std::vector<std::shared_ptr<Constraint>> &cons) {
+  for (std::shared_ptr<Constraint> &con : cons) {
+    constraints.remove(con);
+  }
+  if (constraints.compact_if_sparse())
+    prune_dependents();
+  constraints_removed();
+}
+
+void Model::add_dependencies(
+    std::shared_ptr<Constraint> con,
+    std::vector<std::shared_ptr<ExpressionBase>> exprs) {
+  std::vector<std::shared_ptr<Leaf>> leaves;
+  std::set<Leaf *> leaf_set;
+  std::shared_ptr<std::vector<std::shared_ptr<Param>>> expr_params;
+  std::shared_ptr<std::vector<std::shared_ptr<Var>>> expr_vars;
+  for (std::shared_ptr<ExpressionBase> &expr : exprs) {
+    if (expr == nullptr || expr->is_constant_type())
+      continue;
+    expr_params = expr->identify_params();
+    for (std::shared_ptr<Param> &p : *expr_params) {
+      if (leaf_set.insert(p.get()).second)
+        leaves.push_back(p);
+    }
+    expr_vars = expr->identify_variables();
+    for (std::shared_ptr<Var> &v : *expr_vars) {
+      if (v->fixed && leaf_set.insert(v.get()).second)
+        leaves.push_back(v);
+    }
+  }
+  std::unordered_map<Leaf *, unsigned int>::iterator it;
+  for (std::shared_ptr<Leaf> &leaf : leaves) {
+    it = dependents_index.find(leaf.get());
+    if (it == dependents_index.end()) {
+      it = dependents_index.emplace(leaf.get(), dependents.size()).first;
+      dependents.emplace_back();
+      dependents.back().leaf = leaf;
+      dependents.back().value = leaf->value;
+      dependents.back().taken_value = leaf->value;
+    }
+    dependents[it->second].constraints.push_back(con);
+  }
+}
+
+std::vector<std::shared_ptr<Constraint>>
+Model::get_dependents(std::shared_ptr<ExpressionBase> leaf) {
+  std::vector<std::shared_ptr<Constraint>> res;
+  std::unordered_map<Leaf *, unsigned int>::iterator it =
+      dependents_index.find(dynamic_cast<Leaf *>(leaf.get()));
+  if (it == dependents_index.end())
+    return res;
+  std::shared_ptr<Constraint> con;
+  for (std::weak_ptr<Constraint> &ref : dependents[it->second].constraints) {
+    con = ref.lock();
+    if (con != nullptr && constraints.contains(con))
+      res.push_back(con);
+  }
+  return res;
+}
+
+void Model::mark_dirty(std::shared_ptr<ExpressionBase> leaf) {
+  std::unordered_map<Leaf *, unsigned int>::iterator it =
+      dependents_index.find(dynamic_cast<Leaf *>(leaf.get()));
+  if (it == dependents_index.end() || dependents[it->second].dirty)
+    return;
+  dependents[it->second].dirty = true;
+  dirty_leaves.push_back(it->second);
+}
+
+void Model::find_changed_values() {
+  for (unsigned int i = 0; i < dependents.size(); ++i) {
+    LeafDependents &d = dependents[i];
+    if (!d.dirty && d.leaf->value != d.value) {
+      d.dirty = true;
+      dirty_leaves.push_back(i);
+    }
+  }
+}
+
+std::vector<std::shared_ptr<ExpressionBase>> Model::get_dirty_leaves() {
+  std::vector<std::shared_ptr<ExpressionBase>> res;
+  for (unsigned int i : dirty_leaves) {
+    res.push_back(dependents[i].leaf);
+  }
+  return res;
+}
+
+std::vector<std::shared_ptr<Constraint>> Model::get_dirty_constraints() {
+  return get_constraints_of(dirty_leaves);
+}
+
+std::vector<std::shared_ptr<Constraint>> Model::take_changed_constraints() {
+  std::vector<unsigned int> changed;
+  for (unsigned int i = 0; i < dependents.size(); ++i) {
+    LeafDependents &d = dependents[i];
+    if (d.leaf->value != d.taken_value) {
+      d.taken_value = d.leaf->value;
+      changed.push_back(i);
+    }
+  }
+  return get_constraints_of(changed);
+}
+
+// the constraints in the model that depend on the given leaves (positions
+// in dependents), in the order of the constraints
+std::vector<std::shared_ptr<Constraint>>
+Model::get_constraints_of(const std::vector<unsigned int> &leaves) {
+  std::vector<std::shared_ptr<Constraint>> res;
+  std::vector<char> found(constraints.n_slots(), 0);
+  std::shared_ptr<Constraint> con;
+  for (unsigned int i : leaves) {
+    for (std::weak_ptr<Constraint> &ref : dependents[i].constraints) {
+      con = ref.lock();
+      if (con != nullptr && constraints.contains(con) && !found[con->index]) {
+        found[con->index] = 1;
+        res.push_back(con);
+      }
+    }
+  }
+  std::sort(res.begin(), res.end(), constraint_sorter);
+  return res;
+}
+
+void Model::clear_dirty() {
+  for (unsigned int i : dirty_leaves) {
+    dependents[i].dirty = false;
+    dependents[i].value = dependents[i].leaf->value;
+  }
+  dirty_leaves.clear();
+}
+
+std::map<std::string, size_t> Model::memory_report() {
+  MemoryReport report;
+  add_to_memory_report(report);
+  return report.get_bytes();
+}
+
+void Model::add_to_memory_report(MemoryReport &report) {
+  size_t &constraints_bytes = report["constraints"];
+  size_t &strings = report["strings"];
+  report.add_allocation(constraints_bytes,
+                        constraints.slot_capacity() *
+                            sizeof(std::shared_ptr<Constraint>));
+  for (const std::shared_ptr<Constraint> &con : constraints) {
+    report.add_string(strings, con->name);
+    report.add_node(con->lb);
+    report.add_node(con->ub);
+  }
+  if (objective != nullptr)
+    report.add_string(strings, objective->name);
+
+  size_t &index_bytes = report["dependency_index"];
+  report.add_vector(index_bytes, dependents);
+  for (LeafDependents &d : dependents) {
+    report.add_vector(index_bytes, d.constraints);
+  }
+  report.add_vector(index_bytes, dirty_leaves);
+  // the buckets and a node (the key, the value and a pointer to the next
+  // node) per entry
+  // (an empty map uses a single bucket that is not allocated)
+  if (dependents_index.bucket_count() > 1)
+    report.add_allocation(index_bytes,
+                          dependents_index.bucket_count() * sizeof(void *));
+  for (unsigned int i = 0; i < dependents_index.size(); ++i) {
+    report.add_allocation(index_bytes,
+                          sizeof(void *) + sizeof(std::pair<Leaf *, int>));
+  }
+}
+
+// drops the constraints that are no longer in the model and the leaves
+// without any constraints left
+void Model::prune_dependents() {
+  std::vector<LeafDependents> kept;
+  std::shared_ptr<Constraint> con;
+  dependents_index.clear();
+  dirty_leaves.clear();
+  for (LeafDependents &d : dependents) {
+    std::vector<std::weak_ptr<Constraint>> refs;
+    for (std::weak_ptr<Constraint> &ref : d.constraints) {
+      con = ref.lock();
+      if (con != nullptr && constraints.contains(con))
+        refs.push_back(ref);
+    }
+    if (refs.empty())
+      continue;
+    d.constraints = std::move(refs);
+    dependents_index[d.leaf.get()] = kept.size();
+    if (d.dirty)
+      dirty_leaves.push_back(kept.size());
+    kept.push_back(std::move(d));
+  }
+  dependents = std::move(kept);
 }
@@ -14,9 +14,12 @@
 #define MODEL_HEADER
 
 #include "expression.hpp"
+#include "memory_report.hpp"
+#include <unordered_map>
 
 class Constraint;
 class Objective;
+class ConstraintSet;
 class Model;
 
 extern double inf;
@@ -43,16 +46,146 @@ public:
 bool constraint_sorter(std::shared_ptr<Constraint> c1,
                        std::shared_ptr<Constraint> c2);
 
+// The constraints of a model in the order they were added. Each constraint
+// is stored in a slot of a vector and Constraint::index is its slot, so
+// adding or removing a constraint is O(1). A removed constraint leaves an
+// empty slot that iteration skips. compact() drops the empty slots and
+// renumbers the constraints (the order does not change); remove_constraint
+// does that once more than half of the slots are empty. Empty slots are
+// not reused, since that would change the order of the constraints.
+class ConstraintSet {
+public:
+  class const_iterator {
+  public:
+    const_iterator(const std::shared_ptr<Constraint> *_ptr,
+                   const std::shared_ptr<Constraint> *_end)
+        : ptr(_ptr), end(_end) {
+      skip_empty();
+    }
+    const std::shared_ptr<Constraint> &operator*() const { return *ptr; }
+    const_iterator &operator++() {
+      ++ptr;
+      skip_empty();
+      return *this;
+    }
+    bool operator==(const const_iterator &other) const {
+      return ptr == other.ptr;
+    }
+    bool operator!=(const const_iterator &other) const {
+      return ptr != other.ptr;
+    }
+
+  private:
+    void skip_empty() {
+      while (ptr != end && *ptr == nullptr)
+        ++ptr;
+    }
+    const std::shared_ptr<Constraint> *ptr;
+    const std::shared_ptr<Constraint> *end;
+  };
+
+  const_iterator begin() const {
+    return const_iterator(slots.data(), slots.data() + slots.size());
+  }
+  const_iterator end() const {
+    return const_iterator(slots.data() + slots.size(),
+                          slots.data() + slots.size());
+  }
+  // the number of constraints
+  unsigned int size() const { return n_constraints; }
+  bool empty() const { return n_constraints == 0; }
+  // the indices of the constraints are less than n_slots()
+  unsigned int n_slots() const { return slots.size(); }
+  size_t slot_capacity() const { return slots.capacity(); }
+  bool contains(const std::shared_ptr<Constraint> &con) const {
+    return con->index >= 0 && (unsigned int)con->index < slots.size() &&
+           slots[con->index] == con;
+  }
+  void reserve(unsigned int n) { slots.reserve(n); }
+  // does nothing if con is already in the set
+  void add(std::shared_ptr<Constraint> con);
+  // does nothing if con is not in the set
+  void remove(std::shared_ptr<Constraint> con);
+  void compact();
+  // compacts the slots if more than half of them are empty; returns true if
+  // it did
+  bool compact_if_sparse();
+  std::vector<std::shared_ptr<Constraint>> to_vector() const;
+
+private:
+  std::vector<std::shared_ptr<Constraint>> slots;
+  unsigned int n_constraints = 0;
+};
+
 class Model {
 public:
-  Model();
+  Model() = default;
   virtual ~Model() = default;
-  std::set<std::shared_ptr<Constraint>, decltype(constraint_sorter) *>
-      constraints;
+  ConstraintSet constraints;
   std::shared_ptr<Objective> objective;
   void add_constraint(std::shared_ptr<Constraint>);
   void remove_constraint(std::shared_ptr<Constraint>);
-  int current_con_ndx = 0;
+  void add_constraints(std::vector<std::shared_ptr<Constraint>> &cons);
+  void remove_constraints(std::vector<std::shared_ptr<Constraint>> &cons);
+
+  // Reverse dependency index from the params and fixed variables to the
+  // constraints whose constants, coefficients or bounds (exprs) reference
+  // them. The process_*_constraints functions add the constraints they
+  // convert; constraints removed from the model are dropped whenever the
+  // constraint slots are compacted.
+  void add_dependencies(std::shared_ptr<Constraint> con,
+                        std::vector<std::shared_ptr<ExpressionBase>> exprs);
+  std::vector<std::shared_ptr<Constraint>>
+  get_dependents(std::shared_ptr<ExpressionBase> leaf);
+  // A param or fixed variable in the index is dirty if it was passed to
+  // mark_dirty or if find_changed_values found that its value changed
+  // since it was added or since the last call to clear_dirty. The dirty set
+  // is only for callers; the writers do not use it.
+  void mark_dirty(std::shared_ptr<ExpressionBase> leaf);
+  void find_changed_values();
+  std::vector<std::shared_ptr<ExpressionBase>> get_dirty_leaves();
+  // the constraints that depend on a dirty param or variable, in the order
+  // of the constraints
+  std::vector<std::shared_ptr<Constraint>> get_dirty_constraints();
+  void clear_dirty();
+
+  // An estimate of the memory used by the model in bytes, by category (see
+  // MemoryReport). It takes time linear in the size of the model and does
+  // not allocate much, so it can be called on large models.
+  std::map<std::string, size_t> memory_report();
+  // subclasses add their constraints, objective and caches
+  virtual void add_to_memory_report(MemoryReport &report);
+
+protected:
+  // called by remove_constraint(s) after the constraints were removed
+  virtual void constraints_removed() {}
+  // compacts the constraint slots and drops the removed constraints from
+  // the dependency index
+  void compact_constraints();
+  // The constraints that depend on a param or fixed variable whose value
+  // changed since the last call (or since it was added), in the order of
+  // the constraints. The writers use this to find the rows to regenerate;
+  // it keeps its own copy of the values, so it neither depends on nor
+  // changes the dirty set above.
+  std::vector<std::shared_ptr<Constraint>> take_changed_constraints();
+
+private:
+  struct LeafDependents {
+    std::shared_ptr<Leaf> leaf;
+    // the value when the leaf was added or the dirty set was cleared
+    double value;
+    bool dirty = false;
+    // the value when the leaf was added or take_changed_constraints was
+    // last called
+    double taken_value;
+    std::vector<std::weak_ptr<Constraint>> constraints;
+  };
+  std::vector<LeafDependents> dependents;
+  std::unordered_map<Leaf *, unsigned int> dependents_index;
+  std::vector<unsigned int> dirty_leaves;
+  void prune_dependents();
+  std::vector<std::shared_ptr<Constraint>>
+  get_constraints_of(const std::vector<unsigned int> &leaves);
 };
 
 #endif
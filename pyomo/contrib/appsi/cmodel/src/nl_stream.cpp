@@ -0,0 +1,68 @@
+/**___________________________________________________________________________
+ *
+ * Pyomo: Python Optimization Modeling Objects
+ * Copyright (c) 2008-2024
+ * National Technology and Engineering Solutions of Sandia, LLC
+ * Under the terms of Contract DE-NA0003525 with National Technology and
+ * Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+ * rights in this software.
+ * This software is distributed under the 3-clause BSD License.
+ * ___________________________________________________________________________
+**/
+
+#include "nl_stream.hpp"
+#include <cstdint>
+
+NLStream::NLStream(BufferedSink &_out, bool _binary)
+    : binary(_binary), out(_out) {}
+
+void NLStream::put_text(const std::string &s) { out << s; }
+
+void NLStream::put_key(char c) { out.put(c); }
+
+void NLStream::put_int(int i) {
+  if (binary) {
+    int32_t val = i;
+    out.write(reinterpret_cast<const char *>(&val), sizeof(val));
+  } else {
+    out.put_int(i);
+  }
+}
+
+void NLStream::put_double(double d) {
+  if (binary)
+    out.write(reinterpret_cast<const char *>(&d), sizeof(d));
+  else
+    out.put_double(d);
+}
+
+void NLStream::put_string(const std::string &s) {
+  if (binary) {
+    put_int(s.size());
+    out.write(s.data(), s.size());
+  } else {
+    out << s;
+  }
+}
+
+void NLStream::put_segment(const std::string &s) {
+  out.write(s.data(), s.size());
+}
+
+void NLStream::space() {
+  if (!binary)
+    out.put(' ');
+}
+
+void NLStream::newline() {
+  if (!binary)
+    out.put('\n');
+}
+
+int nl_arith_kind() {
+  // 1 for IEEE little-endian, 2 for IEEE big-endian
+  uint32_t one = 1;
+  if (*reinterpret_cast<unsigned char *>(&one) == 1)
+    return 1;
+  return 2;
+}
@@ -0,0 +1,45 @@
+/**___________________________________________________________________________
+ *
+ * Pyomo: Python Optimization Modeling Objects
+ * Copyright (c) 2008-2024
+ * National Technology and Engineering Solutions of Sandia, LLC
+ * Under the terms of Contract DE-NA0003525 with National Technology and
+ * Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+ * rights in this software.
+ * This software is distributed under the 3-clause BSD License.
+ * ___________________________________________________________________________
+**/
+
+#ifndef NL_STREAM_HEADER
+#define NL_STREAM_HEADER
+
+#include "buffered_sink.hpp"
+
+// Writes the tokens of an NL file either in the text ("g") format or in the
+// binary ("b") format. In the binary format, segment keys and expression
+// node types are single bytes, integers are 4 bytes, reals are 8 bytes (all
+// in native byte order) and there are no separators. The header is text in
+// both formats.
+class NLStream {
+public:
+  NLStream(BufferedSink &_out, bool _binary);
+  ~NLStream() = default;
+  bool binary;
+  void put_text(const std::string &s);
+  void put_key(char c);
+  void put_int(int i);
+  void put_double(double d);
+  void put_string(const std::string &s);
+  // copy tokens that were already written by an NLStream in the same mode
+  void put_segment(const std::string &s);
+  void space();
+  void newline();
+
+private:
+  BufferedSink &out;
+};
+
+// the value of the "arith" header field for this machine
+int nl_arith_kind();
+
+#endif
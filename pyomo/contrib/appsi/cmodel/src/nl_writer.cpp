@@ -11,6 +11,168 @@
 **/
 
 #include "nl_writer.hpp"
+#include "nl_stream.hpp"
+#include <functional>
+
+// Collects the subexpressions reached from root in prefix order without
+// descending into them. If prefix is not null, the nodes visited are
+// appended to it.
+static void
+split_at_subexpressions(std::shared_ptr<Node> root, SubexpressionMap &named,
+                        std::vector<std::shared_ptr<Node>> *prefix,
+                        std::vector<std::shared_ptr<NLSubexpression>> &refs) {
+  std::shared_ptr<std::vector<std::shared_ptr<Node>>> stack =
+      std::make_shared<std::vector<std::shared_ptr<Node>>>();
+  std::shared_ptr<Node> node;
+  SubexpressionMap::iterator it;
+  stack->push_back(root);
+  while (stack->size() > 0) {
+    node = stack->back();
+    stack->pop_back();
+    if (prefix != nullptr)
+      prefix->push_back(node);
+    if (node != root) {
+      it = named.find(node);
+      if (it != named.end()) {
+        refs.push_back(it->second);
+        continue;
+      }
+    }
+    node->fill_prefix_notation_stack(stack);
+  }
+}
+
+static void write_subexpression_reference(NLStream &f, NLSubexpression &sub);
+
+// Writes node in prefix notation. refs are the subexpressions below node in
+// the order they are reached, starting at ref_ndx.
+static void
+write_with_subexpressions(NLStream &f, std::shared_ptr<Node> node,
+                          std::vector<std::shared_ptr<NLSubexpression>> &refs,
+                          unsigned int &ref_ndx) {
+  std::shared_ptr<std::vector<std::shared_ptr<Node>>> stack =
+      std::make_shared<std::vector<std::shared_ptr<Node>>>();
+  stack->push_back(node);
+  while (stack->size() > 0) {
+    node = stack->back();
+    stack->pop_back();
+    if (ref_ndx < refs.size() && node == refs[ref_ndx]->root) {
+      write_subexpression_reference(f, *(refs[ref_ndx]));
+      ++ref_ndx;
+      continue;
+    }
+    node->write_nl_string(f);
+    node->fill_prefix_notation_stack(stack);
+  }
+}
+
+static void write_subexpression_reference(NLStream &f, NLSubexpression &sub) {
+  if (sub.nl_index >= 0) {
+    f.put_key('v');
+    f.put_int(sub.nl_index);
+    f.newline();
+  } else {
+    unsigned int ref_ndx = 0;
+    write_with_subexpressions(f, sub.root, sub.subexpressions, ref_ndx);
+  }
+}
+
+// Writes the V segment of a subexpression. Variables and linear operators
+// that are terms of the root sum go into the linear part of the segment.
+static void write_defined_variable(NLStream &f, NLSubexpression &sub, int k) {
+  std::vector<std::shared_ptr<Node>> terms;
+  if (sub.root->is_sum_operator()) {
+    std::shared_ptr<SumOperator> sum =
+        std::dynamic_pointer_cast<SumOperator>(sub.root);
+    for (unsigned int i = 0; i < sum->nargs; ++i) {
+      terms.push_back(sum->operands[i]);
+    }
+  } else {
+    terms.push_back(sub.root);
+  }
+
+  std::map<int, double> linear;
+  std::vector<std::shared_ptr<Node>> nonlinear_terms;
+  double constant = 0;
+  for (std::shared_ptr<Node> &term : terms) {
+    if (term->is_variable_type()) {
+      linear[std::dynamic_pointer_cast<Var>(term)->index] += 1;
+    } else if (term->is_linear_operator()) {
+      std::shared_ptr<LinearOperator> lin =
+          std::dynamic_pointer_cast<LinearOperator>(term);
+      constant += lin->constant->evaluate();
+      for (unsigned int i = 0; i < lin->nterms; ++i) {
+        linear[lin->variables[i]->index] += lin->coefficients[i]->evaluate();
+      }
+    } else {
+      nonlinear_terms.push_back(term);
+    }
+  }
+  // zero coefficients confuse the derivative computations in the ASL
+  for (std::map<int, double>::iterator it = linear.begin();
+       it != linear.end();) {
+    if (it->second == 0)
+      it = linear.erase(it);
+    else
+      ++it;
+  }
+
+  f.put_key('V');
+  f.put_int(sub.nl_index);
+  f.space();
+  f.put_int(linear.size());
+  f.space();
+  f.put_int(k);
+  f.newline();
+  for (std::pair<const int, double> &p : linear) {
+    f.put_int(p.first);
+    f.space();
+    f.put_double(p.second);
+    f.newline();
+  }
+
+  unsigned int n_args = nonlinear_terms.size() + (constant != 0 ? 1 : 0);
+  if (n_args == 2) {
+    f.put_key('o');
+    f.put_int(0);
+    f.newline();
+  } else if (n_args > 2) {
+    f.put_key('o');
+    f.put_int(54);
+    f.newline();
+    f.put_int(n_args);
+    f.newline();
+  }
+  if (constant != 0 || n_args == 0) {
+    f.put_key('n');
+    f.put_double(constant);
+    f.newline();
+  }
+  unsigned int ref_ndx = 0;
+  for (std::shared_ptr<Node> &term : nonlinear_terms) {
+    write_with_subexpressions(f, term, sub.subexpressions, ref_ndx);
+  }
+}
+
+// records that sub is written once for the given user (a row index)
+static void add_subexpression_use(NLSubexpression &sub, int user, bool in_cons,
+                                  bool in_obj) {
+  if (sub.n_uses == 0)
+    sub.user = user;
+  else if (sub.user != user)
+    sub.user = -1;
+  sub.n_uses += 1;
+  sub.in_cons = sub.in_cons || in_cons;
+  sub.in_obj = sub.in_obj || in_obj;
+}
+
+NLSubexpression::NLSubexpression(std::shared_ptr<Node> _root,
+                                 unsigned int _order,
+                                 SubexpressionMap &subexpressions) {
+  root = _root;
+  order = _order;
+  split_at_subexpressions(root, subexpressions, nullptr, this->subexpressions);
+}
 
 NLBase::NLBase(
     std::shared_ptr<ExpressionBase> _constant_expr,
@@ -51,6 +213,32 @@ NLBase::NLBase(
   }
 
   nonlinear_prefix_notation = _nonlinear_expr->get_prefix_notation();
+  for (std::shared_ptr<Node> &node : *nonlinear_prefix_notation) {
+    if (!node->is_linear_operator())
+      continue;
+    LinearOperator *oper = static_cast<LinearOperator *>(node.get());
+    if (!oper->constant->is_leaf())
+      evaluates_operators = true;
+    for (unsigned int i = 0; i < oper->nterms; ++i) {
+      if (!oper->coefficients[i]->is_leaf())
+        evaluates_operators = true;
+    }
+  }
+
+  params = _nonlinear_expr->identify_params();
+  std::set<std::shared_ptr<Param>> param_set(params->begin(), params->end());
+  std::shared_ptr<std::vector<std::shared_ptr<Param>>> coef_params;
+  for (std::shared_ptr<ExpressionBase> &coef : *all_linear_coefficients) {
+    if (!coef->is_leaf())
+      evaluates_operators = true;
+    coef_params = coef->identify_params();
+    for (std::shared_ptr<Param> p : *coef_params) {
+      if (param_set.count(p) == 0) {
+        params->push_back(p);
+        param_set.insert(p);
+      }
+    }
+  }
 }
 
 bool NLBase::is_nonlinear() {
@@ -64,30 +252,407 @@ bool NLBase::is_nonlinear() {
   }
 }
 
-bool variable_sorter(std::pair<std::shared_ptr<Var>, double> p1,
-                     std::pair<std::shared_ptr<Var>, double> p2) {
-  return p1.first->index < p2.first->index;
+void NLBase::find_subexpressions(SubexpressionMap &named) {
+  subexpressions_found = true;
+  subexpressions.clear();
+  nested_subexpressions.clear();
+  if (named.size() == 0)
+    return;
+  std::shared_ptr<std::vector<std::shared_ptr<Node>>> prefix =
+      std::make_shared<std::vector<std::shared_ptr<Node>>>();
+  split_at_subexpressions(nonlinear_prefix_notation->at(0), named,
+                          prefix.get(), subexpressions);
+  nonlinear_prefix_notation = prefix;
+
+  std::set<std::shared_ptr<NLSubexpression>> seen;
+  std::vector<std::shared_ptr<NLSubexpression>> stack(subexpressions);
+  std::shared_ptr<NLSubexpression> sub;
+  while (stack.size() > 0) {
+    sub = stack.back();
+    stack.pop_back();
+    if (seen.count(sub) != 0)
+      continue;
+    seen.insert(sub);
+    nested_subexpressions.push_back(sub);
+    for (std::shared_ptr<NLSubexpression> &child : sub->subexpressions) {
+      stack.push_back(child);
+    }
+  }
+}
+
+void NLBase::check_segment_cache(bool binary) {
+  bool changed = (binary != cached_binary);
+  cached_binary = binary;
+
+  unsigned int ndx = 0;
+  cached_var_indices.resize(all_vars->size());
+  for (std::shared_ptr<Var> &v : *all_vars) {
+    if (cached_var_indices[ndx] != v->index) {
+      cached_var_indices[ndx] = v->index;
+      changed = true;
+    }
+    ++ndx;
+  }
+
+  ndx = 0;
+  cached_external_indices.resize(external_operators->size());
+  for (std::shared_ptr<ExternalOperator> &n : *external_operators) {
+    if (cached_external_indices[ndx] != n->external_function_index) {
+      cached_external_indices[ndx] = n->external_function_index;
+      changed = true;
+    }
+    ++ndx;
+  }
+
+  ndx = 0;
+  cached_param_values.resize(params->size());
+  for (std::shared_ptr<Param> &p : *params) {
+    if (cached_param_values[ndx] != p->value) {
+      cached_param_values[ndx] = p->value;
+      changed = true;
+    }
+    ++ndx;
+  }
+
+  // whether a subexpression is written inline or referenced, and by which
+  // index
+  ndx = 0;
+  cached_subexpression_indices.resize(nested_subexpressions.size());
+  for (std::shared_ptr<NLSubexpression> &sub : nested_subexpressions) {
+    if (cached_subexpression_indices[ndx] != sub->nl_index) {
+      cached_subexpression_indices[ndx] = sub->nl_index;
+      changed = true;
+    }
+    ++ndx;
+  }
+
+  if (changed) {
+    nonlinear_segment_valid = false;
+    linear_segment_valid = false;
+  }
+}
+
+void NLBase::write_nonlinear_segment(NLStream &f) {
+  unsigned int ref_ndx = 0;
+  for (std::shared_ptr<Node> &node : *nonlinear_prefix_notation) {
+    if (ref_ndx < subexpressions.size() &&
+        node == subexpressions[ref_ndx]->root) {
+      write_subexpression_reference(f, *(subexpressions[ref_ndx]));
+      ++ref_ndx;
+    } else {
+      node->write_nl_string(f);
+    }
+  }
+}
+
+void NLBase::write_linear_segment(NLStream &f, const int *order) {
+  unsigned int n = all_vars->size();
+  int pos;
+  for (unsigned int ndx = 0; ndx < n; ++ndx) {
+    pos = order[ndx];
+    f.put_int(all_vars->at(pos)->index);
+    f.space();
+    f.put_double(all_linear_coefficients->at(pos)->evaluate());
+    f.newline();
+  }
+}
+
+const std::string &NLBase::get_nonlinear_segment(bool binary) {
+  check_segment_cache(binary);
+  if (!nonlinear_segment_valid) {
+    BufferedSink out;
+    NLStream f(out, binary);
+    write_nonlinear_segment(f);
+    nonlinear_segment = out.release();
+    nonlinear_segment_valid = true;
+  }
+  return nonlinear_segment;
+}
+
+const std::string &NLBase::get_linear_segment(bool binary,
+                                              const int *order) {
+  check_segment_cache(binary);
+  if (!linear_segment_valid) {
+    BufferedSink out;
+    NLStream f(out, binary);
+    write_linear_segment(f, order);
+    linear_segment = out.release();
+    linear_segment_valid = true;
+  }
+  return linear_segment;
+}
+
+void NLBase::clear_segment_cache() {
+  nonlinear_segment_valid = false;
+  linear_segment_valid = false;
+  std::string().swap(nonlinear_segment);
+  std::string().swap(linear_segment);
+  std::vector<int>().swap(cached_var_indices);
+  std::vector<int>().swap(cached_external_indices);
+  std::vector<double>().swap(cached_param_values);
+  std::vector<int>().swap(cached_subexpression_indices);
+}
+
+void NLBase::add_to_memory_report(MemoryReport &report) {
+  size_t &terms = report["terms"];
+  size_t &incidence = report["incidence"];
+  report.add_node(constant_expr);
+  report.add_shared_vector(terms, all_linear_coefficients);
+  for (std::shared_ptr<ExpressionBase> &coef : *all_linear_coefficients) {
+    report.add_node(coef);
+  }
+  report.add_shared_vector(incidence, nonlinear_vars);
+  report.add_shared_vector(incidence, linear_vars);
+  report.add_shared_vector(incidence, all_vars);
+  for (std::shared_ptr<Var> &v : *all_vars) {
+    report.add_node(v);
+  }
+  report.add_shared_vector(incidence, external_operators);
+  report.add_shared_vector(incidence, params);
+  report.add_shared_vector(report["prefix_notation"],
+                           nonlinear_prefix_notation);
+  for (std::shared_ptr<Node> &node : *nonlinear_prefix_notation) {
+    report.add_node(node);
+  }
+  size_t &subexpression_bytes = report["subexpressions"];
+  report.add_vector(subexpression_bytes, subexpressions);
+  report.add_vector(subexpression_bytes, nested_subexpressions);
+  size_t &text = report["text_cache"];
+  report.add_string(text, nonlinear_segment);
+  report.add_string(text, linear_segment);
+  report.add_vector(text, cached_var_indices);
+  report.add_vector(text, cached_external_indices);
+  report.add_vector(text, cached_param_values);
+  report.add_vector(text, cached_subexpression_indices);
+}
+
+// The positions in the all_vars of row sorted by variable index, for
+// streaming writes (which do not build an NLJacobian)
+static void sort_row(NLBase &row, std::vector<int> &order) {
+  order.resize(row.all_vars->size());
+  for (unsigned int pos = 0; pos < order.size(); ++pos) {
+    order[pos] = pos;
+  }
+  std::vector<std::shared_ptr<Var>> &vars = *(row.all_vars);
+  std::sort(order.begin(), order.end(), [&vars](int a, int b) {
+    return vars[a]->index < vars[b]->index;
+  });
+}
+
+void NLJacobian::build(std::vector<std::shared_ptr<NLConstraint>> &cons,
+                       NLObjective &obj, int n_vars) {
+  n_rows = cons.size();
+  n_cols = n_vars;
+  std::vector<NLBase *> rows;
+  for (std::shared_ptr<NLConstraint> &con : cons) {
+    rows.push_back(con.get());
+  }
+  rows.push_back(&obj);
+
+  // count the entries in each row and column
+  indptr.assign(rows.size() + 1, 0);
+  column_counts.assign(n_vars, 0);
+  std::vector<int> col_ptr(n_vars + 1, 0);
+  unsigned int row_ndx = 0;
+  for (NLBase *row : rows) {
+    indptr[row_ndx + 1] = indptr[row_ndx] + row->all_vars->size();
+    for (std::shared_ptr<Var> &v : *(row->all_vars)) {
+      col_ptr[v->index + 1] += 1;
+      if (row_ndx < n_rows)
+        column_counts[v->index] += 1;
+    }
+    ++row_ndx;
+  }
+  for (int col = 0; col < n_vars; ++col) {
+    col_ptr[col + 1] += col_ptr[col];
+  }
+  int nnz = indptr.back();
+
+  // scatter the entries into columns; the rows within each column end up
+  // in increasing order
+  std::vector<int> col_rows(nnz);
+  std::vector<int> col_entries(nnz);
+  std::vector<int> next(col_ptr.begin(), col_ptr.end() - 1);
+  int k;
+  int pos;
+  row_ndx = 0;
+  for (NLBase *row : rows) {
+    pos = 0;
+    for (std::shared_ptr<Var> &v : *(row->all_vars)) {
+      k = next[v->index]++;
+      col_rows[k] = row_ndx;
+      col_entries[k] = pos;
+      ++pos;
+    }
+    ++row_ndx;
+  }
+
+  // gather the entries back into rows; the columns within each row end up
+  // in increasing order
+  indices.resize(nnz);
+  entries.resize(nnz);
+  next.assign(indptr.begin(), indptr.end() - 1);
+  for (int col = 0; col < n_vars; ++col) {
+    for (k = col_ptr[col]; k < col_ptr[col + 1]; ++k) {
+      pos = next[col_rows[k]]++;
+      indices[pos] = col;
+      entries[pos] = col_entries[k];
+    }
+  }
+  values.clear();
 }
 
-void NLWriter::write(std::string filename) {
-  std::ofstream f;
-  f.open(filename);
-  f.precision(17);
+void NLJacobian::evaluate(std::vector<std::shared_ptr<NLConstraint>> &cons) {
+  values.resize(indptr[n_rows]);
+  for (unsigned int i = 0; i < n_rows; ++i) {
+    NLBase &row = *cons[i];
+    for (int k = indptr[i]; k < indptr[i + 1]; ++k) {
+      values[k] = row.all_linear_coefficients->at(entries[k])->evaluate();
+    }
+  }
+}
 
-  std::vector<std::shared_ptr<NLConstraint>> sorted_constraints;
-  for (std::shared_ptr<Constraint> con : constraints) {
-    sorted_constraints.push_back(std::dynamic_pointer_cast<NLConstraint>(con));
+// Splits [0, n) into contiguous ranges, calls fill for each range on its
+// own thread with a private buffer, and copies the buffers to f in order.
+// n_threads = 0 means one thread per core. fill must not evaluate
+// expressions with operators: Expression::evaluate numbers the operators
+// in place, and the same operators may be reachable from rows in different
+// ranges (e.g., through a named expression). The segments of such rows are
+// cached on the calling thread first (see NLBase::evaluates_operators).
+static void
+write_in_parallel(NLStream &f, unsigned int n, int n_threads,
+                  std::function<void(unsigned int, unsigned int, NLStream &)>
+                      fill) {
+  if (n_threads <= 0)
+    n_threads = std::max(1u, std::thread::hardware_concurrency());
+  // not worth starting threads for small segments
+  unsigned int min_chunk = 64;
+  unsigned int n_chunks = std::min<unsigned int>(n_threads, n / min_chunk);
+  if (n_chunks <= 1) {
+    fill(0, n, f);
+    return;
   }
-  int sorted_con_index = 0;
-  for (std::shared_ptr<NLConstraint> con : sorted_constraints) {
-    con->index = sorted_con_index;
-    sorted_con_index += 1;
+
+  std::vector<BufferedSink> buffers(n_chunks);
+  std::vector<std::exception_ptr> errors(n_chunks);
+  std::vector<std::thread> threads;
+  unsigned int chunk = n / n_chunks;
+  unsigned int remainder = n % n_chunks;
+  unsigned int begin = 0;
+  unsigned int end;
+  for (unsigned int t = 0; t < n_chunks; ++t) {
+    end = begin + chunk + (t < remainder ? 1 : 0);
+    threads.push_back(std::thread([&, t, begin, end]() {
+      try {
+        NLStream buf(buffers[t], f.binary);
+        fill(begin, end, buf);
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    }));
+    begin = end;
+  }
+  for (std::thread &th : threads) {
+    th.join();
+  }
+  for (unsigned int t = 0; t < n_chunks; ++t) {
+    if (errors[t])
+      std::rethrow_exception(errors[t]);
+  }
+  for (BufferedSink &buf : buffers) {
+    f.put_segment(buf.str());
   }
-  current_con_ndx = constraints.size();
+}
+
+static void write_single_use_defined_vars(
+    NLStream &f,
+    std::map<int, std::vector<std::shared_ptr<NLSubexpression>>> &defined_vars,
+    int user) {
+  std::map<int, std::vector<std::shared_ptr<NLSubexpression>>>::iterator it =
+      defined_vars.find(user);
+  if (it == defined_vars.end())
+    return;
+  for (std::shared_ptr<NLSubexpression> &sub : it->second) {
+    write_defined_variable(f, *sub, user + 1);
+  }
+}
+
+// Evaluates the bounds of con with the constant of its body moved into
+// them, and returns the type of the constraint in the r segment (0: range,
+// 1: upper bound, 2: lower bound, 3: free, 4: equality)
+static int nl_constraint_bounds(NLConstraint &con, double &lb, double &ub) {
+  lb = con.lb->evaluate();
+  ub = con.ub->evaluate();
+  double body_constant_val = con.constant_expr->evaluate();
+  if (lb == ub) {
+    lb -= body_constant_val;
+    ub = lb;
+    return 4;
+  } else if (lb > -inf && ub < inf) {
+    lb -= body_constant_val;
+    ub -= body_constant_val;
+    return 0;
+  } else if (lb > -inf) {
+    lb -= body_constant_val;
+    return 2;
+  } else if (ub < inf) {
+    ub -= body_constant_val;
+    return 1;
+  } else {
+    return 3;
+  }
+}
+
+static void write_constraint_bounds(NLStream &f, int con_type, double lb,
+                                    double ub) {
+  f.put_key('0' + con_type);
+  if (con_type == 0) {
+    f.space();
+    f.put_double(lb);
+    f.space();
+    f.put_double(ub);
+  } else if (con_type == 1) {
+    f.space();
+    f.put_double(ub);
+  } else if (con_type == 2 || con_type == 4) {
+    f.space();
+    f.put_double(lb);
+  }
+  f.newline();
+}
 
+void NLWriter::write(std::string filename, bool binary, int n_threads,
+                     bool streaming) {
+  std::ofstream out;
+  if (binary)
+    out.open(filename, std::ios::out | std::ios::binary);
+  else
+    out.open(filename);
+  BufferedSink sink(out);
+  write_nl(sink, binary, n_threads, streaming);
+  sink.flush();
+  out.close();
+}
+
+std::string NLWriter::write_to_string(bool binary, int n_threads,
+                                      bool streaming) {
+  BufferedSink sink;
+  write_nl(sink, binary, n_threads, streaming);
+  return sink.release();
+}
+
+void NLWriter::write_nl(BufferedSink &sink, bool binary, int n_threads,
+                        bool streaming) {
+  NLStream f(sink, binary);
+
+  if (pruned_objective.lock() != objective)
+    prune_named_expressions();
+  compact_constraints();
   std::vector<std::shared_ptr<NLConstraint>> nonlinear_constraints;
   std::vector<std::shared_ptr<NLConstraint>> linear_constraints;
-  for (std::shared_ptr<NLConstraint> con : sorted_constraints) {
+  std::shared_ptr<NLConstraint> con;
+  for (const std::shared_ptr<Constraint> &c : constraints) {
+    con = std::dynamic_pointer_cast<NLConstraint>(c);
     if (con->is_nonlinear()) {
       nonlinear_constraints.push_back(con);
     } else {
@@ -175,48 +740,27 @@ void NLWriter::write(std::string filename) {
     }
   }
 
-  unsigned int con_ndx = 0;
   double con_lb;
   double con_ub;
-  double body_constant_val;
-  int _n_con_vars;
+  int _con_type;
   unsigned int _v_ndx;
   for (std::shared_ptr<NLConstraint> con : all_cons) {
-    con_lb = con->lb->evaluate();
-    con_ub = con->ub->evaluate();
-    body_constant_val = con->constant_expr->evaluate();
-    if (con_lb == con_ub) {
+    _con_type = nl_constraint_bounds(*con, con_lb, con_ub);
+    if (_con_type == 4)
       n_eq_cons += 1;
-      con_type.push_back(4);
-      con_lb -= body_constant_val;
-      con_ub = con_lb;
-    } else {
+    else
       n_range_cons += 1;
-      if (con_lb > -inf && con_ub < inf) {
-        con_type.push_back(0);
-        con_lb -= body_constant_val;
-        con_ub -= body_constant_val;
-      } else if (con_lb > -inf) {
-        con_type.push_back(2);
-        con_lb -= body_constant_val;
-      } else if (con_ub < inf) {
-        con_type.push_back(1);
-        con_ub -= body_constant_val;
-      } else {
-        con_type.push_back(3);
-      }
-    }
-    _n_con_vars = 0;
-    _v_ndx = 0;
     for (std::shared_ptr<Var> v : *(con->all_vars)) {
       v->index = -1;
-      jac_nnz += 1;
-      _n_con_vars += 1;
     }
-    n_vars_per_con.push_back(_n_con_vars);
-    con_lower.push_back(con_lb);
-    con_upper.push_back(con_ub);
-    con_ndx += 1;
+    jac_nnz += con->all_vars->size();
+    // streaming writes evaluate the bounds again when writing them
+    if (!streaming) {
+      n_vars_per_con.push_back(con->all_vars->size());
+      con_type.push_back(_con_type);
+      con_lower.push_back(con_lb);
+      con_upper.push_back(con_ub);
+    }
   }
 
   // -1 means not visited yet
@@ -319,183 +863,433 @@ void NLWriter::write(std::string filename) {
     ++ndx;
   }
 
-  // now write the header
-
   int n_vars = all_vars.size();
   if (n_vars == 0) {
     throw py::value_error("there are not any unfixed variables in the problem");
   }
 
-  f << "g3 1 1 0\n";
-  f << n_vars << " ";
-  f << all_cons.size() << " ";
-  f << "1 " << n_range_cons << " " << n_eq_cons << " 0\n";
-  f << active_nonlinear_cons.size() << " ";
+  // Named subexpressions used more than once become defined variables.
+  // Those used by more than one constraint/objective are numbered first and
+  // written before the constraints; the ASL expects the ones used by a
+  // single constraint/objective to come last and to be written right before
+  // it. Nested subexpressions always get the smaller index.
+  unsigned int n_nonlinear_cons = active_nonlinear_cons.size();
+  std::vector<std::shared_ptr<NLSubexpression>> used_subexpressions;
+  std::set<std::shared_ptr<NLSubexpression>> seen_subexpressions;
+  for (unsigned int i = 0; i <= n_nonlinear_cons; ++i) {
+    NLBase *nl_base = (i < n_nonlinear_cons)
+                          ? static_cast<NLBase *>(all_cons[i].get())
+                          : static_cast<NLBase *>(nl_objective.get());
+    if (!nl_base->subexpressions_found)
+      nl_base->find_subexpressions(subexpressions);
+    for (std::shared_ptr<NLSubexpression> &sub :
+         nl_base->nested_subexpressions) {
+      if (seen_subexpressions.count(sub) == 0) {
+        seen_subexpressions.insert(sub);
+        used_subexpressions.push_back(sub);
+        sub->n_uses = 0;
+        sub->user = -1;
+        sub->in_cons = false;
+        sub->in_obj = false;
+        sub->nl_index = -1;
+      }
+    }
+  }
+  std::sort(used_subexpressions.begin(), used_subexpressions.end(),
+            [](const std::shared_ptr<NLSubexpression> &a,
+               const std::shared_ptr<NLSubexpression> &b) {
+              return a->order > b->order;
+            });
+
+  unsigned int n_cons = all_cons.size();
+  for (unsigned int i = 0; i < n_nonlinear_cons; ++i) {
+    for (std::shared_ptr<NLSubexpression> &sub : all_cons[i]->subexpressions) {
+      add_subexpression_use(*sub, i, true, false);
+    }
+  }
+  if (nl_objective->is_nonlinear()) {
+    for (std::shared_ptr<NLSubexpression> &sub :
+         nl_objective->subexpressions) {
+      add_subexpression_use(*sub, n_cons, false, true);
+    }
+  }
+  // a subexpression that is written once (either inline or as a defined
+  // variable) uses its children once; parents come first here
+  for (std::shared_ptr<NLSubexpression> &sub : used_subexpressions) {
+    if (sub->n_uses == 0)
+      continue;
+    for (std::shared_ptr<NLSubexpression> &child : sub->subexpressions) {
+      add_subexpression_use(*child, sub->user, sub->in_cons, sub->in_obj);
+    }
+  }
+
+  std::vector<std::shared_ptr<NLSubexpression>> common_defined_vars;
+  std::map<int, std::vector<std::shared_ptr<NLSubexpression>>>
+      single_use_defined_vars;
+  int n_common_both = 0;
+  int n_common_cons = 0;
+  int n_common_obj = 0;
+  int n_single_cons = 0;
+  int n_single_obj = 0;
+  for (int i = used_subexpressions.size() - 1; i >= 0; --i) {
+    std::shared_ptr<NLSubexpression> &sub = used_subexpressions[i];
+    if (sub->n_uses < 2)
+      continue;
+    if (sub->user == -1) {
+      common_defined_vars.push_back(sub);
+      if (sub->in_cons && sub->in_obj)
+        n_common_both += 1;
+      else if (sub->in_cons)
+        n_common_cons += 1;
+      else
+        n_common_obj += 1;
+    } else {
+      single_use_defined_vars[sub->user].push_back(sub);
+      if (sub->user < (int)n_cons)
+        n_single_cons += 1;
+      else
+        n_single_obj += 1;
+    }
+  }
+  // The solver evaluates the common defined variables in ranges given by
+  // the header counts: those used by the constraints and the objective,
+  // then those only used by the constraints, then those only used by the
+  // objective. A child is used wherever its parent is, so a stable
+  // partition keeps every child ahead of its parents.
+  typedef std::vector<std::shared_ptr<NLSubexpression>>::iterator SubIter;
+  SubIter cons_only_begin = std::stable_partition(
+      common_defined_vars.begin(), common_defined_vars.end(),
+      [](const std::shared_ptr<NLSubexpression> &sub) {
+        return sub->in_cons && sub->in_obj;
+      });
+  std::stable_partition(cons_only_begin, common_defined_vars.end(),
+                        [](const std::shared_ptr<NLSubexpression> &sub) {
+                          return sub->in_cons;
+                        });
+  int nl_index = n_vars;
+  for (std::shared_ptr<NLSubexpression> &sub : common_defined_vars) {
+    sub->nl_index = nl_index;
+    ++nl_index;
+  }
+  std::map<int, std::string> single_use_segments;
+  for (std::pair<const int,
+                 std::vector<std::shared_ptr<NLSubexpression>>> &p :
+       single_use_defined_vars) {
+    for (std::shared_ptr<NLSubexpression> &sub : p.second) {
+      sub->nl_index = nl_index;
+      ++nl_index;
+    }
+  }
+  for (std::pair<const int,
+                 std::vector<std::shared_ptr<NLSubexpression>>> &p :
+       single_use_defined_vars) {
+    if (streaming)
+      break;
+    BufferedSink out;
+    NLStream vf(out, binary);
+    for (std::shared_ptr<NLSubexpression> &sub : p.second) {
+      write_defined_variable(vf, *sub, p.first + 1);
+    }
+    single_use_segments[p.first] = out.release();
+  }
+
+  // now write the header
+  std::ostringstream header;
+  header << (binary ? "b" : "g") << "3 1 1 0\n";
+  header << n_vars << " ";
+  header << all_cons.size() << " ";
+  header << "1 " << n_range_cons << " " << n_eq_cons << " 0\n";
+  header << active_nonlinear_cons.size() << " ";
   if (nl_objective->is_nonlinear()) {
-    f << "1\n";
+    header << "1\n";
   } else {
-    f << "0\n";
+    header << "0\n";
   }
-  f << "0 0\n";
+  header << "0 0\n";
   if (nl_vars_just_in_obj.size() == 0) {
-    f << nl_vars_in_cons.size() << " " << nl_vars_in_both.size() << " "
-      << nl_vars_in_both.size() << "\n";
+    header << nl_vars_in_cons.size() << " " << nl_vars_in_both.size() << " "
+           << nl_vars_in_both.size() << "\n";
   } else {
-    f << nl_vars_in_cons.size() << " " << nl_vars_in_obj_or_cons.size() << " "
-      << nl_vars_in_both.size() << "\n";
+    header << nl_vars_in_cons.size() << " " << nl_vars_in_obj_or_cons.size()
+           << " " << nl_vars_in_both.size() << "\n";
   }
-  f << "0 " << external_function_indices.size() << " 0 1\n";
-  f << "0 0 0 0 0\n";
-  f << jac_nnz << " " << grad_obj_nnz << "\n";
-  f << "0 0\n";
-  f << "0 0 0 0 0\n";
+  header << "0 " << external_function_indices.size() << " "
+         << (binary ? nl_arith_kind() : 0) << " 1\n";
+  header << n_common_both << " " << n_common_cons << " " << n_common_obj << " "
+         << n_single_cons << " " << n_single_obj << "\n";
+  header << jac_nnz << " " << grad_obj_nnz << "\n";
+  header << "0 0\n";
+  header << "0 0 0 0 0\n";
+  f.put_text(header.str());
 
   // now write the names of the external functions
   for (std::map<std::string, int>::iterator it =
            external_function_indices.begin();
        it != external_function_indices.end(); ++it) {
-    f << "F" << it->second << " 1 -1 " << it->first << "\n";
+    f.put_key('F');
+    f.put_int(it->second);
+    f.space();
+    f.put_int(1);
+    f.space();
+    f.put_int(-1);
+    f.space();
+    f.put_string(it->first);
+    f.newline();
   }
 
-  // now write the nonlinear parts of the constraints in prefix notation
-  ndx = 0;
-  for (std::shared_ptr<NLConstraint> con : active_nonlinear_cons) {
-    f << "C" << ndx << "\n";
-    for (std::shared_ptr<Node> &node : *(con->nonlinear_prefix_notation)) {
-      node->write_nl_string(f);
-    }
-    ++ndx;
+  // now write the defined variables used in more than one place
+  for (std::shared_ptr<NLSubexpression> &sub : common_defined_vars) {
+    write_defined_variable(f, *sub, 0);
   }
 
-  for (std::shared_ptr<NLConstraint> con : active_linear_cons) {
-    f << "C" << ndx << "\n"
-      << "n0\n";
-    ++ndx;
+  // now write the nonlinear parts of the constraints in prefix notation
+  std::map<int, std::string>::const_iterator segment_it;
+  if (streaming) {
+    for (unsigned int i = 0; i < n_cons; ++i) {
+      write_single_use_defined_vars(f, single_use_defined_vars, i);
+      f.put_key('C');
+      f.put_int(i);
+      f.newline();
+      if (i < n_nonlinear_cons) {
+        all_cons[i]->clear_segment_cache();
+        all_cons[i]->write_nonlinear_segment(f);
+      } else {
+        f.put_key('n');
+        f.put_double(0);
+        f.newline();
+      }
+    }
+  } else {
+    for (unsigned int i = 0; i < n_nonlinear_cons; ++i) {
+      if (all_cons[i]->evaluates_operators)
+        all_cons[i]->get_nonlinear_segment(binary);
+    }
+    write_in_parallel(
+        f, all_cons.size(), n_threads,
+        [&](unsigned int begin, unsigned int end, NLStream &buf) {
+          std::map<int, std::string>::const_iterator it;
+          for (unsigned int i = begin; i < end; ++i) {
+            it = single_use_segments.find(i);
+            if (it != single_use_segments.end())
+              buf.put_segment(it->second);
+            buf.put_key('C');
+            buf.put_int(i);
+            buf.newline();
+            if (i < n_nonlinear_cons) {
+              buf.put_segment(all_cons[i]->get_nonlinear_segment(binary));
+            } else {
+              buf.put_key('n');
+              buf.put_double(0);
+              buf.newline();
+            }
+          }
+        });
   }
 
   // now write the nonlinear part of the objective in prefix notation
-  f << "O0"
-    << " " << nl_objective->sense << "\n";
+  if (streaming) {
+    write_single_use_defined_vars(f, single_use_defined_vars, n_cons);
+  } else {
+    segment_it = single_use_segments.find(n_cons);
+    if (segment_it != single_use_segments.end())
+      f.put_segment(segment_it->second);
+  }
+  f.put_key('O');
+  f.put_int(0);
+  f.space();
+  f.put_int(nl_objective->sense);
+  f.newline();
   if (nl_objective->is_nonlinear()) {
-    f << "o0\n";
-    for (std::shared_ptr<Node> &node :
-         *(nl_objective->nonlinear_prefix_notation)) {
-      node->write_nl_string(f);
+    f.put_key('o');
+    f.put_int(0);
+    f.newline();
+    if (streaming) {
+      nl_objective->clear_segment_cache();
+      nl_objective->write_nonlinear_segment(f);
+    } else {
+      f.put_segment(nl_objective->get_nonlinear_segment(binary));
+    }
+  }
+  f.put_key('n');
+  f.put_double(nl_objective->constant_expr->evaluate());
+  f.newline();
+
+  // now write the initial values of the duals
+  unsigned int n_duals = 0;
+  for (std::shared_ptr<NLConstraint> &con : all_cons) {
+    if (con->dual != 0)
+      n_duals += 1;
+  }
+  if (n_duals > 0) {
+    f.put_key('d');
+    f.put_int(n_duals);
+    f.newline();
+    for (unsigned int i = 0; i < n_cons; ++i) {
+      if (all_cons[i]->dual != 0) {
+        f.put_int(i);
+        f.space();
+        f.put_double(all_cons[i]->dual);
+        f.newline();
+      }
     }
-    f << "n";
-    f << nl_objective->constant_expr->evaluate() << "\n";
-  } else {
-    f << "n";
-    f << nl_objective->constant_expr->evaluate() << "\n";
   }
 
   // now write initial variable values
-  f << "x " << n_vars << "\n";
+  f.put_key('x');
+  f.space();
+  f.put_int(n_vars);
+  f.newline();
   for (std::shared_ptr<Var> v : all_vars) {
-    f << v->index << " " << v->value << "\n";
+    f.put_int(v->index);
+    f.space();
+    f.put_double(v->value);
+    f.newline();
   }
 
   // now write the constraint bounds
-  f << "r\n";
-  int _con_type;
-  for (con_ndx = 0; con_ndx < all_cons.size(); ++con_ndx) {
-    _con_type = con_type[con_ndx];
-    if (_con_type == 0) {
-      f << "0 " << con_lower[con_ndx] << " " << con_upper[con_ndx] << "\n";
-    } else if (_con_type == 1) {
-      f << "1 " << con_upper[con_ndx] << "\n";
-    } else if (_con_type == 2) {
-      f << "2 " << con_lower[con_ndx] << "\n";
-    } else if (_con_type == 3) {
-      f << "3\n";
-    } else {
-      f << "4 " << con_lower[con_ndx] << "\n";
+  f.put_key('r');
+  f.newline();
+  if (streaming) {
+    for (std::shared_ptr<NLConstraint> &con : all_cons) {
+      _con_type = nl_constraint_bounds(*con, con_lb, con_ub);
+      write_constraint_bounds(f, _con_type, con_lb, con_ub);
     }
+  } else {
+    write_in_parallel(
+        f, all_cons.size(), n_threads,
+        [&](unsigned int begin, unsigned int end, NLStream &buf) {
+          for (unsigned int i = begin; i < end; ++i) {
+            write_constraint_bounds(buf, con_type[i], con_lower[i],
+                                    con_upper[i]);
+          }
+        });
   }
 
   // now write variable bounds
-  f << "b\n";
-  double v_lb;
-  double v_ub;
-  Domain v_domain;
-  for (std::shared_ptr<Var> v : all_vars) {
-    v_lb = v->get_lb();
-    v_ub = v->get_ub();
-    v_domain = v->get_domain();
-    if (v->fixed) {
-      f << "4 " << v->value << "\n";
-    } else if (v_domain != continuous) {
-      throw py::value_error(
-          "NLWriter currently only supports continuous variables.");
-    } else if (v_lb == v_ub) {
-      f << "4 " << v_lb << "\n";
-    } else if (v_lb > -inf && v_ub < inf) {
-      f << "0 " << v_lb << " " << v_ub << "\n";
-    } else if (v_lb > -inf) {
-      f << "2 " << v_lb << "\n";
-    } else if (v_ub < inf) {
-      f << "1 " << v_ub << "\n";
-    } else {
-      f << "3\n";
-    }
-  }
+  f.put_key('b');
+  f.newline();
+  write_in_parallel(
+      f, all_vars.size(), streaming ? 1 : n_threads,
+      [&](unsigned int begin, unsigned int end, NLStream &buf) {
+        double v_lb;
+        double v_ub;
+        Domain v_domain;
+        std::shared_ptr<Var> v;
+        for (unsigned int i = begin; i < end; ++i) {
+          v = all_vars[i];
+          v_lb = v->get_lb();
+          v_ub = v->get_ub();
+          v_domain = v->get_domain();
+          if (v->fixed) {
+            buf.put_key('4');
+            buf.space();
+            buf.put_double(v->value);
+          } else if (v_domain != continuous) {
+            throw py::value_error(
+                "NLWriter currently only supports continuous variables.");
+          } else if (v_lb == v_ub) {
+            buf.put_key('4');
+            buf.space();
+            buf.put_double(v_lb);
+          } else if (v_lb > -inf && v_ub < inf) {
+            buf.put_key('0');
+            buf.space();
+            buf.put_double(v_lb);
+            buf.space();
+            buf.put_double(v_ub);
+          } else if (v_lb > -inf) {
+            buf.put_key('2');
+            buf.space();
+            buf.put_double(v_lb);
+          } else if (v_ub < inf) {
+            buf.put_key('1');
+            buf.space();
+            buf.put_double(v_ub);
+          } else {
+            buf.put_key('3');
+          }
+          buf.newline();
+        }
+      });
 
   // now write the jacobian column counts
-  std::vector<int> referenced_variables;
-  for (std::shared_ptr<Var> v : all_vars) {
-    referenced_variables.push_back(0);
-  }
-  for (std::shared_ptr<NLConstraint> con : all_cons) {
-    for (std::shared_ptr<Var> v : *(con->all_vars)) {
-      referenced_variables[v->index] += 1;
+  std::vector<int> column_counts;
+  if (streaming) {
+    jacobian.reset();
+    column_counts.assign(n_vars, 0);
+    for (std::shared_ptr<NLConstraint> &con : all_cons) {
+      for (std::shared_ptr<Var> &v : *(con->all_vars)) {
+        column_counts[v->index] += 1;
+      }
     }
+  } else {
+    jacobian = std::make_shared<NLJacobian>();
+    jacobian->build(all_cons, *nl_objective, n_vars);
   }
+  std::vector<int> &col_counts =
+      streaming ? column_counts : jacobian->column_counts;
 
   int cumulative = 0;
-  f << "k" << (all_vars.size() - 1) << "\n";
+  f.put_key('k');
+  f.put_int(all_vars.size() - 1);
+  f.newline();
   for (_v_ndx = 0; _v_ndx < (all_vars.size() - 1); ++_v_ndx) {
-    cumulative += referenced_variables[_v_ndx];
-    f << cumulative << "\n";
+    cumulative += col_counts[_v_ndx];
+    f.put_int(cumulative);
+    f.newline();
   }
 
   // now write the linear part of the jacobian
-  con_ndx = 0;
-  for (std::shared_ptr<NLConstraint> con : all_cons) {
-    std::vector<std::pair<std::shared_ptr<Var>, double>> sorted_vars;
-    _v_ndx = 0;
-    for (std::shared_ptr<Var> v : *(con->all_vars)) {
-      sorted_vars.push_back(std::make_pair(
-          v, con->all_linear_coefficients->at(_v_ndx)->evaluate()));
-      _v_ndx += 1;
+  std::vector<int> row_order;
+  if (streaming) {
+    unsigned int i = 0;
+    for (std::shared_ptr<NLConstraint> &con : all_cons) {
+      f.put_key('J');
+      f.put_int(i);
+      f.space();
+      f.put_int(con->all_vars->size());
+      f.newline();
+      sort_row(*con, row_order);
+      con->write_linear_segment(f, row_order.data());
+      ++i;
     }
-    std::sort(sorted_vars.begin(), sorted_vars.end(), variable_sorter);
-
-    f << "J" << con_ndx << " " << n_vars_per_con[con_ndx] << "\n";
-    for (std::pair<std::shared_ptr<Var>, double> p : sorted_vars) {
-      f << p.first->index << " " << p.second << "\n";
+  } else {
+    for (unsigned int i = 0; i < all_cons.size(); ++i) {
+      if (all_cons[i]->evaluates_operators)
+        all_cons[i]->get_linear_segment(
+            binary, jacobian->entries.data() + jacobian->indptr[i]);
     }
-    con_ndx += 1;
+    write_in_parallel(
+        f, all_cons.size(), n_threads,
+        [&](unsigned int begin, unsigned int end, NLStream &buf) {
+          for (unsigned int i = begin; i < end; ++i) {
+            buf.put_key('J');
+            buf.put_int(i);
+            buf.space();
+            buf.put_int(n_vars_per_con[i]);
+            buf.newline();
+            buf.put_segment(all_cons[i]->get_linear_segment(
+                binary, jacobian->entries.data() + jacobian->indptr[i]));
+          }
+        });
   }
 
   // now write the linear part of the gradient of the objective
-  std::vector<std::pair<std::shared_ptr<Var>, double>> sorted_obj_vars;
-  _v_ndx = 0;
-  for (std::shared_ptr<Var> v : *(nl_objective->all_vars)) {
-    sorted_obj_vars.push_back(std::make_pair(
-        v, nl_objective->all_linear_coefficients->at(_v_ndx)->evaluate()));
-    _v_ndx += 1;
-  }
-  std::sort(sorted_obj_vars.begin(), sorted_obj_vars.end(), variable_sorter);
-
-  if (sorted_obj_vars.size() > 0) {
-    f << "G0 " << grad_obj_nnz << "\n";
-    for (std::pair<std::shared_ptr<Var>, double> p : sorted_obj_vars) {
-      f << p.first->index << " " << p.second << "\n";
+  if (nl_objective->all_vars->size() > 0) {
+    f.put_key('G');
+    f.put_int(0);
+    f.space();
+    f.put_int(grad_obj_nnz);
+    f.newline();
+    if (streaming) {
+      sort_row(*nl_objective, row_order);
+      nl_objective->write_linear_segment(f, row_order.data());
+    } else {
+      f.put_segment(nl_objective->get_linear_segment(
+          binary, jacobian->entries.data() + jacobian->indptr[n_cons]));
     }
   }
 
-  f.close();
-
   solve_vars = all_vars;
   solve_cons = all_cons;
 }
@@ -508,49 +1302,163 @@ std::vector<std::shared_ptr<NLConstraint>> NLWriter::get_solve_cons() {
   return solve_cons;
 }
 
+void NLWriter::load_solution(SolFile &sol) {
+  if (sol.primals.size() != solve_vars.size())
+    throw py::value_error("the .sol file has " +
+                          std::to_string(sol.primals.size()) +
+                          " primal values, but the NL file has " +
+                          std::to_string(solve_vars.size()) + " variables");
+  unsigned int ndx = 0;
+  for (std::shared_ptr<Var> &v : solve_vars) {
+    v->value = sol.primals[ndx];
+    ++ndx;
+  }
+  if (sol.duals.size() > 0)
+    set_duals(sol.duals.data(), sol.duals.size());
+}
+
+void NLWriter::set_duals(const double *duals, size_t n) {
+  if (n != solve_cons.size())
+    throw py::value_error("got " + std::to_string(n) +
+                          " dual values, but the NL file has " +
+                          std::to_string(solve_cons.size()) + " constraints");
+  for (size_t ndx = 0; ndx < n; ++ndx) {
+    solve_cons[ndx]->dual = duals[ndx];
+  }
+}
+
+std::shared_ptr<NLJacobian> NLWriter::get_jacobian() {
+  if (!jacobian)
+    throw py::value_error("the Jacobian is only available after writing an "
+                          "NL file without streaming");
+  if (jacobian->values.empty())
+    jacobian->evaluate(solve_cons);
+  return jacobian;
+}
+
+void NLWriter::add_to_memory_report(MemoryReport &report) {
+  Model::add_to_memory_report(report);
+  size_t &constraints_bytes = report["constraints"];
+  for (const std::shared_ptr<Constraint> &con : constraints) {
+    report.add_shared(constraints_bytes, sizeof(NLConstraint));
+    std::dynamic_pointer_cast<NLConstraint>(con)->add_to_memory_report(report);
+  }
+  std::shared_ptr<NLObjective> nl_objective =
+      std::dynamic_pointer_cast<NLObjective>(objective);
+  if (nl_objective != nullptr) {
+    report.add_shared(constraints_bytes, sizeof(NLObjective));
+    nl_objective->add_to_memory_report(report);
+  }
+  report.add_vector(constraints_bytes, solve_cons);
+  report.add_vector(report["incidence"], solve_vars);
+
+  // a node of the map holds the links of the tree (about 32 bytes) and the
+  // key and value
+  size_t &subexpression_bytes = report["subexpressions"];
+  for (SubexpressionMap::value_type &item : subexpressions) {
+    report.add_allocation(subexpression_bytes,
+                          32 + sizeof(SubexpressionMap::value_type));
+    report.add_shared(subexpression_bytes, sizeof(NLSubexpression));
+    report.add_vector(subexpression_bytes, item.second->subexpressions);
+    report.add_node(item.second->root);
+  }
+
+  if (jacobian != nullptr) {
+    size_t &jacobian_bytes = report["jacobian"];
+    report.add_shared(jacobian_bytes, sizeof(NLJacobian));
+    report.add_vector(jacobian_bytes, jacobian->indptr);
+    report.add_vector(jacobian_bytes, jacobian->indices);
+    report.add_vector(jacobian_bytes, jacobian->entries);
+    report.add_vector(jacobian_bytes, jacobian->column_counts);
+    report.add_vector(jacobian_bytes, jacobian->values);
+  }
+}
+
+std::shared_ptr<ExpressionBase>
+NLWriter::convert_nonlinear_expr(py::handle expr, py::handle var_map,
+                                 py::handle param_map,
+                                 PyomoExprTypes &expr_types) {
+  std::shared_ptr<ExpressionBase> res = appsi_expr_from_pyomo_expr_with_cache(
+      expr, var_map, param_map, expr_types, named_expressions);
+  add_named_expressions();
+  return res;
+}
+
+std::shared_ptr<ExpressionBase>
+NLWriter::convert_nonlinear_expr(StandardRepn &repn, py::handle var_map,
+                                 py::handle param_map,
+                                 PyomoExprTypes &expr_types) {
+  std::shared_ptr<ExpressionBase> res = repn.get_nonlinear_expr(
+      var_map, param_map, expr_types, &named_expressions);
+  add_named_expressions();
+  return res;
+}
+
+void NLWriter::prune_named_expressions() {
+  pruned_objective = objective;
+  if (subexpressions.empty())
+    return;
+  std::set<std::shared_ptr<NLSubexpression>> used;
+  auto add_used = [&](NLBase *base) {
+    if (!base->subexpressions_found)
+      base->find_subexpressions(subexpressions);
+    used.insert(base->nested_subexpressions.begin(),
+                base->nested_subexpressions.end());
+  };
+  for (const std::shared_ptr<Constraint> &con : constraints) {
+    add_used(std::dynamic_pointer_cast<NLConstraint>(con).get());
+  }
+  std::shared_ptr<NLObjective> nl_objective =
+      std::dynamic_pointer_cast<NLObjective>(objective);
+  if (nl_objective != nullptr)
+    add_used(nl_objective.get());
+
+  std::set<Node *> nodes_in_use;
+  SubexpressionMap::iterator it = subexpressions.begin();
+  while (it != subexpressions.end()) {
+    if (used.count(it->second) == 0) {
+      it = subexpressions.erase(it);
+    } else {
+      nodes_in_use.insert(it->first.get());
+      ++it;
+    }
+  }
+  named_expressions.retain(nodes_in_use);
+}
+
+void NLWriter::add_named_expressions() {
+  for (std::shared_ptr<Node> &node : named_expressions.replaced_nodes) {
+    subexpressions.erase(node);
+  }
+  named_expressions.replaced_nodes.clear();
+  // nested named expressions were added first
+  for (std::shared_ptr<Node> &node : named_expressions.nodes) {
+    subexpressions[node] = std::make_shared<NLSubexpression>(
+        node, n_named_expressions, subexpressions);
+    ++n_named_expressions;
+  }
+  named_expressions.nodes.clear();
+}
+
 void process_nl_constraints(NLWriter *nl_writer, PyomoExprTypes &expr_types,
                             py::list cons, py::dict var_map, py::dict param_map,
                             py::dict active_constraints, py::dict con_map,
                             py::dict rev_con_map) {
-  py::object generate_standard_repn =
-      py::module_::import("pyomo.repn.standard_repn")
-          .attr("generate_standard_repn");
-  py::object repn;
-  std::shared_ptr<ExpressionBase> _const;
-  std::vector<std::shared_ptr<Var>> lin_vars;
-  std::vector<std::shared_ptr<ExpressionBase>> lin_coefs;
   std::shared_ptr<ExpressionBase> nonlin_expr;
   std::shared_ptr<NLConstraint> nl_con;
   py::tuple lower_body_upper;
   py::handle c_lb;
   py::handle c_ub;
-  py::handle repn_nonlinear_expr;
 
   for (py::handle c : cons) {
     lower_body_upper = c.attr("to_bounded_expression")();
-    repn = generate_standard_repn(
-        lower_body_upper[1], "compute_values"_a = false, "quadratic"_a = false);
-    _const = appsi_expr_from_pyomo_expr(repn.attr("constant"), var_map,
-                                        param_map, expr_types);
-    lin_coefs.clear();
-    lin_vars.clear();
-    for (py::handle coef : repn.attr("linear_coefs")) {
-      lin_coefs.push_back(
-          appsi_expr_from_pyomo_expr(coef, var_map, param_map, expr_types));
-    }
-    for (py::handle v : repn.attr("linear_vars")) {
-      lin_vars.push_back(
-          var_map[expr_types.id(v)].cast<std::shared_ptr<Var>>());
-    }
-    repn_nonlinear_expr = repn.attr("nonlinear_expr");
-    if (repn_nonlinear_expr.is(py::none())) {
-      nonlin_expr = std::make_shared<Constant>(0);
-    } else {
-      nonlin_expr = appsi_expr_from_pyomo_expr(repn_nonlinear_expr, var_map,
-                                               param_map, expr_types);
-    }
-    nl_con = std::make_shared<NLConstraint>(_const, lin_coefs, lin_vars,
-                                            nonlin_expr);
+    StandardRepn repn = generate_standard_repn(lower_body_upper[1], var_map,
+                                               param_map, expr_types, false);
+    nonlin_expr =
+        nl_writer->convert_nonlinear_expr(repn, var_map, param_map, expr_types);
+    nl_con = std::make_shared<NLConstraint>(
+        repn.constant, repn.linear_coefs, repn.linear_vars, nonlin_expr);
+    nl_con->find_subexpressions(nl_writer->subexpressions);
 
     c_lb = lower_body_upper[0];
     c_ub = lower_body_upper[2];
@@ -563,7 +1471,33 @@ void process_nl_constraints(NLWriter *nl_writer, PyomoExprTypes &expr_types,
           appsi_expr_from_pyomo_expr(c_ub, var_map, param_map, expr_types);
     }
     nl_writer->add_constraint(nl_con);
+    std::vector<std::shared_ptr<ExpressionBase>> exprs(
+        nl_con->all_linear_coefficients->begin(),
+        nl_con->all_linear_coefficients->end());
+    exprs.push_back(nl_con->constant_expr);
+    exprs.push_back(nonlin_expr);
+    exprs.push_back(nl_con->lb);
+    exprs.push_back(nl_con->ub);
+    nl_writer->add_dependencies(nl_con, exprs);
     con_map[c] = py::cast(nl_con);
     rev_con_map[py::cast(nl_con)] = c;
   }
 }
+
+std::shared_ptr<NLObjective> process_nl_objective(NLWriter *nl_writer,
+                                                  PyomoExprTypes &expr_types,
+                                                  py::object pyomo_obj,
+                                                  py::dict var_map,
+                                                  py::dict param_map) {
+  StandardRepn repn;
+  if (pyomo_obj.is(py::none())) {
+    repn.constant = std::make_shared<Constant>(0);
+  } else {
+    repn = generate_standard_repn(pyomo_obj.attr("expr"), var_map, param_map,
+                                  expr_types, false);
+  }
+  std::shared_ptr<ExpressionBase> nonlin_expr =
+      nl_writer->convert_nonlinear_expr(repn, var_map, param_map, expr_types);
+  return std::make_shared<NLObjective>(repn.constant, repn.linear_coefs,
+                                       repn.linear_vars, nonlin_expr);
+}
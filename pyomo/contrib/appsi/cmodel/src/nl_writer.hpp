@@ -11,14 +11,47 @@
 **/
 
 #include "model_base.hpp"
+#include "buffered_sink.hpp"
+#include "repn.hpp"
+#include "sol_reader.hpp"
 
+class NLSubexpression;
 class NLBase;
 class NLConstraint;
 class NLObjective;
+class NLJacobian;
 class NLWriter;
+class NLStream;
 
 extern double inf;
 
+typedef std::map<std::shared_ptr<Node>, std::shared_ptr<NLSubexpression>>
+    SubexpressionMap;
+
+// A named expression that may be shared by several constraints and the
+// objective. If it is used more than once, the writer emits it once as a
+// defined variable (V segment); otherwise it is written inline.
+class NLSubexpression {
+public:
+  NLSubexpression(std::shared_ptr<Node> _root, unsigned int _order,
+                  SubexpressionMap &subexpressions);
+  std::shared_ptr<Node> root;
+  // the subexpressions directly referenced by root (one entry per
+  // reference)
+  std::vector<std::shared_ptr<NLSubexpression>> subexpressions;
+  // nested subexpressions always have a smaller order
+  unsigned int order;
+  // set while writing: the number of places that would write this
+  // subexpression inline, where it is used (a row index, or -1 if it is
+  // used by more than one constraint/objective) and its variable index in
+  // the NL file (or -1 if it is written inline)
+  int n_uses = 0;
+  int user = -1;
+  bool in_cons = false;
+  bool in_obj = false;
+  int nl_index = -1;
+};
+
 class NLBase {
 public:
   NLBase(std::shared_ptr<ExpressionBase> _constant_expr,
@@ -36,7 +69,48 @@ public:
   std::shared_ptr<std::vector<std::shared_ptr<Node>>> nonlinear_prefix_notation;
   std::shared_ptr<std::vector<std::shared_ptr<ExternalOperator>>>
       external_operators;
+  // the params the nonlinear expression and linear coefficients depend on
+  std::shared_ptr<std::vector<std::shared_ptr<Param>>> params;
+  // whether writing the segments evaluates a coefficient that is an
+  // expression rather than a leaf; the writer does not format such rows on
+  // worker threads, since their operators may be shared with other rows
+  bool evaluates_operators = false;
   bool is_nonlinear();
+  // Splits the nonlinear expression at the given subexpressions. After this,
+  // nonlinear_prefix_notation stops at the roots of subexpressions, and
+  // subexpressions lists them in the order they appear there.
+  void find_subexpressions(SubexpressionMap &named);
+  bool subexpressions_found = false;
+  std::vector<std::shared_ptr<NLSubexpression>> subexpressions;
+  // all subexpressions used directly or through other subexpressions
+  std::vector<std::shared_ptr<NLSubexpression>> nested_subexpressions;
+  // The serialized nonlinear part (prefix notation) and linear part
+  // (sorted index/coefficient pairs) without the segment headers. These are
+  // cached and only regenerated when a param value, the index of a variable,
+  // the index of an external function, or the format changes.
+  // order lists the positions in all_vars sorted by variable index (see
+  // NLJacobian::entries).
+  const std::string &get_nonlinear_segment(bool binary);
+  const std::string &get_linear_segment(bool binary, const int *order);
+  // write the same segments without caching them
+  void write_nonlinear_segment(NLStream &f);
+  void write_linear_segment(NLStream &f, const int *order);
+  void clear_segment_cache();
+  // the expressions, the incidence vectors and the cached segments (not the
+  // object itself)
+  void add_to_memory_report(MemoryReport &report);
+
+private:
+  void check_segment_cache(bool binary);
+  bool nonlinear_segment_valid = false;
+  bool linear_segment_valid = false;
+  std::string nonlinear_segment;
+  std::string linear_segment;
+  bool cached_binary = false;
+  std::vector<int> cached_var_indices;
+  std::vector<int> cached_external_indices;
+  std::vector<double> cached_param_values;
+  std::vector<int> cached_subexpression_indices;
 };
 
 class NLObjective : public NLBase, public Objective {
@@ -58,6 +132,34 @@ public:
       std::shared_ptr<ExpressionBase> _nonlinear_expr)
       : NLBase(_constant_expr, _linear_coefficients, _linear_vars,
                _nonlinear_expr) {}
+  // initial value of the multiplier; nonzero values are written to the d
+  // segment
+  double dual = 0;
+};
+
+// The sparsity pattern of the linear part of the Jacobian in CSR form, with
+// the columns of each row in the variable order of the NL file. The
+// gradient of the objective is stored as an extra last row. Rows are
+// ordered with two counting-sort passes (rows to columns and back) instead
+// of sorting each row.
+class NLJacobian {
+public:
+  NLJacobian() = default;
+  void build(std::vector<std::shared_ptr<NLConstraint>> &cons,
+             NLObjective &obj, int n_vars);
+  // evaluates the coefficients of the constraint rows
+  void evaluate(std::vector<std::shared_ptr<NLConstraint>> &cons);
+  unsigned int n_rows = 0;
+  unsigned int n_cols = 0;
+  // row i is indptr[i] to indptr[i + 1]
+  std::vector<int> indptr;
+  std::vector<int> indices;
+  // the position of each entry in the all_vars of its row
+  std::vector<int> entries;
+  // the number of constraint rows each column appears in
+  std::vector<int> column_counts;
+  // empty until evaluate is called
+  std::vector<double> values;
 };
 
 class NLWriter : public Model {
@@ -65,12 +167,66 @@ public:
   NLWriter() = default;
   std::vector<std::shared_ptr<Var>> solve_vars;
   std::vector<std::shared_ptr<NLConstraint>> solve_cons;
-  void write(std::string filename);
+  // Segments are formatted on n_threads threads (0 means one per core).
+  // With streaming, the header statistics are gathered in a first pass and
+  // each segment is written straight to the file in a second one, on a
+  // single thread; the segments are not cached and the Jacobian is not
+  // kept, so the memory used beyond the model is linear in the number of
+  // variables and constraints rather than in the size of the file.
+  void write(std::string filename, bool binary = false, int n_threads = 1,
+             bool streaming = false);
+  // the content of the NL file, for readers that accept it from memory
+  std::string write_to_string(bool binary = false, int n_threads = 1,
+                              bool streaming = false);
+  void write_nl(BufferedSink &sink, bool binary, int n_threads,
+                bool streaming);
   std::vector<std::shared_ptr<Var>> get_solve_vars();
   std::vector<std::shared_ptr<NLConstraint>> get_solve_cons();
+  // sets the values of solve_vars to the primal values in a .sol file and
+  // the duals of solve_cons to its dual values (if it has them)
+  void load_solution(SolFile &sol);
+  // sets the duals of solve_cons
+  void set_duals(const double *duals, size_t n);
+  // the Jacobian of the linear part of solve_cons with respect to
+  // solve_vars; the coefficients are evaluated on the first call after
+  // each write
+  std::shared_ptr<NLJacobian> get_jacobian();
+  // Converts a nonlinear expression. Named expressions are converted once
+  // and shared between all expressions converted by this method, so that
+  // they can be written as defined variables.
+  std::shared_ptr<ExpressionBase>
+  convert_nonlinear_expr(py::handle expr, py::handle var_map,
+                         py::handle param_map, PyomoExprTypes &expr_types);
+  // the nonlinear part of repn, converted the same way
+  std::shared_ptr<ExpressionBase>
+  convert_nonlinear_expr(StandardRepn &repn, py::handle var_map,
+                         py::handle param_map, PyomoExprTypes &expr_types);
+  SubexpressionMap subexpressions;
+  // Drops the subexpressions and cached named expressions that are no
+  // longer used by a constraint or the objective, so that they do not keep
+  // the Pyomo named expressions alive. This runs when constraints are
+  // removed and when the objective changed since the last write.
+  void prune_named_expressions();
+  // the cache of the named expressions converted so far is not included
+  void add_to_memory_report(MemoryReport &report) override;
+
+protected:
+  void constraints_removed() override { prune_named_expressions(); }
+
+private:
+  void add_named_expressions();
+  std::weak_ptr<Objective> pruned_objective;
+  std::shared_ptr<NLJacobian> jacobian;
+  NamedExpressionCache named_expressions;
+  unsigned int n_named_expressions = 0;
 };
 
 void process_nl_constraints(NLWriter *nl_writer, PyomoExprTypes &expr_types,
                             py::list cons, py::dict var_map, py::dict param_map,
                             py::dict active_constraints, py::dict con_map,
                             py::dict rev_con_map);
+std::shared_ptr<NLObjective> process_nl_objective(NLWriter *nl_writer,
+                                                  PyomoExprTypes &expr_types,
+                                                  py::object pyomo_obj,
+                                                  py::dict var_map,
+                                                  py::dict param_map);
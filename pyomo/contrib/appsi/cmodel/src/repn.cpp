@@ -0,0 +1,553 @@
+/**___________________________________________________________________________
+ *
+ * Pyomo: Python Optimization Modeling Objects
+ * Copyright (c) 2008-2024
+ * National Technology and Engineering Solutions of Sandia, LLC
+ * Under the terms of Contract DE-NA0003525 with National Technology and
+ * Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+ * rights in this software.
+ * This software is distributed under the 3-clause BSD License.
+ * ___________________________________________________________________________
+**/
+
+#include "repn.hpp"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+std::shared_ptr<Node> RepnCoef::get_node() const {
+  if (is_number())
+    return std::make_shared<Constant>(value);
+  return node;
+}
+
+std::shared_ptr<ExpressionBase> RepnCoef::get_expression() const {
+  if (is_number())
+    return std::make_shared<Constant>(value);
+  return expression_from_node(node, n_operators);
+}
+
+static RepnCoef coef_sum(const RepnCoef &a, const RepnCoef &b) {
+  if (a.is_number() && b.is_number())
+    return RepnCoef(a.value + b.value);
+  if (a.is_zero())
+    return b;
+  if (b.is_zero())
+    return a;
+  std::shared_ptr<SumOperator> oper = std::make_shared<SumOperator>(2);
+  oper->operands[0] = a.get_node();
+  oper->operands[1] = b.get_node();
+  return RepnCoef(oper, a.n_operators + b.n_operators + 1);
+}
+
+static RepnCoef coef_product(const RepnCoef &a, const RepnCoef &b) {
+  if (a.is_number() && b.is_number())
+    return RepnCoef(a.value * b.value);
+  if (a.is_zero() || b.is_zero())
+    return RepnCoef(0);
+  if (a.is_number() && a.value == 1)
+    return b;
+  if (b.is_number() && b.value == 1)
+    return a;
+  std::shared_ptr<MultiplyOperator> oper = std::make_shared<MultiplyOperator>();
+  oper->operand1 = a.get_node();
+  oper->operand2 = b.get_node();
+  return RepnCoef(oper, a.n_operators + b.n_operators + 1);
+}
+
+static RepnCoef coef_quotient(const RepnCoef &a, const RepnCoef &b) {
+  if (a.is_number() && b.is_number())
+    return RepnCoef(a.value / b.value);
+  if (a.is_zero())
+    return RepnCoef(0);
+  if (b.is_number() && b.value == 1)
+    return a;
+  std::shared_ptr<DivideOperator> oper = std::make_shared<DivideOperator>();
+  oper->operand1 = a.get_node();
+  oper->operand2 = b.get_node();
+  return RepnCoef(oper, a.n_operators + b.n_operators + 1);
+}
+
+static RepnCoef coef_power(const RepnCoef &a, const RepnCoef &b) {
+  if (a.is_number() && b.is_number())
+    return RepnCoef(std::pow(a.value, b.value));
+  std::shared_ptr<PowerOperator> oper = std::make_shared<PowerOperator>();
+  oper->operand1 = a.get_node();
+  oper->operand2 = b.get_node();
+  return RepnCoef(oper, a.n_operators + b.n_operators + 1);
+}
+
+namespace {
+
+// a variable found while collecting a repn; key is the order in which the
+// variables were found (used to order the pairs of the quadratic part)
+struct RepnVar {
+  std::shared_ptr<Var> var;
+  int key;
+  bool fixed;
+};
+
+// the sum of the terms collected so far
+class RepnSum {
+public:
+  double constant_value = 0;
+  std::vector<RepnCoef> constant_terms;
+  std::vector<RepnVar *> linear_vars;
+  std::vector<RepnCoef> linear_coefs;
+  std::unordered_map<int, size_t> linear_index;
+  std::vector<RepnVar *> quadratic_vars_1;
+  std::vector<RepnVar *> quadratic_vars_2;
+  std::vector<RepnCoef> quadratic_coefs;
+  std::unordered_map<long long, size_t> quadratic_index;
+  std::vector<RepnCoef> nonlinear_coefs;
+  std::vector<py::object> nonlinear_exprs;
+
+  void add_constant(const RepnCoef &c) {
+    if (c.is_number())
+      constant_value += c.value;
+    else
+      constant_terms.push_back(c);
+  }
+
+  void add_linear(RepnVar *v, const RepnCoef &c) {
+    if (c.is_zero())
+      return;
+    auto it = linear_index.find(v->key);
+    if (it == linear_index.end()) {
+      linear_index[v->key] = linear_vars.size();
+      linear_vars.push_back(v);
+      linear_coefs.push_back(c);
+    } else {
+      linear_coefs[it->second] = coef_sum(linear_coefs[it->second], c);
+    }
+  }
+
+  void add_quadratic(RepnVar *v1, RepnVar *v2, const RepnCoef &c) {
+    if (c.is_zero())
+      return;
+    if (v2->key < v1->key)
+      std::swap(v1, v2);
+    long long k = (static_cast<long long>(v1->key) << 32) + v2->key;
+    auto it = quadratic_index.find(k);
+    if (it == quadratic_index.end()) {
+      quadratic_index[k] = quadratic_vars_1.size();
+      quadratic_vars_1.push_back(v1);
+      quadratic_vars_2.push_back(v2);
+      quadratic_coefs.push_back(c);
+    } else {
+      quadratic_coefs[it->second] = coef_sum(quadratic_coefs[it->second], c);
+    }
+  }
+
+  void add_nonlinear(const RepnCoef &c, py::handle expr) {
+    nonlinear_coefs.push_back(c);
+    nonlinear_exprs.push_back(py::reinterpret_borrow<py::object>(expr));
+  }
+
+  // adds factor * other
+  void add(const RepnSum &other, const RepnCoef &factor) {
+    add_constant(coef_product(factor, other.get_constant()));
+    for (size_t i = 0; i < other.linear_vars.size(); ++i)
+      add_linear(other.linear_vars[i],
+                 coef_product(factor, other.linear_coefs[i]));
+    for (size_t i = 0; i < other.quadratic_vars_1.size(); ++i)
+      add_quadratic(other.quadratic_vars_1[i], other.quadratic_vars_2[i],
+                    coef_product(factor, other.quadratic_coefs[i]));
+    for (size_t i = 0; i < other.nonlinear_exprs.size(); ++i)
+      add_nonlinear(coef_product(factor, other.nonlinear_coefs[i]),
+                    other.nonlinear_exprs[i]);
+  }
+
+  RepnCoef get_constant() const {
+    if (constant_terms.empty())
+      return RepnCoef(constant_value);
+    if (constant_terms.size() == 1 && constant_value == 0)
+      return constant_terms[0];
+    unsigned int n_args = constant_terms.size();
+    if (constant_value != 0)
+      ++n_args;
+    std::shared_ptr<SumOperator> oper = std::make_shared<SumOperator>(n_args);
+    int n_operators = 1;
+    unsigned int ndx = 0;
+    if (constant_value != 0) {
+      oper->operands[ndx] = std::make_shared<Constant>(constant_value);
+      ++ndx;
+    }
+    for (const RepnCoef &c : constant_terms) {
+      oper->operands[ndx] = c.node;
+      n_operators += c.n_operators;
+      ++ndx;
+    }
+    return RepnCoef(oper, n_operators);
+  }
+
+  bool has_linear() const {
+    for (const RepnCoef &c : linear_coefs) {
+      if (!c.is_zero())
+        return true;
+    }
+    return false;
+  }
+
+  bool has_quadratic() const {
+    for (const RepnCoef &c : quadratic_coefs) {
+      if (!c.is_zero())
+        return true;
+    }
+    return false;
+  }
+
+  bool has_nonlinear() const { return !nonlinear_exprs.empty(); }
+
+  bool is_constant() const {
+    return !has_nonlinear() && !has_linear() && !has_quadratic();
+  }
+
+  // the degree of a sum without a nonlinear part
+  int degree() const {
+    if (has_quadratic())
+      return 2;
+    if (has_linear())
+      return 1;
+    return 0;
+  }
+};
+
+// Walks a Pyomo expression once, following the rules of
+// pyomo.repn.standard_repn (e.g., products of sums are only expanded if the
+// result is at most quadratic).
+class RepnCollector {
+public:
+  RepnCollector(py::handle _var_map, py::handle _param_map,
+                PyomoExprTypes &_expr_types, bool _quadratic)
+      : var_map(_var_map), param_map(_param_map), expr_types(_expr_types),
+        quadratic(_quadratic) {}
+  void collect(py::handle expr, const RepnCoef &multiplier, RepnSum &ans);
+
+private:
+  py::handle var_map;
+  py::handle param_map;
+  PyomoExprTypes &expr_types;
+  bool quadratic;
+  std::unordered_map<PyObject *, RepnVar> vars;
+  std::unordered_map<PyObject *, RepnCoef> params;
+
+  ExprType get_type(py::handle expr) {
+    return expr_types.expr_type_map[py::type::of(expr)].cast<ExprType>();
+  }
+  RepnVar *get_var(py::handle v);
+  RepnCoef get_param(py::handle p);
+  void collect_product(py::handle expr, const RepnCoef &multiplier,
+                       RepnSum &ans);
+  void collect_division(py::handle expr, const RepnCoef &multiplier,
+                        RepnSum &ans);
+  void collect_power(py::handle expr, const RepnCoef &multiplier,
+                     RepnSum &ans);
+  void collect_unary_function(py::handle expr, const RepnCoef &multiplier,
+                              RepnSum &ans);
+};
+
+} // namespace
+
+RepnVar *RepnCollector::get_var(py::handle v) {
+  auto it = vars.find(v.ptr());
+  if (it != vars.end())
+    return &(it->second);
+  RepnVar &res = vars[v.ptr()];
+  res.var = var_map[expr_types.id(v)].cast<std::shared_ptr<Var>>();
+  res.key = vars.size() - 1;
+  res.fixed = v.attr("fixed").cast<bool>();
+  return &res;
+}
+
+RepnCoef RepnCollector::get_param(py::handle p) {
+  auto it = params.find(p.ptr());
+  if (it != params.end())
+    return it->second;
+  RepnCoef res;
+  if (p.attr("parent_component")().attr("mutable").cast<bool>())
+    res = RepnCoef(param_map[expr_types.id(p)].cast<std::shared_ptr<Node>>(), 0);
+  else
+    res = RepnCoef(p.attr("value").cast<double>());
+  params[p.ptr()] = res;
+  return res;
+}
+
+void RepnCollector::collect(py::handle expr, const RepnCoef &multiplier,
+                            RepnSum &ans) {
+  if (multiplier.is_zero())
+    return;
+  switch (get_type(expr)) {
+  case py_float: {
+    ans.add_constant(coef_product(multiplier, RepnCoef(expr.cast<double>())));
+    break;
+  }
+  case numeric_constant: {
+    ans.add_constant(
+        coef_product(multiplier, RepnCoef(expr.attr("value").cast<double>())));
+    break;
+  }
+  case pyomo_unit: {
+    ans.add_constant(multiplier);
+    break;
+  }
+  case var: {
+    RepnVar *v = get_var(expr);
+    if (v->fixed)
+      ans.add_constant(coef_product(multiplier, RepnCoef(v->var, 0)));
+    else
+      ans.add_linear(v, multiplier);
+    break;
+  }
+  case param: {
+    ans.add_constant(coef_product(multiplier, get_param(expr)));
+    break;
+  }
+  case named_expr: {
+    collect(expr.attr("expr"), multiplier, ans);
+    break;
+  }
+  case negation: {
+    py::sequence args = expr.attr("args");
+    collect(args[0], coef_product(multiplier, RepnCoef(-1)), ans);
+    break;
+  }
+  case sum:
+  case linear: {
+    for (py::handle arg : expr.attr("args")) {
+      collect(arg, multiplier, ans);
+    }
+    break;
+  }
+  case product: {
+    collect_product(expr, multiplier, ans);
+    break;
+  }
+  case division: {
+    collect_division(expr, multiplier, ans);
+    break;
+  }
+  case power: {
+    collect_power(expr, multiplier, ans);
+    break;
+  }
+  case unary_func:
+  case unary_abs: {
+    collect_unary_function(expr, multiplier, ans);
+    break;
+  }
+  case external_func: {
+    ans.add_nonlinear(multiplier, expr);
+    break;
+  }
+  default: {
+    throw py::value_error("Unrecognized expression type: " +
+                          expr_types.builtins.attr("str")(py::type::of(expr))
+                              .cast<std::string>());
+    break;
+  }
+  }
+}
+
+void RepnCollector::collect_product(py::handle expr,
+                                    const RepnCoef &multiplier, RepnSum &ans) {
+  py::sequence args = expr.attr("args");
+  py::handle arg1 = args[0];
+  py::handle arg2 = args[1];
+  // the common case of a number times an expression (e.g., 2*x)
+  if (get_type(arg1) == py_float) {
+    collect(arg2, coef_product(multiplier, RepnCoef(arg1.cast<double>())),
+            ans);
+    return;
+  }
+  RepnSum lhs;
+  collect(arg1, RepnCoef(1), lhs);
+  if (lhs.is_constant()) {
+    collect(arg2, coef_product(multiplier, lhs.get_constant()), ans);
+    return;
+  }
+  RepnSum rhs;
+  collect(arg2, RepnCoef(1), rhs);
+  if (rhs.is_constant()) {
+    ans.add(lhs, coef_product(multiplier, rhs.get_constant()));
+    return;
+  }
+  if (lhs.has_nonlinear() || rhs.has_nonlinear() ||
+      lhs.degree() + rhs.degree() > (quadratic ? 2 : 1)) {
+    ans.add_nonlinear(multiplier, expr);
+    return;
+  }
+  // the product of two linear sums
+  RepnCoef lhs_constant = lhs.get_constant();
+  RepnCoef rhs_constant = rhs.get_constant();
+  ans.add_constant(
+      coef_product(multiplier, coef_product(lhs_constant, rhs_constant)));
+  RepnCoef c = coef_product(multiplier, lhs_constant);
+  for (size_t i = 0; i < rhs.linear_vars.size(); ++i)
+    ans.add_linear(rhs.linear_vars[i], coef_product(c, rhs.linear_coefs[i]));
+  c = coef_product(multiplier, rhs_constant);
+  for (size_t i = 0; i < lhs.linear_vars.size(); ++i)
+    ans.add_linear(lhs.linear_vars[i], coef_product(c, lhs.linear_coefs[i]));
+  for (size_t i = 0; i < lhs.linear_vars.size(); ++i) {
+    c = coef_product(multiplier, lhs.linear_coefs[i]);
+    for (size_t j = 0; j < rhs.linear_vars.size(); ++j)
+      ans.add_quadratic(lhs.linear_vars[i], rhs.linear_vars[j],
+                        coef_product(c, rhs.linear_coefs[j]));
+  }
+}
+
+void RepnCollector::collect_division(py::handle expr,
+                                     const RepnCoef &multiplier,
+                                     RepnSum &ans) {
+  py::sequence args = expr.attr("args");
+  RepnSum denominator;
+  collect(args[1], RepnCoef(1), denominator);
+  if (!denominator.is_constant()) {
+    ans.add_nonlinear(multiplier, expr);
+    return;
+  }
+  RepnCoef denom = denominator.get_constant();
+  if (denom.is_zero())
+    throw py::value_error("division by zero in " +
+                          py::str(expr).cast<std::string>());
+  collect(args[0], coef_quotient(multiplier, denom), ans);
+}
+
+void RepnCollector::collect_power(py::handle expr, const RepnCoef &multiplier,
+                                  RepnSum &ans) {
+  py::sequence args = expr.attr("args");
+  RepnSum exponent_sum;
+  collect(args[1], RepnCoef(1), exponent_sum);
+  if (!exponent_sum.is_constant()) {
+    ans.add_nonlinear(multiplier, expr);
+    return;
+  }
+  RepnCoef exponent = exponent_sum.get_constant();
+  if (exponent.is_number() && exponent.value == 0) {
+    ans.add_constant(multiplier);
+    return;
+  }
+  if (exponent.is_number() && exponent.value == 1) {
+    collect(args[0], multiplier, ans);
+    return;
+  }
+  RepnSum base;
+  collect(args[0], RepnCoef(1), base);
+  if (base.is_constant()) {
+    ans.add_constant(
+        coef_product(multiplier, coef_power(base.get_constant(), exponent)));
+    return;
+  }
+  if (!(quadratic && exponent.is_number() && exponent.value == 2) ||
+      base.has_nonlinear() || base.has_quadratic()) {
+    ans.add_nonlinear(multiplier, expr);
+    return;
+  }
+  // the square of a linear sum; the variables are visited in the order in
+  // which they were found
+  RepnCoef base_constant = base.get_constant();
+  ans.add_constant(coef_product(
+      multiplier, coef_product(base_constant, base_constant)));
+  std::vector<size_t> order(base.linear_vars.size());
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), [&base](size_t i, size_t j) {
+    return base.linear_vars[i]->key < base.linear_vars[j]->key;
+  });
+  RepnCoef two_multiplier = coef_product(RepnCoef(2), multiplier);
+  for (size_t i = 0; i < order.size(); ++i) {
+    RepnVar *v1 = base.linear_vars[order[i]];
+    const RepnCoef &coef1 = base.linear_coefs[order[i]];
+    ans.add_linear(v1, coef_product(two_multiplier,
+                                    coef_product(coef1, base_constant)));
+    ans.add_quadratic(v1, v1,
+                      coef_product(multiplier, coef_product(coef1, coef1)));
+    for (size_t j = i + 1; j < order.size(); ++j) {
+      ans.add_quadratic(
+          v1, base.linear_vars[order[j]],
+          coef_product(two_multiplier,
+                       coef_product(coef1, base.linear_coefs[order[j]])));
+    }
+  }
+}
+
+void RepnCollector::collect_unary_function(py::handle expr,
+                                           const RepnCoef &multiplier,
+                                           RepnSum &ans) {
+  py::sequence args = expr.attr("args");
+  RepnSum arg;
+  collect(args[0], RepnCoef(1), arg);
+  if (!arg.is_constant()) {
+    ans.add_nonlinear(multiplier, expr);
+    return;
+  }
+  // a function of parameters and fixed variables
+  RepnCoef arg_constant = arg.get_constant();
+  std::shared_ptr<UnaryOperator> oper = std::dynamic_pointer_cast<UnaryOperator>(
+      appsi_operator_from_pyomo_expr(expr, var_map, param_map, expr_types));
+  oper->operand = arg_constant.get_node();
+  ans.add_constant(coef_product(
+      multiplier, RepnCoef(oper, arg_constant.n_operators + 1)));
+}
+
+std::shared_ptr<ExpressionBase>
+StandardRepn::get_nonlinear_expr(py::handle var_map, py::handle param_map,
+                                 PyomoExprTypes &expr_types,
+                                 NamedExpressionCache *named_exprs) {
+  unsigned int n_terms = nonlinear_exprs.size();
+  if (n_terms == 0)
+    return std::make_shared<Constant>(0);
+  std::vector<std::shared_ptr<Node>> terms(n_terms);
+  int n_operators = 0;
+  for (unsigned int ndx = 0; ndx < n_terms; ++ndx) {
+    std::shared_ptr<Node> node;
+    n_operators += appsi_node_from_pyomo_expr(
+        nonlinear_exprs[ndx], node, var_map, param_map, expr_types,
+        named_exprs);
+    const RepnCoef &c = nonlinear_coefs[ndx];
+    if (c.is_number() && c.value == 1) {
+      terms[ndx] = node;
+    } else {
+      std::shared_ptr<MultiplyOperator> oper =
+          std::make_shared<MultiplyOperator>();
+      oper->operand1 = c.get_node();
+      oper->operand2 = node;
+      terms[ndx] = oper;
+      n_operators += c.n_operators + 1;
+    }
+  }
+  if (n_terms == 1)
+    return expression_from_node(terms[0], n_operators);
+  std::shared_ptr<SumOperator> oper = std::make_shared<SumOperator>(n_terms);
+  for (unsigned int ndx = 0; ndx < n_terms; ++ndx)
+    oper->operands[ndx] = terms[ndx];
+  return expression_from_node(oper, n_operators + 1);
+}
+
+StandardRepn generate_standard_repn(py::handle expr, py::handle var_map,
+                                    py::handle param_map,
+                                    PyomoExprTypes &expr_types,
+                                    bool quadratic) {
+  RepnCollector collector(var_map, param_map, expr_types, quadratic);
+  RepnSum ans;
+  collector.collect(expr, RepnCoef(1), ans);
+
+  StandardRepn res;
+  res.constant = ans.get_constant().get_expression();
+  for (size_t i = 0; i < ans.linear_vars.size(); ++i) {
+    if (ans.linear_coefs[i].is_zero())
+      continue;
+    res.linear_vars.push_back(ans.linear_vars[i]->var);
+    res.linear_coefs.push_back(ans.linear_coefs[i].get_expression());
+  }
+  for (size_t i = 0; i < ans.quadratic_vars_1.size(); ++i) {
+    if (ans.quadratic_coefs[i].is_zero())
+      continue;
+    res.quadratic_vars_1.push_back(ans.quadratic_vars_1[i]->var);
+    res.quadratic_vars_2.push_back(ans.quadratic_vars_2[i]->var);
+    res.quadratic_coefs.push_back(ans.quadratic_coefs[i].get_expression());
+  }
+  res.nonlinear_coefs = ans.nonlinear_coefs;
+  res.nonlinear_exprs = ans.nonlinear_exprs;
+  return res;
+}
@@ -0,0 +1,78 @@
+/**___________________________________________________________________________
+ *
+ * Pyomo: Python Optimization Modeling Objects
+ * Copyright (c) 2008-2024
+ * National Technology and Engineering Solutions of Sandia, LLC
+ * Under the terms of Contract DE-NA0003525 with National Technology and
+ * Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+ * rights in this software.
+ * This software is distributed under the 3-clause BSD License.
+ * ___________________________________________________________________________
+**/
+
+#ifndef REPN_HEADER
+#define REPN_HEADER
+
+#include "expression.hpp"
+
+class RepnCoef;
+class StandardRepn;
+
+// A coefficient of a standard repn: either a number (node is nullptr) or an
+// expression of mutable parameters and fixed variables with root node and
+// n_operators operators. Coefficients stay symbolic so that they can be
+// evaluated again after the parameters change.
+class RepnCoef {
+public:
+  RepnCoef() = default;
+  RepnCoef(double _value) : value(_value) {}
+  RepnCoef(std::shared_ptr<Node> _node, int _n_operators)
+      : node(_node), n_operators(_n_operators) {}
+  double value = 0;
+  std::shared_ptr<Node> node;
+  int n_operators = 0;
+  bool is_number() const { return node == nullptr; }
+  bool is_zero() const { return node == nullptr && value == 0; }
+  std::shared_ptr<Node> get_node() const;
+  std::shared_ptr<ExpressionBase> get_expression() const;
+};
+
+// The C++ counterpart of pyomo.repn.standard_repn.generate_standard_repn
+// with compute_values=False:
+//
+//     constant + sum(linear_coefs[i] * linear_vars[i])
+//     + sum(quadratic_coefs[i] * quadratic_vars_1[i] * quadratic_vars_2[i])
+//     + nonlinear part
+//
+// Each variable appears at most once in the linear part and each pair of
+// variables at most once in the quadratic part. Terms with a coefficient of
+// zero are dropped. The quadratic part is empty unless the repn was
+// generated with quadratic=true.
+class StandardRepn {
+public:
+  StandardRepn() = default;
+  std::shared_ptr<ExpressionBase> constant;
+  std::vector<std::shared_ptr<ExpressionBase>> linear_coefs;
+  std::vector<std::shared_ptr<Var>> linear_vars;
+  std::vector<std::shared_ptr<ExpressionBase>> quadratic_coefs;
+  std::vector<std::shared_ptr<Var>> quadratic_vars_1;
+  std::vector<std::shared_ptr<Var>> quadratic_vars_2;
+  // the nonlinear part is the sum of nonlinear_coefs[i] * nonlinear_exprs[i];
+  // the Pyomo expressions are only converted by get_nonlinear_expr
+  std::vector<RepnCoef> nonlinear_coefs;
+  std::vector<py::object> nonlinear_exprs;
+  bool has_nonlinear() { return !nonlinear_exprs.empty(); }
+  // the nonlinear part (Constant(0) if there is none); named expressions are
+  // converted with named_exprs if it is not nullptr
+  std::shared_ptr<ExpressionBase>
+  get_nonlinear_expr(py::handle var_map, py::handle param_map,
+                     PyomoExprTypes &expr_types,
+                     NamedExpressionCache *named_exprs = nullptr);
+};
+
+StandardRepn generate_standard_repn(py::handle expr, py::handle var_map,
+                                    py::handle param_map,
+                                    PyomoExprTypes &expr_types,
+                                    bool quadratic);
+
+#endif
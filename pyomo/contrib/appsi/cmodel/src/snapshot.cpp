@@ -0,0 +1,780 @@
+/**___________________________________________________________________________
+ *
+ * Pyomo: Python Optimization Modeling Objects
+ * Copyright (c) 2008-2024
+ * National Technology and Engineering Solutions of Sandia, LLC
+ * Under the terms of Contract DE-NA0003525 with National Technology and
+ * Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+ * rights in this software.
+ * This software is distributed under the 3-clause BSD License.
+ * ___________________________________________________________________________
+**/
+
+#include "snapshot.hpp"
+#include "buffered_sink.hpp"
+#include "fbbt_model.hpp"
+#include "lp_writer.hpp"
+#include <cstring>
+#include <unordered_set>
+
+static const char snapshot_magic[8] = {'A', 'P', 'P', 'S',
+                                       'I', 'C', 'M', '\n'};
+static const uint32_t snapshot_byte_order = 0x01020304;
+// the position of a missing node (e.g., a constraint without an upper bound)
+static const uint32_t no_node = 0xffffffff;
+
+enum SnapshotModelKind { fbbt_model = 1, lp_model = 2 };
+
+enum SnapshotNodeKind {
+  var_node,
+  param_node,
+  constant_node,
+  expression_node,
+  linear_node,
+  sum_node,
+  external_node,
+  // unary operators
+  negation_node,
+  exp_node,
+  log_node,
+  abs_node,
+  sqrt_node,
+  log10_node,
+  sin_node,
+  cos_node,
+  tan_node,
+  asin_node,
+  acos_node,
+  atan_node,
+  // binary operators
+  multiply_node,
+  divide_node,
+  power_node,
+  n_node_kinds
+};
+
+static void _snapshot_error(const std::string &msg) {
+  throw py::value_error("Error reading snapshot: " + msg);
+}
+
+static SnapshotNodeKind operator_kind(Operator &oper) {
+  static const std::map<std::string, SnapshotNodeKind> kinds = {
+      {"LinearOperator", linear_node},
+      {"SumOperator", sum_node},
+      {"ExternalOperator", external_node},
+      {"NegationOperator", negation_node},
+      {"ExpOperator", exp_node},
+      {"LogOperator", log_node},
+      {"AbsOperator", abs_node},
+      {"SqrtOperator", sqrt_node},
+      {"Log10Operator", log10_node},
+      {"SinOperator", sin_node},
+      {"CosOperator", cos_node},
+      {"TanOperator", tan_node},
+      {"AsinOperator", asin_node},
+      {"AcosOperator", acos_node},
+      {"AtanOperator", atan_node},
+      {"MultiplyOperator", multiply_node},
+      {"DivideOperator", divide_node},
+      {"PowerOperator", power_node}};
+  std::map<std::string, SnapshotNodeKind>::const_iterator it =
+      kinds.find(oper.name());
+  if (it == kinds.end())
+    throw py::value_error("cannot save a snapshot with a " + oper.name());
+  return it->second;
+}
+
+static std::shared_ptr<Operator> make_operator(SnapshotNodeKind kind) {
+  switch (kind) {
+  case negation_node:
+    return std::make_shared<NegationOperator>();
+  case exp_node:
+    return std::make_shared<ExpOperator>();
+  case log_node:
+    return std::make_shared<LogOperator>();
+  case abs_node:
+    return std::make_shared<AbsOperator>();
+  case sqrt_node:
+    return std::make_shared<SqrtOperator>();
+  case log10_node:
+    return std::make_shared<Log10Operator>();
+  case sin_node:
+    return std::make_shared<SinOperator>();
+  case cos_node:
+    return std::make_shared<CosOperator>();
+  case tan_node:
+    return std::make_shared<TanOperator>();
+  case asin_node:
+    return std::make_shared<AsinOperator>();
+  case acos_node:
+    return std::make_shared<AcosOperator>();
+  case atan_node:
+    return std::make_shared<AtanOperator>();
+  case multiply_node:
+    return std::make_shared<MultiplyOperator>();
+  case divide_node:
+    return std::make_shared<DivideOperator>();
+  case power_node:
+    return std::make_shared<PowerOperator>();
+  default:
+    _snapshot_error("invalid node kind");
+  }
+  return nullptr;
+}
+
+class SnapshotWriter {
+public:
+  SnapshotWriter(BufferedSink &_out) : out(_out) {}
+  // numbers the nodes reachable from node (operands first) and returns the
+  // position of node
+  uint32_t add(Node *node);
+  uint32_t add(const std::shared_ptr<Node> &node) { return add(node.get()); }
+  void write_nodes();
+  void put_u8(unsigned char val) { out.put(val); }
+  void put_u32(uint32_t val) {
+    out.write(reinterpret_cast<const char *>(&val), sizeof(val));
+  }
+  void put_i32(int32_t val) {
+    out.write(reinterpret_cast<const char *>(&val), sizeof(val));
+  }
+  void put_double(double val) {
+    out.write(reinterpret_cast<const char *>(&val), sizeof(val));
+  }
+  void put_string(const std::string &s) {
+    put_u32(s.size());
+    out.write(s.data(), s.size());
+  }
+  void put_node(Node *node) {
+    put_u32(node == nullptr ? no_node : positions.at(node));
+  }
+  void put_node(const std::shared_ptr<Node> &node) { put_node(node.get()); }
+  template <class T> void put_nodes(const std::vector<std::shared_ptr<T>> &v) {
+    put_u32(v.size());
+    for (const std::shared_ptr<T> &node : v) {
+      put_node(node.get());
+    }
+  }
+
+private:
+  BufferedSink &out;
+  std::unordered_map<Node *, uint32_t> positions;
+  std::vector<Node *> nodes;
+  std::vector<SnapshotNodeKind> kinds;
+};
+
+uint32_t SnapshotWriter::add(Node *node) {
+  if (node == nullptr)
+    return no_node;
+  std::unordered_map<Node *, uint32_t>::iterator it = positions.find(node);
+  if (it != positions.end())
+    return it->second;
+
+  SnapshotNodeKind kind;
+  if (node->is_variable_type()) {
+    kind = var_node;
+    Var *v = static_cast<Var *>(node);
+    add(v->lb);
+    add(v->ub);
+  } else if (node->is_param_type()) {
+    kind = param_node;
+  } else if (node->is_constant_type()) {
+    kind = constant_node;
+  } else if (node->is_expression_type()) {
+    kind = expression_node;
+    Expression *e = static_cast<Expression *>(node);
+    for (unsigned int i = 0; i < e->n_operators; ++i) {
+      add(e->operators[i]);
+    }
+  } else if (node->is_operator_type()) {
+    kind = operator_kind(*static_cast<Operator *>(node));
+    if (kind == linear_node) {
+      LinearOperator *oper = static_cast<LinearOperator *>(node);
+      for (unsigned int i = 0; i < oper->nterms; ++i) {
+        add(oper->variables[i]);
+        add(oper->coefficients[i]);
+      }
+      add(oper->constant);
+    } else if (kind == sum_node) {
+      SumOperator *oper = static_cast<SumOperator *>(node);
+      for (unsigned int i = 0; i < oper->nargs; ++i) {
+        add(oper->operands[i]);
+      }
+    } else if (kind == external_node) {
+      ExternalOperator *oper = static_cast<ExternalOperator *>(node);
+      for (unsigned int i = 0; i < oper->nargs; ++i) {
+        add(oper->operands[i]);
+      }
+    } else if (kind < multiply_node) {
+      add(static_cast<UnaryOperator *>(node)->operand);
+    } else {
+      BinaryOperator *oper = static_cast<BinaryOperator *>(node);
+      add(oper->operand1);
+      add(oper->operand2);
+    }
+  } else {
+    throw py::value_error("cannot save a snapshot with an unknown node type");
+  }
+
+  uint32_t pos = nodes.size();
+  positions[node] = pos;
+  nodes.push_back(node);
+  kinds.push_back(kind);
+  return pos;
+}
+
+void SnapshotWriter::write_nodes() {
+  put_u32(nodes.size());
+  for (unsigned int i = 0; i < nodes.size(); ++i) {
+    Node *node = nodes[i];
+    SnapshotNodeKind kind = kinds[i];
+    put_u8(kind);
+    if (kind == var_node) {
+      Var *v = static_cast<Var *>(node);
+      put_string(v->name);
+      put_double(v->value);
+      put_u8(v->fixed);
+      put_u8(v->domain);
+      put_double(v->domain_lb);
+      put_double(v->domain_ub);
+      put_node(v->lb);
+      put_node(v->ub);
+    } else if (kind == param_node) {
+      Param *p = static_cast<Param *>(node);
+      put_string(p->name);
+      put_double(p->value);
+    } else if (kind == constant_node) {
+      put_double(static_cast<Constant *>(node)->value);
+    } else if (kind == expression_node) {
+      Expression *e = static_cast<Expression *>(node);
+      put_u32(e->n_operators);
+      for (unsigned int j = 0; j < e->n_operators; ++j) {
+        put_node(e->operators[j]);
+      }
+    } else {
+      put_i32(static_cast<Operator *>(node)->index);
+      if (kind == linear_node) {
+        LinearOperator *oper = static_cast<LinearOperator *>(node);
+        put_u32(oper->nterms);
+        for (unsigned int j = 0; j < oper->nterms; ++j) {
+          put_node(oper->variables[j]);
+          put_node(oper->coefficients[j]);
+        }
+        put_node(oper->constant);
+      } else if (kind == sum_node) {
+        SumOperator *oper = static_cast<SumOperator *>(node);
+        put_u32(oper->nargs);
+        for (unsigned int j = 0; j < oper->nargs; ++j) {
+          put_node(oper->operands[j]);
+        }
+      } else if (kind == external_node) {
+        ExternalOperator *oper = static_cast<ExternalOperator *>(node);
+        put_string(oper->function_name);
+        put_i32(oper->external_function_index);
+        put_u32(oper->nargs);
+        for (unsigned int j = 0; j < oper->nargs; ++j) {
+          put_node(oper->operands[j]);
+        }
+      } else if (kind < multiply_node) {
+        put_node(static_cast<UnaryOperator *>(node)->operand);
+      } else {
+        BinaryOperator *oper = static_cast<BinaryOperator *>(node);
+        put_node(oper->operand1);
+        put_node(oper->operand2);
+      }
+    }
+  }
+}
+
+class SnapshotReader {
+public:
+  SnapshotReader(const std::string &_content) : content(_content) {}
+  void read_nodes();
+  void read(void *dest, size_t n) {
+    if (n > content.size() - pos)
+      _snapshot_error("unexpected end of file");
+    std::memcpy(dest, content.data() + pos, n);
+    pos += n;
+  }
+  unsigned char get_u8() {
+    unsigned char val;
+    read(&val, sizeof(val));
+    return val;
+  }
+  uint32_t get_u32() {
+    uint32_t val;
+    read(&val, sizeof(val));
+    return val;
+  }
+  int32_t get_i32() {
+    int32_t val;
+    read(&val, sizeof(val));
+    return val;
+  }
+  double get_double() {
+    double val;
+    read(&val, sizeof(val));
+    return val;
+  }
+  std::string get_string() {
+    uint32_t n = get_u32();
+    if (n > content.size() - pos)
+      _snapshot_error("unexpected end of file");
+    std::string res = content.substr(pos, n);
+    pos += n;
+    return res;
+  }
+  // the next node, which must be one of the nodes read so far
+  std::shared_ptr<Node> get_node() {
+    uint32_t ndx = get_u32();
+    if (ndx == no_node)
+      return nullptr;
+    if (ndx >= nodes.size())
+      _snapshot_error("invalid node reference");
+    return nodes[ndx];
+  }
+  std::shared_ptr<ExpressionBase> get_expression() {
+    std::shared_ptr<Node> node = get_node();
+    if (node != nullptr && node->is_operator_type())
+      _snapshot_error("expected an expression");
+    return std::static_pointer_cast<ExpressionBase>(node);
+  }
+  // the operand of an operator: a leaf or another operator
+  std::shared_ptr<Node> get_operand() {
+    std::shared_ptr<Node> node = get_node();
+    if (node == nullptr)
+      _snapshot_error("missing operand");
+    if (node->is_expression_type())
+      _snapshot_error("expected a leaf or an operator");
+    return node;
+  }
+  // a coefficient or the constant of a linear operator
+  std::shared_ptr<ExpressionBase> get_operand_expression() {
+    std::shared_ptr<ExpressionBase> expr = get_expression();
+    if (expr == nullptr)
+      _snapshot_error("missing operand");
+    return expr;
+  }
+  std::shared_ptr<Var> get_var() {
+    std::shared_ptr<Node> node = get_node();
+    if (node == nullptr || !node->is_variable_type())
+      _snapshot_error("expected a variable");
+    return std::static_pointer_cast<Var>(node);
+  }
+  std::shared_ptr<Param> get_param() {
+    std::shared_ptr<Node> node = get_node();
+    if (node == nullptr || !node->is_param_type())
+      _snapshot_error("expected a param");
+    return std::static_pointer_cast<Param>(node);
+  }
+  std::vector<std::shared_ptr<ExpressionBase>> get_expressions() {
+    std::vector<std::shared_ptr<ExpressionBase>> res(get_count());
+    for (std::shared_ptr<ExpressionBase> &e : res) {
+      e = get_expression();
+    }
+    return res;
+  }
+  std::vector<std::shared_ptr<Var>> get_vars() {
+    std::vector<std::shared_ptr<Var>> res(get_count());
+    for (std::shared_ptr<Var> &v : res) {
+      v = get_var();
+    }
+    return res;
+  }
+  std::vector<std::shared_ptr<Param>> get_params() {
+    std::vector<std::shared_ptr<Param>> res(get_count());
+    for (std::shared_ptr<Param> &p : res) {
+      p = get_param();
+    }
+    return res;
+  }
+  // a number of items of at least 4 bytes each that follow
+  uint32_t get_count() {
+    uint32_t n = get_u32();
+    if (n > (content.size() - pos) / 4)
+      _snapshot_error("unexpected end of file");
+    return n;
+  }
+  bool at_end() { return pos == content.size(); }
+  std::vector<std::shared_ptr<Var>> vars;
+  std::vector<std::shared_ptr<Param>> params;
+
+private:
+  void check_operands(Operator &oper, uint32_t position,
+                      std::unordered_map<Node *, uint32_t> &positions);
+  const std::string &content;
+  size_t pos = 0;
+  std::vector<std::shared_ptr<Node>> nodes;
+};
+
+// The operators of an expression read the values of the operands that are
+// operators from an array indexed by Operator::index (see
+// Expression::evaluate), so those operands have to come earlier in the same
+// expression.
+void SnapshotReader::check_operands(
+    Operator &oper, uint32_t position,
+    std::unordered_map<Node *, uint32_t> &positions) {
+  std::vector<Node *> operands;
+  if (oper.is_unary_operator()) {
+    operands.push_back(static_cast<UnaryOperator &>(oper).operand.get());
+  } else if (oper.is_binary_operator()) {
+    BinaryOperator &bin = static_cast<BinaryOperator &>(oper);
+    operands.push_back(bin.operand1.get());
+    operands.push_back(bin.operand2.get());
+  } else if (oper.is_sum_operator()) {
+    SumOperator &sum = static_cast<SumOperator &>(oper);
+    for (unsigned int i = 0; i < sum.nargs; ++i) {
+      operands.push_back(sum.operands[i].get());
+    }
+  } else if (oper.is_external_operator()) {
+    ExternalOperator &ext = static_cast<ExternalOperator &>(oper);
+    for (unsigned int i = 0; i < ext.nargs; ++i) {
+      operands.push_back(ext.operands[i].get());
+    }
+  }
+  // the terms of a linear operator are variables and expressions
+  std::unordered_map<Node *, uint32_t>::iterator it;
+  for (Node *operand : operands) {
+    if (!operand->is_operator_type())
+      continue;
+    it = positions.find(operand);
+    if (it == positions.end() || it->second >= position)
+      _snapshot_error("an operand does not precede its operator");
+  }
+}
+
+void SnapshotReader::read_nodes() {
+  uint32_t n_nodes = get_count();
+  nodes.reserve(n_nodes);
+  for (uint32_t i = 0; i < n_nodes; ++i) {
+    unsigned char kind = get_u8();
+    if (kind == var_node) {
+      std::shared_ptr<Var> v = std::make_shared<Var>(get_string());
+      v->value = get_double();
+      v->fixed = get_u8();
+      unsigned char domain = get_u8();
+      if (domain > integers)
+        _snapshot_error("invalid domain");
+      v->domain = static_cast<Domain>(domain);
+      v->domain_lb = get_double();
+      v->domain_ub = get_double();
+      v->lb = get_expression();
+      v->ub = get_expression();
+      vars.push_back(v);
+      nodes.push_back(v);
+    } else if (kind == param_node) {
+      std::shared_ptr<Param> p = std::make_shared<Param>(get_string());
+      p->value = get_double();
+      params.push_back(p);
+      nodes.push_back(p);
+    } else if (kind == constant_node) {
+      nodes.push_back(std::make_shared<Constant>(get_double()));
+    } else if (kind == expression_node) {
+      uint32_t n_operators = get_count();
+      if (n_operators == 0)
+        _snapshot_error("expression without operators");
+      std::shared_ptr<Expression> e =
+          std::make_shared<Expression>(n_operators);
+      // An operator may be shared by several expressions, so the index it
+      // was saved with is only its position in one of them. It is numbered
+      // by its position here, like every pass over the expression does.
+      std::unordered_map<Node *, uint32_t> positions;
+      for (uint32_t j = 0; j < n_operators; ++j) {
+        std::shared_ptr<Node> oper = get_node();
+        if (oper == nullptr || !oper->is_operator_type())
+          _snapshot_error("expected an operator");
+        if (!positions.emplace(oper.get(), j).second)
+          _snapshot_error("an operator appears twice in an expression");
+        e->operators[j] = std::static_pointer_cast<Operator>(oper);
+        check_operands(*e->operators[j], j, positions);
+        e->operators[j]->index = j;
+      }
+      nodes.push_back(e);
+    } else if (kind < n_node_kinds) {
+      int32_t index = get_i32();
+      std::shared_ptr<Operator> res;
+      if (kind == linear_node) {
+        uint32_t nterms = get_count();
+        std::shared_ptr<LinearOperator> oper =
+            std::make_shared<LinearOperator>(nterms);
+        for (uint32_t j = 0; j < nterms; ++j) {
+          oper->variables[j] = get_var();
+          oper->coefficients[j] = get_operand_expression();
+        }
+        oper->constant = get_operand_expression();
+        res = oper;
+      } else if (kind == sum_node) {
+        uint32_t nargs = get_count();
+        std::shared_ptr<SumOperator> oper =
+            std::make_shared<SumOperator>(nargs);
+        for (uint32_t j = 0; j < nargs; ++j) {
+          oper->operands[j] = get_operand();
+        }
+        res = oper;
+      } else if (kind == external_node) {
+        std::string function_name = get_string();
+        int32_t external_function_index = get_i32();
+        uint32_t nargs = get_count();
+        std::shared_ptr<ExternalOperator> oper =
+            std::make_shared<ExternalOperator>(nargs);
+        oper->function_name = function_name;
+        oper->external_function_index = external_function_index;
+        for (uint32_t j = 0; j < nargs; ++j) {
+          oper->operands[j] = get_operand();
+        }
+        res = oper;
+      } else if (kind < multiply_node) {
+        res = make_operator(static_cast<SnapshotNodeKind>(kind));
+        std::static_pointer_cast<UnaryOperator>(res)->operand = get_operand();
+      } else {
+        res = make_operator(static_cast<SnapshotNodeKind>(kind));
+        std::shared_ptr<BinaryOperator> oper =
+            std::static_pointer_cast<BinaryOperator>(res);
+        oper->operand1 = get_operand();
+        oper->operand2 = get_operand();
+      }
+      res->index = index;
+      nodes.push_back(res);
+    } else {
+      _snapshot_error("invalid node kind");
+    }
+  }
+}
+
+static void put_lp_terms(SnapshotWriter &w, LPBase &obj) {
+  w.put_node(obj.constant_expr);
+  w.put_nodes(*obj.linear_coefficients);
+  w.put_nodes(*obj.linear_vars);
+  w.put_nodes(*obj.quadratic_coefficients);
+  w.put_nodes(*obj.quadratic_vars_1);
+  w.put_nodes(*obj.quadratic_vars_2);
+}
+
+static void get_lp_terms(SnapshotReader &r, LPBase &obj) {
+  typedef std::vector<std::shared_ptr<ExpressionBase>> Exprs;
+  typedef std::vector<std::shared_ptr<Var>> Vars;
+  obj.constant_expr = r.get_expression();
+  if (obj.constant_expr == nullptr)
+    _snapshot_error("expected an expression");
+  obj.linear_coefficients = std::make_shared<Exprs>(r.get_expressions());
+  obj.linear_vars = std::make_shared<Vars>(r.get_vars());
+  obj.quadratic_coefficients = std::make_shared<Exprs>(r.get_expressions());
+  obj.quadratic_vars_1 = std::make_shared<Vars>(r.get_vars());
+  obj.quadratic_vars_2 = std::make_shared<Vars>(r.get_vars());
+  if (obj.linear_coefficients->size() != obj.linear_vars->size() ||
+      obj.quadratic_coefficients->size() != obj.quadratic_vars_1->size() ||
+      obj.quadratic_coefficients->size() != obj.quadratic_vars_2->size())
+    _snapshot_error("the number of terms does not match");
+}
+
+static void add_lp_terms(SnapshotWriter &w, LPBase &obj) {
+  w.add(obj.constant_expr);
+  for (std::shared_ptr<ExpressionBase> &coef : *obj.linear_coefficients) {
+    w.add(coef);
+  }
+  for (std::shared_ptr<Var> &v : *obj.linear_vars) {
+    w.add(v);
+  }
+  for (std::shared_ptr<ExpressionBase> &coef : *obj.quadratic_coefficients) {
+    w.add(coef);
+  }
+  for (std::shared_ptr<Var> &v : *obj.quadratic_vars_1) {
+    w.add(v);
+  }
+  for (std::shared_ptr<Var> &v : *obj.quadratic_vars_2) {
+    w.add(v);
+  }
+}
+
+// appends the nodes of all that are not in res yet, in the order of all
+template <class T>
+static void append_others(std::vector<std::shared_ptr<T>> &res,
+                          const std::vector<std::shared_ptr<T>> &all) {
+  std::unordered_set<T *> found;
+  for (const std::shared_ptr<T> &node : res) {
+    found.insert(node.get());
+  }
+  for (const std::shared_ptr<T> &node : all) {
+    if (found.count(node.get()) == 0)
+      res.push_back(node);
+  }
+}
+
+void save_snapshot(Model &model, std::string filename,
+                   std::vector<std::shared_ptr<Var>> &vars,
+                   std::vector<std::shared_ptr<Param>> &params) {
+  SnapshotModelKind model_kind;
+  if (dynamic_cast<FBBTModel *>(&model) != nullptr)
+    model_kind = fbbt_model;
+  else if (dynamic_cast<LPWriter *>(&model) != nullptr)
+    model_kind = lp_model;
+  else
+    throw py::value_error(
+        "snapshots are only supported for FBBTModel and LPWriter");
+
+  std::ofstream f;
+  f.open(filename, std::ios::out | std::ios::binary);
+  if (!f)
+    throw py::value_error("could not open " + filename);
+  BufferedSink out(f);
+  SnapshotWriter w(out);
+
+  // the params first, since the bounds of the vars may reference them
+  for (std::shared_ptr<Param> &p : params) {
+    w.add(p);
+  }
+  for (std::shared_ptr<Var> &v : vars) {
+    w.add(v);
+  }
+  std::shared_ptr<FBBTObjective> fbbt_obj;
+  std::shared_ptr<LPObjective> lp_obj;
+  for (const std::shared_ptr<Constraint> &con : model.constraints) {
+    w.add(con->lb);
+    w.add(con->ub);
+    if (model_kind == fbbt_model)
+      w.add(std::static_pointer_cast<FBBTConstraint>(con)->body);
+    else
+      add_lp_terms(w, *std::dynamic_pointer_cast<LPConstraint>(con));
+  }
+  if (model_kind == fbbt_model) {
+    fbbt_obj = std::dynamic_pointer_cast<FBBTObjective>(model.objective);
+    if (fbbt_obj != nullptr)
+      w.add(fbbt_obj->expr);
+  } else {
+    lp_obj = std::dynamic_pointer_cast<LPObjective>(model.objective);
+    if (lp_obj != nullptr)
+      add_lp_terms(w, *lp_obj);
+  }
+
+  out.write(snapshot_magic, sizeof(snapshot_magic));
+  w.put_u32(snapshot_version);
+  w.put_u32(snapshot_byte_order);
+  w.put_u8(model_kind);
+  w.write_nodes();
+  // the positions of the vars and params that were passed in
+  w.put_nodes(vars);
+  w.put_nodes(params);
+
+  w.put_u32(model.constraints.size());
+  for (const std::shared_ptr<Constraint> &con : model.constraints) {
+    w.put_string(con->name);
+    w.put_u8(con->active);
+    w.put_node(con->lb);
+    w.put_node(con->ub);
+    if (model_kind == fbbt_model)
+      w.put_node(std::static_pointer_cast<FBBTConstraint>(con)->body);
+    else
+      put_lp_terms(w, *std::dynamic_pointer_cast<LPConstraint>(con));
+  }
+
+  Objective *obj = fbbt_obj.get();
+  if (lp_obj != nullptr)
+    obj = lp_obj.get();
+  w.put_u8(obj != nullptr);
+  if (obj != nullptr) {
+    w.put_string(obj->name);
+    w.put_i32(obj->sense);
+    if (model_kind == fbbt_model)
+      w.put_node(fbbt_obj->expr);
+    else
+      put_lp_terms(w, *lp_obj);
+  }
+  out.flush();
+  f.close();
+}
+
+std::pair<std::vector<std::shared_ptr<Var>>,
+          std::vector<std::shared_ptr<Param>>>
+load_snapshot(Model &model, std::string filename) {
+  std::ifstream in(filename, std::ios::in | std::ios::binary);
+  if (!in)
+    throw py::value_error("could not open " + filename);
+  in.seekg(0, std::ios::end);
+  std::string content(static_cast<size_t>(in.tellg()), '\0');
+  in.seekg(0, std::ios::beg);
+  in.read(&content[0], content.size());
+
+  SnapshotReader r(content);
+  char magic[sizeof(snapshot_magic)];
+  r.read(magic, sizeof(magic));
+  if (std::memcmp(magic, snapshot_magic, sizeof(magic)) != 0)
+    _snapshot_error(filename + " is not a cmodel snapshot");
+  uint32_t version = r.get_u32();
+  if (version != snapshot_version)
+    _snapshot_error("unsupported version " + std::to_string(version));
+  if (r.get_u32() != snapshot_byte_order)
+    _snapshot_error("the snapshot was saved with a different byte order");
+  unsigned char model_kind = r.get_u8();
+  if (model_kind == fbbt_model) {
+    if (dynamic_cast<FBBTModel *>(&model) == nullptr)
+      throw py::value_error("the snapshot is of an FBBTModel");
+  } else if (model_kind == lp_model) {
+    if (dynamic_cast<LPWriter *>(&model) == nullptr)
+      throw py::value_error("the snapshot is of an LPWriter");
+  } else {
+    _snapshot_error("invalid model kind");
+  }
+  if (!model.constraints.empty())
+    throw py::value_error("cannot load a snapshot into a model with "
+                          "constraints");
+
+  r.read_nodes();
+  std::vector<std::shared_ptr<Var>> vars = r.get_vars();
+  std::vector<std::shared_ptr<Param>> params = r.get_params();
+
+  uint32_t n_cons = r.get_count();
+  std::vector<std::shared_ptr<Constraint>> cons;
+  cons.reserve(n_cons);
+  std::string name;
+  bool active;
+  std::shared_ptr<ExpressionBase> lb;
+  std::shared_ptr<ExpressionBase> ub;
+  for (uint32_t i = 0; i < n_cons; ++i) {
+    name = r.get_string();
+    active = r.get_u8();
+    lb = r.get_expression();
+    ub = r.get_expression();
+    if (model_kind == fbbt_model) {
+      std::shared_ptr<ExpressionBase> body = r.get_expression();
+      if (body == nullptr)
+        _snapshot_error("expected an expression");
+      cons.push_back(std::make_shared<FBBTConstraint>(lb, body, ub));
+      model.add_dependencies(cons.back(), {body, lb, ub});
+    } else {
+      std::shared_ptr<LPConstraint> con = std::make_shared<LPConstraint>();
+      con->lb = lb;
+      con->ub = ub;
+      get_lp_terms(r, *con);
+      model.add_dependencies(con, con->get_exprs({lb, ub}));
+      con->params_found = true;
+      cons.push_back(con);
+    }
+    cons.back()->name = name;
+    cons.back()->active = active;
+  }
+
+  std::shared_ptr<Objective> obj;
+  if (r.get_u8()) {
+    name = r.get_string();
+    int32_t sense = r.get_i32();
+    if (model_kind == fbbt_model) {
+      std::shared_ptr<ExpressionBase> expr = r.get_expression();
+      if (expr == nullptr)
+        _snapshot_error("expected an expression");
+      obj = std::make_shared<FBBTObjective>(expr);
+    } else {
+      std::shared_ptr<LPObjective> lp_obj = std::make_shared<LPObjective>();
+      get_lp_terms(r, *lp_obj);
+      obj = lp_obj;
+    }
+    obj->name = name;
+    obj->sense = sense;
+  }
+  if (!r.at_end())
+    _snapshot_error("unexpected data at the end of the file");
+
+  model.add_constraints(cons);
+  model.objective = obj;
+  append_others(vars, r.vars);
+  append_others(params, r.params);
+  return std::make_pair(vars, params);
+}
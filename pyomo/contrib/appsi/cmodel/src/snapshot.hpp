@@ -0,0 +1,50 @@
+/**___________________________________________________________________________
+ *
+ * Pyomo: Python Optimization Modeling Objects
+ * Copyright (c) 2008-2024
+ * National Technology and Engineering Solutions of Sandia, LLC
+ * Under the terms of Contract DE-NA0003525 with National Technology and
+ * Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+ * rights in this software.
+ * This software is distributed under the 3-clause BSD License.
+ * ___________________________________________________________________________
+**/
+
+#ifndef SNAPSHOT_HEADER
+#define SNAPSHOT_HEADER
+
+#include "model_base.hpp"
+#include <cstdint>
+
+// Binary snapshots of converted models, so that a model does not have to be
+// converted from Pyomo again (e.g., in every worker of a parameter sweep).
+// A snapshot holds the vars, params and constants, the operators of every
+// expression, and the constraints and objective of an FBBTModel or an
+// LPWriter. Nodes that are shared in the saved model are shared in the
+// loaded one as well.
+//
+// The file starts with a magic string, the format version and a byte order
+// mark, followed by the nodes (each node after the nodes it references), the
+// positions of the vars and params passed to save_snapshot, and the
+// constraints and objective, which refer to the nodes by position.
+// Numbers are stored in native byte order, so a snapshot can only be loaded
+// on a machine with the same byte order.
+//
+// load_snapshot adds the constraints and objective to model, which must not
+// have any constraints and must be of the same type as the saved model. It
+// returns the vars and params that were passed to save_snapshot in the order
+// they were passed, so that the caller can map them back to Pyomo
+// components. They are followed by the other vars and params the model
+// references (e.g., a var that was not passed in), in no particular order,
+// so the positions of the passed ones do not depend on them.
+
+const uint32_t snapshot_version = 2;
+
+void save_snapshot(Model &model, std::string filename,
+                   std::vector<std::shared_ptr<Var>> &vars,
+                   std::vector<std::shared_ptr<Param>> &params);
+std::pair<std::vector<std::shared_ptr<Var>>,
+          std::vector<std::shared_ptr<Param>>>
+load_snapshot(Model &model, std::string filename);
+
+#endif
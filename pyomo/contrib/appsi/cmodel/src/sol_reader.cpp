@@ -0,0 +1,321 @@
+/**___________________________________________________________________________
+ *
+ * Pyomo: Python Optimization Modeling Objects
+ * Copyright (c) 2008-2024
+ * National Technology and Engineering Solutions of Sandia, LLC
+ * Under the terms of Contract DE-NA0003525 with National Technology and
+ * Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+ * rights in this software.
+ * This software is distributed under the 3-clause BSD License.
+ * ___________________________________________________________________________
+**/
+
+#include "sol_reader.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+bool SolFile::has_suffix(const std::string &name) {
+  for (SolSuffix &suffix : suffixes) {
+    if (suffix.name == name)
+      return true;
+  }
+  return false;
+}
+
+SolSuffix &SolFile::get_suffix(const std::string &name) {
+  for (SolSuffix &suffix : suffixes) {
+    if (suffix.name == name)
+      return suffix;
+  }
+  throw py::value_error("the .sol file does not have a suffix named " + name);
+}
+
+static void _sol_error(const std::string &msg) {
+  throw py::value_error("Error reading .sol file: " + msg);
+}
+
+// The text format has one token per line (except for the objno and suffix
+// lines). Numbers are parsed in place with strtol/strtod.
+class SolTextParser {
+public:
+  SolTextParser(const std::string &_content) : content(_content) {}
+  bool at_end() { return pos >= content.size(); }
+  std::string next_line() {
+    if (at_end())
+      _sol_error("unexpected end of file");
+    size_t end = content.find('\n', pos);
+    if (end == std::string::npos)
+      end = content.size();
+    std::string line = content.substr(pos, end - pos);
+    pos = end + 1;
+    return strip(line);
+  }
+  long next_int() {
+    const char *start = content.c_str() + pos;
+    char *end;
+    long res = std::strtol(start, &end, 10);
+    finish_number(start, end);
+    return res;
+  }
+  double next_double() {
+    const char *start = content.c_str() + pos;
+    char *end;
+    double res = std::strtod(start, &end);
+    finish_number(start, end);
+    return res;
+  }
+  static std::string strip(const std::string &s) {
+    size_t begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string::npos)
+      return "";
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+  }
+
+private:
+  // skips the rest of the line after a number
+  void finish_number(const char *start, char *end) {
+    if (end == start)
+      _sol_error("expected a number");
+    pos = end - content.c_str();
+    size_t eol = content.find('\n', pos);
+    if (eol == std::string::npos)
+      pos = content.size();
+    else
+      pos = eol + 1;
+  }
+  const std::string &content;
+  size_t pos = 0;
+};
+
+// The binary format is a sequence of records; each record is its length in
+// bytes (a 4 byte integer), the data, and the length again.
+class SolBinaryParser {
+public:
+  SolBinaryParser(const std::string &_content) : content(_content) {}
+  bool at_end() { return pos >= content.size(); }
+  std::string next_record() {
+    int32_t len = read_length();
+    if (len < 0 || pos + len > content.size())
+      _sol_error("invalid record length");
+    std::string res = content.substr(pos, len);
+    pos += len;
+    if (read_length() != len)
+      _sol_error("record lengths do not match");
+    return res;
+  }
+  std::vector<int> next_ints(size_t min_size = 0) {
+    std::string rec = next_record();
+    std::vector<int> res(rec.size() / sizeof(int32_t));
+    for (size_t i = 0; i < res.size(); ++i) {
+      int32_t val;
+      std::memcpy(&val, rec.data() + i * sizeof(int32_t), sizeof(int32_t));
+      res[i] = val;
+    }
+    if (res.size() < min_size)
+      _sol_error("record is too short");
+    return res;
+  }
+  std::vector<double> next_doubles(size_t size) {
+    std::string rec = next_record();
+    if (rec.size() != size * sizeof(double))
+      _sol_error("record has the wrong size");
+    std::vector<double> res(size);
+    if (size > 0)
+      std::memcpy(res.data(), rec.data(), rec.size());
+    return res;
+  }
+
+private:
+  int32_t read_length() {
+    if (pos + sizeof(int32_t) > content.size())
+      _sol_error("unexpected end of file");
+    int32_t len;
+    std::memcpy(&len, content.data() + pos, sizeof(int32_t));
+    pos += sizeof(int32_t);
+    return len;
+  }
+  const std::string &content;
+  size_t pos = 0;
+};
+
+static bool is_binary_sol(const std::string &content) {
+  if (content.size() < 2 * sizeof(int32_t) + 6)
+    return false;
+  int32_t len;
+  std::memcpy(&len, content.data(), sizeof(int32_t));
+  return len == 6 && content.compare(sizeof(int32_t), 6, "binary") == 0;
+}
+
+// The options are followed by the number of constraints, the number of
+// duals, the number of variables and the number of primals. If there are
+// more than 4 options, the last two are not written and a vbtol value
+// comes after the counts.
+static bool process_options(SolFile &sol, std::vector<int> &z,
+                            int &n_duals, int &n_primals) {
+  int nopts = z[0];
+  bool need_vbtol = false;
+  if (nopts > 4) {
+    nopts -= 2;
+    need_vbtol = true;
+  }
+  if (nopts < 0 || z.size() < (size_t)nopts + 5)
+    _sol_error("invalid options");
+  sol.options.assign(z.begin() + 1, z.begin() + 1 + nopts);
+  sol.n_cons = z[nopts + 1];
+  n_duals = z[nopts + 2];
+  sol.n_vars = z[nopts + 3];
+  n_primals = z[nopts + 4];
+  return need_vbtol;
+}
+
+static void read_text_sol(const std::string &content, SolFile &sol) {
+  SolTextParser p(content);
+  std::string line;
+  while (true) {
+    if (p.at_end())
+      _sol_error("no Options line found");
+    line = p.next_line();
+    if (line == "Options")
+      break;
+    if (line.size() > 0) {
+      if (sol.message.size() > 0)
+        sol.message += "\n";
+      sol.message += line;
+    }
+  }
+
+  std::vector<int> z;
+  z.push_back(p.next_int());
+  int nopts = (z[0] > 4) ? z[0] - 2 : z[0];
+  for (int i = 0; i < nopts + 4; ++i) {
+    z.push_back(p.next_int());
+  }
+  int n_duals;
+  int n_primals;
+  if (process_options(sol, z, n_duals, n_primals))
+    p.next_double();
+
+  sol.duals.resize(n_duals);
+  for (int i = 0; i < n_duals; ++i) {
+    sol.duals[i] = p.next_double();
+  }
+  sol.primals.resize(n_primals);
+  for (int i = 0; i < n_primals; ++i) {
+    sol.primals[i] = p.next_double();
+  }
+
+  while (!p.at_end()) {
+    line = p.next_line();
+    if (line.size() == 0)
+      continue;
+    if (line.compare(0, 5, "objno") == 0) {
+      const char *start = line.c_str() + 5;
+      char *end;
+      sol.objno = std::strtol(start, &end, 10);
+      sol.solve_result_num = std::strtol(end, &end, 10);
+      continue;
+    }
+    if (line.compare(0, 6, "suffix") != 0) {
+      // solver specific sections come after all of the suffixes
+      break;
+    }
+    // suffix kind n namelen tablen tablines
+    const char *start = line.c_str() + 6;
+    char *end;
+    int kind = std::strtol(start, &end, 10);
+    int n = std::strtol(end, &end, 10);
+    std::strtol(end, &end, 10);
+    std::strtol(end, &end, 10);
+    int tablines = std::strtol(end, &end, 10);
+    SolSuffix suffix;
+    suffix.kind = kind & 3;
+    suffix.is_real = (kind & 4) != 0;
+    suffix.name = p.next_line();
+    for (int i = 0; i < tablines; ++i) {
+      p.next_line();
+    }
+    suffix.indices.resize(n);
+    suffix.values.resize(n);
+    for (int i = 0; i < n; ++i) {
+      line = p.next_line();
+      start = line.c_str();
+      suffix.indices[i] = std::strtol(start, &end, 10);
+      if (end == start)
+        _sol_error("invalid suffix value");
+      suffix.values[i] = std::strtod(end, &end);
+    }
+    sol.suffixes.push_back(suffix);
+  }
+}
+
+static void read_binary_sol(const std::string &content, SolFile &sol) {
+  SolBinaryParser p(content);
+  p.next_record(); // "binary"
+  std::string line;
+  while (true) {
+    line = p.next_record();
+    if (line.size() == 0)
+      break;
+    if (sol.message.size() > 0)
+      sol.message += "\n";
+    sol.message += line;
+  }
+
+  std::vector<int> z = p.next_ints(1);
+  int n_duals;
+  int n_primals;
+  if (process_options(sol, z, n_duals, n_primals))
+    p.next_record();
+
+  if (n_duals > 0)
+    sol.duals = p.next_doubles(n_duals);
+  if (n_primals > 0)
+    sol.primals = p.next_doubles(n_primals);
+
+  if (p.at_end())
+    return;
+  std::vector<int> objno = p.next_ints(2);
+  sol.objno = objno[0];
+  sol.solve_result_num = objno[1];
+
+  while (!p.at_end()) {
+    // kind n namelen tablen tablines
+    std::vector<int> header = p.next_ints(5);
+    SolSuffix suffix;
+    suffix.kind = header[0] & 3;
+    suffix.is_real = (header[0] & 4) != 0;
+    suffix.name = p.next_record();
+    if (header[3] > 0)
+      p.next_record(); // table
+    suffix.indices = p.next_ints(header[1]);
+    if (suffix.is_real) {
+      suffix.values = p.next_doubles(header[1]);
+    } else {
+      std::vector<int> values = p.next_ints(header[1]);
+      suffix.values.assign(values.begin(), values.end());
+    }
+    sol.suffixes.push_back(suffix);
+  }
+}
+
+std::shared_ptr<SolFile> read_sol_from_string(const std::string &content) {
+  std::shared_ptr<SolFile> sol = std::make_shared<SolFile>();
+  if (is_binary_sol(content))
+    read_binary_sol(content, *sol);
+  else
+    read_text_sol(content, *sol);
+  return sol;
+}
+
+std::shared_ptr<SolFile> read_sol(std::string filename) {
+  std::ifstream in(filename, std::ios::in | std::ios::binary);
+  if (!in)
+    throw py::value_error("could not open " + filename);
+  std::string content((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+  return read_sol_from_string(content);
+}
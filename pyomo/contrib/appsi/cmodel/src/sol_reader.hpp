@@ -0,0 +1,60 @@
+/**___________________________________________________________________________
+ *
+ * Pyomo: Python Optimization Modeling Objects
+ * Copyright (c) 2008-2024
+ * National Technology and Engineering Solutions of Sandia, LLC
+ * Under the terms of Contract DE-NA0003525 with National Technology and
+ * Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+ * rights in this software.
+ * This software is distributed under the 3-clause BSD License.
+ * ___________________________________________________________________________
+**/
+
+#ifndef SOL_READER_HEADER
+#define SOL_READER_HEADER
+
+#include "common.hpp"
+#include <string>
+#include <vector>
+
+class SolSuffix;
+class SolFile;
+
+// The values of one suffix in a .sol file
+class SolSuffix {
+public:
+  SolSuffix() = default;
+  // 0: variables, 1: constraints, 2: objectives, 3: problem
+  int kind = 0;
+  bool is_real = false;
+  std::string name;
+  std::vector<int> indices;
+  std::vector<double> values;
+};
+
+// The content of a .sol file written by an AMPL solver. The duals and
+// primals are in the order of the constraints and variables in the NL file
+// (see NLWriter::get_solve_cons and NLWriter::get_solve_vars); they are
+// empty if the solver did not write them.
+class SolFile {
+public:
+  SolFile() = default;
+  std::string message;
+  std::vector<int> options;
+  int n_cons = 0;
+  int n_vars = 0;
+  std::vector<double> duals;
+  std::vector<double> primals;
+  int objno = 0;
+  // -1 if the file does not have an objno line
+  int solve_result_num = -1;
+  std::vector<SolSuffix> suffixes;
+  bool has_suffix(const std::string &name);
+  SolSuffix &get_suffix(const std::string &name);
+};
+
+// Reads a .sol file in either the text or the binary format.
+std::shared_ptr<SolFile> read_sol(std::string filename);
+std::shared_ptr<SolFile> read_sol_from_string(const std::string &content);
+
+#endif
@@ -0,0 +1,199 @@
+#  ___________________________________________________________________________
+#
+#  Pyomo: Python Optimization Modeling Objects
+#  Copyright (c) 2008-2024
+#  National Technology and Engineering Solutions of Sandia, LLC
+#  Under the terms of Contract DE-NA0003525 with National Technology and
+#  Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+#  rights in this software.
+#  This software is distributed under the 3-clause BSD License.
+#  ___________________________________________________________________________
+
+import ctypes
+import hashlib
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+from pyomo.common.envvar import PYOMO_CONFIG_DIR
+from pyomo.core.expr.visitor import identify_variables, identify_mutable_parameters
+from pyomo.contrib.appsi.cmodel import cmodel, cmodel_available
+
+
+# hash -> loaded library; kernels are never unloaded
+_loaded_kernels = dict()
+
+
+def default_cache_dir():
+    return os.path.join(PYOMO_CONFIG_DIR, 'appsi', 'codegen')
+
+
+def find_compiler():
+    cc = os.environ.get('CC', None)
+    if cc is not None:
+        return cc
+    for cc in ['cc', 'gcc', 'clang']:
+        if shutil.which(cc) is not None:
+            return cc
+    return None
+
+
+def _load_kernel(source, cache_dir, compiler):
+    if sys.platform.startswith('win'):
+        raise RuntimeError('Compiled expressions are not supported on Windows')
+    if compiler is None:
+        compiler = find_compiler()
+    if compiler is None:
+        raise RuntimeError('Could not find a C compiler')
+    cmd = [compiler, '-O2', '-shared', '-fPIC']
+
+    # the compile command is part of the key so that kernels built by
+    # different compilers do not collide
+    key = hashlib.sha256((' '.join(cmd) + '\n' + source).encode()).hexdigest()
+    if key in _loaded_kernels:
+        return _loaded_kernels[key]
+
+    if cache_dir is None:
+        cache_dir = default_cache_dir()
+    os.makedirs(cache_dir, exist_ok=True)
+    lib_path = os.path.join(cache_dir, key + '.so')
+    if not os.path.exists(lib_path):
+        tmpdir = tempfile.mkdtemp(dir=cache_dir)
+        try:
+            src_path = os.path.join(tmpdir, key + '.c')
+            tmp_lib_path = os.path.join(tmpdir, key + '.so')
+            with open(src_path, 'w') as f:
+                f.write(source)
+            res = subprocess.run(
+                cmd + ['-o', tmp_lib_path, src_path, '-lm'],
+                stdout=subprocess.PIPE,
+                stderr=subprocess.STDOUT,
+                universal_newlines=True,
+            )
+            if res.returncode != 0:
+                raise RuntimeError(
+                    'Failed to compile generated code:\n' + res.stdout
+                )
+            # atomic, so concurrent processes never load a partial file
+            os.replace(tmp_lib_path, lib_path)
+        finally:
+            shutil.rmtree(tmpdir, ignore_errors=True)
+
+    lib = ctypes.CDLL(lib_path)
+    c_double_p = ctypes.POINTER(ctypes.c_double)
+    lib.pyomo_kernel_value.argtypes = [c_double_p, c_double_p]
+    lib.pyomo_kernel_value.restype = ctypes.c_double
+    lib.pyomo_kernel_gradient.argtypes = [c_double_p, c_double_p, c_double_p]
+    lib.pyomo_kernel_gradient.restype = ctypes.c_double
+    lib.pyomo_kernel_bounds.argtypes = [
+        c_double_p,
+        c_double_p,
+        c_double_p,
+        c_double_p,
+        c_double_p,
+    ]
+    lib.pyomo_kernel_bounds.restype = None
+    _loaded_kernels[key] = lib
+    return lib
+
+
+class CompiledExpression(object):
+    """
+    A Pyomo expression compiled to native code.
+
+    C source for the value, the gradient (reverse mode), and interval
+    bounds of the expression is generated from the appsi expression,
+    compiled with the system C compiler into a shared library, and loaded
+    with ctypes. Libraries are cached on disk by a hash of the generated
+    source, which only depends on the structure of the expression (mutable
+    Params are arguments), so later processes reuse them without
+    recompiling.
+
+    Parameters
+    ----------
+    expr: pyomo expression
+    variables: list of VarData
+        The variables of the expression, in the order used for x, the
+        gradient, and the bounds. Defaults to identify_variables(expr).
+    params: list of ParamData
+        The mutable params of the expression, in the order used for p.
+        Defaults to identify_mutable_parameters(expr).
+    cache_dir: str
+        Directory for compiled kernels. Defaults to
+        <PYOMO_CONFIG_DIR>/appsi/codegen.
+    compiler: str
+        The C compiler. Defaults to $CC, then cc, gcc, or clang.
+    """
+
+    def __init__(
+        self, expr, variables=None, params=None, cache_dir=None, compiler=None
+    ):
+        if not cmodel_available:
+            raise RuntimeError('appsi extensions are not available')
+        if variables is None:
+            variables = list(identify_variables(expr, include_fixed=True))
+        if params is None:
+            params = list(identify_mutable_parameters(expr))
+        self.variables = list(variables)
+        self.params = list(params)
+
+        expr_types = cmodel.PyomoExprTypes()
+        cvars = cmodel.create_vars(len(self.variables))
+        cparams = cmodel.create_params(len(self.params))
+        var_map = dict()
+        param_map = dict()
+        for v, cv in zip(self.variables, cvars):
+            var_map[id(v)] = cv
+        for p, cp in zip(self.params, cparams):
+            cp.value = p.value
+            param_map[id(p)] = cp
+        cexpr = cmodel.appsi_expr_from_pyomo_expr(
+            expr, var_map, param_map, expr_types
+        )
+        self.source = cmodel.generate_c_code(cexpr, cvars, cparams)
+        self._lib = _load_kernel(self.source, cache_dir, compiler)
+
+    def _array(self, vals):
+        return (ctypes.c_double * len(vals))(*vals)
+
+    def _x(self, x):
+        if x is None:
+            x = [v.value for v in self.variables]
+        return self._array(x)
+
+    def _p(self, p):
+        if p is None:
+            p = [param.value for param in self.params]
+        return self._array(p)
+
+    def value(self, x=None, p=None):
+        """Value of the expression; x and p default to the current values"""
+        return self._lib.pyomo_kernel_value(self._x(x), self._p(p))
+
+    def gradient(self, x=None, p=None):
+        """Returns the value and the gradient (a list ordered like
+        self.variables)"""
+        g = (ctypes.c_double * len(self.variables))()
+        val = self._lib.pyomo_kernel_gradient(self._x(x), self._p(p), g)
+        return val, list(g)
+
+    def bounds(self, xl=None, xu=None, p=None):
+        """Interval bounds of the expression; xl and xu default to the
+        variable bounds"""
+        inf = float('inf')
+        if xl is None:
+            xl = [-inf if v.lb is None else v.lb for v in self.variables]
+        if xu is None:
+            xu = [inf if v.ub is None else v.ub for v in self.variables]
+        lb = ctypes.c_double()
+        ub = ctypes.c_double()
+        self._lib.pyomo_kernel_bounds(
+            self._array(xl),
+            self._array(xu),
+            self._p(p),
+            ctypes.byref(lb),
+            ctypes.byref(ub),
+        )
+        return lb.value, ub.value
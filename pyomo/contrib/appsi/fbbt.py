@@ -179,10 +179,12 @@ class IntervalTightener(PersistentBase):
         if self._symbolic_solver_labels:
             for c in cons:
                 self._symbol_map.removeSymbol(c)
+        ccons = list()
         for c in cons:
             cc = self._con_map.pop(c)
-            self._cmodel.remove_constraint(cc)
+            ccons.append(cc)
             del self._rcon_map[cc]
+        self._cmodel.remove_constraints(ccons)
 
     def _remove_sos_constraints(self, cons: List[SOSConstraintData]):
         if len(cons) != 0:
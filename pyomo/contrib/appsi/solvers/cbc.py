@@ -276,8 +276,6 @@ class Cbc(PersistentSolver):
         self._primal_sol = dict()
         self._reduced_costs = dict()
 
-        symbol_map = self._writer.symbol_map
-
         for line in all_lines[first_con_line : last_con_line + 1]:
             split_line = line.strip('*')
             split_line = split_line.split()
@@ -285,7 +283,7 @@ class Cbc(PersistentSolver):
             orig_name = name[:-3]
             if orig_name == 'obj_const_con':
                 continue
-            con = symbol_map.bySymbol[orig_name]
+            con = self._writer.get_con_from_row_name(name)
             dual_val = float(split_line[-1])
             if con in self._dual_sol:
                 if abs(dual_val) > abs(self._dual_sol[con]):
@@ -301,7 +299,7 @@ class Cbc(PersistentSolver):
                 continue
             val = float(split_line[2])
             rc = float(split_line[3])
-            var = symbol_map.bySymbol[name]
+            var = self._writer.get_var_from_name(name)
             self._primal_sol[id(var)] = (var, val)
             self._reduced_costs[id(var)] = (var, rc)
 
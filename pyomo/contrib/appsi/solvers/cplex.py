@@ -373,20 +373,29 @@ class Cplex(PersistentSolver):
                 'check the termination condition.'
             )
 
-        symbol_map = self._writer.symbol_map
-        if vars_to_load is None:
-            var_names = self._cplex_model.variables.get_names()
-        else:
-            var_names = [symbol_map.byObject[id(v)] for v in vars_to_load]
+        var_names = self._get_var_names(vars_to_load)
         var_vals = self._cplex_model.solution.get_values(var_names)
         res = ComponentMap()
         for name, val in zip(var_names, var_vals):
             if name == 'obj_const':
                 continue
-            v = symbol_map.bySymbol[name]
+            v = self._writer.get_var_from_name(name)
             if self._writer._referenced_variables[id(v)]:
                 res[v] = val
-        return res
+        return self._filter(res, vars_to_load)
+
+    def _get_var_names(self, vars_to_load):
+        # with compact labels the names of all variables are read and the
+        # result is filtered afterwards (see _filter)
+        if vars_to_load is None or self._writer.config.compact_labels:
+            return self._cplex_model.variables.get_names()
+        symbol_map = self._writer.symbol_map
+        return [symbol_map.byObject[id(v)] for v in vars_to_load]
+
+    def _filter(self, res, components):
+        if components is None or not self._writer.config.compact_labels:
+            return res
+        return type(res)((c, res[c]) for c in components if c in res)
 
     def get_duals(
         self, cons_to_load: Optional[Sequence[ConstraintData]] = None
@@ -409,7 +418,7 @@ class Cplex(PersistentSolver):
 
         symbol_map = self._writer.symbol_map
 
-        if cons_to_load is None:
+        if cons_to_load is None or self._writer.config.compact_labels:
             con_names = self._cplex_model.linear_constraints.get_names()
             dual_values = self._cplex_model.solution.get_dual_values()
         else:
@@ -430,14 +439,14 @@ class Cplex(PersistentSolver):
             orig_name = name[:-3]
             if orig_name == 'obj_const_con':
                 continue
-            _con = symbol_map.bySymbol[orig_name]
+            _con = self._writer.get_con_from_row_name(name)
             if _con in res:
                 if abs(val) > abs(res[_con]):
                     res[_con] = val
             else:
                 res[_con] = val
 
-        return res
+        return self._filter(res, cons_to_load)
 
     def get_reduced_costs(
         self, vars_to_load: Optional[Sequence[VarData]] = None
@@ -458,16 +467,12 @@ class Cplex(PersistentSolver):
         ]:
             raise RuntimeError('Cannot get reduced costs for mixed-integer problems')
 
-        symbol_map = self._writer.symbol_map
-        if vars_to_load is None:
-            var_names = self._cplex_model.variables.get_names()
-        else:
-            var_names = [symbol_map.byObject[id(v)] for v in vars_to_load]
+        var_names = self._get_var_names(vars_to_load)
         rc = self._cplex_model.solution.get_reduced_costs(var_names)
         res = ComponentMap()
         for name, val in zip(var_names, rc):
             if name == 'obj_const':
                 continue
-            v = symbol_map.bySymbol[name]
+            v = self._writer.get_var_from_name(name)
             res[v] = val
-        return res
+        return self._filter(res, vars_to_load)
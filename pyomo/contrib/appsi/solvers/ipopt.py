@@ -309,96 +309,41 @@ class Ipopt(PersistentSolver):
         solve_cons = self._writer.get_ordered_cons()
         results = Results()
 
-        f = open(self._filename + '.sol', 'r')
-        all_lines = list(f.readlines())
-        f.close()
+        sol = self._writer.read_sol(self._filename + '.sol')
 
-        termination_line = all_lines[1]
-        if 'Optimal Solution Found' in termination_line:
+        if 'Optimal Solution Found' in sol.message:
             results.termination_condition = TerminationCondition.optimal
-        elif 'Problem may be infeasible' in termination_line:
+        elif 'Problem may be infeasible' in sol.message:
             results.termination_condition = TerminationCondition.infeasible
-        elif 'problem might be unbounded' in termination_line:
+        elif 'problem might be unbounded' in sol.message:
             results.termination_condition = TerminationCondition.unbounded
-        elif 'Maximum Number of Iterations Exceeded' in termination_line:
+        elif 'Maximum Number of Iterations Exceeded' in sol.message:
             results.termination_condition = TerminationCondition.maxIterations
-        elif 'Maximum CPU Time Exceeded' in termination_line:
+        elif 'Maximum CPU Time Exceeded' in sol.message:
             results.termination_condition = TerminationCondition.maxTimeLimit
         else:
             results.termination_condition = TerminationCondition.unknown
 
-        n_cons = len(solve_cons)
-        n_vars = len(solve_vars)
-        dual_lines = all_lines[12 : 12 + n_cons]
-        primal_lines = all_lines[12 + n_cons : 12 + n_cons + n_vars]
-
-        rc_upper_info_line = all_lines[12 + n_cons + n_vars + 1]
-        assert rc_upper_info_line.startswith('suffix')
-        n_rc_upper = int(rc_upper_info_line.split()[2])
-        assert 'ipopt_zU_out' in all_lines[12 + n_cons + n_vars + 2]
-        upper_rc_lines = all_lines[
-            12 + n_cons + n_vars + 3 : 12 + n_cons + n_vars + 3 + n_rc_upper
-        ]
-
-        rc_lower_info_line = all_lines[12 + n_cons + n_vars + 3 + n_rc_upper]
-        assert rc_lower_info_line.startswith('suffix')
-        n_rc_lower = int(rc_lower_info_line.split()[2])
-        assert 'ipopt_zL_out' in all_lines[12 + n_cons + n_vars + 3 + n_rc_upper + 1]
-        lower_rc_lines = all_lines[
-            12
-            + n_cons
-            + n_vars
-            + 3
-            + n_rc_upper
-            + 2 : 12
-            + n_cons
-            + n_vars
-            + 3
-            + n_rc_upper
-            + 2
-            + n_rc_lower
-        ]
-
-        self._dual_sol = dict()
-        self._primal_sol = ComponentMap()
-        self._reduced_costs = ComponentMap()
-
-        for ndx, dual in enumerate(dual_lines):
-            dual = float(dual)
-            con = solve_cons[ndx]
-            self._dual_sol[con] = dual
-
-        for ndx, primal in enumerate(primal_lines):
-            primal = float(primal)
-            var = solve_vars[ndx]
-            self._primal_sol[var] = primal
-
-        for rcu_line in upper_rc_lines:
-            split_line = rcu_line.split()
-            var_ndx = int(split_line[0])
-            rcu = float(split_line[1])
-            var = solve_vars[var_ndx]
-            self._reduced_costs[var] = rcu
-
-        for rcl_line in lower_rc_lines:
-            split_line = rcl_line.split()
-            var_ndx = int(split_line[0])
-            rcl = float(split_line[1])
-            var = solve_vars[var_ndx]
-            if var in self._reduced_costs:
-                if abs(rcl) > abs(self._reduced_costs[var]):
-                    self._reduced_costs[var] = rcl
-            else:
-                self._reduced_costs[var] = rcl
-
-        for var in solve_vars:
-            if var not in self._reduced_costs:
-                self._reduced_costs[var] = 0
+        self._dual_sol = dict(zip(solve_cons, sol.duals.tolist()))
+        self._primal_sol = ComponentMap(zip(solve_vars, sol.primals.tolist()))
+
+        # use the larger (in absolute value) of the upper and lower bound
+        # multipliers
+        rc = [0] * len(solve_vars)
+        for suffix_name in ['ipopt_zU_out', 'ipopt_zL_out']:
+            if not sol.has_suffix(suffix_name):
+                continue
+            suffix = sol.get_suffix(suffix_name)
+            for var_ndx, val in zip(suffix.indices.tolist(), suffix.values.tolist()):
+                if abs(val) > abs(rc[var_ndx]):
+                    rc[var_ndx] = val
+        self._reduced_costs = ComponentMap(zip(solve_vars, rc))
 
         if (
             results.termination_condition == TerminationCondition.optimal
             and self.config.load_solution
         ):
+            self._writer.load_solution(sol)
             for v, val in self._primal_sol.items():
                 v.set_value(val, skip_validation=True)
             if self._writer.get_active_objective() is None:
@@ -53,6 +53,7 @@ qcp_solvers = [
     ('maingo', MAiNGO),
 ]
 miqcqp_solvers = [('gurobi', Gurobi), ('cplex', Cplex), ('maingo', MAiNGO)]
+lp_writer_solvers = [('cplex', Cplex), ('cbc', Cbc)]
 only_child_vars_options = [True, False]
 
 
@@ -545,6 +546,42 @@ class TestSolvers(unittest.TestCase):
             self.assertAlmostEqual(duals[m.c1], 0.5)
             self.assertNotIn(m.c2, duals)
 
+    @parameterized.expand(input=_load_tests(lp_writer_solvers, only_child_vars_options))
+    def test_compact_labels(
+        self, name: str, opt_class: Type[PersistentSolver], only_child_vars
+    ):
+        opt: PersistentSolver = opt_class(only_child_vars=only_child_vars)
+        if not opt.available():
+            raise unittest.SkipTest
+        opt.writer.config.compact_labels = True
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(-5, None))
+        m.y = pe.Var()
+        m.z = pe.Var(bounds=(0, None))
+        m.obj = pe.Objective(expr=m.y + m.z)
+        m.c1 = pe.Constraint(expr=m.y - m.x >= 0)
+        m.c2 = pe.Constraint(expr=m.y + m.x - 2 >= 0)
+
+        res = opt.solve(m)
+        self.assertAlmostEqual(res.best_feasible_objective, 1)
+        self.assertAlmostEqual(m.x.value, 1)
+        self.assertAlmostEqual(m.y.value, 1)
+        self.assertAlmostEqual(m.z.value, 0)
+        duals = opt.get_duals()
+        self.assertAlmostEqual(duals[m.c1], 0.5)
+        self.assertAlmostEqual(duals[m.c2], 0.5)
+        duals = opt.get_duals(cons_to_load=[m.c1])
+        self.assertAlmostEqual(duals[m.c1], 0.5)
+        self.assertNotIn(m.c2, duals)
+        rc = opt.get_reduced_costs()
+        self.assertAlmostEqual(rc[m.z], 1)
+        rc = opt.get_reduced_costs(vars_to_load=[m.z])
+        self.assertAlmostEqual(rc[m.z], 1)
+        self.assertNotIn(m.x, rc)
+        primals = opt.get_primals(vars_to_load=[m.y])
+        self.assertAlmostEqual(primals[m.y], 1)
+        self.assertNotIn(m.x, primals)
+
     @parameterized.expand(input=_load_tests(qcp_solvers, only_child_vars_options))
     def test_mutable_quadratic_coefficient(
         self, name: str, opt_class: Type[PersistentSolver], only_child_vars
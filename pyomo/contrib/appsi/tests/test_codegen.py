@@ -0,0 +1,71 @@
+#  ___________________________________________________________________________
+#
+#  Pyomo: Python Optimization Modeling Objects
+#  Copyright (c) 2008-2024
+#  National Technology and Engineering Solutions of Sandia, LLC
+#  Under the terms of Contract DE-NA0003525 with National Technology and
+#  Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+#  rights in this software.
+#  This software is distributed under the 3-clause BSD License.
+#  ___________________________________________________________________________
+
+import math
+import os
+import sys
+
+from pyomo.common import unittest
+from pyomo.common.tempfiles import TempfileManager
+import pyomo.environ as pyo
+from pyomo.contrib.appsi.cmodel import cmodel_available
+from pyomo.contrib.appsi.codegen import CompiledExpression, find_compiler
+
+
+@unittest.skipUnless(cmodel_available, 'appsi extensions are not available')
+@unittest.skipIf(find_compiler() is None, 'no C compiler available')
+@unittest.skipIf(sys.platform.startswith('win'), 'not supported on Windows')
+class TestCompiledExpression(unittest.TestCase):
+    def setUp(self):
+        TempfileManager.push()
+        self.cache_dir = TempfileManager.create_tempdir()
+
+    def tearDown(self):
+        TempfileManager.pop()
+
+    def test_value_gradient_bounds(self):
+        m = pyo.ConcreteModel()
+        m.x = pyo.Var(bounds=(0, 1), initialize=0.5)
+        m.y = pyo.Var(bounds=(0, 2), initialize=1)
+        m.p = pyo.Param(mutable=True, initialize=3)
+        e = m.x * m.y + pyo.exp(m.x) + m.y**m.p + 2 * m.p * m.x + m.y - 1.5
+        ce = CompiledExpression(e, [m.x, m.y], [m.p], cache_dir=self.cache_dir)
+        self.assertAlmostEqual(ce.value(), pyo.value(e))
+        val, g = ce.gradient()
+        self.assertAlmostEqual(val, pyo.value(e))
+        self.assertAlmostEqual(g[0], 1 + math.exp(0.5) + 6)
+        self.assertAlmostEqual(g[1], 0.5 + 3 + 1)
+        lb, ub = ce.bounds()
+        self.assertAlmostEqual(lb, -0.5)
+        self.assertAlmostEqual(ub, 2 + math.e + 8 + 6 + 2 - 1.5)
+
+        # params are arguments of the kernel
+        m.p.value = 2
+        self.assertAlmostEqual(ce.value(), pyo.value(e))
+        self.assertAlmostEqual(ce.value(x=[1, 2]), 2 + math.e + 4 + 4 + 2 - 1.5)
+
+    def test_cache(self):
+        m = pyo.ConcreteModel()
+        m.x = pyo.Var(initialize=2)
+        m.y = pyo.Var(initialize=3)
+        ce1 = CompiledExpression(pyo.log(m.x) * m.y, cache_dir=self.cache_dir)
+        self.assertEqual(
+            len([f for f in os.listdir(self.cache_dir) if f.endswith('.so')]), 1
+        )
+        # the same structure reuses the cached kernel
+        ce2 = CompiledExpression(
+            pyo.log(m.y) * m.x, [m.y, m.x], cache_dir=self.cache_dir
+        )
+        self.assertEqual(
+            len([f for f in os.listdir(self.cache_dir) if f.endswith('.so')]), 1
+        )
+        self.assertEqual(ce1.source, ce2.source)
+        self.assertAlmostEqual(ce2.value(), math.log(3) * 2)
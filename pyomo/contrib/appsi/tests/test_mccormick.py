@@ -0,0 +1,121 @@
+#  ___________________________________________________________________________
+#
+#  Pyomo: Python Optimization Modeling Objects
+#  Copyright (c) 2008-2024
+#  National Technology and Engineering Solutions of Sandia, LLC
+#  Under the terms of Contract DE-NA0003525 with National Technology and
+#  Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+#  rights in this software.
+#  This software is distributed under the 3-clause BSD License.
+#  ___________________________________________________________________________
+
+from pyomo.common import unittest
+from pyomo.common.dependencies import numpy as np, numpy_available
+import pyomo.environ as pyo
+from pyomo.contrib.appsi.cmodel import cmodel, cmodel_available
+import math
+
+
+def _relaxation(expr, variables):
+    expr_types = cmodel.PyomoExprTypes()
+    var_map = dict()
+    cvars = list()
+    for v in variables:
+        cv = cmodel.Var(v.name, v.value)
+        cv.lb = cmodel.Constant(v.lb)
+        cv.ub = cmodel.Constant(v.ub)
+        var_map[id(v)] = cv
+        cvars.append(cv)
+    cexpr = cmodel.appsi_expr_from_pyomo_expr(expr, var_map, dict(), expr_types)
+    return cmodel.McCormickRelaxation(cexpr, cvars)
+
+
+@unittest.skipUnless(cmodel_available, 'appsi extensions are not available')
+class TestMcCormick(unittest.TestCase):
+    def test_product(self):
+        m = pyo.ConcreteModel()
+        m.x = pyo.Var(bounds=(-1, 2), initialize=0.5)
+        m.y = pyo.Var(bounds=(0, 3), initialize=1)
+        r = _relaxation(m.x * m.y, [m.x, m.y])
+        r.evaluate(1e-8, 1e-5)
+        self.assertAlmostEqual(r.lb, -3)
+        self.assertAlmostEqual(r.ub, 6)
+        self.assertAlmostEqual(r.cv, -1)
+        self.assertAlmostEqual(r.cc, 2)
+        self.assertAlmostEqual(r.cv_subgradient[0], 0)
+        self.assertAlmostEqual(r.cv_subgradient[1], -1)
+        self.assertAlmostEqual(r.cc_subgradient[0], 0)
+        self.assertAlmostEqual(r.cc_subgradient[1], 2)
+
+    def test_exp_plus_product(self):
+        m = pyo.ConcreteModel()
+        m.x = pyo.Var(bounds=(-1, 2), initialize=0.5)
+        m.y = pyo.Var(bounds=(0, 3), initialize=1)
+        r = _relaxation(m.x * m.y + pyo.exp(m.x), [m.x, m.y])
+        r.evaluate(1e-8, 1e-5)
+        slope = (math.exp(2) - math.exp(-1)) / 3
+        self.assertAlmostEqual(r.cv, -1 + math.exp(0.5))
+        self.assertAlmostEqual(r.cc, 2 + math.exp(-1) + slope * 1.5)
+        self.assertAlmostEqual(r.cv_subgradient[0], math.exp(0.5))
+        self.assertAlmostEqual(r.cc_subgradient[0], slope)
+
+    def test_relaxation_is_valid(self):
+        m = pyo.ConcreteModel()
+        m.x = pyo.Var(bounds=(0.5, 4))
+        m.y = pyo.Var(bounds=(-2, 1))
+        e = m.x**2 * m.y - pyo.log(m.x) + m.y / m.x + pyo.sqrt(m.x)
+        for xval in [0.5, 1, 2.5, 4]:
+            for yval in [-2, -0.5, 0, 1]:
+                m.x.value = xval
+                m.y.value = yval
+                r = _relaxation(e, [m.x, m.y])
+                r.evaluate(1e-8, 1e-5)
+                val = pyo.value(e)
+                self.assertLessEqual(r.lb, r.cv + 1e-8)
+                self.assertLessEqual(r.cv, val + 1e-8)
+                self.assertLessEqual(val, r.cc + 1e-8)
+                self.assertLessEqual(r.cc, r.ub + 1e-8)
+
+    def test_fallback_to_bounds(self):
+        m = pyo.ConcreteModel()
+        m.x = pyo.Var(bounds=(0, 1), initialize=0.5)
+        r = _relaxation(pyo.sin(m.x), [m.x])
+        r.evaluate(1e-8, 1e-5)
+        self.assertAlmostEqual(r.cv, r.lb)
+        self.assertAlmostEqual(r.cc, r.ub)
+        self.assertEqual(list(r.cv_subgradient), [0])
+        self.assertEqual(list(r.cc_subgradient), [0])
+
+    @unittest.skipUnless(numpy_available, 'numpy is not available')
+    def test_subgradient_arrays(self):
+        m = pyo.ConcreteModel()
+        m.x = pyo.Var(bounds=(-1, 2), initialize=0.5)
+        m.y = pyo.Var(bounds=(0, 3), initialize=1)
+        r = _relaxation(m.x * m.y, [m.x, m.y])
+        cv_sub = r.cv_subgradient
+        cc_sub = r.cc_subgradient
+        self.assertIsInstance(cv_sub, np.ndarray)
+        self.assertEqual(cv_sub.dtype, np.float64)
+        self.assertEqual(cv_sub.tolist(), [0, 0])
+        # the arrays share memory with the relaxation, so they are updated
+        # by the evaluation
+        r.evaluate(1e-8, 1e-5)
+        self.assertEqual(cv_sub.tolist(), [0, -1])
+        self.assertEqual(cc_sub.tolist(), [0, 2])
+
+    def test_evaluate_from_bounds(self):
+        m = pyo.ConcreteModel()
+        m.x = pyo.Var(bounds=(-1, 2), initialize=0.5)
+        m.y = pyo.Var(bounds=(0, 3), initialize=1)
+        r = _relaxation(m.x * m.y, [m.x, m.y])
+        self.assertEqual(r.n_operators, 1)
+        # the bounds of the product (e.g., from FBBT) are used as given
+        r.evaluate_from_bounds([-2], [5])
+        self.assertAlmostEqual(r.lb, -2)
+        self.assertAlmostEqual(r.ub, 5)
+        self.assertAlmostEqual(r.cv, -1)
+        self.assertAlmostEqual(r.cc, 2)
+        self.assertEqual(list(r.cv_subgradient), [0, -1])
+        self.assertEqual(list(r.cc_subgradient), [0, 2])
+        with self.assertRaisesRegex(ValueError, 'bounds of 1 operators'):
+            r.evaluate_from_bounds([-2, 0], [5, 1])
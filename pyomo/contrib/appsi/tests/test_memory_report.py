@@ -0,0 +1,101 @@
+#  ___________________________________________________________________________
+#
+#  Pyomo: Python Optimization Modeling Objects
+#  Copyright (c) 2008-2024
+#  National Technology and Engineering Solutions of Sandia, LLC
+#  Under the terms of Contract DE-NA0003525 with National Technology and
+#  Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+#  rights in this software.
+#  This software is distributed under the 3-clause BSD License.
+#  ___________________________________________________________________________
+
+from pyomo.common import unittest
+from pyomo.common.tempfiles import TempfileManager
+import pyomo.environ as pe
+from pyomo.contrib import appsi
+from pyomo.contrib.appsi.cmodel import cmodel, cmodel_available
+from pyomo.contrib.appsi.utils import python_memory_report
+
+
+@unittest.skipUnless(cmodel_available, 'appsi extensions are not available')
+class TestMemoryReport(unittest.TestCase):
+    def test_categories(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var(range(3), bounds=(-1, 1))
+        m.p = pe.Param(initialize=2, mutable=True)
+        m.c1 = pe.Constraint(expr=m.x[0] * m.x[1] + pe.exp(m.x[2]) <= m.p)
+        m.c2 = pe.Constraint(expr=m.x[0] + m.p * m.x[2] >= 0)
+        it = appsi.fbbt.IntervalTightener()
+        it.set_instance(m)
+        report = it._cmodel.memory_report()
+        for category in [
+            'constraints',
+            'control_blocks',
+            'allocator_overhead',
+            'fbbt_bounds',
+            'incidence',
+            'nodes.Var',
+            'nodes.MultiplyOperator',
+            'nodes.ExpOperator',
+        ]:
+            self.assertIn(category, report)
+        self.assertTrue(all(v > 0 for v in report.values()))
+
+        m.c3 = pe.Constraint(expr=m.x[1] ** 2 <= 1)
+        it.add_constraints([m.c3])
+        new_report = it._cmodel.memory_report()
+        self.assertIn('nodes.PowerOperator', new_report)
+        self.assertGreater(new_report['fbbt_bounds'], report['fbbt_bounds'])
+
+        writer = appsi.writers.LPWriter()
+        writer.set_instance(m)
+        self.assertIn('terms', writer._writer.memory_report())
+        self.assertEqual(cmodel.LPWriter().memory_report(), {})
+
+    def _lp_model(self, n_vars, n_cons):
+        # every constraint has 10 terms with constant coefficients
+        m = pe.ConcreteModel()
+        m.x = pe.Var(range(n_vars), bounds=(0, 1))
+        m.c = pe.Constraint(
+            range(n_cons),
+            rule=lambda m, i: sum(
+                (i % 7 + j) * m.x[(i * 13 + j * 101) % n_vars] for j in range(10)
+            )
+            <= i,
+        )
+        writer = appsi.writers.LPWriter()
+        writer.set_instance(m)
+        return writer
+
+    def test_scaling(self):
+        # every constraint and var adds the same number of bytes to the
+        # terms and vars (the objective adds a constant)
+        writers = [self._lp_model(500 * k, 1000 * k) for k in range(1, 4)]
+        reports = [w._writer.memory_report() for w in writers]
+        report1 = reports[0]
+        self.assertGreater(report1['terms'], report1['nodes.Var'])
+        for category in ['terms', 'nodes.Var']:
+            n1, n2, n3 = [r[category] for r in reports]
+            self.assertEqual(n3 - n2, n2 - n1)
+            self.assertGreater(n2, n1)
+
+        # the nodes shared by the constraints are shared by the constraints
+        # of a loaded snapshot as well, so they are counted the same way
+        cvars = list(writers[0]._pyomo_var_to_solver_var_map.values())
+        with TempfileManager:
+            fname = TempfileManager.create_tempfile(suffix='.snapshot')
+            cmodel.save_snapshot(writers[0]._writer, fname, cvars, [])
+            new_writer = cmodel.LPWriter()
+            cmodel.load_snapshot(new_writer, fname)
+        new_report = new_writer.memory_report()
+        for category in ['nodes.Var', 'nodes.Constant']:
+            self.assertEqual(new_report[category], report1[category])
+
+    def test_python_maps(self):
+        writer = self._lp_model(500, 1000)
+        report = python_memory_report(writer)
+        n_entries, n_bytes = report['_pyomo_var_to_solver_var_map']
+        self.assertEqual(n_entries, 500)
+        self.assertGreater(n_bytes, 0)
+        self.assertEqual(report['_pyomo_con_to_solver_con_map'][0], 1000)
+        self.assertEqual(report['_symbol_map'][0], 1500)
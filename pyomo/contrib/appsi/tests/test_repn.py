@@ -0,0 +1,158 @@
+#  ___________________________________________________________________________
+#
+#  Pyomo: Python Optimization Modeling Objects
+#  Copyright (c) 2008-2024
+#  National Technology and Engineering Solutions of Sandia, LLC
+#  Under the terms of Contract DE-NA0003525 with National Technology and
+#  Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+#  rights in this software.
+#  This software is distributed under the 3-clause BSD License.
+#  ___________________________________________________________________________
+
+from pyomo.common import unittest
+from pyomo.common.tempfiles import TempfileManager
+import pyomo.environ as pe
+from pyomo.contrib import appsi
+from pyomo.repn.standard_repn import generate_standard_repn
+from pyomo.contrib.appsi.cmodel import cmodel, cmodel_available
+
+
+@unittest.skipUnless(cmodel_available, 'appsi extensions are not available')
+class TestStandardRepn(unittest.TestCase):
+    def setUp(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var(initialize=1.5)
+        m.y = pe.Var(initialize=2)
+        m.z = pe.Var(initialize=0.5)
+        m.w = pe.Var(initialize=3)
+        m.w.fix()
+        m.p = pe.Param(initialize=2, mutable=True)
+        m.q = pe.Param(initialize=-3, mutable=True)
+        m.r = pe.Param(initialize=4)
+        m.e = pe.Expression(expr=m.x + m.p * m.y)
+        self.m = m
+        self.var_map = dict()
+        for v in [m.x, m.y, m.z, m.w]:
+            self.var_map[id(v)] = cmodel.Var(v.name)
+        self.param_map = dict()
+        for p in [m.p, m.q]:
+            self.param_map[id(p)] = cmodel.Param(p.name)
+        self.expr_types = cmodel.PyomoExprTypes()
+
+    def _update_values(self):
+        for v in [self.m.x, self.m.y, self.m.z, self.m.w]:
+            self.var_map[id(v)].value = v.value
+        for p in [self.m.p, self.m.q]:
+            self.param_map[id(p)].value = p.value
+
+    def _check(self, expr, quadratic):
+        repn = cmodel.generate_standard_repn(
+            expr, self.var_map, self.param_map, self.expr_types, quadratic
+        )
+        expected = generate_standard_repn(
+            expr, compute_values=False, quadratic=quadratic
+        )
+        self.assertEqual(
+            len(repn.linear_vars), len(set(v.name for v in repn.linear_vars))
+        )
+        quad_keys = [
+            frozenset((v1.name, v2.name))
+            for v1, v2 in zip(repn.quadratic_vars_1, repn.quadratic_vars_2)
+        ]
+        self.assertEqual(len(quad_keys), len(set(quad_keys)))
+        # the coefficients are expressions of the parameters and fixed
+        # variables, so they are compared for several values
+        for p_val, w_val in [(2, 3), (0.5, -1.25)]:
+            self.m.p.value = p_val
+            self.m.w.value = w_val
+            self._update_values()
+            self.assertAlmostEqual(
+                repn.constant.evaluate(), pe.value(expected.constant)
+            )
+            linear = {
+                v.name: c.evaluate()
+                for v, c in zip(repn.linear_vars, repn.linear_coefs)
+            }
+            expected_linear = dict()
+            for v, c in zip(expected.linear_vars, expected.linear_coefs):
+                expected_linear[v.name] = expected_linear.get(v.name, 0) + pe.value(c)
+            self.assertEqual(set(linear), set(expected_linear))
+            for k, val in expected_linear.items():
+                self.assertAlmostEqual(linear[k], val)
+            quad = {k: c.evaluate() for k, c in zip(quad_keys, repn.quadratic_coefs)}
+            expected_quad = dict()
+            if quadratic:
+                for (v1, v2), c in zip(
+                    expected.quadratic_vars, expected.quadratic_coefs
+                ):
+                    k = frozenset((v1.name, v2.name))
+                    expected_quad[k] = expected_quad.get(k, 0) + pe.value(c)
+            expected_quad = {k: c for k, c in expected_quad.items() if c != 0}
+            self.assertEqual(set(quad), set(expected_quad))
+            for k, val in expected_quad.items():
+                self.assertAlmostEqual(quad[k], val)
+            nonlinear = repn.get_nonlinear_expr(
+                self.var_map, self.param_map, self.expr_types
+            )
+            if expected.nonlinear_expr is None:
+                self.assertIsNone(nonlinear)
+            else:
+                self.assertAlmostEqual(
+                    nonlinear.evaluate(), pe.value(expected.nonlinear_expr)
+                )
+
+    def test_repn(self):
+        m = self.m
+        exprs = [
+            m.x,
+            m.w,
+            m.p,
+            3.5,
+            2 * m.x + 3 * m.y - m.x + m.p * m.x + 4,
+            m.x - m.x + m.y,
+            sum(i * m.x + m.p * m.y for i in range(4)),
+            -(m.x + m.q * m.y) + m.w * m.x + m.w**2 + 3 * m.w,
+            (m.x + m.p * m.y + 1) * (2 * m.x - m.y),
+            m.p * (m.x + m.y) ** 2,
+            m.x * m.y * m.z,
+            m.x**3 + m.x ** (m.r / 2) + m.y**m.p + m.x**1 + m.y**0,
+            pe.exp(m.x) + m.p * pe.log(m.y) + pe.log(m.p) * m.z + pe.exp(m.w),
+            (m.x + 1) / m.p + m.y / (m.w + 2) + m.z / m.x,
+            2 * m.e + m.e**2 - m.p * m.e * m.z,
+            (m.x + m.y) * (m.p + m.w) + (m.p - 2) * (m.x**2 + 1),
+            abs(m.x) + m.r * m.z,
+        ]
+        for quadratic in [True, False]:
+            for e in exprs:
+                with self.subTest(expr=str(e), quadratic=quadratic):
+                    self._check(e, quadratic)
+
+    def test_lp_writer(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(-1, 2))
+        m.y = pe.Var(bounds=(0, 3))
+        m.p = pe.Param(initialize=2, mutable=True)
+        m.obj = pe.Objective(expr=m.x * m.y + 2 * m.y)
+        m.c1 = pe.Constraint(expr=m.x + m.p * m.y + m.x >= 1)
+        writer = appsi.writers.LPWriter()
+        writer.config.symbolic_solver_labels = True
+
+        def write():
+            with TempfileManager:
+                fname = TempfileManager.create_tempfile(suffix='.appsi.lp')
+                writer.write(m, fname)
+                with open(fname, 'r') as f:
+                    return f.read().splitlines()
+
+        # duplicate terms are merged
+        lines = write()
+        ndx = lines.index('c1_lb: ')
+        self.assertEqual(lines[ndx + 1 : ndx + 3], ['+2 x ', '+2 y '])
+        m.p.value = -5
+        lines = write()
+        ndx = lines.index('c1_lb: ')
+        self.assertEqual(lines[ndx + 1 : ndx + 3], ['+2 x ', '-5 y '])
+
+        m.c2 = pe.Constraint(expr=pe.exp(m.x) <= 1)
+        with self.assertRaisesRegex(ValueError, 'nonlinear constraint'):
+            write()
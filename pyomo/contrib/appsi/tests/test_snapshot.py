@@ -0,0 +1,147 @@
+#  ___________________________________________________________________________
+#
+#  Pyomo: Python Optimization Modeling Objects
+#  Copyright (c) 2008-2024
+#  National Technology and Engineering Solutions of Sandia, LLC
+#  Under the terms of Contract DE-NA0003525 with National Technology and
+#  Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+#  rights in this software.
+#  This software is distributed under the 3-clause BSD License.
+#  ___________________________________________________________________________
+
+from pyomo.common import unittest
+from pyomo.common.tempfiles import TempfileManager
+import pyomo.environ as pe
+from pyomo.contrib import appsi
+from pyomo.contrib.appsi.cmodel import cmodel, cmodel_available
+
+
+@unittest.skipUnless(cmodel_available, 'appsi extensions are not available')
+class TestSnapshot(unittest.TestCase):
+    def _save_and_load(self, cmodel_obj, new_model, var_map, param_map):
+        cvars = list(var_map.values())
+        cparams = list(param_map.values())
+        with TempfileManager:
+            fname = TempfileManager.create_tempfile(suffix='.snapshot')
+            cmodel.save_snapshot(cmodel_obj, fname, cvars, cparams)
+            new_vars, new_params = cmodel.load_snapshot(new_model, fname)
+        # the vars and params come back in the order they were passed in,
+        # followed by any others the model references
+        self.assertEqual(
+            [v.name for v in new_vars[: len(cvars)]], [v.name for v in cvars]
+        )
+        self.assertEqual(
+            [p.name for p in new_params[: len(cparams)]], [p.name for p in cparams]
+        )
+        return dict(zip(var_map, new_vars)), dict(zip(param_map, new_params))
+
+    def test_fbbt_model(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(-2, 3))
+        m.y = pe.Var(bounds=(1, 4))
+        m.z = pe.Var()
+        m.w = pe.Var()
+        m.p = pe.Param(initialize=2, mutable=True)
+        m.e = pe.Expression(expr=m.x * m.y)
+        m.c1 = pe.Constraint(expr=m.e + pe.exp(m.z) <= 5)
+        m.c2 = pe.Constraint(expr=m.w == m.p * m.e - pe.log(m.y) + abs(m.x))
+        m.c3 = pe.Constraint(expr=m.w**2 <= m.p * 10)
+        it = appsi.fbbt.IntervalTightener()
+        it.set_instance(m, symbolic_solver_labels=True)
+
+        new_model = cmodel.FBBTModel()
+        new_vars, new_params = self._save_and_load(
+            it._cmodel, new_model, it._var_map, it._param_map
+        )
+        self.assertEqual(len(new_model.constraints), 3)
+        it.perform_fbbt(m)
+        new_model.perform_fbbt(
+            it.config.feasibility_tol,
+            it.config.integer_tol,
+            it.config.improvement_tol,
+            it.config.max_iter,
+            it.config.deactivate_satisfied_constraints,
+        )
+        for v in [m.x, m.y, m.z, m.w]:
+            cv = new_vars[id(v)]
+            self.assertAlmostEqual(cv.get_lb(), v.lb if v.has_lb() else -cmodel.inf)
+            self.assertAlmostEqual(cv.get_ub(), v.ub if v.has_ub() else cmodel.inf)
+
+    def test_lp_writer(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var(range(4), bounds=(0, 5))
+        m.y = pe.Var(domain=pe.Integers, bounds=(-3, 3))
+        m.p = pe.Param(initialize=2, mutable=True)
+        m.obj = pe.Objective(expr=m.x[0] * m.y + m.p * m.x[1], sense=pe.maximize)
+        m.c1 = pe.Constraint(expr=m.p * m.x[0] + m.x[1] <= m.p + 1)
+        m.c2 = pe.Constraint(expr=(1, m.x[2] - m.x[3] + m.y, 4))
+        m.c3 = pe.Constraint(expr=m.x[0] * m.x[1] + m.x[3] >= -1)
+        writer = appsi.writers.LPWriter()
+        writer.config.symbolic_solver_labels = True
+
+        def write(w):
+            with TempfileManager:
+                fname = TempfileManager.create_tempfile(suffix='.lp')
+                if isinstance(w, cmodel.LPWriter):
+                    w.write(fname)
+                else:
+                    w.write(m, fname)
+                with open(fname, 'r') as f:
+                    return f.read()
+
+        expected = write(writer)
+        new_writer = cmodel.LPWriter()
+        new_vars, new_params = self._save_and_load(
+            writer._writer,
+            new_writer,
+            writer._pyomo_var_to_solver_var_map,
+            writer._pyomo_param_to_solver_param_map,
+        )
+        self.assertEqual(write(new_writer), expected)
+
+        # the params of the loaded model are updated through the new map
+        m.p.value = -4
+        new_params[id(m.p)].value = m.p.value
+        self.assertEqual(write(new_writer), write(writer))
+
+        with TempfileManager:
+            fname = TempfileManager.create_tempfile(suffix='.snapshot')
+            cmodel.save_snapshot(new_writer, fname, [], [])
+            with self.assertRaisesRegex(ValueError, 'LPWriter'):
+                cmodel.load_snapshot(cmodel.FBBTModel(), fname)
+            with self.assertRaisesRegex(ValueError, 'with constraints'):
+                cmodel.load_snapshot(new_writer, fname)
+            with open(fname, 'rb') as f:
+                content = f.read()
+            with open(fname, 'wb') as f:
+                f.write(content[: len(content) // 2])
+            with self.assertRaisesRegex(ValueError, 'unexpected end of file'):
+                cmodel.load_snapshot(cmodel.LPWriter(), fname)
+            with open(fname, 'w') as f:
+                f.write(expected)
+            with self.assertRaisesRegex(ValueError, 'not a cmodel snapshot'):
+                cmodel.load_snapshot(cmodel.LPWriter(), fname)
+        with self.assertRaisesRegex(ValueError, 'only supported'):
+            cmodel.save_snapshot(cmodel.NLWriter(), 'unused.snapshot', [], [])
+
+    def test_vars_not_passed(self):
+        # a var the model references but that was not passed to save_snapshot
+        # does not shift the positions of the ones that were
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(-2, 3))
+        m.y = pe.Var(bounds=(1, 4))
+        m.z = pe.Var()
+        m.p = pe.Param(initialize=2, mutable=True)
+        m.c1 = pe.Constraint(expr=m.x * m.y + pe.exp(m.z) <= 5)
+        m.c2 = pe.Constraint(expr=m.p * m.x - m.z >= -1)
+        it = appsi.fbbt.IntervalTightener()
+        it.set_instance(m, symbolic_solver_labels=True)
+
+        cvars = [it._var_map[id(v)] for v in [m.z, m.x, m.z]]
+        with TempfileManager:
+            fname = TempfileManager.create_tempfile(suffix='.snapshot')
+            cmodel.save_snapshot(it._cmodel, fname, cvars, [])
+            new_vars, new_params = cmodel.load_snapshot(cmodel.FBBTModel(), fname)
+        self.assertEqual([v.name for v in new_vars], ['z', 'x', 'z', 'y'])
+        self.assertIs(new_vars[0], new_vars[2])
+        self.assertEqual([p.name for p in new_params], ['p'])
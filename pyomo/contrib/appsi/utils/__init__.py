@@ -11,3 +11,4 @@
 
 from .get_objective import get_objective
 from .collect_vars_and_named_exprs import collect_vars_and_named_exprs
+from .python_memory_report import python_memory_report
@@ -0,0 +1,38 @@
+#  ___________________________________________________________________________
+#
+#  Pyomo: Python Optimization Modeling Objects
+#  Copyright (c) 2008-2024
+#  National Technology and Engineering Solutions of Sandia, LLC
+#  Under the terms of Contract DE-NA0003525 with National Technology and
+#  Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+#  rights in this software.
+#  This software is distributed under the 3-clause BSD License.
+#  ___________________________________________________________________________
+
+
+import sys
+
+from pyomo.core.base import SymbolMap
+
+
+def python_memory_report(obj):
+    """
+    Report the maps that the Python side of an appsi interface (e.g., an
+    LPWriter or an IntervalTightener) keeps between the Pyomo components
+    and the cmodel objects. Model.memory_report() of the cmodel model does
+    not include them.
+
+    Returns a dict from the name of each attribute of obj that is a dict or
+    a SymbolMap to a tuple with the number of entries and the approximate
+    number of bytes. Only the hash tables are counted (sys.getsizeof), not
+    the keys and values they refer to (e.g., the Pyomo components or the
+    Python objects that wrap the cmodel nodes).
+    """
+    res = dict()
+    for name, val in vars(obj).items():
+        if isinstance(val, dict):
+            res[name] = (len(val), sys.getsizeof(val))
+        elif isinstance(val, SymbolMap):
+            tables = [val.byObject, val.bySymbol, val.aliases]
+            res[name] = (len(val.byObject), sum(sys.getsizeof(d) for d in tables))
+    return res
@@ -13,3 +13,28 @@
 class WriterConfig(object):
     def __init__(self):
         self.symbolic_solver_labels = False
+
+
+class NLWriterConfig(WriterConfig):
+    def __init__(self):
+        super().__init__()
+        # write the NL file in the binary format instead of the text format
+        self.binary = False
+        # the number of threads used to format the segments of the file;
+        # 0 means one per core
+        self.n_threads = 1
+        # write each segment straight to the file instead of caching the
+        # segments between writes (uses less memory; ignores n_threads)
+        self.streaming = False
+
+
+class LPWriterConfig(WriterConfig):
+    def __init__(self):
+        super().__init__()
+        # the number of threads used to format the rows of the file;
+        # 0 means one per core
+        self.n_threads = 1
+        # write the variables as x<i> and the constraints as c<i> (i is the
+        # position in get_vars() and get_ordered_cons()) instead of creating
+        # a name for each component
+        self.compact_labels = False
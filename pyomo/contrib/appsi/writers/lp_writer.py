@@ -16,20 +16,19 @@ from pyomo.core.base.constraint import ConstraintData
 from pyomo.core.base.objective import ObjectiveData
 from pyomo.core.base.sos import SOSConstraintData
 from pyomo.core.base.block import BlockData
-from pyomo.repn.standard_repn import generate_standard_repn
 from pyomo.core.expr.numvalue import value
 from pyomo.contrib.appsi.base import PersistentBase
 from pyomo.core.base import SymbolMap, NumericLabeler, TextLabeler
 from pyomo.common.timing import HierarchicalTimer
 from pyomo.core.kernel.objective import minimize, maximize
-from .config import WriterConfig
+from .config import LPWriterConfig
 from ..cmodel import cmodel, cmodel_available
 
 
 class LPWriter(PersistentBase):
     def __init__(self, only_child_vars=False):
         super(LPWriter, self).__init__(only_child_vars=only_child_vars)
-        self._config = WriterConfig()
+        self._config = LPWriterConfig()
         self._writer = None
         self._symbol_map = SymbolMap()
         self._var_labeler = None
@@ -42,13 +41,14 @@ class LPWriter(PersistentBase):
         self._solver_con_to_pyomo_con_map = dict()
         self._pyomo_param_to_solver_param_map = dict()
         self._expr_types = None
+        self._compact_labels = False
 
     @property
     def config(self):
         return self._config
 
     @config.setter
-    def config(self, val: WriterConfig):
+    def config(self, val: LPWriterConfig):
         self._config = val
 
     def set_instance(self, model):
@@ -59,8 +59,12 @@ class LPWriter(PersistentBase):
         self.update_config = saved_update_config
         self._model = model
         self._expr_types = cmodel.PyomoExprTypes()
+        self._compact_labels = self.config.compact_labels
 
-        if self.config.symbolic_solver_labels:
+        if self._compact_labels:
+            # the writer generates the labels; the components are not named
+            pass
+        elif self.config.symbolic_solver_labels:
             self._var_labeler = TextLabeler()
             self._con_labeler = TextLabeler()
             self._param_labeler = TextLabeler()
@@ -85,7 +89,7 @@ class LPWriter(PersistentBase):
             self._pyomo_param_to_solver_param_map,
             self._vars,
             self._solver_var_to_pyomo_var_map,
-            True,
+            self._var_labeler is not None,
             self._symbol_map,
             self._var_labeler,
             False,
@@ -95,7 +99,8 @@ class LPWriter(PersistentBase):
         cparams = cmodel.create_params(len(params))
         for ndx, p in enumerate(params):
             cp = cparams[ndx]
-            cp.name = self._symbol_map.getSymbol(p, self._param_labeler)
+            if self._param_labeler is not None:
+                cp.name = self._symbol_map.getSymbol(p, self._param_labeler)
             cp.value = p.value
             self._pyomo_param_to_solver_param_map[id(p)] = cp
 
@@ -107,11 +112,14 @@ class LPWriter(PersistentBase):
             raise NotImplementedError('LP writer does not yet support SOS constraints')
 
     def _remove_constraints(self, cons: List[ConstraintData]):
+        ccons = list()
         for c in cons:
             cc = self._pyomo_con_to_solver_con_map.pop(c)
-            self._writer.remove_constraint(cc)
-            self._symbol_map.removeSymbol(c)
+            ccons.append(cc)
+            if self._con_labeler is not None:
+                self._symbol_map.removeSymbol(c)
             del self._solver_con_to_pyomo_con_map[cc]
+        self._writer.remove_constraints(ccons)
 
     def _remove_sos_constraints(self, cons: List[SOSConstraintData]):
         if len(cons) != 0:
@@ -121,12 +129,14 @@ class LPWriter(PersistentBase):
         for v in variables:
             cvar = self._pyomo_var_to_solver_var_map.pop(id(v))
             del self._solver_var_to_pyomo_var_map[cvar]
-            self._symbol_map.removeSymbol(v)
+            if self._var_labeler is not None:
+                self._symbol_map.removeSymbol(v)
 
     def _remove_params(self, params: List[ParamData]):
         for p in params:
             del self._pyomo_param_to_solver_param_map[id(p)]
-            self._symbol_map.removeSymbol(p)
+            if self._param_labeler is not None:
+                self._symbol_map.removeSymbol(p)
 
     def _update_variables(self, variables: List[VarData]):
         cmodel.process_pyomo_vars(
@@ -158,19 +168,24 @@ class LPWriter(PersistentBase):
             sense = 0
             cname = 'objective'
         else:
-            cname = self._symbol_map.getSymbol(obj, self._obj_labeler)
             if obj.sense is minimize:
                 sense = 0
             else:
                 sense = 1
+            if self._obj_labeler is None:
+                cname = 'obj'
+            else:
+                cname = self._symbol_map.getSymbol(obj, self._obj_labeler)
         cobj.sense = sense
         cobj.name = cname
         self._writer.objective = cobj
 
-    def write(self, model: BlockData, filename: str, timer: HierarchicalTimer = None):
-        if timer is None:
-            timer = HierarchicalTimer()
-        if model is not self._model:
+    def _prepare(self, model: BlockData, timer: HierarchicalTimer):
+        # the components are only named if compact_labels is False
+        if (
+            model is not self._model
+            or self.config.compact_labels != self._compact_labels
+        ):
             timer.start('set_instance')
             self.set_instance(model)
             timer.stop('set_instance')
@@ -178,10 +193,52 @@ class LPWriter(PersistentBase):
             timer.start('update')
             self.update(timer=timer)
             timer.stop('update')
+
+    def write(self, model: BlockData, filename: str, timer: HierarchicalTimer = None):
+        if timer is None:
+            timer = HierarchicalTimer()
+        self._prepare(model, timer)
         timer.start('write file')
-        self._writer.write(filename)
+        self._writer.write(
+            filename, self.config.n_threads, self.config.compact_labels
+        )
         timer.stop('write file')
 
+    def write_mps(
+        self, model: BlockData, filename: str, timer: HierarchicalTimer = None
+    ):
+        """
+        Write the model in the free MPS format instead of the CPLEX LP format
+        """
+        if self.config.compact_labels:
+            raise ValueError('write_mps does not support compact_labels')
+        if timer is None:
+            timer = HierarchicalTimer()
+        self._prepare(model, timer)
+        timer.start('write file')
+        self._writer.write_mps(filename)
+        timer.stop('write file')
+
+    def to_arrays(self, model: BlockData, timer: HierarchicalTimer = None):
+        """
+        Evaluate the model into arrays instead of writing a file (e.g., to
+        load it into a solver in-process). The result has the constraint
+        matrix in CSR (row_indptr, row_indices, row_values) and CSC
+        (col_indptr, col_indices, col_values) form, row_lower, row_upper,
+        col_lower, col_upper, integrality, obj_coefs, obj_constant, sense
+        and the lower triangle of the Q matrix of the objective (0.5 x^T Q x)
+        in q_rows, q_cols and q_values. The arrays are NumPy arrays that
+        share memory with the result. Rows and columns are in the order of
+        get_ordered_cons() and get_vars().
+        """
+        if timer is None:
+            timer = HierarchicalTimer()
+        self._prepare(model, timer)
+        timer.start('to arrays')
+        res = self._writer.to_arrays()
+        timer.stop('to arrays')
+        return res
+
     def get_vars(self):
         return [
             self._solver_var_to_pyomo_var_map[i] for i in self._writer.get_solve_vars()
@@ -192,6 +249,54 @@ class LPWriter(PersistentBase):
             self._solver_con_to_pyomo_con_map[i] for i in self._writer.get_solve_cons()
         ]
 
+    def get_changed_cons(self):
+        """
+        The constraints whose rows were added or regenerated (because the
+        value of a parameter they depend on changed) by the last call to
+        write; the text of the other rows is reused from the previous write
+        """
+        return [
+            self._solver_con_to_pyomo_con_map[i]
+            for i in self._writer.get_changed_cons()
+        ]
+
+    def get_var_from_label(self, label):
+        """
+        The variable written as label (e.g., x12) in the last file written
+        with config.compact_labels
+        """
+        return self._solver_var_to_pyomo_var_map[
+            self._writer.get_var_from_label(label)
+        ]
+
+    def get_con_from_label(self, label):
+        """
+        The constraint of the row label (e.g., c3_ub) in the last file
+        written with config.compact_labels
+        """
+        return self._solver_con_to_pyomo_con_map[
+            self._writer.get_con_from_label(label)
+        ]
+
+    def get_var_from_name(self, name):
+        """
+        The variable written as name in the last file written, with or
+        without config.compact_labels
+        """
+        if self._compact_labels:
+            return self.get_var_from_label(name)
+        return self._symbol_map.bySymbol[name]
+
+    def get_con_from_row_name(self, name):
+        """
+        The constraint of the row name (the constraint name followed by _lb,
+        _ub or _eq) in the last file written, with or without
+        config.compact_labels
+        """
+        if self._compact_labels:
+            return self.get_con_from_label(name)
+        return self._symbol_map.bySymbol[name[:-3]]
+
     def get_active_objective(self):
         return self._objective
 
@@ -16,13 +16,12 @@ from pyomo.core.base.constraint import ConstraintData
 from pyomo.core.base.objective import ObjectiveData
 from pyomo.core.base.sos import SOSConstraintData
 from pyomo.core.base.block import BlockData
-from pyomo.repn.standard_repn import generate_standard_repn
 from pyomo.core.expr.numvalue import value
 from pyomo.contrib.appsi.base import PersistentBase
 from pyomo.core.base import SymbolMap, NumericLabeler, TextLabeler
 from pyomo.common.timing import HierarchicalTimer
 from pyomo.core.kernel.objective import minimize
-from .config import WriterConfig
+from .config import NLWriterConfig
 from pyomo.common.collections import OrderedSet
 import os
 from ..cmodel import cmodel, cmodel_available
@@ -32,7 +31,7 @@ from pyomo.repn.plugins.ampl.ampl_ import set_pyomo_amplfunc_env
 class NLWriter(PersistentBase):
     def __init__(self, only_child_vars=False):
         super(NLWriter, self).__init__(only_child_vars=only_child_vars)
-        self._config = WriterConfig()
+        self._config = NLWriterConfig()
         self._writer = None
         self._symbol_map = SymbolMap()
         self._var_labeler = None
@@ -50,7 +49,7 @@ class NLWriter(PersistentBase):
         return self._config
 
     @config.setter
-    def config(self, val: WriterConfig):
+    def config(self, val: NLWriterConfig):
         self._config = val
 
     @property
@@ -135,10 +134,12 @@ class NLWriter(PersistentBase):
             for c in cons:
                 self._symbol_map.removeSymbol(c)
                 self._con_labeler.remove_obj(c)
+        ccons = list()
         for c in cons:
             cc = self._pyomo_con_to_solver_con_map.pop(c)
-            self._writer.remove_constraint(cc)
+            ccons.append(cc)
             del self._solver_con_to_pyomo_con_map[cc]
+        self._writer.remove_constraints(ccons)
 
     def _remove_sos_constraints(self, cons: List[SOSConstraintData]):
         if len(cons) != 0:
@@ -181,60 +182,20 @@ class NLWriter(PersistentBase):
             cp.value = p.value
 
     def _set_objective(self, obj: ObjectiveData):
-        if obj is None:
-            const = cmodel.Constant(0)
-            lin_vars = list()
-            lin_coef = list()
-            nonlin = cmodel.Constant(0)
-            sense = 0
+        cobj = cmodel.process_nl_objective(
+            self._writer,
+            self._expr_types,
+            obj,
+            self._pyomo_var_to_solver_var_map,
+            self._pyomo_param_to_solver_param_map,
+        )
+        if obj is None or obj.sense is minimize:
+            cobj.sense = 0
         else:
-            pyomo_expr_types = cmodel.PyomoExprTypes()
-            repn = generate_standard_repn(
-                obj.expr, compute_values=False, quadratic=False
-            )
-            const = cmodel.appsi_expr_from_pyomo_expr(
-                repn.constant,
-                self._pyomo_var_to_solver_var_map,
-                self._pyomo_param_to_solver_param_map,
-                pyomo_expr_types,
-            )
-            lin_vars = [
-                self._pyomo_var_to_solver_var_map[id(i)] for i in repn.linear_vars
-            ]
-            lin_coef = [
-                cmodel.appsi_expr_from_pyomo_expr(
-                    i,
-                    self._pyomo_var_to_solver_var_map,
-                    self._pyomo_param_to_solver_param_map,
-                    pyomo_expr_types,
-                )
-                for i in repn.linear_coefs
-            ]
-            if repn.nonlinear_expr is None:
-                nonlin = cmodel.appsi_expr_from_pyomo_expr(
-                    0,
-                    self._pyomo_var_to_solver_var_map,
-                    self._pyomo_param_to_solver_param_map,
-                    pyomo_expr_types,
-                )
-            else:
-                nonlin = cmodel.appsi_expr_from_pyomo_expr(
-                    repn.nonlinear_expr,
-                    self._pyomo_var_to_solver_var_map,
-                    self._pyomo_param_to_solver_param_map,
-                    pyomo_expr_types,
-                )
-            if obj.sense is minimize:
-                sense = 0
-            else:
-                sense = 1
-        cobj = cmodel.NLObjective(const, lin_coef, lin_vars, nonlin)
-        cobj.sense = sense
+            cobj.sense = 1
         self._writer.objective = cobj
 
-    def write(self, model: BlockData, filename: str, timer: HierarchicalTimer = None):
-        if timer is None:
-            timer = HierarchicalTimer()
+    def _prepare(self, model: BlockData, timer: HierarchicalTimer):
         if model is not self._model:
             timer.start('set_instance')
             self.set_instance(model)
@@ -246,10 +207,35 @@ class NLWriter(PersistentBase):
                 if v.value is not None:
                     cv.value = v.value
             timer.stop('update')
+
+    def write(self, model: BlockData, filename: str, timer: HierarchicalTimer = None):
+        if timer is None:
+            timer = HierarchicalTimer()
+        self._prepare(model, timer)
         timer.start('write file')
-        self._writer.write(filename)
+        self._writer.write(
+            filename,
+            self.config.binary,
+            self.config.n_threads,
+            self.config.streaming,
+        )
         timer.stop('write file')
 
+    def write_to_bytes(self, model: BlockData, timer: HierarchicalTimer = None):
+        """
+        Returns the content of the NL file instead of writing it to disk
+        (e.g., for pynumero's AslNLP(nl_buffer=...))
+        """
+        if timer is None:
+            timer = HierarchicalTimer()
+        self._prepare(model, timer)
+        timer.start('write buffer')
+        res = self._writer.write_to_bytes(
+            self.config.binary, self.config.n_threads, self.config.streaming
+        )
+        timer.stop('write buffer')
+        return res
+
     def update(self, timer: HierarchicalTimer = None):
         super(NLWriter, self).update(timer=timer)
         self._set_pyomo_amplfunc_env()
@@ -267,6 +253,42 @@ class NLWriter(PersistentBase):
     def get_active_objective(self):
         return self._objective
 
+    def read_sol(self, filename: str):
+        """
+        Parse a .sol file (text or binary) for the last NL file written. The
+        duals and primals attributes of the result are NumPy arrays in the
+        order of get_ordered_cons() and get_ordered_vars().
+        """
+        return cmodel.read_sol(filename)
+
+    def load_solution(self, sol):
+        """
+        Set the values of the writer's variables and the duals of its
+        constraints (used for the initial point of the next NL file) from the
+        result of read_sol
+        """
+        self._writer.load_solution(sol)
+
+    def set_duals(self, duals):
+        """
+        Set the initial duals written to the next NL file (d segment) from an
+        array in the order of get_ordered_cons()
+        """
+        self._writer.set_duals(duals)
+
+    def get_jacobian(self):
+        """
+        The Jacobian of the linear part of the constraints in the last NL
+        file written (the J segments), in the order of get_ordered_cons() and
+        get_ordered_vars(). The result has shape, indptr, indices and values
+        attributes (CSR format), e.g., for
+
+            scipy.sparse.csr_matrix(
+                (jac.values, jac.indices, jac.indptr), shape=jac.shape
+            )
+        """
+        return self._writer.get_jacobian()
+
     def _set_pyomo_amplfunc_env(self):
         if self._external_functions:
             external_Libs = OrderedSet()
@@ -0,0 +1,458 @@
+#  ___________________________________________________________________________
+#
+#  Pyomo: Python Optimization Modeling Objects
+#  Copyright (c) 2008-2024
+#  National Technology and Engineering Solutions of Sandia, LLC
+#  Under the terms of Contract DE-NA0003525 with National Technology and
+#  Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+#  rights in this software.
+#  This software is distributed under the 3-clause BSD License.
+#  ___________________________________________________________________________
+
+import pyomo.common.unittest as unittest
+from pyomo.common.tempfiles import TempfileManager
+import pyomo.environ as pe
+from pyomo.contrib import appsi
+from pyomo.contrib.appsi.cmodel import cmodel_available
+
+
+@unittest.skipUnless(cmodel_available, 'appsi extensions are not available')
+class TestLPWriter(unittest.TestCase):
+    def _write_mps(self, m):
+        writer = appsi.writers.LPWriter()
+        writer.config.symbolic_solver_labels = True
+        with TempfileManager:
+            fname = TempfileManager.create_tempfile(suffix='.appsi.mps')
+            writer.write_mps(m, fname)
+            with open(fname, 'r') as f:
+                return f.read().splitlines()
+
+    def test_mps(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var()
+        m.y = pe.Var(bounds=(0, 10))
+        m.z = pe.Var(domain=pe.Integers, bounds=(-2, 3))
+        m.b = pe.Var(domain=pe.Binary)
+        m.obj = pe.Objective(
+            expr=m.y - m.b + 7 + 3 * m.x**2 + 2 * m.x * m.y, sense=pe.maximize
+        )
+        m.c1 = pe.Constraint(expr=(1, 0.5 + m.x + 2 * m.y, 4))
+        m.c2 = pe.Constraint(expr=3 * m.b - m.z == 2)
+        lines = self._write_mps(m)
+
+        self.assertEqual(lines[0], 'NAME obj')
+        self.assertEqual(lines[1:3], ['OBJSENSE', ' MAX'])
+        ndx = lines.index('ROWS')
+        self.assertEqual(lines[ndx + 1 : ndx + 4], [' N obj', ' G c1', ' E c2'])
+        self.assertEqual(lines[ndx + 4], 'COLUMNS')
+        for line in [' x c1 1', ' y c1 2', ' y obj 1', ' b c2 3', ' z c2 -1']:
+            self.assertIn(line, lines)
+        start = lines.index(" MARKER 'MARKER' 'INTORG'")
+        end = lines.index(" MARKER 'MARKER' 'INTEND'")
+        self.assertEqual(
+            sorted(line.split()[0] for line in lines[start + 1 : end]),
+            ['b', 'b', 'z'],
+        )
+        # the objective constant is the negative of the RHS of the objective
+        ndx = lines.index('RHS')
+        self.assertEqual(
+            lines[ndx + 1 : ndx + 4], [' RHS obj -7', ' RHS c1 0.5', ' RHS c2 2']
+        )
+        # the range constraint is written once
+        ndx = lines.index('RANGES')
+        self.assertEqual(lines[ndx + 1], ' RNG c1 3')
+        for line in [' FR BND x', ' UP BND y 10', ' LO BND z -2', ' UP BND z 3']:
+            self.assertIn(line, lines)
+        self.assertIn(' BV BND b', lines)
+        # 0.5 * x^T Q x
+        ndx = lines.index('QUADOBJ')
+        self.assertEqual(sorted(lines[ndx + 1 : ndx + 3]), [' x x 6', ' x y 2'])
+        self.assertEqual(lines[-1], 'ENDATA')
+
+    def test_mps_quadratic_constraint(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(-1, 1))
+        m.y = pe.Var(bounds=(-1, 1))
+        m.w = pe.Var()
+        m.obj = pe.Objective(expr=m.w)
+        m.c = pe.Constraint(expr=m.x**2 + 4 * m.x * m.y + m.w <= 9)
+        lines = self._write_mps(m)
+        # x^T Q x with both triangles
+        ndx = lines.index('QCMATRIX c')
+        self.assertEqual(
+            sorted(lines[ndx + 1 : ndx + 4]), [' x x 1', ' x y 2', ' y x 2']
+        )
+        self.assertIn(' FR BND w', lines)
+
+    def test_to_arrays(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var()
+        m.y = pe.Var(bounds=(0, 10))
+        m.z = pe.Var(domain=pe.Integers, bounds=(-2, 3))
+        m.b = pe.Var(domain=pe.Binary)
+        m.p = pe.Param(initialize=2, mutable=True)
+        m.obj = pe.Objective(
+            expr=m.y - m.b + 7 + 3 * m.x**2 + 2 * m.x * m.y, sense=pe.maximize
+        )
+        m.c1 = pe.Constraint(expr=(1, 0.5 + m.x + m.p * m.y, 4))
+        m.c2 = pe.Constraint(expr=3 * m.b - m.z == 2)
+        m.c3 = pe.Constraint(expr=m.x + m.y >= 1)
+        writer = appsi.writers.LPWriter()
+        res = writer.to_arrays(m)
+        cols = {v.name: i for i, v in enumerate(writer.get_vars())}
+        rows = {c.name: i for i, c in enumerate(writer.get_ordered_cons())}
+        self.assertEqual((res.n_rows, res.n_cols), (3, 4))
+
+        dense = [[0] * 4 for i in range(3)]
+        for i in range(3):
+            row_cols = res.row_indices[res.row_indptr[i] : res.row_indptr[i + 1]]
+            self.assertEqual(row_cols.tolist(), sorted(row_cols.tolist()))
+            for k in range(res.row_indptr[i], res.row_indptr[i + 1]):
+                dense[i][res.row_indices[k]] = res.row_values[k]
+        expected = [[0] * 4 for i in range(3)]
+        for cname, vname, val in [
+            ('c1', 'x', 1),
+            ('c1', 'y', 2),
+            ('c2', 'b', 3),
+            ('c2', 'z', -1),
+            ('c3', 'x', 1),
+            ('c3', 'y', 1),
+        ]:
+            expected[rows[cname]][cols[vname]] = val
+        self.assertEqual(dense, expected)
+        dense = [[0] * 4 for i in range(3)]
+        for j in range(4):
+            for k in range(res.col_indptr[j], res.col_indptr[j + 1]):
+                dense[res.col_indices[k]][j] = res.col_values[k]
+        self.assertEqual(dense, expected)
+
+        inf = float('inf')
+        lower = [0] * 3
+        upper = [0] * 3
+        for cname, lb, ub in [('c1', 0.5, 3.5), ('c2', 2, 2), ('c3', 1, inf)]:
+            lower[rows[cname]] = lb
+            upper[rows[cname]] = ub
+        self.assertEqual(res.row_lower.tolist(), lower)
+        self.assertEqual(res.row_upper.tolist(), upper)
+        col_lower = [0] * 4
+        col_upper = [0] * 4
+        integrality = [0] * 4
+        obj = [0] * 4
+        for vname, lb, ub, is_int, c in [
+            ('x', -inf, inf, 0, 0),
+            ('y', 0, 10, 0, 1),
+            ('z', -2, 3, 1, 0),
+            ('b', 0, 1, 1, -1),
+        ]:
+            col_lower[cols[vname]] = lb
+            col_upper[cols[vname]] = ub
+            integrality[cols[vname]] = is_int
+            obj[cols[vname]] = c
+        self.assertEqual(res.col_lower.tolist(), col_lower)
+        self.assertEqual(res.col_upper.tolist(), col_upper)
+        self.assertEqual(res.integrality.tolist(), integrality)
+        self.assertEqual(res.obj_coefs.tolist(), obj)
+        self.assertEqual(res.obj_constant, 7)
+        self.assertEqual(res.sense, 1)
+        q = {
+            (r, c): val
+            for r, c, val in zip(
+                res.q_rows.tolist(), res.q_cols.tolist(), res.q_values.tolist()
+            )
+        }
+        x, y = cols['x'], cols['y']
+        self.assertEqual(q, {(x, x): 6, (max(x, y), min(x, y)): 2})
+
+        # coefficients are evaluated with the current parameter values
+        m.p.value = 4
+        res = writer.to_arrays(m)
+        i = rows['c1']
+        for k in range(res.row_indptr[i], res.row_indptr[i + 1]):
+            if res.row_indices[k] == cols['y']:
+                self.assertEqual(res.row_values[k], 4)
+
+        m.c4 = pe.Constraint(expr=m.x**2 <= 1)
+        with self.assertRaisesRegex(ValueError, 'quadratic constraints'):
+            writer.to_arrays(m)
+
+    def test_rewrite_after_changes(self):
+        # cached rows must give the same file as a new writer
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(-2, 2))
+        m.y = pe.Var()
+        m.z = pe.Var(domain=pe.Integers)
+        m.p = pe.Param(initialize=3, mutable=True)
+        m.q = pe.Param(initialize=2, mutable=True)
+        m.obj = pe.Objective(expr=m.x**2 + m.p * m.z)
+        m.c1 = pe.Constraint(expr=m.y >= m.x + m.q * m.z)
+        m.c2 = pe.Constraint(expr=(m.p, m.x - m.y, 10))
+        m.c3 = pe.Constraint(expr=m.x + m.y + m.z == 1)
+        writer = appsi.writers.LPWriter()
+
+        def check(changed):
+            with TempfileManager:
+                fname1 = TempfileManager.create_tempfile(suffix='.appsi.lp')
+                fname2 = TempfileManager.create_tempfile(suffix='.appsi.lp')
+                writer.write(m, fname1)
+                appsi.writers.LPWriter().write(m, fname2)
+                with open(fname1, 'r') as f1, open(fname2, 'r') as f2:
+                    self.assertEqual(f1.read(), f2.read())
+            self.assertEqual(
+                sorted(c.name for c in writer.get_changed_cons()), changed
+            )
+
+        check(['c1', 'c2', 'c3'])
+        check([])
+        m.p.value = 4
+        check(['c2'])
+        m.q.value = -1
+        check(['c1'])
+        m.c4 = pe.Constraint(expr=m.z + m.y <= 5)
+        check(['c4'])
+        # constraints with a variable that is fixed or unfixed are added again
+        m.x.fix(1)
+        check(['c1', 'c2', 'c3'])
+        m.x.unfix()
+        check(['c1', 'c2', 'c3'])
+        m.y.setlb(-5)
+        check([])
+        del m.c1
+        check([])
+
+    def test_parallel_write(self):
+        m = pe.ConcreteModel()
+        m.I = pe.RangeSet(500)
+        m.x = pe.Var(m.I, bounds=(-1, 1))
+        m.p = pe.Param(m.I, initialize=lambda m, i: i / 8, mutable=True)
+        m.obj = pe.Objective(expr=sum(m.x[i] ** 2 for i in m.I))
+        m.c = pe.Constraint(
+            m.I,
+            rule=lambda m, i: (
+                -i,
+                m.p[i] * m.x[i] - 0.1 * m.x[i % 500 + 1] + 3.25 * m.x[1],
+                i + 1,
+            ),
+        )
+        writers = dict()
+        for n_threads in [1, 4, 0]:
+            writers[n_threads] = appsi.writers.LPWriter()
+            writers[n_threads].config.n_threads = n_threads
+
+        def check(changed):
+            contents = dict()
+            with TempfileManager:
+                for n_threads, writer in writers.items():
+                    fname = TempfileManager.create_tempfile(suffix='.appsi.lp')
+                    writer.write(m, fname)
+                    with open(fname, 'r') as f:
+                        contents[n_threads] = f.read()
+                    # the rows are in the same order as the constraints
+                    self.assertEqual(
+                        [c.name for c in writer.get_changed_cons()], changed
+                    )
+            self.assertEqual(contents[4], contents[1])
+            self.assertEqual(contents[0], contents[1])
+
+        check([m.c[i].name for i in m.I])
+        for i in [3, 250, 499]:
+            m.p[i].value = -i
+        check([m.c[i].name for i in [3, 250, 499]])
+
+    def test_compact_labels(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(-1, 2))
+        m.y = pe.Var(domain=pe.Binary)
+        m.z = pe.Var(domain=pe.Integers, bounds=(0, 5))
+        m.p = pe.Param(initialize=3, mutable=True)
+        m.obj = pe.Objective(expr=m.x + m.z)
+        m.c1 = pe.Constraint(expr=m.x + m.p * m.y >= 1)
+        m.c2 = pe.Constraint(expr=(0, m.y - m.z, 4))
+        m.c3 = pe.Constraint(expr=m.z + m.x == 2)
+        writer = appsi.writers.LPWriter()
+        writer.config.compact_labels = True
+
+        def write(writer):
+            with TempfileManager:
+                fname = TempfileManager.create_tempfile(suffix='.appsi.lp')
+                writer.write(m, fname)
+                with open(fname, 'r') as f:
+                    return f.read()
+
+        def check():
+            text = write(writer)
+            # rewriting the cached rows gives the same file as a new writer
+            new_writer = appsi.writers.LPWriter()
+            new_writer.config.compact_labels = True
+            self.assertEqual(text, write(new_writer))
+            lines = text.splitlines()
+            for i, v in enumerate(writer.get_vars()):
+                self.assertIs(writer.get_var_from_label('x%d' % i), v)
+                lb = '-inf' if v.lb is None else '%d' % v.lb
+                ub = '+inf' if v.ub is None else '%d' % v.ub
+                self.assertIn('  %s <= x%d <= %s ' % (lb, i, ub), lines)
+            for i, c in enumerate(writer.get_ordered_cons()):
+                for suffix in ['_lb', '_ub', '_eq']:
+                    if 'c%d%s: ' % (i, suffix) in lines:
+                        label = 'c%d%s' % (i, suffix)
+                        self.assertIs(writer.get_con_from_label(label), c)
+            self.assertNotIn(' x ', text)
+            return lines
+
+        lines = check()
+        self.assertIn('obj: ', lines)
+        self.assertEqual(len(writer.symbol_map.bySymbol), 0)
+        ndx = lines.index('Generals ')
+        self.assertEqual(writer.get_var_from_label(lines[ndx + 1].strip()), m.z)
+        # the labels of the other rows and columns move
+        del m.c1
+        check()
+        m.p.value = 4
+        m.c4 = pe.Constraint(expr=m.p * m.x - m.y <= 0)
+        check()
+        with self.assertRaisesRegex(ValueError, 'unknown variable label'):
+            writer.get_var_from_label('x100')
+        with self.assertRaisesRegex(ValueError, 'unknown constraint label'):
+            writer.get_con_from_label('obj')
+        with self.assertRaisesRegex(ValueError, 'compact_labels'):
+            writer.write_mps(m, 'unused.mps')
+        m.obj.sense = pe.maximize
+        lines = check()
+        self.assertEqual(lines[lines.index('obj: ') - 1], 'maximize')
+        self.assertEqual(len(writer.symbol_map.bySymbol), 0)
+
+        # the components are named again without compact labels
+        writer.config.compact_labels = False
+        writer.config.symbolic_solver_labels = True
+        self.assertIn('c2_lb: ', write(writer).splitlines())
+
+    def test_remove_many_constraints(self):
+        # removed constraints leave empty slots that are compacted later;
+        # the rows stay in the order the constraints were added
+        m = pe.ConcreteModel()
+        m.x = pe.Var(range(10), bounds=(0, 1))
+        m.obj = pe.Objective(expr=sum(m.x.values()))
+        m.c = pe.Constraint(range(300), rule=lambda m, i: m.x[i % 10] <= i)
+        writer = appsi.writers.LPWriter()
+
+        def check():
+            with TempfileManager:
+                fname1 = TempfileManager.create_tempfile(suffix='.appsi.lp')
+                fname2 = TempfileManager.create_tempfile(suffix='.appsi.lp')
+                writer.write(m, fname1)
+                appsi.writers.LPWriter().write(m, fname2)
+                with open(fname1, 'r') as f1, open(fname2, 'r') as f2:
+                    self.assertEqual(f1.read(), f2.read())
+            self.assertEqual(
+                [c.name for c in writer.get_ordered_cons()],
+                [c.name for c in m.component_data_objects(pe.Constraint)],
+            )
+
+        check()
+        for i in range(0, 300, 3):
+            del m.c[i]
+        check()
+        for i in range(300):
+            if i % 3 and i % 5:
+                del m.c[i]
+        m.d = pe.Constraint(expr=m.x[0] + m.x[1] >= 1)
+        check()
+        self.assertEqual(len(writer._writer.constraints), 41)
+
+    def test_add_constraint_twice(self):
+        # adding a constraint that is already in the model does nothing
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(0, 1))
+        m.y = pe.Var(bounds=(0, 1))
+        m.obj = pe.Objective(expr=m.x + m.y)
+        m.c1 = pe.Constraint(expr=m.x + m.y >= 1)
+        m.c2 = pe.Constraint(expr=m.x - m.y <= 0)
+        writer = appsi.writers.LPWriter()
+        writer.set_instance(m)
+        ccon = writer._pyomo_con_to_solver_con_map[m.c1]
+        writer._writer.add_constraint(ccon)
+        writer._writer.add_constraints([ccon, ccon])
+        self.assertEqual(len(writer._writer.constraints), 2)
+        self.assertEqual(writer.get_ordered_cons(), [m.c1, m.c2])
+
+        writer.remove_constraints([m.c1])
+        self.assertEqual(len(writer._writer.constraints), 1)
+        with TempfileManager:
+            fname = TempfileManager.create_tempfile(suffix='.appsi.lp')
+            writer.write(m, fname)
+            with open(fname, 'r') as f:
+                lp = f.read()
+        self.assertNotIn('_lb:', lp)
+        self.assertEqual(lp.count('_ub:'), 1)
+        self.assertEqual(writer.get_ordered_cons(), [m.c2])
+
+    def test_param_dependents(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var(range(3), bounds=(0, 1))
+        m.p = pe.Param(initialize=2, mutable=True)
+        m.q = pe.Param(initialize=3, mutable=True)
+        m.obj = pe.Objective(expr=sum(m.x.values()))
+        m.c1 = pe.Constraint(expr=m.p * m.x[0] + m.x[1] <= 1)
+        m.c2 = pe.Constraint(expr=m.x[1] + m.x[2] >= m.q)
+        m.c3 = pe.Constraint(expr=m.x[0] - m.x[2] == 0)
+        m.c4 = pe.Constraint(expr=(m.p + m.q) * m.x[2] <= 4)
+        writer = appsi.writers.LPWriter()
+        writer.config.symbolic_solver_labels = True
+
+        def write():
+            with TempfileManager:
+                fname = TempfileManager.create_tempfile(suffix='.appsi.lp')
+                writer.write(m, fname)
+                with open(fname, 'r') as f:
+                    return f.read()
+
+        write()
+        w = writer._writer
+        cp = writer._pyomo_param_to_solver_param_map[id(m.p)]
+        cq = writer._pyomo_param_to_solver_param_map[id(m.q)]
+        con_map = writer._solver_con_to_pyomo_con_map
+        self.assertEqual([con_map[c] for c in w.get_dependents(cp)], [m.c1, m.c4])
+        self.assertEqual([con_map[c] for c in w.get_dependents(cq)], [m.c2, m.c4])
+
+        m.q.value = 5
+        writer.update_params()
+        w.find_changed_values()
+        self.assertEqual([p.name for p in w.get_dirty_leaves()], [cq.name])
+        self.assertEqual([con_map[c] for c in w.get_dirty_constraints()], [m.c2, m.c4])
+        w.mark_dirty(cp)
+        self.assertEqual(
+            [con_map[c] for c in w.get_dirty_constraints()], [m.c1, m.c2, m.c4]
+        )
+        w.clear_dirty()
+        self.assertEqual(w.get_dirty_constraints(), [])
+
+        # the writer keeps its own copy of the values, so it still regenerates
+        # the rows that depend on q, and it leaves the dirty set alone
+        m.p.value = -1
+        writer.update_params()
+        w.find_changed_values()
+        text = write()
+        self.assertEqual(
+            sorted(c.name for c in writer.get_changed_cons()), ['c1', 'c2', 'c4']
+        )
+        self.assertEqual([con_map[c] for c in w.get_dirty_constraints()], [m.c1, m.c4])
+        w.clear_dirty()
+        with TempfileManager:
+            fname = TempfileManager.create_tempfile(suffix='.appsi.lp')
+            fresh = appsi.writers.LPWriter()
+            fresh.config.symbolic_solver_labels = True
+            fresh.write(m, fname)
+            with open(fname, 'r') as f:
+                self.assertEqual(text, f.read())
+
+        # the writer only regenerates the rows that depend on the params that
+        # changed
+        m.q.value = 2
+        write()
+        self.assertEqual(
+            sorted(c.name for c in writer.get_changed_cons()), ['c2', 'c4']
+        )
+
+        # removed constraints are dropped from the index
+        del m.c4
+        write()
+        self.assertEqual([con_map[c] for c in w.get_dependents(cq)], [m.c2])
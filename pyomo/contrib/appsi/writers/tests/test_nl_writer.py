@@ -14,7 +14,18 @@ from pyomo.common.tempfiles import TempfileManager
 import pyomo.environ as pe
 from pyomo.contrib import appsi
 from pyomo.contrib.appsi.cmodel import cmodel_available
+from pyomo.contrib.pynumero.dependencies import numpy_available, scipy_available
 import os
+import struct
+import sys
+
+
+def _asl_available():
+    if not (numpy_available and scipy_available):
+        return False
+    from pyomo.contrib.pynumero.asl import AmplInterface
+
+    return AmplInterface.available()
 
 
 @unittest.skipUnless(cmodel_available, 'appsi extensions are not available')
@@ -364,3 +375,537 @@ class TestNLWriter(unittest.TestCase):
             '0 0 0 0 0',
         ]
         self._write_and_check_header(m, correct_lines)
+
+    def test_binary_header(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var()
+        m.y = pe.Var()
+        m.obj = pe.Objective(expr=m.x**2 + m.y**2)
+        m.c = pe.Constraint(expr=m.x**2 + m.y**2 == 1)
+        writer = appsi.writers.NLWriter()
+        writer.config.binary = True
+        with TempfileManager:
+            fname = TempfileManager.create_tempfile(suffix='.appsi.nl')
+            writer.write(m, fname)
+            with open(fname, 'rb') as f:
+                lines = f.read().split(b'\n')
+        self.assertEqual(lines[0], b'b3 1 1 0')
+        # the arithmetic kind identifies the byte order of the binary segments
+        self.assertIn(lines[5], (b'0 0 1 1', b'0 0 2 1'))
+        # the first segment follows the header without a newline
+        self.assertTrue(lines[10].startswith(b'C'))
+
+    @unittest.skipUnless(appsi.solvers.Ipopt().available(), 'ipopt is not available')
+    def test_binary_solve(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(-2, 2))
+        m.y = pe.Var(initialize=1)
+        m.p = pe.Param(initialize=3, mutable=True)
+        m.obj = pe.Objective(expr=(m.x - 1) ** 2 + m.p * pe.exp(m.y) - m.y)
+        m.c1 = pe.Constraint(expr=m.y >= pe.log(m.x + 3) - m.p)
+        m.c2 = pe.Constraint(expr=(-1, m.x + m.y, 5))
+        res = list()
+        for binary in [False, True]:
+            opt = appsi.solvers.Ipopt()
+            opt.writer.config.binary = binary
+            opt.solve(m)
+            res.append((m.x.value, m.y.value, pe.value(m.obj)))
+        for a, b in zip(*res):
+            self.assertAlmostEqual(a, b)
+
+    @unittest.skipUnless(_asl_available(), 'pynumero ASL is not available')
+    def test_binary_asl(self):
+        # the ASL reads the same problem from the text and the binary files
+        from pyomo.contrib.pynumero.interfaces.ampl_nlp import AslNLP
+
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(-2, 2), initialize=0.5)
+        m.y = pe.Var(initialize=1)
+        m.p = pe.Param(initialize=3, mutable=True)
+        m.obj = pe.Objective(expr=(m.x - 1) ** 2 + m.p * pe.exp(m.y) - m.y)
+        m.c1 = pe.Constraint(expr=m.y >= pe.log(m.x + 3) - m.p)
+        m.c2 = pe.Constraint(expr=(-1, m.x + m.y, 5))
+        m.c3 = pe.Constraint(expr=m.x * m.y**2 == 0.25)
+        nlps = list()
+        with TempfileManager:
+            for binary in [False, True]:
+                writer = appsi.writers.NLWriter()
+                writer.config.binary = binary
+                fname = TempfileManager.create_tempfile(suffix='.appsi.nl')
+                writer.write(m, fname)
+                nlps.append(AslNLP(fname))
+        text_nlp, binary_nlp = nlps
+        self.assertEqual(binary_nlp.n_primals(), 2)
+        self.assertEqual(binary_nlp.n_constraints(), 3)
+        for nlp in nlps:
+            nlp.set_primals([0.5, -0.75])
+        for method in [
+            'primals_lb',
+            'primals_ub',
+            'constraints_lb',
+            'constraints_ub',
+            'evaluate_grad_objective',
+            'evaluate_constraints',
+        ]:
+            expected = getattr(text_nlp, method)()
+            got = getattr(binary_nlp, method)()
+            self.assertEqual(len(got), len(expected))
+            for a, b in zip(expected, got):
+                self.assertAlmostEqual(a, b)
+        self.assertAlmostEqual(
+            binary_nlp.evaluate_objective(), text_nlp.evaluate_objective()
+        )
+        expected = text_nlp.evaluate_jacobian().toarray()
+        got = binary_nlp.evaluate_jacobian().toarray()
+        self.assertEqual(got.shape, expected.shape)
+        for a, b in zip(expected.flat, got.flat):
+            self.assertAlmostEqual(a, b)
+
+    def test_rewrite_after_changes(self):
+        # cached segments must give the same file as a new writer
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(-2, 2))
+        m.y = pe.Var(initialize=1)
+        m.z = pe.Var()
+        m.p = pe.Param(initialize=3, mutable=True)
+        m.q = pe.Param(initialize=2, mutable=True)
+        m.obj = pe.Objective(expr=m.x**2 + m.p * m.z)
+        m.c1 = pe.Constraint(expr=m.y >= pe.exp(m.x) + m.q * m.z)
+        m.c2 = pe.Constraint(expr=m.y >= (m.x - m.p) ** 2)
+        writer = appsi.writers.NLWriter()
+
+        def check():
+            with TempfileManager:
+                fname1 = TempfileManager.create_tempfile(suffix='.appsi.nl')
+                fname2 = TempfileManager.create_tempfile(suffix='.appsi.nl')
+                writer.write(m, fname1)
+                appsi.writers.NLWriter().write(m, fname2)
+                with open(fname1, 'r') as f1, open(fname2, 'r') as f2:
+                    self.assertEqual(f1.read(), f2.read())
+
+        check()
+        m.p.value = 4
+        check()
+        m.q.value = -1
+        check()
+        m.c3 = pe.Constraint(expr=m.z + m.y**2 <= 5)
+        check()
+        m.x.fix(1)
+        check()
+        del m.c1
+        check()
+
+    def test_threads(self):
+        m = pe.ConcreteModel()
+        m.I = pe.RangeSet(500)
+        m.x = pe.Var(m.I, bounds=(-1, 1))
+        m.p = pe.Param(initialize=2, mutable=True)
+        m.obj = pe.Objective(expr=sum(m.x[i] ** 2 for i in m.I))
+
+        @m.Constraint(m.I)
+        def c(m, i):
+            if i % 2:
+                return pe.exp(m.x[i]) + m.p * m.x[i % 500 + 1] <= i
+            return m.x[i] + m.x[(3 * i) % 500 + 1] == m.p
+
+        res = list()
+        for n_threads in [1, 4, 0]:
+            writer = appsi.writers.NLWriter()
+            writer.config.n_threads = n_threads
+            with TempfileManager:
+                fname = TempfileManager.create_tempfile(suffix='.appsi.nl')
+                writer.write(m, fname)
+                with open(fname, 'r') as f:
+                    res.append(f.read())
+        self.assertEqual(res[0], res[1])
+        self.assertEqual(res[0], res[2])
+
+    def test_number_format(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(-0.5, 2))
+        m.y = pe.Var()
+        m.obj = pe.Objective(expr=m.x**2 + m.y**2)
+        m.c = pe.Constraint(expr=0.1 * m.x + (1 / 3) * m.y == 1)
+        writer = appsi.writers.NLWriter()
+        with TempfileManager:
+            fname = TempfileManager.create_tempfile(suffix='.appsi.nl')
+            writer.write(m, fname)
+            with open(fname, 'r') as f:
+                lines = f.read().splitlines()
+        # short values are not padded to 17 digits, and all values round-trip
+        self.assertIn('0 -0.5 2', lines)
+        j = lines.index('J0 2')
+        coefs = sorted(float(line.split()[1]) for line in lines[j + 1 : j + 3])
+        self.assertEqual(coefs, [0.1, 1 / 3])
+        self.assertIn('0.1', [line.split()[1] for line in lines[j + 1 : j + 3]])
+
+    def test_write_to_bytes(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(-2, 2))
+        m.y = pe.Var()
+        m.obj = pe.Objective(expr=m.x**2 + m.y**2)
+        m.c = pe.Constraint(expr=m.y >= pe.exp(m.x))
+        for binary in [False, True]:
+            writer = appsi.writers.NLWriter()
+            writer.config.binary = binary
+            with TempfileManager:
+                fname = TempfileManager.create_tempfile(suffix='.appsi.nl')
+                writer.write(m, fname)
+                with open(fname, 'rb') as f:
+                    expected = f.read()
+            if not binary:
+                # text files are written with the platform's line endings
+                expected = expected.replace(b'\r\n', b'\n')
+            self.assertEqual(writer.write_to_bytes(m), expected)
+
+    def test_defined_variables(self):
+        # named expressions used more than once are written once as V segments
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(-2, 2))
+        m.y = pe.Var(initialize=1)
+        m.z = pe.Var(initialize=1)
+        m.e = pe.Expression(expr=m.x**2 + m.y)
+        m.obj = pe.Objective(expr=(m.e - 1) ** 2)
+        m.c1 = pe.Constraint(expr=pe.exp(m.e) <= 10)
+        m.c2 = pe.Constraint(expr=m.e * m.z >= 1)
+        writer = appsi.writers.NLWriter()
+        with TempfileManager:
+            fname = TempfileManager.create_tempfile(suffix='.appsi.nl')
+            writer.write(m, fname)
+            with open(fname, 'r') as f:
+                lines = f.read().splitlines()
+        self.assertEqual(lines[6].split(), ['1', '0', '0', '0', '0'])
+        v_lines = [line for line in lines if line.startswith('V')]
+        # m.e is x**2 + y, so y goes in the linear part
+        self.assertEqual(v_lines, ['V3 1 0'])
+
+        # changing the named expression must not reuse the old one
+        m.e.expr = m.x**2 - m.y
+        with TempfileManager:
+            fname1 = TempfileManager.create_tempfile(suffix='.appsi.nl')
+            fname2 = TempfileManager.create_tempfile(suffix='.appsi.nl')
+            writer.write(m, fname1)
+            appsi.writers.NLWriter().write(m, fname2)
+            with open(fname1, 'r') as f1, open(fname2, 'r') as f2:
+                self.assertEqual(f1.read(), f2.read())
+
+        # nor when a named expression inside it changes
+        m.e2 = pe.Expression(expr=m.x * m.z)
+        m.e.expr = m.e2 + pe.sin(m.y)
+        for e2 in [m.x * m.y, pe.cos(m.x)]:
+            m.e2.expr = e2
+            with TempfileManager:
+                fname1 = TempfileManager.create_tempfile(suffix='.appsi.nl')
+                fname2 = TempfileManager.create_tempfile(suffix='.appsi.nl')
+                writer.write(m, fname1)
+                appsi.writers.NLWriter().write(m, fname2)
+                with open(fname1, 'r') as f1, open(fname2, 'r') as f2:
+                    self.assertEqual(f1.read(), f2.read())
+
+        # the writer lets go of named expressions that are no longer used
+        m.e3 = pe.Expression(expr=pe.exp(m.z))
+        n_refs = sys.getrefcount(m.e3)
+        m.c3 = pe.Constraint(expr=m.e3 + m.e3**2 <= 4)
+        with TempfileManager:
+            writer.write(m, TempfileManager.create_tempfile(suffix='.appsi.nl'))
+        self.assertGreater(sys.getrefcount(m.e3), n_refs)
+        m.del_component(m.c3)
+        with TempfileManager:
+            writer.write(m, TempfileManager.create_tempfile(suffix='.appsi.nl'))
+        self.assertEqual(sys.getrefcount(m.e3), n_refs)
+
+    def _mixed_defined_variables_model(self, named):
+        # exp(x) is used by the constraints and the objective, sin(x) by both
+        # constraints and cos(y) twice by the objective; the constraints use
+        # sin(x) first
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(-2, 2), initialize=1)
+        m.y = pe.Var(bounds=(-2, 2), initialize=1)
+        e_both = pe.exp(m.x)
+        e_cons = pe.sin(m.x)
+        e_obj = pe.cos(m.y)
+        if named:
+            m.e_both = pe.Expression(expr=e_both)
+            m.e_cons = pe.Expression(expr=e_cons)
+            m.e_obj = pe.Expression(expr=e_obj)
+            e_both, e_cons, e_obj = m.e_both, m.e_cons, m.e_obj
+        m.c1 = pe.Constraint(expr=e_cons * m.y + e_both * m.x <= 4)
+        m.c2 = pe.Constraint(expr=e_cons + e_both >= 1)
+        m.obj = pe.Objective(expr=(e_obj - 0.5) ** 2 + e_obj * m.y + e_both)
+        return m
+
+    def test_defined_variables_categories(self):
+        # the common V segments are written in the order of the header counts
+        # (used by the constraints and the objective, then by the constraints
+        # only); cos(y) only has one user, so it is written with the objective
+        m = self._mixed_defined_variables_model(named=True)
+        writer = appsi.writers.NLWriter()
+        with TempfileManager:
+            fname = TempfileManager.create_tempfile(suffix='.appsi.nl')
+            writer.write(m, fname)
+            with open(fname, 'r') as f:
+                lines = f.read().splitlines()
+        self.assertEqual(lines[6].split(), ['1', '1', '0', '0', '1'])
+        v_ndx = [i for i, line in enumerate(lines) if line.startswith('V')]
+        self.assertEqual([lines[i] for i in v_ndx], ['V2 0 0', 'V3 0 0', 'V4 0 3'])
+        # exp, sin and cos
+        self.assertEqual([lines[i + 1] for i in v_ndx], ['o44', 'o41', 'o46'])
+
+    @unittest.skipUnless(appsi.solvers.Ipopt().available(), 'ipopt is not available')
+    def test_defined_variables_categories_solve(self):
+        res = list()
+        for named in [True, False]:
+            m = self._mixed_defined_variables_model(named)
+            opt = appsi.solvers.Ipopt()
+            opt.solve(m)
+            res.append((m.x.value, m.y.value, pe.value(m.obj)))
+        for a, b in zip(*res):
+            self.assertAlmostEqual(a, b, places=5)
+
+    @unittest.skipUnless(appsi.solvers.Ipopt().available(), 'ipopt is not available')
+    def test_defined_variables_solve(self):
+        res = list()
+        for named in [True, False]:
+            m = pe.ConcreteModel()
+            m.x = pe.Var(bounds=(-2, 2), initialize=1)
+            m.y = pe.Var(initialize=1)
+            e = m.x**2 + 2 * m.y + 1
+            if named:
+                m.e = pe.Expression(expr=e)
+                e = m.e
+            m.obj = pe.Objective(expr=(e - 3) ** 2 + m.y**2)
+            m.c1 = pe.Constraint(expr=pe.exp(e) <= 10)
+            m.c2 = pe.Constraint(expr=e * m.x >= 1)
+            opt = appsi.solvers.Ipopt()
+            opt.solve(m)
+            res.append((m.x.value, m.y.value, pe.value(m.obj)))
+        for a, b in zip(*res):
+            self.assertAlmostEqual(a, b, places=5)
+
+    def test_read_sol(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(-2, 2))
+        m.y = pe.Var()
+        m.obj = pe.Objective(expr=m.x**2 + m.y**2)
+        m.c1 = pe.Constraint(expr=m.y >= pe.exp(m.x))
+        m.c2 = pe.Constraint(expr=m.x + m.y <= 5)
+        writer = appsi.writers.NLWriter()
+        sol_lines = [
+            '',
+            'Ipopt 3.14.4: Optimal Solution Found',
+            '',
+            'Options',
+            '3',
+            '1',
+            '1',
+            '0',
+            '2',
+            '2',
+            '2',
+            '2',
+            '-0.5',
+            '0.25',
+            '1.5',
+            '-1e-07',
+            'objno 0 0',
+            'suffix 4 1 13 0 0',
+            'ipopt_zU_out',
+            '0 -0.125',
+        ]
+        with TempfileManager:
+            fname = TempfileManager.create_tempfile(suffix='.appsi.nl')
+            writer.write(m, fname)
+            sol_fname = TempfileManager.create_tempfile(suffix='.sol')
+            with open(sol_fname, 'w') as f:
+                f.write('\n'.join(sol_lines) + '\n')
+            sol = writer.read_sol(sol_fname)
+        self.assertIn('Optimal Solution Found', sol.message)
+        self.assertEqual(sol.solve_result_num, 0)
+        self.assertEqual(sol.duals.tolist(), [-0.5, 0.25])
+        self.assertEqual(sol.primals.tolist(), [1.5, -1e-07])
+        self.assertEqual(len(writer.get_ordered_vars()), len(sol.primals))
+        self.assertEqual(len(writer.get_ordered_cons()), len(sol.duals))
+        suffix = sol.get_suffix('ipopt_zU_out')
+        self.assertEqual(suffix.indices.tolist(), [0])
+        self.assertEqual(suffix.values.tolist(), [-0.125])
+        self.assertFalse(sol.has_suffix('ipopt_zL_out'))
+
+        writer.load_solution(sol)
+        cvars = writer._writer.get_solve_vars()
+        self.assertEqual([v.value for v in cvars], [1.5, -1e-07])
+
+    def test_read_binary_sol(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(-2, 2))
+        m.y = pe.Var()
+        m.obj = pe.Objective(expr=m.x**2 + m.y**2)
+        m.c1 = pe.Constraint(expr=m.y >= pe.exp(m.x))
+        m.c2 = pe.Constraint(expr=m.x + m.y <= 5)
+        writer = appsi.writers.NLWriter()
+
+        # each record is its length, the data and the length again
+        def record(data):
+            return struct.pack('i', len(data)) + data + struct.pack('i', len(data))
+
+        def ints(*vals):
+            return record(struct.pack('%di' % len(vals), *vals))
+
+        def doubles(*vals):
+            return record(struct.pack('%dd' % len(vals), *vals))
+
+        content = b''.join(
+            [
+                record(b'binary'),
+                record(b'Ipopt 3.14.4: Optimal Solution Found'),
+                record(b''),
+                # options, then n_cons, n_duals, n_vars, n_primals
+                ints(3, 1, 1, 0, 2, 2, 2, 2),
+                doubles(-0.5, 0.25),
+                doubles(1.5, -1e-07),
+                # objno and solve_result_num
+                ints(0, 0),
+                # kind n namelen tablen tablines
+                ints(4, 1, 13, 0, 0),
+                record(b'ipopt_zU_out'),
+                ints(0),
+                doubles(-0.125),
+                ints(1, 2, 7, 0, 0),
+                record(b'sstatus'),
+                ints(0, 1),
+                ints(1, 3),
+            ]
+        )
+        with TempfileManager:
+            fname = TempfileManager.create_tempfile(suffix='.appsi.nl')
+            writer.write(m, fname)
+            sol_fname = TempfileManager.create_tempfile(suffix='.sol')
+            with open(sol_fname, 'wb') as f:
+                f.write(content)
+            sol = writer.read_sol(sol_fname)
+            with open(sol_fname, 'wb') as f:
+                f.write(content[:-4])
+            with self.assertRaisesRegex(ValueError, 'unexpected end of file'):
+                writer.read_sol(sol_fname)
+            with open(sol_fname, 'wb') as f:
+                f.write(content[:100])
+            with self.assertRaisesRegex(ValueError, 'invalid record length'):
+                writer.read_sol(sol_fname)
+        self.assertEqual(sol.message, 'Ipopt 3.14.4: Optimal Solution Found')
+        self.assertEqual(sol.options, [1, 1, 0])
+        self.assertEqual((sol.n_cons, sol.n_vars), (2, 2))
+        self.assertEqual((sol.objno, sol.solve_result_num), (0, 0))
+        self.assertEqual(sol.duals.tolist(), [-0.5, 0.25])
+        self.assertEqual(sol.primals.tolist(), [1.5, -1e-07])
+        suffix = sol.get_suffix('ipopt_zU_out')
+        self.assertEqual(suffix.kind, 0)
+        self.assertTrue(suffix.is_real)
+        self.assertEqual(suffix.indices.tolist(), [0])
+        self.assertEqual(suffix.values.tolist(), [-0.125])
+        suffix = sol.get_suffix('sstatus')
+        self.assertEqual(suffix.kind, 1)
+        self.assertFalse(suffix.is_real)
+        self.assertEqual(suffix.indices.tolist(), [0, 1])
+        self.assertEqual(suffix.values.tolist(), [1, 3])
+
+        writer.load_solution(sol)
+        cvars = writer._writer.get_solve_vars()
+        self.assertEqual([v.value for v in cvars], [1.5, -1e-07])
+        ccons = writer._writer.get_solve_cons()
+        self.assertEqual([c.dual for c in ccons], [-0.5, 0.25])
+
+    def test_dual_segment(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var(bounds=(-2, 2))
+        m.y = pe.Var()
+        m.obj = pe.Objective(expr=m.x**2 + m.y**2)
+        m.c1 = pe.Constraint(expr=m.y >= pe.exp(m.x))
+        m.c2 = pe.Constraint(expr=m.x + m.y <= 5)
+        writer = appsi.writers.NLWriter()
+
+        def get_lines():
+            with TempfileManager:
+                fname = TempfileManager.create_tempfile(suffix='.appsi.nl')
+                writer.write(m, fname)
+                with open(fname, 'r') as f:
+                    return f.read().splitlines()
+
+        lines = get_lines()
+        self.assertFalse(any(line.startswith('d') for line in lines))
+        # only nonzero duals are written
+        writer.set_duals([0, -1.5])
+        lines = get_lines()
+        ndx = lines.index('d1')
+        self.assertEqual(lines[ndx + 1], '1 -1.5')
+        self.assertTrue(lines[ndx + 2].startswith('x'))
+        with self.assertRaisesRegex(ValueError, 'got 3 dual values'):
+            writer.set_duals([1, 2, 3])
+
+    def test_jacobian(self):
+        m = pe.ConcreteModel()
+        m.x = pe.Var()
+        m.y = pe.Var()
+        m.z = pe.Var()
+        m.p = pe.Param(initialize=2, mutable=True)
+        m.obj = pe.Objective(expr=m.x**2 + m.z)
+        m.c1 = pe.Constraint(expr=m.p * m.z + 3 * m.x >= 1)
+        m.c2 = pe.Constraint(expr=m.y - 4 * m.x == 0)
+        m.c3 = pe.Constraint(expr=m.y - pe.exp(m.z) >= 0)
+        writer = appsi.writers.NLWriter()
+        with TempfileManager:
+            fname = TempfileManager.create_tempfile(suffix='.appsi.nl')
+            writer.write(m, fname)
+        cons = writer.get_ordered_cons()
+        variables = writer.get_ordered_vars()
+        jac = writer.get_jacobian()
+        self.assertEqual(jac.shape, (3, 3))
+        self.assertEqual(jac.indptr.tolist(), [0, 2, 4, 6])
+        entries = dict()
+        for i, c in enumerate(cons):
+            cols = jac.indices[jac.indptr[i] : jac.indptr[i + 1]].tolist()
+            self.assertEqual(cols, sorted(cols))
+            for k in range(jac.indptr[i], jac.indptr[i + 1]):
+                entries[c.name, variables[jac.indices[k]].name] = jac.values[k]
+        self.assertEqual(
+            entries,
+            {
+                ('c1', 'x'): 3,
+                ('c1', 'z'): 2,
+                ('c2', 'x'): -4,
+                ('c2', 'y'): 1,
+                ('c3', 'y'): 1,
+                ('c3', 'z'): 0,
+            },
+        )
+
+    def test_streaming(self):
+        m = pe.ConcreteModel()
+        m.I = pe.RangeSet(300)
+        m.x = pe.Var(m.I, bounds=(-1, 1))
+        m.p = pe.Param(initialize=2, mutable=True)
+        m.e = pe.Expression(expr=m.x[1] ** 2 + m.x[2])
+        m.f = pe.Expression(expr=pe.sin(m.x[3]))
+        m.obj = pe.Objective(expr=sum(m.x[i] ** 2 for i in m.I) + m.e**2)
+
+        @m.Constraint(m.I)
+        def c(m, i):
+            if i == 1:
+                # m.f is only used by this constraint
+                return m.f * m.e + m.f**2 <= 1
+            if i % 2:
+                return pe.exp(m.x[i]) + m.p * m.x[i % 300 + 1] <= i
+            return m.x[i] + m.x[(3 * i) % 300 + 1] == m.p
+
+        for binary in [False, True]:
+            res = list()
+            for streaming in [False, True]:
+                writer = appsi.writers.NLWriter()
+                writer.config.binary = binary
+                writer.config.streaming = streaming
+                with TempfileManager:
+                    fname = TempfileManager.create_tempfile(suffix='.appsi.nl')
+                    writer.write(m, fname)
+                    with open(fname, 'rb') as f:
+                        res.append(f.read())
+            self.assertEqual(res[0], res[1])
+        with self.assertRaisesRegex(ValueError, 'without streaming'):
+            writer.get_jacobian()
@@ -11,6 +11,7 @@
 
 import os
 import shutil
+import sys
 import tempfile
 
 import pyomo.common.envvar as envvar
@@ -48,11 +49,20 @@ def _generate_configuration():
         os.path.join(mcpp, 'src', '3rdparty', 'fadbad++'),
     ]
 
+    if sys.platform.startswith('win'):
+        extra_compile_args = []
+        extra_link_args = []
+    else:
+        # batched evaluation uses std::thread
+        extra_compile_args = ['-pthread']
+        extra_link_args = ['-pthread']
+
     mcpp_ext = Extension(
         "mcppInterface",
         sources=sources,
         language="c++",
-        extra_compile_args=[],
+        extra_compile_args=extra_compile_args,
+        extra_link_args=extra_link_args,
         include_dirs=include_dirs,
         library_dirs=[],
         libraries=[],
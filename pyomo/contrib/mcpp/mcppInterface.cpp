@@ -12,17 +12,222 @@
 #include "interval.hpp"
 #include "mccormick.hpp"
 #include <sstream>
+#include <algorithm>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 typedef mc::Interval I;
 typedef mc::McCormick<I> MC;
 
-// Module-level variables as utilities to pass information back to Python
-std::string lastException;
-std::string lastDisplay;
+// Per-context buffers used to pass information back to Python. Each
+// caller (e.g., each thread) owns its context, so there is no shared
+// mutable state. The context-free functions use a thread-local default.
+struct MCContext
+{
+    std::string lastException;
+    std::string lastDisplay;
+};
+static thread_local MCContext default_context;
+
+// Opcodes of the postfix programs accepted by mc_evaluate. Each instruction
+// is a pair (opcode, argument) of doubles.
+enum MCOpcode
+{
+    MC_VAR = 0,        // push variable; argument is the variable index
+    MC_CONST = 1,      // push constant; argument is the value
+    MC_ADD = 2,        // pop argument operands, push their sum
+    MC_MULTIPLY = 3,
+    MC_DIVIDE = 4,
+    MC_POWER = 5,      // integer exponent
+    MC_POWERF = 6,     // fractional exponent
+    MC_POWERX = 7,     // exponent is an expression
+    MC_NEGATION = 8,
+    MC_ABS = 9,
+    MC_SQRT = 10,
+    MC_RECIPROCAL = 11,
+    MC_SIN = 12,
+    MC_COS = 13,
+    MC_TAN = 14,
+    MC_ASIN = 15,
+    MC_ACOS = 16,
+    MC_ATAN = 17,
+    MC_EXP = 18,
+    MC_LOG = 19
+};
+
+// Run a postfix program, leaving the result on top of stack. Intermediates
+// live in the stack (no per-operation heap allocation of MC objects).
+// Returns false and sets err on failure.
+static bool run_program(const double *program, int n_ops,
+                        const std::vector<MC> &vars, std::vector<MC> &stack,
+                        std::string &err)
+{
+    stack.clear();
+    try {
+        for (int i = 0; i < n_ops; ++i) {
+            int opcode = (int) program[2*i];
+            double arg = program[2*i + 1];
+            size_t n = stack.size();
+            size_t n_args = 0;
+            switch (opcode) {
+            case MC_VAR:
+            case MC_CONST:
+                break;
+            case MC_ADD:
+                n_args = (size_t) arg;
+                break;
+            case MC_MULTIPLY:
+            case MC_DIVIDE:
+            case MC_POWER:
+            case MC_POWERF:
+            case MC_POWERX:
+                n_args = 2;
+                break;
+            default:
+                n_args = 1;
+            }
+            if (n_args > n || (opcode == MC_ADD && n_args == 0)) {
+                err = "Malformed MC++ program: stack underflow";
+                return false;
+            }
+            switch (opcode) {
+            case MC_VAR:
+                if (arg < 0 || (size_t) arg >= vars.size()) {
+                    err = "Malformed MC++ program: invalid variable index";
+                    return false;
+                }
+                stack.push_back(vars[(size_t) arg]);
+                break;
+            case MC_CONST:
+                stack.push_back(MC(arg));
+                break;
+            case MC_ADD:
+                for (size_t j = n - n_args + 1; j < n; ++j)
+                    stack[n - n_args] += stack[j];
+                stack.resize(n - n_args + 1);
+                break;
+            case MC_MULTIPLY:
+                stack[n-2] = stack[n-2] * stack[n-1];
+                stack.pop_back();
+                break;
+            case MC_DIVIDE:
+                stack[n-2] = stack[n-2] / stack[n-1];
+                stack.pop_back();
+                break;
+            case MC_POWER:
+                stack[n-2] = pow(stack[n-2], (int) stack[n-1].l());
+                stack.pop_back();
+                break;
+            case MC_POWERF:
+                stack[n-2] = pow(stack[n-2], (double) stack[n-1].l());
+                stack.pop_back();
+                break;
+            case MC_POWERX:
+                stack[n-2] = exp(stack[n-1] * log(stack[n-2]));
+                stack.pop_back();
+                break;
+            case MC_NEGATION: stack[n-1] = 0 - stack[n-1]; break;
+            case MC_ABS: stack[n-1] = fabs(stack[n-1]); break;
+            case MC_SQRT: stack[n-1] = sqrt(stack[n-1]); break;
+            case MC_RECIPROCAL: stack[n-1] = inv(stack[n-1]); break;
+            case MC_SIN: stack[n-1] = sin(stack[n-1]); break;
+            case MC_COS: stack[n-1] = cos(stack[n-1]); break;
+            case MC_TAN: stack[n-1] = tan(stack[n-1]); break;
+            case MC_ASIN: stack[n-1] = asin(stack[n-1]); break;
+            case MC_ACOS: stack[n-1] = acos(stack[n-1]); break;
+            case MC_ATAN: stack[n-1] = atan(stack[n-1]); break;
+            case MC_EXP: stack[n-1] = exp(stack[n-1]); break;
+            case MC_LOG: stack[n-1] = log(stack[n-1]); break;
+            default:
+                err = "Malformed MC++ program: unknown opcode";
+                return false;
+            }
+        }
+    } catch (MC::Exceptions &e) {
+        err = e.what();
+        return false;
+    } catch (std::exception &e) {
+        err = e.what();
+        return false;
+    } catch (...) {
+        err = "Unknown error while evaluating MC++ program";
+        return false;
+    }
+    if (stack.size() != 1) {
+        err = "Malformed MC++ program: expected a single result";
+        return false;
+    }
+    return true;
+}
+
+// Layout of out: lower, upper, cv, cc, cv subgradient (n_vars),
+// cc subgradient (n_vars)
+static void store_result(const MC &res, int n_vars, double *out)
+{
+    out[0] = res.l();
+    out[1] = res.u();
+    out[2] = res.cv();
+    out[3] = res.cc();
+    for (int i = 0; i < n_vars; ++i) {
+        bool has_sub = (unsigned int) i < res.nsub();
+        out[4 + i] = has_sub ? res.cvsub(i) : 0.0;
+        out[4 + n_vars + i] = has_sub ? res.ccsub(i) : 0.0;
+    }
+}
+
+static void set_vars(int n_vars, const double *var_bounds,
+                     const double *points, std::vector<MC> &vars)
+{
+    vars.resize(n_vars);
+    for (int i = 0; i < n_vars; ++i) {
+        vars[i] = MC( I( var_bounds[2*i], var_bounds[2*i + 1] ), points[i] );
+        vars[i].sub(n_vars, i);
+    }
+}
+
+// Evaluate points [begin, end) with a workspace private to the caller.
+// On failure, the lowest failing point and its message are recorded.
+// Nothing may be thrown from here: this runs on worker threads, where an
+// uncaught exception would call std::terminate.
+static void evaluate_points(const double *program, int n_ops, int n_vars,
+                            const double *var_bounds, const double *points,
+                            double *out, int begin, int end,
+                            std::mutex *err_mutex, int *err_point,
+                            std::string *err)
+{
+    std::vector<MC> vars;
+    std::vector<MC> stack;
+    std::string msg;
+    int n_out = 4 + 2*n_vars;
+    for (int k = begin; k < end; ++k) {
+        bool ok;
+        try {
+            stack.reserve(n_ops);
+            set_vars(n_vars, var_bounds, points + (size_t) k*n_vars, vars);
+            ok = run_program(program, n_ops, vars, stack, msg);
+        } catch (std::exception &e) {
+            msg = e.what();
+            ok = false;
+        } catch (...) {
+            msg = "Unknown error while evaluating MC++ program";
+            ok = false;
+        }
+        if (!ok) {
+            std::lock_guard<std::mutex> lock(*err_mutex);
+            if (*err_point < 0 || k < *err_point) {
+                *err_point = k;
+                *err = msg;
+            }
+            return;
+        }
+        store_result(stack.back(), n_vars, out + (size_t) k*n_out);
+    }
+}
 
 extern "C"
 {
-    const char* version_string = "19.11.12";
+    const char* version_string = "19.11.12.3";
 
     // Version number
     const char* get_version() {
@@ -88,13 +293,22 @@ extern "C"
     MC* exponential(MC *arg1) {return new MC( exp(*arg1) );}
     MC* logarithm(MC *arg1) {return new MC( log(*arg1) );}
 
-    // Get the MC++ string representation of the MC object
-    const char* toString(MC *arg)
+    // Create and destroy contexts holding error and display buffers
+    MCContext* mc_context_new() { return new MCContext(); }
+    void mc_context_free(MCContext *ctx) { delete ctx; }
+
+    // Get the MC++ string representation of the MC object. The returned
+    // string is valid until the next call using the same context.
+    const char* ctx_toString(MCContext *ctx, MC *arg)
     {
         std::ostringstream Fstrm;
         Fstrm << *arg << std::flush;
-        lastDisplay = Fstrm.str();
-        return lastDisplay.c_str();
+        ctx->lastDisplay = Fstrm.str();
+        return ctx->lastDisplay.c_str();
+    }
+    const char* toString(MC *arg)
+    {
+        return ctx_toString(&default_context, arg);
     }
 
     // Lower and upper interval bounds on expression
@@ -115,27 +329,132 @@ extern "C"
 
     // Catch MC++ exceptions so that we don't core dump,
     // saving the exception message so that Python can retrieve it later.
-    MC* try_unary_fcn(MC*(*fcn)(MC*), MC *arg)
+    MC* ctx_try_unary_fcn(MCContext *ctx, MC*(*fcn)(MC*), MC *arg)
     {
         try {
             return fcn(arg);
         } catch (MC::Exceptions &e) {
-            lastException = e.what();
+            ctx->lastException = e.what();
             return NULL;
         }
     }
-    MC* try_binary_fcn(MC*(*fcn)(MC*, MC*), MC *arg1, MC *arg2)
+    MC* ctx_try_binary_fcn(MCContext *ctx, MC*(*fcn)(MC*, MC*), MC *arg1,
+                           MC *arg2)
     {
         try {
             return fcn(arg1, arg2);
         } catch (MC::Exceptions &e) {
-            lastException = e.what();
+            ctx->lastException = e.what();
             return NULL;
         }
     }
+    MC* try_unary_fcn(MC*(*fcn)(MC*), MC *arg)
+    {
+        return ctx_try_unary_fcn(&default_context, fcn, arg);
+    }
+    MC* try_binary_fcn(MC*(*fcn)(MC*, MC*), MC *arg1, MC *arg2)
+    {
+        return ctx_try_binary_fcn(&default_context, fcn, arg1, arg2);
+    }
+
+    // Evaluate the relaxation of a whole expression, given as a postfix
+    // program of n_ops (opcode, argument) pairs, in a single call.
+    // var_bounds holds (lb, ub) for each variable and points the reference
+    // point. Returns 0 on success; on failure the message is stored in
+    // the context.
+    int ctx_evaluate(MCContext *ctx, const double *program, int n_ops,
+                     int n_vars, const double *var_bounds,
+                     const double *points, double *out)
+    {
+        std::vector<MC> vars;
+        std::vector<MC> stack;
+        try {
+            stack.reserve(n_ops);
+            set_vars(n_vars, var_bounds, points, vars);
+        } catch (std::exception &e) {
+            ctx->lastException = e.what();
+            return 1;
+        }
+        if (!run_program(program, n_ops, vars, stack, ctx->lastException))
+            return 1;
+        store_result(stack.back(), n_vars, out);
+        return 0;
+    }
+    int mc_evaluate(const double *program, int n_ops, int n_vars,
+                    const double *var_bounds, const double *points,
+                    double *out)
+    {
+        return ctx_evaluate(&default_context, program, n_ops, n_vars,
+                            var_bounds, points, out);
+    }
+
+    // Evaluate the relaxation of one program at n_points reference points.
+    // points is row-major (n_points x n_vars) and out receives one
+    // mc_evaluate result row per point. Points are split across n_threads
+    // threads (hardware concurrency if n_threads <= 0), each with its own
+    // workspace. Returns 0 on success.
+    int ctx_evaluate_points(MCContext *ctx, const double *program,
+                            int n_ops, int n_vars, const double *var_bounds,
+                            int n_points, const double *points, double *out,
+                            int n_threads)
+    {
+        if (n_threads <= 0)
+            n_threads = (int) std::thread::hardware_concurrency();
+        n_threads = std::max(1, std::min(n_threads, n_points));
+
+        std::mutex err_mutex;
+        int err_point = -1;
+        std::string err;
+        int chunk = n_points / n_threads;
+        int extra = n_points % n_threads;
+        std::vector<std::thread> threads;
+        int begin = 0;
+        for (int t = 0; t < n_threads; ++t) {
+            int end = begin + chunk + (t < extra ? 1 : 0);
+            if (t == n_threads - 1)
+                evaluate_points(program, n_ops, n_vars, var_bounds, points,
+                                out, begin, end, &err_mutex, &err_point,
+                                &err);
+            else {
+                try {
+                    threads.push_back(std::thread(
+                        evaluate_points, program, n_ops, n_vars, var_bounds,
+                        points, out, begin, end, &err_mutex, &err_point,
+                        &err));
+                } catch (std::exception &) {
+                    // no thread could be started; do the chunk here
+                    evaluate_points(program, n_ops, n_vars, var_bounds,
+                                    points, out, begin, end, &err_mutex,
+                                    &err_point, &err);
+                }
+            }
+            begin = end;
+        }
+        for (size_t t = 0; t < threads.size(); ++t)
+            threads[t].join();
+
+        if (err_point >= 0) {
+            ctx->lastException = err;
+            return 1;
+        }
+        return 0;
+    }
+    int mc_evaluate_points(const double *program, int n_ops, int n_vars,
+                           const double *var_bounds, int n_points,
+                           const double *points, double *out, int n_threads)
+    {
+        return ctx_evaluate_points(&default_context, program, n_ops, n_vars,
+                                   var_bounds, n_points, points, out,
+                                   n_threads);
+    }
+
+    const char* ctx_get_last_exception_message(MCContext *ctx)
+    {
+        return ctx->lastException.c_str();
+    }
     const char* get_last_exception_message()
     {
-        return lastException.c_str();
+        return ctx_get_last_exception_message(&default_context);
     }
 }
 
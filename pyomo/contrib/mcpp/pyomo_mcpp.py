@@ -17,6 +17,7 @@ import ctypes
 import logging
 import os
 
+from pyomo.common.dependencies import numpy as np
 from pyomo.common.fileutils import Library
 from pyomo.core import value, Expression
 from pyomo.core.base.block import SubclassOf
@@ -47,7 +48,7 @@ logger = logging.getLogger('pyomo.contrib.mcpp')
 
 path = os.path.dirname(__file__)
 
-__version__ = "19.11.12"
+__version__ = "19.11.12.3"
 
 
 def mcpp_available():
@@ -189,6 +190,63 @@ def _MCPP_lib():
     # Error message retrieval
     mcpp.get_last_exception_message.restype = ctypes.c_char_p
 
+    # Whole-expression evaluation of a postfix program
+    mcpp.mc_evaluate.argtypes = [
+        ctypes.POINTER(ctypes.c_double),
+        ctypes.c_int,
+        ctypes.c_int,
+        ctypes.POINTER(ctypes.c_double),
+        ctypes.POINTER(ctypes.c_double),
+        ctypes.POINTER(ctypes.c_double),
+    ]
+    mcpp.mc_evaluate.restype = ctypes.c_int
+
+    # Batched evaluation of a postfix program at many points
+    mcpp.mc_evaluate_points.argtypes = [
+        ctypes.POINTER(ctypes.c_double),
+        ctypes.c_int,
+        ctypes.c_int,
+        ctypes.POINTER(ctypes.c_double),
+        ctypes.c_int,
+        ctypes.POINTER(ctypes.c_double),
+        ctypes.POINTER(ctypes.c_double),
+        ctypes.c_int,
+    ]
+    mcpp.mc_evaluate_points.restype = ctypes.c_int
+
+    # Context handles holding per-caller error and display buffers
+    mcpp.mc_context_new.restype = ctypes.c_void_p
+    mcpp.mc_context_free.argtypes = [ctypes.c_void_p]
+
+    mcpp.ctx_toString.argtypes = [ctypes.c_void_p, ctypes.c_void_p]
+    mcpp.ctx_toString.restype = ctypes.c_char_p
+
+    mcpp.ctx_try_unary_fcn.argtypes = [
+        ctypes.c_void_p,
+        ctypes.c_void_p,
+        ctypes.c_void_p,
+    ]
+    mcpp.ctx_try_unary_fcn.restype = ctypes.c_void_p
+
+    mcpp.ctx_try_binary_fcn.argtypes = [
+        ctypes.c_void_p,
+        ctypes.c_void_p,
+        ctypes.c_void_p,
+        ctypes.c_void_p,
+    ]
+    mcpp.ctx_try_binary_fcn.restype = ctypes.c_void_p
+
+    mcpp.ctx_get_last_exception_message.argtypes = [ctypes.c_void_p]
+    mcpp.ctx_get_last_exception_message.restype = ctypes.c_char_p
+
+    mcpp.ctx_evaluate.argtypes = [ctypes.c_void_p] + mcpp.mc_evaluate.argtypes
+    mcpp.ctx_evaluate.restype = ctypes.c_int
+
+    mcpp.ctx_evaluate_points.argtypes = [ctypes.c_void_p] + (
+        mcpp.mc_evaluate_points.argtypes
+    )
+    mcpp.ctx_evaluate_points.restype = ctypes.c_int
+
     return mcpp
 
 
@@ -200,6 +258,71 @@ class MCPP_Error(Exception):
     pass
 
 
+class MCPP_context(object):
+    """Owns an MC++ interface context.
+
+    Error messages and string representations are stored in the context
+    instead of library globals, so objects using different contexts can
+    be used from different threads. A context (and so the MCPP_visitor or
+    McCormickProgram that owns it) must not be used by several threads at
+    once: the library releases the GIL during calls, and the message and
+    display buffers of the context are not synchronized.
+    """
+
+    def __init__(self, mcpp):
+        self.mcpp = mcpp
+        self.handle = mcpp.mc_context_new()
+
+    def __del__(self):
+        if self.handle is not None:
+            self.mcpp.mc_context_free(self.handle)
+            self.handle = None
+
+    def last_exception_message(self):
+        msg = self.mcpp.ctx_get_last_exception_message(self.handle)
+        return msg.decode("utf-8")
+
+
+# Opcodes of the postfix programs accepted by mc_evaluate (see MCOpcode in
+# mcppInterface.cpp)
+MC_VAR = 0
+MC_CONST = 1
+MC_ADD = 2
+MC_MULTIPLY = 3
+MC_DIVIDE = 4
+MC_POWER = 5
+MC_POWERF = 6
+MC_POWERX = 7
+MC_NEGATION = 8
+MC_ABS = 9
+MC_SQRT = 10
+MC_RECIPROCAL = 11
+MC_EXP = 18
+MC_LOG = 19
+
+_unary_opcodes = {
+    'exp': MC_EXP,
+    'log': MC_LOG,
+    'sin': 12,
+    'cos': 13,
+    'tan': 14,
+    'asin': 15,
+    'acos': 16,
+    'atan': 17,
+    'sqrt': MC_SQRT,
+}
+
+
+def _check_version(mcpp):
+    so_file_version = mcpp.get_version()
+    so_file_version = so_file_version.decode("utf-8")
+    if not so_file_version == __version__:
+        raise MCPP_Error(
+            "Shared object file version %s is out of date with MC++ interface version %s. "
+            "Please rebuild the library." % (so_file_version, __version__)
+        )
+
+
 class MCPP_visitor(StreamBasedExpressionVisitor):
     """Creates an MC++ expression from the corresponding Pyomo expression.
 
@@ -216,13 +339,8 @@ class MCPP_visitor(StreamBasedExpressionVisitor):
     def __init__(self, expression, improved_var_bounds=None):
         super(MCPP_visitor, self).__init__()
         self.mcpp = _MCPP_lib()
-        so_file_version = self.mcpp.get_version()
-        so_file_version = so_file_version.decode("utf-8")
-        if not so_file_version == __version__:
-            raise MCPP_Error(
-                "Shared object file version %s is out of date with MC++ interface version %s. "
-                "Please rebuild the library." % (so_file_version, __version__)
-            )
+        _check_version(self.mcpp)
+        self.ctx = MCPP_context(self.mcpp)
         self.missing_value_warnings = []
         self.expr = expression
         vars = list(identify_variables(expression, include_fixed=False))
@@ -258,17 +376,27 @@ class MCPP_visitor(StreamBasedExpressionVisitor):
                 ans = self.mcpp.add(ans, arg)
         elif isinstance(node, PowExpression):
             if type(node.arg(1)) == int:
-                ans = self.mcpp.try_binary_fcn(self.mcpp.power, data[0], data[1])
+                ans = self.mcpp.ctx_try_binary_fcn(
+                    self.ctx.handle, self.mcpp.power, data[0], data[1]
+                )
             elif type(node.arg(1)) == float:
-                ans = self.mcpp.try_binary_fcn(self.mcpp.powerf, data[0], data[1])
+                ans = self.mcpp.ctx_try_binary_fcn(
+                    self.ctx.handle, self.mcpp.powerf, data[0], data[1]
+                )
             else:
-                ans = self.mcpp.try_binary_fcn(self.mcpp.powerx, data[0], data[1])
+                ans = self.mcpp.ctx_try_binary_fcn(
+                    self.ctx.handle, self.mcpp.powerx, data[0], data[1]
+                )
         elif isinstance(node, DivisionExpression):
-            ans = self.mcpp.try_binary_fcn(self.mcpp.divide, data[0], data[1])
+            ans = self.mcpp.ctx_try_binary_fcn(
+                self.ctx.handle, self.mcpp.divide, data[0], data[1]
+            )
         elif isinstance(node, NegationExpression):
             ans = self.mcpp.negation(data[0])
         elif isinstance(node, AbsExpression):
-            ans = self.mcpp.try_unary_fcn(self.mcpp.mc_abs, data[0])
+            ans = self.mcpp.ctx_try_unary_fcn(
+                self.ctx.handle, self.mcpp.mc_abs, data[0]
+            )
         elif isinstance(node, LinearExpression):
             raise NotImplementedError(
                 'Quicksum has bugs that prevent proper usage of MC++.'
@@ -282,23 +410,41 @@ class MCPP_visitor(StreamBasedExpressionVisitor):
             #             self.register_num(var)))
         elif isinstance(node, UnaryFunctionExpression):
             if node.name == "exp":
-                ans = self.mcpp.try_unary_fcn(self.mcpp.exponential, data[0])
+                ans = self.mcpp.ctx_try_unary_fcn(
+                    self.ctx.handle, self.mcpp.exponential, data[0]
+                )
             elif node.name == "log":
-                ans = self.mcpp.try_unary_fcn(self.mcpp.logarithm, data[0])
+                ans = self.mcpp.ctx_try_unary_fcn(
+                    self.ctx.handle, self.mcpp.logarithm, data[0]
+                )
             elif node.name == "sin":
-                ans = self.mcpp.try_unary_fcn(self.mcpp.trigSin, data[0])
+                ans = self.mcpp.ctx_try_unary_fcn(
+                    self.ctx.handle, self.mcpp.trigSin, data[0]
+                )
             elif node.name == "cos":
-                ans = self.mcpp.try_unary_fcn(self.mcpp.trigCos, data[0])
+                ans = self.mcpp.ctx_try_unary_fcn(
+                    self.ctx.handle, self.mcpp.trigCos, data[0]
+                )
             elif node.name == "tan":
-                ans = self.mcpp.try_unary_fcn(self.mcpp.trigTan, data[0])
+                ans = self.mcpp.ctx_try_unary_fcn(
+                    self.ctx.handle, self.mcpp.trigTan, data[0]
+                )
             elif node.name == "asin":
-                ans = self.mcpp.try_unary_fcn(self.mcpp.atrigSin, data[0])
+                ans = self.mcpp.ctx_try_unary_fcn(
+                    self.ctx.handle, self.mcpp.atrigSin, data[0]
+                )
             elif node.name == "acos":
-                ans = self.mcpp.try_unary_fcn(self.mcpp.atrigCos, data[0])
+                ans = self.mcpp.ctx_try_unary_fcn(
+                    self.ctx.handle, self.mcpp.atrigCos, data[0]
+                )
             elif node.name == "atan":
-                ans = self.mcpp.try_unary_fcn(self.mcpp.atrigTan, data[0])
+                ans = self.mcpp.ctx_try_unary_fcn(
+                    self.ctx.handle, self.mcpp.atrigTan, data[0]
+                )
             elif node.name == "sqrt":
-                ans = self.mcpp.try_unary_fcn(self.mcpp.mc_sqrt, data[0])
+                ans = self.mcpp.ctx_try_unary_fcn(
+                    self.ctx.handle, self.mcpp.mc_sqrt, data[0]
+                )
             else:
                 raise NotImplementedError("Unknown unary function: %s" % (node.name,))
         elif isinstance(node, NPV_expressions):
@@ -315,9 +461,7 @@ class MCPP_visitor(StreamBasedExpressionVisitor):
             raise RuntimeError("Unhandled expression type: %s" % (type(node)))
 
         if ans is None:
-            msg = self.mcpp.get_last_exception_message()
-            msg = msg.decode("utf-8")
-            raise MCPP_Error(msg)
+            raise MCPP_Error(self.ctx.last_exception_message())
 
         return ans
 
@@ -436,7 +580,7 @@ class McCormick(object):
             self.mc_expr = None
 
     def __repn__(self):
-        repn = self.mcpp.toString(self.mc_expr)
+        repn = self.mcpp.ctx_toString(self.visitor.ctx.handle, self.mc_expr)
         repn = repn.decode("utf-8")
         return repn
 
@@ -486,3 +630,224 @@ class McCormick(object):
             for message in self.visitor.missing_value_warnings:
                 logger.warning(message)
             self.visitor.missing_value_warnings = []
+
+
+class MCPP_program_visitor(StreamBasedExpressionVisitor):
+    """Serializes a Pyomo expression into a postfix program for mc_evaluate.
+
+    The program is a flat list of (opcode, argument) pairs. Variables are
+    referred to by their position in var_to_idx; fixed variables, params
+    and constant subexpressions are emitted as constants.
+    """
+
+    def __init__(self, var_to_idx):
+        super(MCPP_program_visitor, self).__init__()
+        self.var_to_idx = var_to_idx
+        self.program = []
+
+    def _emit(self, opcode, arg=0):
+        self.program.append(opcode)
+        self.program.append(arg)
+
+    def beforeChild(self, node, child, child_idx):
+        if type(child) in nonpyomo_leaf_types:
+            self._emit(MC_CONST, child)
+            return False, None
+        elif not child.is_expression_type():
+            self._emit_num(child)
+            return False, None
+        elif not child.is_potentially_variable():
+            self._emit(MC_CONST, value(child))
+            return False, None
+        else:
+            return True, None
+
+    def exitNode(self, node, data):
+        if isinstance(node, ProductExpression):
+            self._emit(MC_MULTIPLY)
+        elif isinstance(node, SumExpression):
+            self._emit(MC_ADD, node.nargs())
+        elif isinstance(node, PowExpression):
+            if type(node.arg(1)) == int:
+                self._emit(MC_POWER)
+            elif type(node.arg(1)) == float:
+                self._emit(MC_POWERF)
+            else:
+                self._emit(MC_POWERX)
+        elif isinstance(node, DivisionExpression):
+            self._emit(MC_DIVIDE)
+        elif isinstance(node, NegationExpression):
+            self._emit(MC_NEGATION)
+        elif isinstance(node, AbsExpression):
+            self._emit(MC_ABS)
+        elif isinstance(node, UnaryFunctionExpression):
+            if node.name not in _unary_opcodes:
+                raise NotImplementedError("Unknown unary function: %s" % (node.name,))
+            self._emit(_unary_opcodes[node.name])
+        elif type(node) in nonpyomo_leaf_types:
+            self._emit(MC_CONST, node)
+        elif not node.is_expression_type():
+            self._emit_num(node)
+        elif type(node) in SubclassOf(Expression) or isinstance(
+            node, NamedExpressionData
+        ):
+            pass
+        else:
+            raise RuntimeError("Unhandled expression type: %s" % (type(node)))
+
+    def _emit_num(self, num):
+        if num.is_fixed():
+            self._emit(MC_CONST, value(num))
+        else:
+            self._emit(MC_VAR, self.var_to_idx[num])
+
+
+class McCormickProgram(object):
+    """
+    Compiles a pyomo expression once into a postfix program that is
+    evaluated by MC++ in a single call, without building an MC object
+    graph on the Python side.
+
+    evaluate(self): returns a McCormickResult at the current value() of
+    each variable.
+
+    evaluate_points(self, points, n_threads=0): evaluates the relaxation at
+    each row of points (columns ordered as self.vars) and returns a
+    McCormickResult whose members are NumPy arrays: lower, upper, convex
+    and concave have one entry per point; subcv and subcc are
+    (n_points, n_vars) arrays. Points are split across n_threads threads
+    (all available cores if n_threads <= 0).
+
+    A program must not be shared between Python threads; create one per
+    thread instead (see MCPP_context).
+    """
+
+    def __init__(self, expression, improved_var_bounds=None):
+        self.mcpp = _MCPP_lib()
+        _check_version(self.mcpp)
+        self.ctx = MCPP_context(self.mcpp)
+        self.pyomo_expr = expression
+        self.vars = list(identify_variables(expression, include_fixed=False))
+        self.var_to_idx = ComponentMap((v, i) for i, v in enumerate(self.vars))
+        self.num_vars = len(self.vars)
+
+        inf = float('inf')
+        bounds = []
+        for var in self.vars:
+            if improved_var_bounds is not None:
+                lb, ub = improved_var_bounds.get(var, (-inf, inf))
+            else:
+                lb, ub = -inf, inf
+            lb = -inf if lb is None else lb
+            ub = inf if ub is None else ub
+            lb = max(var.lb if var.has_lb() else -inf, lb)
+            ub = min(var.ub if var.has_ub() else inf, ub)
+            if lb == -inf:
+                lb = -500000
+                logger.warning(
+                    'Var %s missing lower bound. Assuming LB of %s' % (var.name, lb)
+                )
+            if ub == inf:
+                ub = 500000
+                logger.warning(
+                    'Var %s missing upper bound. Assuming UB of %s' % (var.name, ub)
+                )
+            bounds.append(lb)
+            bounds.append(ub)
+        self.var_bounds = (ctypes.c_double * (2 * self.num_vars))(*bounds)
+
+        visitor = MCPP_program_visitor(self.var_to_idx)
+        if type(expression) in nonpyomo_leaf_types or (
+            expression.is_expression_type()
+            and not expression.is_potentially_variable()
+        ):
+            visitor._emit(MC_CONST, value(expression))
+        else:
+            visitor.walk_expression(expression)
+        self.num_ops = len(visitor.program) // 2
+        self.program = (ctypes.c_double * len(visitor.program))(*visitor.program)
+
+    def _current_point(self):
+        point = []
+        for var in self.vars:
+            val = value(var, exception=False)
+            if val is None:
+                i = self.var_to_idx[var]
+                val = (self.var_bounds[2 * i] + self.var_bounds[2 * i + 1]) / 2
+                logger.warning(
+                    'Var %s missing value. Assuming midpoint value of %s'
+                    % (var.name, val)
+                )
+            point.append(val)
+        return point
+
+    def _result(self, out):
+        n = self.num_vars
+        return McCormickResult(
+            lower=out[0],
+            upper=out[1],
+            convex=out[2],
+            concave=out[3],
+            subcv=ComponentMap(zip(self.vars, out[4 : 4 + n])),
+            subcc=ComponentMap(zip(self.vars, out[4 + n : 4 + 2 * n])),
+        )
+
+    def evaluate(self):
+        points = (ctypes.c_double * self.num_vars)(*self._current_point())
+        out = (ctypes.c_double * (4 + 2 * self.num_vars))()
+        if self.mcpp.ctx_evaluate(
+            self.ctx.handle,
+            self.program,
+            self.num_ops,
+            self.num_vars,
+            self.var_bounds,
+            points,
+            out,
+        ):
+            raise MCPP_Error(self.ctx.last_exception_message())
+        return self._result(out)
+
+    def evaluate_points(self, points, n_threads=0):
+        n = self.num_vars
+        points = np.ascontiguousarray(points, dtype=np.float64)
+        if n == 0:
+            # reshape cannot infer the number of points without variables; as
+            # with variables, a 1-D array is a single point
+            points = points.reshape(points.shape[0] if points.ndim > 1 else 1, 0)
+        else:
+            points = points.reshape(-1, n)
+        n_points = points.shape[0]
+        out = np.empty((n_points, 4 + 2 * n), dtype=np.float64)
+        c_double_p = ctypes.POINTER(ctypes.c_double)
+        if self.mcpp.ctx_evaluate_points(
+            self.ctx.handle,
+            self.program,
+            self.num_ops,
+            n,
+            self.var_bounds,
+            n_points,
+            points.ctypes.data_as(c_double_p),
+            out.ctypes.data_as(c_double_p),
+            n_threads,
+        ):
+            raise MCPP_Error(self.ctx.last_exception_message())
+        return McCormickResult(
+            lower=out[:, 0],
+            upper=out[:, 1],
+            convex=out[:, 2],
+            concave=out[:, 3],
+            subcv=out[:, 4 : 4 + n],
+            subcc=out[:, 4 + n : 4 + 2 * n],
+        )
+
+
+class McCormickResult(object):
+    """Interval bounds, relaxation values and subgradients at one point"""
+
+    def __init__(self, lower, upper, convex, concave, subcv, subcc):
+        self.lower = lower
+        self.upper = upper
+        self.convex = convex
+        self.concave = concave
+        self.subcv = subcv
+        self.subcc = subcc
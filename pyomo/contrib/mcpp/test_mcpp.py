@@ -11,14 +11,21 @@
 
 
 import logging
+import math
 from math import pi
 
 from io import StringIO
 
 import pyomo.common.unittest as unittest
 from pyomo.common.log import LoggingIntercept
+from pyomo.common.dependencies import numpy as np, numpy_available
 from pyomo.common.dependencies.matplotlib import pyplot as plt
-from pyomo.contrib.mcpp.pyomo_mcpp import McCormick as mc, mcpp_available, MCPP_Error
+from pyomo.contrib.mcpp.pyomo_mcpp import (
+    McCormick as mc,
+    McCormickProgram,
+    mcpp_available,
+    MCPP_Error,
+)
 from pyomo.core import (
     ConcreteModel,
     Expression,
@@ -226,6 +233,104 @@ class TestMcCormick(unittest.TestCase):
         self.assertAlmostEqual(mc_expr.lower(), 0)
         self.assertAlmostEqual(mc_expr.upper(), 1)
 
+    def test_program(self):
+        m = ConcreteModel()
+        m.x = Var(bounds=(-2, 1), initialize=-1)
+        m.y = Var(bounds=(-1, 2), initialize=0)
+        m.z = Var(bounds=(1, 2), initialize=1.5)
+        m.z.fix()
+        e = m.x * pow(exp(m.x) - m.y, 2) + m.z * cos(m.y) / (m.x + 3)
+        mc_expr = mc(e)
+        res = McCormickProgram(e).evaluate()
+        self.assertAlmostEqual(res.lower, mc_expr.lower())
+        self.assertAlmostEqual(res.upper, mc_expr.upper())
+        self.assertAlmostEqual(res.convex, mc_expr.convex())
+        self.assertAlmostEqual(res.concave, mc_expr.concave())
+        subcv = mc_expr.subcv()
+        subcc = mc_expr.subcc()
+        for v in (m.x, m.y):
+            self.assertAlmostEqual(res.subcv[v], subcv[v])
+            self.assertAlmostEqual(res.subcc[v], subcc[v])
+
+    @unittest.skipUnless(numpy_available, "NumPy is not available")
+    def test_program_points(self):
+        m = ConcreteModel()
+        m.x = Var(bounds=(-2, 1), initialize=-1)
+        m.y = Var(bounds=(-1, 2), initialize=0)
+        e = m.x * pow(exp(m.x) - m.y, 2)
+        prog = McCormickProgram(e)
+        points = np.array(
+            [[x, y] for x in np.linspace(-2, 1, 7) for y in np.linspace(-1, 2, 5)]
+        )
+        res = prog.evaluate_points(points, n_threads=3)
+        self.assertEqual(res.subcv.shape, (35, 2))
+        for k, (x, y) in enumerate(points):
+            m.x.value = x
+            m.y.value = y
+            single = prog.evaluate()
+            self.assertAlmostEqual(res.lower[k], single.lower)
+            self.assertAlmostEqual(res.upper[k], single.upper)
+            self.assertAlmostEqual(res.convex[k], single.convex)
+            self.assertAlmostEqual(res.concave[k], single.concave)
+            for i, v in enumerate(prog.vars):
+                self.assertAlmostEqual(res.subcv[k, i], single.subcv[v])
+                self.assertAlmostEqual(res.subcc[k, i], single.subcc[v])
+
+    @unittest.skipUnless(numpy_available, "NumPy is not available")
+    def test_program_points_without_vars(self):
+        m = ConcreteModel()
+        m.x = Var(bounds=(1, 2), initialize=1.5)
+        m.x.fix()
+        prog = McCormickProgram(m.x * exp(m.x) + 1)
+        self.assertEqual(prog.num_vars, 0)
+        single = prog.evaluate()
+        res = prog.evaluate_points(np.empty((3, 0)))
+        self.assertEqual(res.subcv.shape, (3, 0))
+        self.assertEqual(res.subcc.shape, (3, 0))
+        for k in range(3):
+            self.assertAlmostEqual(res.lower[k], single.lower)
+            self.assertAlmostEqual(res.convex[k], single.convex)
+        res = prog.evaluate_points([])
+        self.assertEqual(res.subcv.shape, (1, 0))
+
+    def test_program_error(self):
+        m = ConcreteModel()
+        m.x = Var(bounds=(-1, 5), initialize=2)
+        with self.assertRaisesRegex(MCPP_Error, '.*Log with negative values in range'):
+            McCormickProgram(log(m.x)).evaluate()
+
+    def test_contexts_across_threads(self):
+        from concurrent.futures import ThreadPoolExecutor
+
+        import threading
+
+        m = ConcreteModel()
+        m.x = Var(bounds=(-1, 5), initialize=2)
+        m.y = Var(bounds=(1, 5), initialize=2)
+        # a context must not be shared between threads, so each thread
+        # compiles its own programs
+        local = threading.local()
+
+        def run(i):
+            if not hasattr(local, 'programs'):
+                local.programs = [
+                    McCormickProgram(log(m.x)),
+                    McCormickProgram(log(m.y)),
+                ]
+            try:
+                return local.programs[i % 2].evaluate().convex
+            except MCPP_Error as e:
+                return str(e)
+
+        with ThreadPoolExecutor(max_workers=4) as pool:
+            results = list(pool.map(run, range(40)))
+        for i, res in enumerate(results):
+            if i % 2:
+                self.assertAlmostEqual(res, math.log(2), places=6)
+            else:
+                self.assertIn('Log with negative values in range', res)
+        self.assertIn('[', str(mc(m.y)))
+
 
 def make2dPlot(expr, numticks=10, show_plot=False):
     mc_ccVals = [None] * (numticks + 1)
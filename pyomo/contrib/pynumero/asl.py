@@ -18,7 +18,7 @@ import os
 
 logger = logging.getLogger(__name__)
 
-CURRENT_INTERFACE_VERSION = 3
+CURRENT_INTERFACE_VERSION = 4
 
 
 class _NotSet:
@@ -60,8 +60,13 @@ def _LoadASLInterface(libname):
         ASLib.EXTERNAL_AmplInterface_new_file.argtypes = [ctypes.c_char_p]
     ASLib.EXTERNAL_AmplInterface_new_file.restype = ctypes.c_void_p
 
-    # ASLib.EXTERNAL_AmplInterface_new_str.argtypes = [ctypes.c_char_p]
-    # ASLib.EXTERNAL_AmplInterface_new_str.restype = ctypes.c_void_p
+    if interface_version >= 4:
+        ASLib.EXTERNAL_AmplInterface_new_str.argtypes = [
+            ctypes.c_char_p,
+            ctypes.c_size_t,
+            ctypes.c_char_p,
+        ]
+        ASLib.EXTERNAL_AmplInterface_new_str.restype = ctypes.c_void_p
 
     # number of variables
     ASLib.EXTERNAL_AmplInterface_n_vars.argtypes = [ctypes.c_void_p]
@@ -257,11 +262,6 @@ class AmplInterface(object):
         if not AmplInterface.available():
             raise RuntimeError("Cannot load the PyNumero ASL interface (pynumero_ASL)")
 
-        if nl_buffer is not None:
-            raise NotImplementedError(
-                "AmplInterface only supported form NL-file for now"
-            )
-
         # Be sure to remove AMPLFUNC from the environment before loading
         # the ASL.  This should prevent it from potentially caching an
         # AMPLFUNC from the initial load and letting it bleed into
@@ -295,11 +295,20 @@ class AmplInterface(object):
                 args = (b_data,)
             self._obj = self.ASLib.EXTERNAL_AmplInterface_new_file(*args)
         elif nl_buffer is not None:
-            b_data = nl_buffer.encode('utf-8')
-            if os.name in ['nt', 'dos']:
-                self._obj = self.ASLib.EXTERNAL_AmplInterface_new_file(b_data)
-            else:
-                self._obj = self.ASLib.EXTERNAL_AmplInterface_new_str(b_data)
+            if self.interface_version < 4:
+                raise NotImplementedError(
+                    "This pynumero_ASL library can only read NL files; "
+                    "please recompile / update your pynumero_ASL library"
+                )
+            if isinstance(nl_buffer, str):
+                nl_buffer = nl_buffer.encode('utf-8')
+            # the ASL reads the buffer in place
+            self._nl_buffer = nl_buffer
+            self._obj = self.ASLib.EXTERNAL_AmplInterface_new_str(
+                nl_buffer, len(nl_buffer), amplfunc.encode('utf-8')
+            )
+        else:
+            raise ValueError("Must specify either filename= or nl_buffer=")
 
         assert self._obj, "Error building ASL interface. Possible error in nl-file"
 
@@ -35,7 +35,7 @@ from pyomo.contrib.pynumero.interfaces.nlp import ExtendedNLP
 # TODO: only create and cache data for ExtendedNLP methods if they are ever asked for
 # TODO: There are todos in the code below
 class AslNLP(ExtendedNLP):
-    def __init__(self, nl_file):
+    def __init__(self, nl_file=None, nl_buffer=None):
         """
         Base class for NLP classes based on the Ampl Solver Library and
         NL files.
@@ -44,6 +44,10 @@ class AslNLP(ExtendedNLP):
         ----------
         nl_file : string
             filename of the NL-file containing the model
+        nl_buffer : bytes
+            content of an NL file (e.g., from the appsi NLWriter); used
+            instead of nl_file so the model does not go through the
+            filesystem
         """
         super(AslNLP, self).__init__()
 
@@ -51,7 +55,10 @@ class AslNLP(ExtendedNLP):
         self._nl_file = nl_file
 
         # initialize the ampl interface
-        self._asl = _asl.AmplInterface(self._nl_file)
+        if nl_buffer is not None:
+            self._asl = _asl.AmplInterface(nl_buffer=nl_buffer)
+        else:
+            self._asl = _asl.AmplInterface(self._nl_file)
 
         # collect the NLP structure and key data
         self._collect_nlp_structure()
@@ -430,6 +430,12 @@ class TestAslNLP(unittest.TestCase):
         self.assertIsNone(anlp.get_eq_constraints_scaling())
         self.assertIsNone(anlp.get_ineq_constraints_scaling())
 
+    def test_nlp_interface_from_buffer(self):
+        with open(self.filename + '.nl', 'rb') as f:
+            nl_buffer = f.read()
+        anlp = AslNLP(nl_buffer=nl_buffer)
+        execute_extended_nlp_interface(self, anlp)
+
 
 class TestAmplNLP(unittest.TestCase):
     @classmethod
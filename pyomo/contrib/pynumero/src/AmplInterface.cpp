@@ -16,6 +16,8 @@
 
 #include <vector>
 #include <string>
+#include <cstdio>
+#include <cstdlib>
 
 AmplInterface::AmplInterface()
    : _p_asl(NULL),      // pointer to the ASL struct
@@ -450,22 +452,56 @@ AmplInterfaceStr::AmplInterfaceStr(char* nl, size_t size)
      nl_size(size)
 {}
 
-// THIS METHOD IS DISABLED FOR NOW
+AmplInterfaceStr::~AmplInterfaceStr()
+{
+   if (!tmp_filename.empty()) {
+      std::remove(tmp_filename.c_str());
+   }
+}
+
 FILE* AmplInterfaceStr::open_nl(ASL_pfgh *asl, char* stub)
 {
    // Ignore the stub and use the cached NL file content
-   //#if defined(__APPLE__) && defined(__MACH__)
-   //FILE* nl = fmemopen(this->nl_content, this->nl_size, "rb");
-   //return jac0dim_FILE(nl);
-   return NULL;
-   //   #elif defined(_WIN32)
-   //return NULL;
-   //#else
-   //FILE* nl = fmemopen(this->nl_content, this->nl_size, "rb");
-   //return jac0dim_FILE(nl);
-   //return NULL;
-   //#endif
-
+#if defined(jac0dim_FILE) && !defined(_WIN32) && !defined(_WIN64)
+   FILE* nl = fmemopen(this->nl_content, this->nl_size, "rb");
+   _ASSERT_EXIT_(nl, "Could not open the NL buffer.");
+   return jac0dim_FILE(nl);
+#else
+   // This ASL can only read the header from a named file: copy the
+   // content to a temporary file (removed by the destructor). This is the
+   // only case in which the NL content goes through the file system.
+#if defined(_WIN32) || defined(_WIN64)
+   char name[L_tmpnam_s];
+   _ASSERT_EXIT_(tmpnam_s(name, L_tmpnam_s) == 0,
+                 "Could not create a temporary NL file.");
+   tmp_filename = std::string(name) + ".nl";
+   FILE* tmp = fopen(tmp_filename.c_str(), "wb");
+#else
+   // honor TMPDIR, as Python's tempfile module does
+   const char* dir = std::getenv("TMPDIR");
+   if (dir == NULL || dir[0] == '\0') {
+#ifdef P_tmpdir
+      dir = P_tmpdir;
+#else
+      dir = "/tmp";
+#endif
+   }
+   std::string templ = std::string(dir) + "/pynumero_XXXXXX";
+   std::vector<char> name(templ.begin(), templ.end());
+   name.push_back('\0');
+   int fd = mkstemp(name.data());
+   _ASSERT_EXIT_(fd != -1, "Could not create a temporary NL file.");
+   tmp_filename = name.data();
+   FILE* tmp = fdopen(fd, "wb");
+#endif
+   _ASSERT_EXIT_(tmp, "Could not create a temporary NL file.");
+   size_t n_written = fwrite(this->nl_content, 1, this->nl_size, tmp);
+   fclose(tmp);
+   _ASSERT_EXIT_(n_written == this->nl_size,
+                 "Could not write the temporary NL file.");
+   return jac0dim(const_cast<char*>(tmp_filename.c_str()),
+                  (int) tmp_filename.size());
+#endif
 }
 
 extern "C" {
@@ -477,8 +513,9 @@ extern "C" {
           2: added EXTERNAL_AmplInterface_version
              added amplfunc argument to EXTERNAL_AmplInterface_new_file
           3: added EXTERNAL_get_asl_date
+          4: implemented EXTERNAL_AmplInterface_new_str
        **/
-      return 3;
+      return 4;
    }
 
    PYNUMERO_ASL_EXPORT AmplInterface*
@@ -13,6 +13,7 @@
 #define __AMPLINTERFACE_HPP__
 
 #include <iostream>
+#include <string>
 
 #if defined(_WIN32) || defined(_WIN64)
 #  if defined(BUILDING_PYNUMERO_ASL)
@@ -147,12 +148,15 @@ public:
 class PYNUMERO_ASL_EXPORT AmplInterfaceStr : public AmplInterface {
 public:
     AmplInterfaceStr(char* nl, size_t size);
+    virtual ~AmplInterfaceStr();
 
     virtual FILE* open_nl(ASL_pfgh *asl, char *stub);
 
 private:
     char *nl_content;
     size_t nl_size;
+    // only used with ASL versions that cannot read from a FILE*
+    std::string tmp_filename;
 };
 
 #endif
@@ -0,0 +1,87 @@
+#  ___________________________________________________________________________
+#
+#  Pyomo: Python Optimization Modeling Objects
+#  Copyright (c) 2008-2024
+#  National Technology and Engineering Solutions of Sandia, LLC
+#  Under the terms of Contract DE-NA0003525 with National Technology and
+#  Engineering Solutions of Sandia, LLC, the U.S. Government retains certain
+#  rights in this software.
+#  This software is distributed under the 3-clause BSD License.
+#  ___________________________________________________________________________
+
+"""
+Compare the peak memory (RSS) of writing a large NL file with the appsi NL
+writer with and without streaming. Each mode runs in its own process
+because the peak RSS of a process never goes down.
+
+    python appsi_nl_memory.py [n_vars]
+"""
+
+import os
+import resource
+import subprocess
+import sys
+import tempfile
+import time
+
+import pyomo.environ as pe
+from pyomo.contrib import appsi
+
+
+def build_model(n):
+    m = pe.ConcreteModel()
+    m.I = pe.RangeSet(n)
+    m.J = pe.RangeSet(10)
+    m.x = pe.Var(m.I, bounds=(-1, 1))
+    m.obj = pe.Objective(expr=sum(m.x[i] ** 2 for i in m.I))
+    m.c = pe.Constraint(
+        m.I,
+        rule=lambda m, i: sum(
+            (j + 0.5) * m.x[(i * 7919 + j * 104729) % n + 1] for j in m.J
+        )
+        + pe.exp(m.x[i])
+        >= -i,
+    )
+    return m
+
+
+def peak_rss_mb():
+    # ru_maxrss is in KB on Linux and in bytes on macOS
+    rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    if sys.platform == 'darwin':
+        rss /= 1024
+    return rss / 1024
+
+
+def run(n, streaming):
+    m = build_model(n)
+    writer = appsi.writers.NLWriter()
+    writer.config.streaming = streaming
+    with tempfile.TemporaryDirectory() as tmpdir:
+        fname = os.path.join(tmpdir, 'model.nl')
+        writer.set_instance(m)
+        before = peak_rss_mb()
+        t0 = time.perf_counter()
+        writer.write(m, fname)
+        elapsed = time.perf_counter() - t0
+        size = os.path.getsize(fname) / 2**20
+    print(
+        f'{"streaming" if streaming else "default"}: {size:.1f} MB file, '
+        f'peak RSS {before:.0f} MB before writing, {peak_rss_mb():.0f} MB '
+        f'after; {elapsed:.2f} s'
+    )
+
+
+def main(n=200000):
+    for streaming in (False, True):
+        subprocess.run(
+            [sys.executable, __file__, '--run', str(n), str(int(streaming))],
+            check=True,
+        )
+
+
+if __name__ == '__main__':
+    if len(sys.argv) > 1 and sys.argv[1] == '--run':
+        run(int(sys.argv[2]), bool(int(sys.argv[3])))
+    else:
+        main(*[int(i) for i in sys.argv[1:]])